@@ -14,7 +14,11 @@ namespace Atlas::Editor::UI {
         meshComponent.mesh = meshSelectionPanel.Render(meshComponent.mesh, resourceChanged);
 
         ImGui::Checkbox("Visible", &meshComponent.visible);
-        ImGui::Checkbox("Don't cull", &meshComponent.dontCull);
+        // The space partitioning only picks up the change with the next transform update
+        if (ImGui::Checkbox("Don't cull", &meshComponent.dontCull) && entity.HasComponent<TransformComponent>()) {
+            auto& transformComponent = entity.GetComponent<TransformComponent>();
+            transformComponent.Set(transformComponent.matrix);
+        }
 
         if (meshComponent.mesh.IsLoaded()) {
             auto& mesh = meshComponent.mesh;
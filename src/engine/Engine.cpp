@@ -97,8 +97,8 @@ namespace Atlas {
 
     void Engine::Shutdown() {
 
-        JobSystem::Shutdown();
         Graphics::ShaderCompiler::Shutdown();
+        Loader::ShaderLoader::Clear();
         Graphics::Profiler::Shutdown();
         PipelineManager::Shutdown();
         Physics::PhysicsManager::Shutdown();
@@ -108,6 +108,9 @@ namespace Atlas {
 
         Events::EventManager::ShutdownEventDelegate.Fire();
 
+        // Audio streams and the physics system wait on their jobs when they are destroyed
+        JobSystem::Shutdown();
+
 #ifdef AE_NO_APP
         SDL_Quit();
 #endif
@@ -117,6 +120,7 @@ namespace Atlas {
 
         Clock::Update();
         Graphics::Profiler::BeginFrame();
+        JobProfiler::BeginFrame();
         Events::EventManager::Update();
         PipelineManager::Update();
         Audio::AudioManager::Update();
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "../System.h"
+
+#include <atomic>
+#include <vector>
+#include <type_traits>
+
+namespace Atlas {
+
+    namespace Audio {
+
+        /*
+         * Bounded lock-free single producer, single consumer ring buffer. Push() and Pop() never
+         * block or allocate, so the consumer can be the real-time audio thread. Elements need to be
+         * trivially copyable, such that no destructor runs on the consumer thread.
+         */
+        template<typename T>
+        class AudioCommandQueue {
+
+            static_assert(std::is_trivially_copyable_v<T>, "Audio command queue elements need to be trivially copyable");
+
+        public:
+            explicit AudioCommandQueue(size_t capacity = 4096);
+
+            AudioCommandQueue(const AudioCommandQueue&) = delete;
+
+            AudioCommandQueue& operator=(const AudioCommandQueue&) = delete;
+
+            bool Push(const T& item);
+
+            bool Pop(T& item);
+
+            bool IsEmpty() const;
+
+        private:
+            std::vector<T> items;
+            size_t mask;
+
+            // Keep the indices on separate cache lines, each one is only written by one side
+            alignas(64) std::atomic<size_t> head = 0;
+            alignas(64) std::atomic<size_t> tail = 0;
+
+        };
+
+        template<typename T>
+        AudioCommandQueue<T>::AudioCommandQueue(size_t capacity) {
+
+            // Capacity needs to be a power of two for the index mask to work
+            size_t powerOfTwoCapacity = 1;
+            while (powerOfTwoCapacity < capacity)
+                powerOfTwoCapacity <<= 1;
+
+            items.resize(powerOfTwoCapacity);
+            mask = powerOfTwoCapacity - 1;
+
+        }
+
+        template<typename T>
+        bool AudioCommandQueue<T>::Push(const T& item) {
+
+            auto currentTail = tail.load(std::memory_order_relaxed);
+            if (currentTail - head.load(std::memory_order_acquire) >= items.size())
+                return false;
+
+            items[currentTail & mask] = item;
+            tail.store(currentTail + 1, std::memory_order_release);
+
+            return true;
+
+        }
+
+        template<typename T>
+        bool AudioCommandQueue<T>::Pop(T& item) {
+
+            auto currentHead = head.load(std::memory_order_relaxed);
+            if (currentHead == tail.load(std::memory_order_acquire))
+                return false;
+
+            item = items[currentHead & mask];
+            head.store(currentHead + 1, std::memory_order_release);
+
+            return true;
+
+        }
+
+        template<typename T>
+        bool AudioCommandQueue<T>::IsEmpty() const {
+
+            return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+
+        }
+
+    }
+
+}
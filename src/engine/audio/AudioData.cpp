@@ -6,6 +6,8 @@
 #include "../loader/AssetLoader.h"
 
 #include <SDL_audio.h>
+#include <algorithm>
+#include <cstring>
 
 namespace Atlas {
 
@@ -19,35 +21,20 @@ namespace Atlas {
 
         AudioData::AudioData(const std::string& filename) : filename(filename) {
 
-            uint8_t* data;
-            uint32_t length;
-
-            auto stream = Loader::AssetLoader::ReadFile(filename, std::ios::in | std::ios::binary);
+            Load();
 
-            if (!stream.is_open()) {
-                throw ResourceLoadException(filename, "Couldn't open file stream");
-            }
-
-            auto filedata = Loader::AssetLoader::GetFileContent(stream);
-
-            auto rw = SDL_RWFromMem(filedata.data(), (int32_t)filedata.size());
+        }
 
-            if (!rw) {
-                throw ResourceLoadException(filename, "Couldn't get RWOPS interface");
-            }
+        AudioData::AudioData(const std::string& filename, bool streamed, size_t streamBufferSize)
+            : filename(filename), streamBufferSize(streamBufferSize) {
 
-            if (!SDL_LoadWAV_RW(rw, 1, &spec, &data, &length)) {
-                throw ResourceLoadException(filename, "Couldn't load audio data");
-            }
+            if (streamed && OpenStream())
+                return;
 
-            this->data.resize(length / 2);
+            if (streamed)
+                Log::Warning("Audio file " + filename + " can't be streamed and is loaded at once");
 
-            std::memcpy(this->data.data(), data, length);
-
-            SDL_FreeWAV(data);
-
-            // Automatically apply format on load
-            isValid = ApplyFormat(AudioManager::audioSpec);
+            Load();
 
         }
 
@@ -113,6 +100,141 @@ namespace Atlas {
 
         }
 
+        int64_t AudioData::GetFrameCount() {
+
+            if (isStreamed)
+                return sourceFrameCount * int64_t(spec.freq) / int64_t(sourceSpec.freq);
+
+            return spec.channels ? int64_t(data.size()) / int64_t(spec.channels) : 0;
+
+        }
+
+        bool AudioData::IsStreamed() const {
+
+            return isStreamed;
+
+        }
+
+        void AudioData::Load() {
+
+            uint8_t* data;
+            uint32_t length;
+
+            auto stream = Loader::AssetLoader::ReadFile(filename, std::ios::in | std::ios::binary);
+
+            if (!stream.is_open()) {
+                throw ResourceLoadException(filename, "Couldn't open file stream");
+            }
+
+            auto filedata = Loader::AssetLoader::GetFileContent(stream);
+
+            auto rw = SDL_RWFromMem(filedata.data(), (int32_t)filedata.size());
+
+            if (!rw) {
+                throw ResourceLoadException(filename, "Couldn't get RWOPS interface");
+            }
+
+            if (!SDL_LoadWAV_RW(rw, 1, &spec, &data, &length)) {
+                throw ResourceLoadException(filename, "Couldn't load audio data");
+            }
+
+            this->data.resize(length / 2);
+
+            std::memcpy(this->data.data(), data, length);
+
+            SDL_FreeWAV(data);
+
+            // Automatically apply format on load
+            isValid = ApplyFormat(AudioManager::audioSpec);
+
+        }
+
+        bool AudioData::OpenStream() {
+
+            auto stream = Loader::AssetLoader::ReadFile(filename, std::ios::in | std::ios::binary);
+
+            if (!stream.is_open()) {
+                throw ResourceLoadException(filename, "Couldn't open file stream");
+            }
+
+            char header[12];
+            if (!stream.read(header, sizeof(header)) || std::memcmp(header, "RIFF", 4) != 0 ||
+                std::memcmp(header + 8, "WAVE", 4) != 0)
+                return false;
+
+            uint16_t formatTag = 0, channels = 0, bitsPerSample = 0;
+            uint32_t frequency = 0, dataSize = 0;
+            bool hasFormat = false, hasData = false;
+
+            // Walk the chunks until the samples are found, only the format is of interest
+            char chunkId[4];
+            uint32_t chunkSize;
+            while (stream.read(chunkId, 4) && stream.read(reinterpret_cast<char*>(&chunkSize), 4)) {
+                if (std::memcmp(chunkId, "fmt ", 4) == 0 && chunkSize >= 16) {
+                    uint8_t format[40] = {};
+                    auto readSize = std::min(chunkSize, uint32_t(sizeof(format)));
+                    stream.read(reinterpret_cast<char*>(format), readSize);
+
+                    std::memcpy(&formatTag, format, sizeof(uint16_t));
+                    std::memcpy(&channels, format + 2, sizeof(uint16_t));
+                    std::memcpy(&frequency, format + 4, sizeof(uint32_t));
+                    std::memcpy(&bitsPerSample, format + 14, sizeof(uint16_t));
+
+                    // The extensible format stores the actual format tag at the start of the sub format
+                    if (formatTag == 0xFFFE && chunkSize >= 26)
+                        std::memcpy(&formatTag, format + 24, sizeof(uint16_t));
+
+                    hasFormat = true;
+                    stream.seekg(std::streamoff(chunkSize - readSize + (chunkSize & 1)), std::ios::cur);
+                }
+                else if (std::memcmp(chunkId, "data", 4) == 0) {
+                    sourceDataOffset = int64_t(stream.tellg());
+                    dataSize = chunkSize;
+                    hasData = true;
+                    break;
+                }
+                else {
+                    // Chunks are padded to an even size
+                    stream.seekg(std::streamoff(chunkSize + (chunkSize & 1)), std::ios::cur);
+                }
+            }
+
+            if (!hasFormat || !hasData || !channels || !frequency)
+                return false;
+
+            SDL_AudioFormat sourceFormat;
+            if (formatTag == 1 && bitsPerSample == 8)
+                sourceFormat = AUDIO_U8;
+            else if (formatTag == 1 && bitsPerSample == 16)
+                sourceFormat = AUDIO_S16LSB;
+            else if (formatTag == 1 && bitsPerSample == 32)
+                sourceFormat = AUDIO_S32LSB;
+            else if (formatTag == 3 && bitsPerSample == 32)
+                sourceFormat = AUDIO_F32LSB;
+            else
+                return false;
+
+            std::memset(&sourceSpec, 0, sizeof(SDL_AudioSpec));
+            sourceSpec.freq = int32_t(frequency);
+            sourceSpec.format = sourceFormat;
+            sourceSpec.channels = uint8_t(channels);
+
+            sourceFrameCount = int64_t(dataSize) / int64_t(channels * bitsPerSample / 8);
+
+            // Blocks are converted to the output format while streaming
+            const auto& outputSpec = AudioManager::audioSpec;
+            std::memset(&spec, 0, sizeof(SDL_AudioSpec));
+            spec.freq = outputSpec.freq;
+            spec.format = outputSpec.format;
+            spec.channels = outputSpec.channels;
+
+            isStreamed = true;
+            isValid = outputSpec.freq > 0 && outputSpec.channels > 0;
+
+            return true;
+
+        }
+
     }
 
 }
\ No newline at end of file
@@ -19,6 +19,17 @@ namespace Atlas {
 
             explicit AudioData(const std::string& filename);
 
+            /**
+             * Constructs an AudioData object.
+             * @param filename The filename of a wav file
+             * @param streamed Whether the clip should be streamed instead of being decoded at once.
+             * Streamed clips are decoded block by block while they play, which keeps the memory
+             * usage low and lets long clips start immediately. Only PCM wav files can be streamed,
+             * other files are decoded at once.
+             * @param streamBufferSize The size of the decode buffer of each playing stream in bytes
+             */
+            AudioData(const std::string& filename, bool streamed, size_t streamBufferSize = 256 * 1024);
+
             bool ApplyFormat(const SDL_AudioSpec& formatSpec);
 
             bool Convert(uint32_t frequency, uint8_t channels, uint32_t format);
@@ -29,20 +40,39 @@ namespace Atlas {
 
             int32_t GetFrequency();
 
+            /**
+             * Returns the number of frames of the clip in the output format.
+             */
+            int64_t GetFrameCount();
+
+            bool IsStreamed() const;
+
             std::vector<int16_t> data;
 
             const std::string filename;
 
         private:
+            void Load();
+
+            bool OpenStream();
+
             SDL_AudioSpec spec;
 
             bool isValid;
 
+            // Location and format of the encoded samples for streaming
+            bool isStreamed = false;
+            size_t streamBufferSize = 0;
+            SDL_AudioSpec sourceSpec;
+            int64_t sourceDataOffset = 0;
+            int64_t sourceFrameCount = 0;
+
             friend class AudioManager;
             friend class AudioStream;
+            friend class AudioStreamBuffer;
 
         };
 
     }
 
-}
\ No newline at end of file
+}
@@ -3,6 +3,7 @@
 
 #include <SDL_audio.h>
 #include <algorithm>
+#include <cstring>
 
 namespace Atlas {
 
@@ -11,10 +12,16 @@ namespace Atlas {
         SDL_AudioSpec AudioManager::audioSpec;
         SDL_AudioDeviceID AudioManager::audioDevice;
 
+        Scope<AudioMixer> AudioManager::mixer;
+
         std::vector<Ref<AudioStream>> AudioManager::audioStreams;
+        std::vector<AudioManager::RetiredResource> AudioManager::retiredResources;
 
         std::mutex AudioManager::mutex;
-        
+
+        int32_t AudioManager::maxVoiceCount = 4096;
+        int32_t AudioManager::maxRealVoiceCount = 128;
+
         bool AudioManager::Configure(int32_t frequency, uint8_t channels, uint32_t samples) {
 
             std::lock_guard<std::mutex> guard(mutex);
@@ -35,6 +42,10 @@ namespace Atlas {
                 if (audioSpec.format != AUDIO_S16LSB)
                     return false;
 
+                // The device is opened paused, so the callback can't run yet
+                mixer = std::make_unique<AudioMixer>(audioSpec.freq, int32_t(audioSpec.channels),
+                    int32_t(audioSpec.samples), maxVoiceCount, maxRealVoiceCount);
+
                 Resume();
 
                 return true;
@@ -51,21 +62,27 @@ namespace Atlas {
 
             Pause();
 
-            audioStreams.clear();
-
+            // Waits for a running callback to finish
             SDL_CloseAudioDevice(audioDevice);
 
+            mixer.reset();
+
+            retiredResources.clear();
+            audioStreams.clear();
+
         }
 
         void AudioManager::Mute() {
 
-
+            if (mixer)
+                mixer->muted = true;
 
         }
 
         void AudioManager::Unmute() {
 
-
+            if (mixer)
+                mixer->muted = false;
 
         }
 
@@ -96,64 +113,116 @@ namespace Atlas {
 
             std::unique_lock<std::mutex> lock(mutex);
 
+            uint64_t processedCommandCount = mixer ? mixer->GetProcessedCommandCount() : 0;
+            std::erase_if(retiredResources, [&](const RetiredResource& resource) {
+                return resource.commandCount <= processedCommandCount;
+            });
+
             for (size_t i = 0; i < audioStreams.size(); i++) {
                 auto& ref = audioStreams[i];
                 if (ref.use_count() == 1) {
+                    if (ref->isMixed) {
+                        // Try again with the next update if the command queue is full
+                        if (!mixer->RemoveStream(ref.get()))
+                            continue;
+                        retiredResources.push_back({ mixer->GetSubmittedCommandCount(), ref, nullptr, nullptr });
+                    }
+
                     ref.swap(audioStreams.back());
                     audioStreams.pop_back();
                     i--;
+                    continue;
                 }
+
+                if (mixer)
+                    SyncStream(ref);
             }
 
         }
 
-        void AudioManager::Callback(void* userData, uint8_t* streamData, int32_t length) {
+        int32_t AudioManager::GetRealVoiceCount() {
 
-            // We only use 16 bit audio internally
-            length /= 2;
+            return mixer ? mixer->GetRealVoiceCount() : 0;
 
-            std::vector<int16_t> dest(length, 0);
-            std::vector<int16_t> chunk(length, 0);
+        }
 
-            std::unique_lock<std::mutex> lock(mutex);
-            auto localStreams = audioStreams;
-            lock.unlock();
+        int32_t AudioManager::GetVirtualVoiceCount() {
 
-            // Take ownership of stream here, such that the update can run in parallel
-            for (const auto& stream : localStreams) {
+            return mixer ? mixer->GetVirtualVoiceCount() : 0;
 
-                if (!stream->IsValid() || stream->IsPaused())
-                    continue;
+        }
 
-                if (!stream->GetChunk(chunk))
-                    continue;
+        void AudioManager::Callback(void* userData, uint8_t* streamData, int32_t length) {
 
-                Mix(dest, chunk);
+            // We only use 16 bit audio internally
+            auto frameCount = length / int32_t(sizeof(int16_t) * audioSpec.channels);
+            mixer->Mix(reinterpret_cast<int16_t*>(streamData), frameCount);
 
-            }
+        }
 
-            std::memcpy(streamData, dest.data(), length * 2);
+        bool AudioManager::SyncStream(const Ref<AudioStream>& stream) {
 
-        }
+            if (!stream->isMixed) {
+                if (!mixer->AddStream(stream.get()))
+                    return false;
+                stream->isMixed = true;
+            }
 
-        void AudioManager::Mix(std::vector<int16_t>& dest, const std::vector<int16_t>& src) {
+            if (stream->loop != stream->mixerLoop) {
+                if (!mixer->SetStreamLoop(stream.get(), stream->loop))
+                    return false;
+                stream->mixerLoop = stream->loop;
+            }
 
-            const int16_t maxAudioValue = ((1 << (16 - 1)) - 1);
-            const int16_t minAudioValue = -(1 << (16 - 1));
+            Ref<AudioData> data = nullptr;
+            {
+                std::lock_guard<std::mutex> streamLock(stream->mutex);
+                if (stream->IsValid())
+                    data = stream->data.Get();
+            }
 
-            for (uint64_t i = 0; i < dest.size(); i++) {
+            // The stream keeps the data alive for the mixer, old data is kept until the mixer switched
+            if (data != stream->mixerData) {
+                // Each stream decodes into its own buffer, since streamed data can be played multiple times at once
+                Ref<AudioStreamBuffer> buffer = nullptr;
+                if (data && data->IsStreamed()) {
+                    buffer = CreateRef<AudioStreamBuffer>(data);
+                    if (!mixer->SetStreamBuffer(stream.get(), buffer.get()))
+                        return false;
+                }
+                else {
+                    auto samples = data ? data->data.data() : nullptr;
+                    auto frameCount = data ? int64_t(data->data.size()) / int64_t(data->GetChannelCount()) : 0;
+                    if (!mixer->SetStreamData(stream.get(), samples, frameCount))
+                        return false;
+                }
 
-                auto sample = dest[i] + src[i];
-            
-                sample = sample > maxAudioValue ? maxAudioValue : sample;
-                sample = sample < minAudioValue ? minAudioValue : sample;
+                if (stream->mixerData)
+                    retiredResources.push_back({ mixer->GetSubmittedCommandCount(), nullptr,
+                        stream->mixerData, stream->mixerBuffer });
+                stream->mixerData = data;
+                stream->mixerBuffer = buffer;
+            }
 
-                dest[i] = sample;
-            
+            auto progress = stream->requestedProgress.exchange(-1.0);
+            // Streamed data can only seek through its buffer
+            if (progress >= 0.0 && stream->mixerBuffer) {
+                stream->mixerBuffer->Seek(int64_t(progress));
+            }
+            else if (progress >= 0.0 && !mixer->SetStreamProgress(stream.get(), progress)) {
+                // Keep the request unless a newer one came in meanwhile
+                double noRequest = -1.0;
+                stream->requestedProgress.compare_exchange_strong(noRequest, progress);
+                return false;
             }
 
+            if (stream->mixerBuffer)
+                stream->mixerBuffer->Update(stream->loop);
+
+            return true;
+
         }
 
     }
 
-}
\ No newline at end of file
+}
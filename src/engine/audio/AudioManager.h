@@ -3,6 +3,7 @@
 #include "../System.h"
 
 #include "AudioStream.h"
+#include "AudioMixer.h"
 
 #include <SDL_audio.h>
 
@@ -13,6 +14,10 @@ namespace Atlas {
 
     namespace Audio {
 
+        /**
+         * Owns the audio device and the mixer. Streams are created and released on the game side,
+         * Update() forwards their changes to the mixer. The device callback only runs the mixer.
+         */
         class AudioManager {
 
         public:
@@ -30,17 +35,39 @@ namespace Atlas {
 
             static Ref<AudioStream> CreateStream(ResourceHandle<AudioData> data, float volume = 1.0f, bool loop = false);
 
+            /**
+             * Synchronizes the streams with the mixer and releases streams which aren't referenced anymore.
+             * Needs to be called from a single thread.
+             */
             static void Update();
 
+            static int32_t GetRealVoiceCount();
+
+            static int32_t GetVirtualVoiceCount();
+
+            static int32_t maxVoiceCount;
+            static int32_t maxRealVoiceCount;
+
         private:
+            // Keeps resources alive until the mixer processed the command which stopped referencing them
+            struct RetiredResource {
+                uint64_t commandCount;
+                Ref<AudioStream> stream;
+                Ref<AudioData> data;
+                Ref<AudioStreamBuffer> buffer;
+            };
+
             static void Callback(void* userData, uint8_t* stream, int32_t length);
 
-            static void Mix(std::vector<int16_t>& dest, const std::vector<int16_t>& src);
+            static bool SyncStream(const Ref<AudioStream>& stream);
 
             static SDL_AudioSpec audioSpec;
             static SDL_AudioDeviceID audioDevice;
 
+            static Scope<AudioMixer> mixer;
+
             static std::vector<Ref<AudioStream>> audioStreams;
+            static std::vector<RetiredResource> retiredResources;
 
             static std::mutex mutex;
 
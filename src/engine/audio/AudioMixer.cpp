@@ -0,0 +1,528 @@
+#include "AudioMixer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AE_AUDIO_SSE
+#include <emmintrin.h>
+#endif
+
+namespace Atlas {
+
+    namespace Audio {
+
+        // Slightly below full scale, such that the conversion to 16 bit never clips
+        static constexpr float limiterThreshold = 0.98f;
+        static constexpr float limiterReleaseTime = 0.05f;
+
+        static constexpr float sampleScale = 1.0f / 32768.0f;
+        static constexpr double fixedPointScale = 4294967296.0;
+
+        // Limits the frames a streamed voice reads per block, such that the window has a fixed size
+        static constexpr double maxBufferPitch = 4.0;
+
+        AudioMixer::AudioMixer(int32_t frequency, int32_t channelCount, int32_t maxFrameCount,
+            int32_t maxVoiceCount, int32_t maxRealVoiceCount) : frequency(frequency), channelCount(channelCount),
+            maxFrameCount(maxFrameCount), maxRealVoiceCount(maxRealVoiceCount), commands(size_t(maxVoiceCount) * 4) {
+
+            AE_ASSERT(channelCount > 0 && channelCount <= 8 && "Unsupported channel count");
+
+            voices.resize(maxVoiceCount);
+            candidates.resize(maxVoiceCount);
+            scratch.resize(size_t(maxFrameCount) * channelCount);
+            block.resize(size_t(maxFrameCount) * channelCount);
+            bufferWindow.resize((size_t(maxBufferPitch) * maxFrameCount + 2) * channelCount);
+
+            limiterRelease = 1.0f - std::exp(-1.0f / (limiterReleaseTime * float(frequency)));
+
+        }
+
+        bool AudioMixer::AddStream(AudioStream* stream) {
+
+            return Submit({ .type = CommandType::AddStream, .stream = stream });
+
+        }
+
+        bool AudioMixer::RemoveStream(AudioStream* stream) {
+
+            return Submit({ .type = CommandType::RemoveStream, .stream = stream });
+
+        }
+
+        bool AudioMixer::SetStreamData(AudioStream* stream, const int16_t* samples, int64_t frameCount) {
+
+            return Submit({ .type = CommandType::SetData, .stream = stream,
+                .samples = samples, .frameCount = samples ? frameCount : 0 });
+
+        }
+
+        bool AudioMixer::SetStreamBuffer(AudioStream* stream, AudioStreamBuffer* buffer) {
+
+            AE_ASSERT((!buffer || buffer->GetChannelCount() == channelCount) && "Channel count of buffer doesn't match");
+
+            return Submit({ .type = CommandType::SetBuffer, .stream = stream, .buffer = buffer });
+
+        }
+
+        bool AudioMixer::SetStreamProgress(AudioStream* stream, double progress) {
+
+            return Submit({ .type = CommandType::SetProgress, .stream = stream, .progress = progress });
+
+        }
+
+        bool AudioMixer::SetStreamLoop(AudioStream* stream, bool loop) {
+
+            return Submit({ .type = CommandType::SetLoop, .stream = stream, .loop = loop });
+
+        }
+
+        void AudioMixer::Mix(float* output, int32_t frameCount) {
+
+            for (int32_t offset = 0; offset < frameCount; offset += maxFrameCount) {
+                auto count = std::min(frameCount - offset, maxFrameCount);
+                MixBlock(output + size_t(offset) * channelCount, count);
+            }
+
+        }
+
+        void AudioMixer::Mix(int16_t* output, int32_t frameCount) {
+
+            for (int32_t offset = 0; offset < frameCount; offset += maxFrameCount) {
+                auto count = std::min(frameCount - offset, maxFrameCount);
+                MixBlock(block.data(), count);
+                Convert(block.data(), output + size_t(offset) * channelCount, int64_t(count) * channelCount);
+            }
+
+        }
+
+        uint64_t AudioMixer::GetSubmittedCommandCount() const {
+
+            return submittedCommandCount;
+
+        }
+
+        uint64_t AudioMixer::GetProcessedCommandCount() const {
+
+            return processedCommandCount.load(std::memory_order_acquire);
+
+        }
+
+        int32_t AudioMixer::GetRealVoiceCount() const {
+
+            return realVoiceCount.load(std::memory_order_relaxed);
+
+        }
+
+        int32_t AudioMixer::GetVirtualVoiceCount() const {
+
+            return virtualVoiceCount.load(std::memory_order_relaxed);
+
+        }
+
+        int32_t AudioMixer::GetFrequency() const {
+
+            return frequency;
+
+        }
+
+        int32_t AudioMixer::GetChannelCount() const {
+
+            return channelCount;
+
+        }
+
+        bool AudioMixer::Submit(const Command& command) {
+
+            if (!commands.Push(command))
+                return false;
+
+            submittedCommandCount++;
+            return true;
+
+        }
+
+        void AudioMixer::ProcessCommands() {
+
+            Command command;
+            uint64_t processedCount = 0;
+
+            while (commands.Pop(command)) {
+                processedCount++;
+
+                auto stream = command.stream;
+                if (command.type == CommandType::AddStream) {
+                    if (stream->voiceIdx >= 0 || voiceCount == int32_t(voices.size()))
+                        continue;
+
+                    stream->voiceIdx = voiceCount;
+                    voices[voiceCount++] = {
+                        .stream = stream,
+                        .samples = nullptr,
+                        .frameCount = 0,
+                        .progress = stream->progress.load(std::memory_order_relaxed),
+                        .loop = false,
+                        .buffer = nullptr,
+                        .bufferFraction = 0.0,
+                        .bufferGeneration = 0
+                    };
+                    continue;
+                }
+
+                // Commands for streams which couldn't be added are dropped
+                if (stream->voiceIdx < 0)
+                    continue;
+
+                auto& voice = voices[stream->voiceIdx];
+                switch (command.type) {
+                case CommandType::RemoveStream: {
+                    auto voiceIdx = stream->voiceIdx;
+                    voice = voices[--voiceCount];
+                    voice.stream->voiceIdx = voiceIdx;
+                    stream->voiceIdx = -1;
+                    break;
+                }
+                case CommandType::SetData:
+                    voice.samples = command.samples;
+                    voice.frameCount = command.frameCount;
+                    voice.buffer = nullptr;
+                    break;
+                case CommandType::SetBuffer:
+                    voice.samples = nullptr;
+                    voice.buffer = command.buffer;
+                    voice.frameCount = command.buffer ? command.buffer->GetFrameCount() : 0;
+                    voice.progress = 0.0;
+                    voice.bufferFraction = 0.0;
+                    voice.bufferGeneration = 0;
+                    stream->progress.store(0.0, std::memory_order_relaxed);
+                    break;
+                case CommandType::SetProgress:
+                    voice.progress = command.progress;
+                    stream->progress.store(command.progress, std::memory_order_relaxed);
+                    break;
+                case CommandType::SetLoop:
+                    voice.loop = command.loop;
+                    break;
+                default: break;
+                }
+            }
+
+            // Tells the producer that resources referenced by earlier commands can be released
+            if (processedCount)
+                processedCommandCount.fetch_add(processedCount, std::memory_order_release);
+
+        }
+
+        void AudioMixer::MixBlock(float* output, int32_t frameCount) {
+
+            ProcessCommands();
+
+            int32_t candidateCount = 0;
+            int32_t silentCount = 0;
+            for (int32_t i = 0; i < voiceCount; i++) {
+                auto& voice = voices[i];
+                auto stream = voice.stream;
+
+                if ((!voice.samples && !voice.buffer) || stream->pause.load(std::memory_order_relaxed))
+                    continue;
+
+                // Inaudible streams only keep their time going
+                auto volume = stream->volume.load(std::memory_order_relaxed);
+                if (volume <= 0.0f) {
+                    auto pitch = stream->pitch.load(std::memory_order_relaxed);
+                    if (voice.buffer)
+                        ReadBuffer(voice, pitch, nullptr, frameCount);
+                    else
+                        Advance(voice, pitch, frameCount);
+                    silentCount++;
+                    continue;
+                }
+
+                candidates[candidateCount++] = { i, volume * stream->priority.load(std::memory_order_relaxed) };
+            }
+
+            // Only the most important streams are mixed, the others are virtualized
+            auto mixedCount = std::min(candidateCount, maxRealVoiceCount);
+            if (candidateCount > mixedCount) {
+                std::nth_element(candidates.begin(), candidates.begin() + mixedCount,
+                    candidates.begin() + candidateCount, [](const Candidate& candidate0, const Candidate& candidate1) {
+                        return candidate0.priority > candidate1.priority;
+                    });
+            }
+
+            auto sampleCount = int64_t(frameCount) * channelCount;
+            std::fill(output, output + sampleCount, 0.0f);
+
+            float gains[8];
+            for (int32_t i = 0; i < mixedCount; i++) {
+                auto& voice = voices[candidates[i].voiceIdx];
+                auto stream = voice.stream;
+
+                auto volume = stream->volume.load(std::memory_order_relaxed);
+                for (int32_t j = 0; j < channelCount; j++)
+                    gains[j] = volume * stream->channelVolume[j].load(std::memory_order_relaxed);
+
+                auto pitch = stream->pitch.load(std::memory_order_relaxed);
+                if (voice.buffer)
+                    ReadBuffer(voice, pitch, scratch.data(), frameCount);
+                else
+                    Resample(voice, pitch, scratch.data(), frameCount);
+                Accumulate(output, scratch.data(), gains, channelCount, sampleCount);
+            }
+
+            for (int32_t i = mixedCount; i < candidateCount; i++) {
+                auto& voice = voices[candidates[i].voiceIdx];
+                auto pitch = voice.stream->pitch.load(std::memory_order_relaxed);
+                // Streamed voices need to consume their frames even if they aren't mixed
+                if (voice.buffer)
+                    ReadBuffer(voice, pitch, nullptr, frameCount);
+                else
+                    Advance(voice, pitch, frameCount);
+            }
+
+            for (int32_t i = 0; i < voiceCount; i++)
+                voices[i].stream->progress.store(voices[i].progress, std::memory_order_relaxed);
+
+            realVoiceCount.store(mixedCount, std::memory_order_relaxed);
+            virtualVoiceCount.store(candidateCount - mixedCount + silentCount, std::memory_order_relaxed);
+
+            auto gain = muted.load(std::memory_order_relaxed) ? 0.0f : masterVolume.load(std::memory_order_relaxed);
+            Limit(output, frameCount, gain);
+
+        }
+
+        void AudioMixer::Advance(Voice& voice, double pitch, int32_t frameCount) {
+
+            if (pitch <= 0.0 || voice.frameCount == 0)
+                return;
+
+            voice.progress += pitch * double(frameCount);
+
+            auto end = double(voice.frameCount);
+            if (voice.progress >= end)
+                voice.progress = voice.loop ? std::fmod(voice.progress, end) : end;
+
+        }
+
+        void AudioMixer::Resample(Voice& voice, double pitch, float* dest, int32_t frameCount) {
+
+            const auto channels = channelCount;
+
+            int32_t writtenCount = 0;
+            while (pitch > 0.0 && writtenCount < frameCount) {
+                if (voice.progress >= double(voice.frameCount)) {
+                    if (!voice.loop || voice.frameCount == 0)
+                        break;
+                    voice.progress = std::fmod(voice.progress, double(voice.frameCount));
+                }
+
+                auto remainingCount = frameCount - writtenCount;
+                auto baseIdx = int64_t(voice.progress);
+                auto fraction = voice.progress - double(baseIdx);
+                auto out = dest + int64_t(writtenCount) * channels;
+
+                // Without pitch the samples only need to be converted until the end of the data
+                if (pitch == 1.0 && fraction == 0.0) {
+                    auto count = int32_t(std::min(int64_t(remainingCount), voice.frameCount - baseIdx));
+                    Convert(voice.samples + baseIdx * channels, out, int64_t(count) * channels);
+
+                    voice.progress += double(count);
+                    writtenCount += count;
+                    continue;
+                }
+
+                // Frames until the lower sample passes the end of the data, such that the loop needs no checks
+                auto count = int32_t(std::min(double(remainingCount),
+                    std::ceil((double(voice.frameCount) - voice.progress) / pitch)));
+                count = std::max(count, 1);
+
+                // Step in 32.32 fixed point instead of double math per frame
+                auto step = uint64_t(pitch * fixedPointScale);
+                auto position = uint64_t(fraction * fixedPointScale);
+
+                auto lastIdx = voice.frameCount - 1;
+                auto wrapIdx = voice.loop ? 0 : lastIdx;
+
+                auto frameIdx = [&](uint64_t position) { return baseIdx + int64_t(position >> 32); };
+                auto nextIdx = [&](int64_t idx) { return idx < lastIdx ? idx + 1 : wrapIdx; };
+                auto weight = [](uint64_t position) { return float(uint32_t(position)) * float(1.0 / fixedPointScale); };
+
+                int32_t i = 0;
+#ifdef AE_AUDIO_SSE
+                // Two stereo frames at once, each one can be loaded as a single 32 bit word
+                if (channels == 2) {
+                    auto loadFrames = [&](int64_t idx0, int64_t idx1) {
+                        int32_t frame0, frame1;
+                        std::memcpy(&frame0, voice.samples + idx0 * 2, sizeof(int32_t));
+                        std::memcpy(&frame1, voice.samples + idx1 * 2, sizeof(int32_t));
+
+                        auto words = _mm_unpacklo_epi32(_mm_cvtsi32_si128(frame0), _mm_cvtsi32_si128(frame1));
+                        return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(words, words), 16));
+                    };
+
+                    auto scale = _mm_set1_ps(sampleScale);
+                    for (; i + 2 <= count; i += 2) {
+                        auto position1 = position + step;
+
+                        auto lower0 = frameIdx(position), lower1 = frameIdx(position1);
+                        auto lower = loadFrames(lower0, lower1);
+                        auto upper = loadFrames(nextIdx(lower0), nextIdx(lower1));
+
+                        auto weight0 = weight(position), weight1 = weight(position1);
+                        auto weights = _mm_setr_ps(weight0, weight0, weight1, weight1);
+
+                        auto result = _mm_add_ps(lower, _mm_mul_ps(weights, _mm_sub_ps(upper, lower)));
+                        _mm_storeu_ps(out + i * 2, _mm_mul_ps(result, scale));
+
+                        position = position1 + step;
+                    }
+                }
+#endif
+                for (; i < count; i++) {
+                    auto lowerIdx = frameIdx(position);
+                    auto lowerSamples = voice.samples + lowerIdx * channels;
+                    auto upperSamples = voice.samples + nextIdx(lowerIdx) * channels;
+                    auto t = weight(position);
+
+                    for (int32_t j = 0; j < channels; j++) {
+                        auto lowerSample = float(lowerSamples[j]);
+                        auto upperSample = float(upperSamples[j]);
+                        out[i * channels + j] = (lowerSample + t * (upperSample - lowerSample)) * sampleScale;
+                    }
+
+                    position += step;
+                }
+
+                voice.progress = double(baseIdx) + double(position) / fixedPointScale;
+                writtenCount += count;
+            }
+
+            // Streams which aren't looping stay silent at their end
+            std::fill(dest + int64_t(writtenCount) * channels, dest + int64_t(frameCount) * channels, 0.0f);
+
+        }
+
+        void AudioMixer::ReadBuffer(Voice& voice, double pitch, float* dest, int32_t frameCount) {
+
+            auto buffer = voice.buffer;
+            if (buffer->CheckGeneration(voice.bufferGeneration, voice.progress))
+                voice.bufferFraction = 0.0;
+
+            // The window holds all frames the block steps over plus the upper frame of the last interpolation
+            pitch = std::min(pitch, maxBufferPitch);
+            auto windowFrameCount = int64_t(voice.bufferFraction + std::max(pitch, 0.0) * double(frameCount)) + 2;
+
+            // Missing frames are played as silence, the buffer catches up within the next blocks
+            Voice window = {
+                .stream = voice.stream,
+                .samples = bufferWindow.data(),
+                .frameCount = buffer->Peek(bufferWindow.data(), windowFrameCount),
+                .progress = voice.bufferFraction,
+                .loop = false
+            };
+
+            if (dest)
+                Resample(window, pitch, dest, frameCount);
+            else
+                Advance(window, pitch, frameCount);
+
+            // The frame at the lower end of the next interpolation stays in the buffer
+            auto consumedCount = std::min(int64_t(window.progress), window.frameCount);
+            buffer->Consume(consumedCount);
+
+            voice.progress += window.progress - voice.bufferFraction;
+            voice.bufferFraction = window.progress - double(consumedCount);
+
+            // The buffer wraps around on its own, the progress only needs to follow it
+            auto end = double(voice.frameCount);
+            if (voice.progress >= end && end > 0.0)
+                voice.progress = voice.loop ? std::fmod(voice.progress, end) : end;
+
+        }
+
+        void AudioMixer::Limit(float* samples, int32_t frameCount, float gain) {
+
+            // Peak limiter with instant attack, such that the output never exceeds the threshold
+            for (int32_t i = 0; i < frameCount; i++) {
+                auto frame = samples + int64_t(i) * channelCount;
+
+                float peak = 0.0f;
+                for (int32_t j = 0; j < channelCount; j++)
+                    peak = std::max(peak, std::abs(frame[j]));
+                peak *= gain;
+
+                auto targetGain = peak > limiterThreshold ? limiterThreshold / peak : 1.0f;
+                if (targetGain < limiterGain)
+                    limiterGain = targetGain;
+                else
+                    limiterGain += (targetGain - limiterGain) * limiterRelease;
+
+                auto frameGain = gain * limiterGain;
+                for (int32_t j = 0; j < channelCount; j++)
+                    frame[j] *= frameGain;
+            }
+
+        }
+
+        void AudioMixer::Convert(const int16_t* src, float* dest, int64_t count) {
+
+            int64_t i = 0;
+#ifdef AE_AUDIO_SSE
+            auto scale = _mm_set1_ps(sampleScale);
+            for (; i + 8 <= count; i += 8) {
+                auto words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                // Sign extend by moving the words into the upper half and shifting them back down
+                auto low = _mm_srai_epi32(_mm_unpacklo_epi16(words, words), 16);
+                auto high = _mm_srai_epi32(_mm_unpackhi_epi16(words, words), 16);
+                _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+                _mm_storeu_ps(dest + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+            }
+#endif
+            for (; i < count; i++)
+                dest[i] = float(src[i]) * sampleScale;
+
+        }
+
+        void AudioMixer::Accumulate(float* dest, const float* src, const float* gains, int32_t channelCount, int64_t count) {
+
+            int64_t i = 0;
+#ifdef AE_AUDIO_SSE
+            // The gains repeat every four samples if the channel count divides four
+            if (4 % channelCount == 0) {
+                auto gain = _mm_setr_ps(gains[0], gains[1 % channelCount],
+                    gains[2 % channelCount], gains[3 % channelCount]);
+                for (; i + 4 <= count; i += 4) {
+                    auto sum = _mm_add_ps(_mm_loadu_ps(dest + i), _mm_mul_ps(_mm_loadu_ps(src + i), gain));
+                    _mm_storeu_ps(dest + i, sum);
+                }
+            }
+#endif
+            for (; i < count; i++)
+                dest[i] += src[i] * gains[i % channelCount];
+
+        }
+
+        void AudioMixer::Convert(const float* src, int16_t* dest, int64_t count) {
+
+            int64_t i = 0;
+#ifdef AE_AUDIO_SSE
+            auto scale = _mm_set1_ps(32767.0f);
+            auto min = _mm_set1_ps(-1.0f);
+            auto max = _mm_set1_ps(1.0f);
+            for (; i + 8 <= count; i += 8) {
+                auto low = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), min), max);
+                auto high = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), min), max);
+                auto words = _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(low, scale)),
+                    _mm_cvtps_epi32(_mm_mul_ps(high, scale)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), words);
+            }
+#endif
+            for (; i < count; i++)
+                dest[i] = int16_t(std::lround(std::clamp(src[i], -1.0f, 1.0f) * 32767.0f));
+
+        }
+
+    }
+
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include "../System.h"
+
+#include "AudioStream.h"
+#include "AudioStreamBuffer.h"
+#include "AudioCommandQueue.h"
+
+#include <vector>
+#include <atomic>
+
+namespace Atlas {
+
+    namespace Audio {
+
+        /**
+         * Mixes audio streams into an interleaved output buffer. All buffers are allocated on construction
+         * and Mix() neither allocates nor locks, so it can run on the real-time audio thread. Streams are
+         * added, removed and changed through a lock-free command queue, which is processed at the start of
+         * each block. The commands need to be submitted from a single thread. The mixer isn't bound to a
+         * device, which means it can render to memory as well.
+         */
+        class AudioMixer {
+
+        public:
+            /**
+             * Constructs an AudioMixer object.
+             * @param frequency The sample rate of the output
+             * @param channelCount The number of interleaved output channels, which needs to match the stream data
+             * @param maxFrameCount The maximum number of frames mixed at once, larger requests are split
+             * @param maxVoiceCount The maximum number of streams known to the mixer
+             * @param maxRealVoiceCount The maximum number of streams which are actually mixed per block
+             */
+            AudioMixer(int32_t frequency, int32_t channelCount, int32_t maxFrameCount,
+                int32_t maxVoiceCount = 4096, int32_t maxRealVoiceCount = 128);
+
+            AudioMixer(const AudioMixer&) = delete;
+
+            AudioMixer& operator=(const AudioMixer&) = delete;
+
+            bool AddStream(AudioStream* stream);
+
+            bool RemoveStream(AudioStream* stream);
+
+            /**
+             * Sets the samples a stream plays from.
+             * @param stream The stream
+             * @param samples Interleaved samples with the channel count of the mixer or nullptr.
+             * The samples need to stay valid until GetProcessedCommandCount() passes the command count
+             * of a following SetStreamData() or RemoveStream().
+             * @param frameCount The number of frames in samples
+             */
+            bool SetStreamData(AudioStream* stream, const int16_t* samples, int64_t frameCount);
+
+            /**
+             * Lets a stream play from a streaming buffer instead of samples. The progress of the
+             * stream restarts at the beginning, seeks need to go through the buffer.
+             * @param stream The stream
+             * @param buffer The buffer with the channel count of the mixer or nullptr. It has the same
+             * lifetime requirements as the samples of SetStreamData().
+             */
+            bool SetStreamBuffer(AudioStream* stream, AudioStreamBuffer* buffer);
+
+            bool SetStreamProgress(AudioStream* stream, double progress);
+
+            bool SetStreamLoop(AudioStream* stream, bool loop);
+
+            /**
+             * Mixes the next frames of all streams into the output.
+             * @param output Interleaved output with room for frameCount * channelCount samples
+             * @param frameCount The number of frames to be mixed
+             */
+            void Mix(float* output, int32_t frameCount);
+
+            void Mix(int16_t* output, int32_t frameCount);
+
+            /**
+             * Returns the number of commands submitted so far. All commands return false
+             * if the queue is full, in which case they aren't counted.
+             */
+            uint64_t GetSubmittedCommandCount() const;
+
+            uint64_t GetProcessedCommandCount() const;
+
+            int32_t GetRealVoiceCount() const;
+
+            int32_t GetVirtualVoiceCount() const;
+
+            int32_t GetFrequency() const;
+
+            int32_t GetChannelCount() const;
+
+            std::atomic<float> masterVolume = 1.0f;
+            std::atomic_bool muted = false;
+
+        private:
+            enum class CommandType {
+                AddStream = 0,
+                RemoveStream,
+                SetData,
+                SetBuffer,
+                SetProgress,
+                SetLoop
+            };
+
+            struct Command {
+                CommandType type;
+                AudioStream* stream;
+
+                const int16_t* samples;
+                AudioStreamBuffer* buffer;
+                int64_t frameCount;
+                double progress;
+                bool loop;
+            };
+
+            struct Voice {
+                AudioStream* stream;
+
+                const int16_t* samples;
+                int64_t frameCount;
+
+                double progress;
+                bool loop;
+
+                // Streamed voices read from the buffer, the fraction is the position between the first two frames
+                AudioStreamBuffer* buffer;
+                double bufferFraction;
+                uint32_t bufferGeneration;
+            };
+
+            struct Candidate {
+                int32_t voiceIdx;
+                float priority;
+            };
+
+            bool Submit(const Command& command);
+
+            void ProcessCommands();
+
+            void MixBlock(float* output, int32_t frameCount);
+
+            void Advance(Voice& voice, double pitch, int32_t frameCount);
+
+            void Resample(Voice& voice, double pitch, float* dest, int32_t frameCount);
+
+            void ReadBuffer(Voice& voice, double pitch, float* dest, int32_t frameCount);
+
+            void Limit(float* samples, int32_t frameCount, float gain);
+
+            static void Convert(const int16_t* src, float* dest, int64_t count);
+
+            static void Accumulate(float* dest, const float* src, const float* gains, int32_t channelCount, int64_t count);
+
+            static void Convert(const float* src, int16_t* dest, int64_t count);
+
+            int32_t frequency;
+            int32_t channelCount;
+            int32_t maxFrameCount;
+            int32_t maxRealVoiceCount;
+
+            AudioCommandQueue<Command> commands;
+            uint64_t submittedCommandCount = 0;
+            std::atomic_uint64_t processedCommandCount = 0;
+
+            // Only accessed by the mixing thread
+            std::vector<Voice> voices;
+            int32_t voiceCount = 0;
+
+            std::vector<Candidate> candidates;
+            std::vector<float> scratch;
+            std::vector<float> block;
+            std::vector<int16_t> bufferWindow;
+
+            float limiterGain = 1.0f;
+            float limiterRelease;
+
+            std::atomic_int32_t realVoiceCount = 0;
+            std::atomic_int32_t virtualVoiceCount = 0;
+
+        };
+
+    }
+
+}
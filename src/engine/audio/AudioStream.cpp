@@ -1,20 +1,30 @@
 #include "AudioStream.h"
 
 namespace Atlas {
-    
+
     namespace Audio {
 
+        AudioStream::AudioStream() {
+
+            for (auto& value : channelVolume)
+                value.store(1.0f);
+
+        }
+
         AudioStream::AudioStream(ResourceHandle<Atlas::Audio::AudioData> data, float volume, bool loop)
             : loop(loop), data(data), volume(volume) {
 
-            channelVolume.fill(1.0f);
+            for (auto& value : channelVolume)
+                value.store(1.0f);
 
         }
 
         void AudioStream::ChangeData(ResourceHandle<AudioData> data) {
 
+            std::lock_guard<std::mutex> lock(mutex);
+
             this->data = data;
-            progress = 0.0;
+            requestedProgress = 0.0;
 
         }
 
@@ -22,7 +32,7 @@ namespace Atlas {
 
             std::lock_guard<std::mutex> lock(mutex);
 
-            return (double)data->data.size() * 2.0 / (double)(data->GetFrequency() * data->GetSampleSize());
+            return (double)data->GetFrameCount() / (double)data->GetFrequency();
 
         }
 
@@ -33,8 +43,8 @@ namespace Atlas {
             if (!data.IsLoaded())
                 return;
 
-            progress = time * (double)(data->GetFrequency() * data->GetSampleSize() / data->GetChannelCount()) / 2.0;
-            progress = progress >= 0.0 ? progress : 0.0;
+            auto newProgress = time * (double)(data->GetFrequency() * data->GetSampleSize() / data->GetChannelCount()) / 2.0;
+            requestedProgress = newProgress >= 0.0 ? newProgress : 0.0;
 
         }
 
@@ -45,22 +55,23 @@ namespace Atlas {
             if (!data.IsLoaded())
                 return 0.0;
 
-            return 2.0 * progress * (double)data->GetChannelCount() / 
+            // A time change might not have reached the mixer yet
+            auto currentProgress = requestedProgress.load();
+            if (currentProgress < 0.0)
+                currentProgress = progress.load();
+
+            return 2.0 * currentProgress * (double)data->GetChannelCount() /
                 (double)(data->GetFrequency() * data->GetSampleSize());
 
         }
 
         void AudioStream::SetVolume(float volume) {
 
-            std::lock_guard<std::mutex> lock(mutex);
-
             this->volume = volume;
 
         }
-        
-        float AudioStream::GetVolume() const {
 
-            std::lock_guard<std::mutex> lock(mutex);
+        float AudioStream::GetVolume() const {
 
             return volume;
 
@@ -68,36 +79,40 @@ namespace Atlas {
 
         void AudioStream::SetChannelVolume(Channel channel, float volume) {
 
-            std::lock_guard<std::mutex> lock(mutex);
-
             this->channelVolume[channel] = volume;
 
         }
 
         float AudioStream::GetChannelVolume(Channel channel) const {
 
-            std::lock_guard<std::mutex> lock(mutex);
-
             return this->channelVolume[channel];
 
         }
 
         void AudioStream::SetPitch(double pitch) {
 
-            std::lock_guard<std::mutex> lock(mutex);
-
             this->pitch = pitch;
 
         }
 
         double AudioStream::GetPitch() const {
 
-            std::lock_guard<std::mutex> lock(mutex);
-
             return pitch;
 
         }
 
+        void AudioStream::SetPriority(float priority) {
+
+            this->priority = priority;
+
+        }
+
+        float AudioStream::GetPriority() const {
+
+            return priority;
+
+        }
+
         void AudioStream::Pause() {
 
             pause = true;
@@ -122,75 +137,6 @@ namespace Atlas {
 
         }
 
-        bool AudioStream::GetChunk(std::vector<int16_t>& chunk) {
-
-            if (!data.IsLoaded())
-                return false;
-
-            std::lock_guard<std::mutex> lock(mutex);
-
-            if (volume == 0.0f)
-                return false;
-
-            int32_t length = int32_t(chunk.size());
-            std::memset(chunk.data(), 0, chunk.size() * 2);
-
-            auto channels = (int32_t)data->GetChannelCount();
-            length /= channels;
-
-            auto sampleCount = (double)data->data.size() / (double)channels - 1.0;
-            auto preMultipliedChannelVolume = channelVolume;
-
-            for (int32_t i = 0; i < channels; i++) {
-                preMultipliedChannelVolume[i] *= volume;
-            }
-
-            for (int32_t i = 0; i < length; i++) {
-
-                if (progress >= sampleCount) {
-                    if (loop)
-                        progress = fmod(progress, sampleCount);
-                    else
-                        break;
-                }
-
-                if (pitch == 1.0) {
-                    auto index = int32_t(progress) * channels;
-
-                    for (int32_t j = 0; j < channels; j++) {
-                        auto sample = float(data->data[index + j]);
-
-                        sample *= preMultipliedChannelVolume[j];
-
-                        chunk[i * channels + j] = (int16_t) sample;
-                    }
-                }
-                else {
-                    auto upperIndex = (int32_t) ceil(progress) * channels;
-                    auto lowerIndex = (int32_t) floor(progress) * channels;
-
-                    auto remainder = progress - floor(progress);
-
-                    for (int32_t j = 0; j < channels; j++) {
-
-                        auto sample = (double) data->data[lowerIndex + j] + remainder *
-                            ((double) data->data[upperIndex + j] - (double) data->data[lowerIndex + j]);
-
-                        sample *= preMultipliedChannelVolume[j];
-
-                        chunk[i * channels + j] = (int16_t) sample;
-
-                    }
-                }
-
-                progress += pitch;
-
-            }
-
-            return true;
-
-        }
-
     }
-    
-}
\ No newline at end of file
+
+}
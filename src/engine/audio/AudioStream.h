@@ -8,6 +8,7 @@
 #include <vector>
 #include <array>
 #include <atomic>
+#include <mutex>
 
 namespace Atlas {
 
@@ -18,10 +19,18 @@ namespace Atlas {
             Right = 1
         };
 
+        class AudioMixer;
+        class AudioManager;
+        class AudioStreamBuffer;
+
+        /**
+         * A playing instance of audio data. The playback parameters can be changed from any thread,
+         * the mixer picks them up with the next audio block without any locking on the audio thread.
+         */
         class AudioStream {
 
         public:
-            AudioStream()  { channelVolume.fill(1.0f); }
+            AudioStream();
 
             explicit AudioStream(ResourceHandle<AudioData> data, float volume, bool loop = false);
 
@@ -47,6 +56,16 @@ namespace Atlas {
 
             double GetPitch() const;
 
+            /**
+             * Sets the priority of the stream. If more streams are playing than the mixer has
+             * real voices, the ones with the lowest priority times volume are virtualized.
+             * Virtualized streams continue to advance, but aren't mixed.
+             * @param priority The priority of the stream
+             */
+            void SetPriority(float priority);
+
+            float GetPriority() const;
+
             void Pause();
 
             void Resume();
@@ -55,26 +74,39 @@ namespace Atlas {
 
             bool IsValid() const;
 
-            bool GetChunk(std::vector<int16_t>& chunk);
-
             bool loop = false;
 
             ResourceHandle<AudioData> data;
 
         private:
-            double progress = 0.0;
+            // Written by any thread, read by the mixer once per block
+            std::atomic<float> volume = 1.0f;
+            std::atomic<double> pitch = 1.0;
+            std::atomic<float> priority = 1.0f;
+            std::atomic_bool pause = false;
+
+            std::array<std::atomic<float>, 8> channelVolume;
 
-            float volume = 1.0f;
-            double pitch = 1.0f;
+            // The position in frames is owned by the mixer, time changes are sent as commands
+            std::atomic<double> progress = 0.0;
+            std::atomic<double> requestedProgress = -1.0;
 
-            bool pause = false;
+            // Only accessed by the mixer thread
+            int32_t voiceIdx = -1;
 
-            std::array<float, 8> channelVolume;
+            // Only accessed by the audio manager to keep the mixer state in sync
+            Ref<AudioData> mixerData = nullptr;
+            Ref<AudioStreamBuffer> mixerBuffer = nullptr;
+            bool mixerLoop = false;
+            bool isMixed = false;
 
             mutable std::mutex mutex;
 
+            friend AudioMixer;
+            friend AudioManager;
+
         };
 
     }
 
-}
\ No newline at end of file
+}
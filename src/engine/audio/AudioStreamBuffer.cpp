@@ -0,0 +1,258 @@
+#include "AudioStreamBuffer.h"
+
+#include "../Log.h"
+#include "../loader/AssetLoader.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Atlas {
+
+    namespace Audio {
+
+        static constexpr int32_t generationShift = 48;
+        static constexpr uint64_t frameMask = (uint64_t(1) << generationShift) - 1;
+
+        AudioStreamBuffer::AudioStreamBuffer(Ref<AudioData> data) : data(data) {
+
+            channelCount = int32_t(data->spec.channels);
+            frameCount = data->GetFrameCount();
+
+            // Keep room for at least two blocks, otherwise the decoding can't run ahead of the mixer
+            auto frameSize = int64_t(sizeof(int16_t)) * channelCount;
+            capacity = std::max(int64_t(data->streamBufferSize) / frameSize, 2 * blockFrameCount);
+            ring.resize(size_t(capacity * channelCount));
+
+            const auto& sourceSpec = data->sourceSpec;
+            converter = SDL_NewAudioStream(sourceSpec.format, sourceSpec.channels, sourceSpec.freq,
+                AUDIO_S16SYS, data->spec.channels, data->spec.freq);
+            if (!converter) {
+                Log::Error("Couldn't create audio converter for streaming " + data->filename);
+                return;
+            }
+
+            file = Loader::AssetLoader::ReadFile(data->filename, std::ios::in | std::ios::binary);
+            if (!file.is_open())
+                Log::Error("Couldn't open " + data->filename + " for streaming");
+
+            auto sourceFrameSize = int64_t(SDL_AUDIO_BITSIZE(sourceSpec.format) / 8) * sourceSpec.channels;
+            sourceBlock.resize(size_t(blockFrameCount * sourceFrameSize));
+            convertedBlock.resize(size_t(blockFrameCount * channelCount));
+
+        }
+
+        AudioStreamBuffer::~AudioStreamBuffer() {
+
+            JobSystem::Wait(jobGroup);
+
+            if (converter)
+                SDL_FreeAudioStream(converter);
+
+        }
+
+        void AudioStreamBuffer::Update(bool loop) {
+
+            this->loop = loop;
+
+            if (!converter || !file.is_open() || !jobGroup.HasFinished())
+                return;
+
+            // No job is running, so the decoder state can be read here
+            auto writeFrame = int64_t(writeState.load(std::memory_order_relaxed) & frameMask);
+            auto freeFrameCount = capacity - (writeFrame - readFrame.load(std::memory_order_acquire));
+
+            auto hasSeek = requestedGeneration.load(std::memory_order_acquire) != generation;
+            if (!hasSeek && (endOfData || freeFrameCount < blockFrameCount))
+                return;
+
+            JobSystem::Execute(jobGroup, [this](JobData&) { Decode(); });
+
+        }
+
+        void AudioStreamBuffer::Seek(int64_t frame) {
+
+            requestedFrame.store(frame, std::memory_order_relaxed);
+            requestedGeneration.fetch_add(1, std::memory_order_release);
+
+        }
+
+        bool AudioStreamBuffer::CheckGeneration(uint32_t& generation, double& progress) {
+
+            auto state = writeState.load(std::memory_order_acquire);
+            auto stateGeneration = uint32_t(state >> generationShift);
+            if (stateGeneration == generation)
+                return false;
+
+            // If the start already belongs to an even newer generation, the frames in between are outdated as well
+            auto startFrame = generationStartFrame.load(std::memory_order_relaxed);
+            auto seekFrame = generationSeekFrame.load(std::memory_order_relaxed);
+
+            // Frames of the new generation might have been read already in the last block
+            auto currentFrame = readFrame.load(std::memory_order_relaxed);
+            auto skippedFrameCount = std::max(currentFrame - startFrame, int64_t(0));
+
+            readFrame.store(std::max(currentFrame, startFrame), std::memory_order_release);
+
+            generation = stateGeneration;
+            progress = double(seekFrame + skippedFrameCount);
+
+            return true;
+
+        }
+
+        int64_t AudioStreamBuffer::Peek(int16_t* dest, int64_t frameCount) const {
+
+            auto writeFrame = int64_t(writeState.load(std::memory_order_acquire) & frameMask);
+            auto currentFrame = readFrame.load(std::memory_order_relaxed);
+
+            auto count = std::clamp(writeFrame - currentFrame, int64_t(0), frameCount);
+
+            int64_t copiedCount = 0;
+            while (copiedCount < count) {
+                auto ringIdx = (currentFrame + copiedCount) % capacity;
+                auto copyCount = std::min(count - copiedCount, capacity - ringIdx);
+                std::memcpy(dest + copiedCount * channelCount, ring.data() + ringIdx * channelCount,
+                    size_t(copyCount * channelCount) * sizeof(int16_t));
+                copiedCount += copyCount;
+            }
+
+            return count;
+
+        }
+
+        void AudioStreamBuffer::Consume(int64_t frameCount) {
+
+            auto currentFrame = readFrame.load(std::memory_order_relaxed);
+            readFrame.store(currentFrame + frameCount, std::memory_order_release);
+
+        }
+
+        int64_t AudioStreamBuffer::GetFrameCount() const {
+
+            return frameCount;
+
+        }
+
+        int32_t AudioStreamBuffer::GetChannelCount() const {
+
+            return channelCount;
+
+        }
+
+        void AudioStreamBuffer::Decode() {
+
+            auto requested = requestedGeneration.load(std::memory_order_acquire);
+            if (requested != generation) {
+                generation = requested;
+
+                auto seekFrame = std::clamp(requestedFrame.load(std::memory_order_relaxed), int64_t(0), frameCount);
+
+                // Reading starts at the block which contains the frame, the frames before it are dropped after conversion
+                const auto& sourceSpec = data->sourceSpec;
+                auto sourceSeekFrame = seekFrame * int64_t(sourceSpec.freq) / int64_t(data->spec.freq);
+                sourceFrame = sourceSeekFrame / blockFrameCount * blockFrameCount;
+                skipFrameCount = (sourceSeekFrame - sourceFrame) * int64_t(data->spec.freq) / int64_t(sourceSpec.freq);
+
+                SDL_AudioStreamClear(converter);
+                endOfData = false;
+
+                auto writeFrame = int64_t(writeState.load(std::memory_order_relaxed) & frameMask);
+                generationStartFrame.store(writeFrame, std::memory_order_relaxed);
+                generationSeekFrame.store(seekFrame, std::memory_order_relaxed);
+                writeState.store(PackState(generation, writeFrame), std::memory_order_release);
+            }
+
+            auto frameSize = int32_t(sizeof(int16_t)) * channelCount;
+            while (requestedGeneration.load(std::memory_order_relaxed) == generation) {
+                auto writeFrame = int64_t(writeState.load(std::memory_order_relaxed) & frameMask);
+                auto freeFrameCount = capacity - (writeFrame - readFrame.load(std::memory_order_acquire));
+                if (freeFrameCount <= 0)
+                    break;
+
+                auto availableFrameCount = int64_t(SDL_AudioStreamAvailable(converter) / frameSize);
+                if (availableFrameCount == 0) {
+                    if (endOfData || !ReadBlock())
+                        break;
+                    continue;
+                }
+
+                auto count = std::min({ availableFrameCount, freeFrameCount, blockFrameCount });
+                auto size = SDL_AudioStreamGet(converter, convertedBlock.data(), int32_t(count) * frameSize);
+                if (size <= 0)
+                    break;
+                count = int64_t(size / frameSize);
+
+                // The first frames after a seek might be in front of the requested frame
+                auto skipCount = std::min(skipFrameCount, count);
+                skipFrameCount -= skipCount;
+
+                Write(convertedBlock.data() + skipCount * channelCount, count - skipCount);
+            }
+
+        }
+
+        bool AudioStreamBuffer::ReadBlock() {
+
+            const auto& sourceSpec = data->sourceSpec;
+            auto sourceFrameSize = int64_t(SDL_AUDIO_BITSIZE(sourceSpec.format) / 8) * sourceSpec.channels;
+
+            if (sourceFrame >= data->sourceFrameCount) {
+                if (!loop || data->sourceFrameCount == 0) {
+                    // Pushes out the frames the resampler still holds back
+                    SDL_AudioStreamFlush(converter);
+                    endOfData = true;
+                    return true;
+                }
+                sourceFrame = 0;
+            }
+
+            auto count = std::min(blockFrameCount, data->sourceFrameCount - sourceFrame);
+
+            file.clear();
+            file.seekg(std::streamoff(data->sourceDataOffset + sourceFrame * sourceFrameSize));
+            file.read(reinterpret_cast<char*>(sourceBlock.data()), std::streamsize(count * sourceFrameSize));
+
+            if (!file) {
+                Log::Error("Couldn't read from " + data->filename + " while streaming");
+                endOfData = true;
+                return false;
+            }
+
+            if (SDL_AudioStreamPut(converter, sourceBlock.data(), int32_t(count * sourceFrameSize)) != 0) {
+                endOfData = true;
+                return false;
+            }
+
+            sourceFrame += count;
+            return true;
+
+        }
+
+        int64_t AudioStreamBuffer::Write(const int16_t* src, int64_t frameCount) {
+
+            auto writeFrame = int64_t(writeState.load(std::memory_order_relaxed) & frameMask);
+
+            int64_t copiedCount = 0;
+            while (copiedCount < frameCount) {
+                auto ringIdx = (writeFrame + copiedCount) % capacity;
+                auto copyCount = std::min(frameCount - copiedCount, capacity - ringIdx);
+                std::memcpy(ring.data() + ringIdx * channelCount, src + copiedCount * channelCount,
+                    size_t(copyCount * channelCount) * sizeof(int16_t));
+                copiedCount += copyCount;
+            }
+
+            writeState.store(PackState(generation, writeFrame + frameCount), std::memory_order_release);
+
+            return frameCount;
+
+        }
+
+        uint64_t AudioStreamBuffer::PackState(uint32_t generation, int64_t frame) {
+
+            return (uint64_t(generation & 0xFFFF) << generationShift) | (uint64_t(frame) & frameMask);
+
+        }
+
+    }
+
+}
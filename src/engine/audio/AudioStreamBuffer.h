@@ -0,0 +1,116 @@
+#pragma once
+
+#include "../System.h"
+
+#include "AudioData.h"
+#include "../jobsystem/JobSystem.h"
+
+#include <SDL_audio.h>
+
+#include <vector>
+#include <atomic>
+#include <fstream>
+
+namespace Atlas {
+
+    namespace Audio {
+
+        /**
+         * Decodes a streamed clip into a ring buffer in the output format. The decoding happens in blocks
+         * on low priority jobs, which are started by Update() on the game side. The mixer reads the buffer
+         * without locking. Seeks start a new generation at the current write position, the mixer drops all
+         * frames of older generations once it sees the new one.
+         */
+        class AudioStreamBuffer {
+
+        public:
+            static constexpr int64_t blockFrameCount = 4096;
+
+            explicit AudioStreamBuffer(Ref<AudioData> data);
+
+            AudioStreamBuffer(const AudioStreamBuffer&) = delete;
+
+            AudioStreamBuffer& operator=(const AudioStreamBuffer&) = delete;
+
+            ~AudioStreamBuffer();
+
+            /**
+             * Starts a decode job if there is room in the buffer and no job is running. Called from the game side.
+             * @param loop Whether the decoding continues at the start of the clip once the end is reached
+             */
+            void Update(bool loop);
+
+            /**
+             * Requests the playback to continue at another frame. Called from the game side.
+             * @param frame The frame in the output format
+             */
+            void Seek(int64_t frame);
+
+            /**
+             * Checks whether a new generation of frames started and drops the frames of older ones. Called by the mixer.
+             * @param generation The generation the caller reads from, is updated to the new one
+             * @param progress Set to the frame of the clip at which the new generation starts
+             * @return True if a new generation started, false otherwise
+             */
+            bool CheckGeneration(uint32_t& generation, double& progress);
+
+            /**
+             * Copies decoded frames from the read position without consuming them. Called by the mixer.
+             * @param dest Interleaved destination with room for frameCount frames
+             * @param frameCount The maximum number of frames to copy
+             * @return The number of frames copied
+             */
+            int64_t Peek(int16_t* dest, int64_t frameCount) const;
+
+            void Consume(int64_t frameCount);
+
+            int64_t GetFrameCount() const;
+
+            int32_t GetChannelCount() const;
+
+        private:
+            void Decode();
+
+            bool ReadBlock();
+
+            int64_t Write(const int16_t* src, int64_t frameCount);
+
+            static uint64_t PackState(uint32_t generation, int64_t frame);
+
+            Ref<AudioData> data;
+
+            std::vector<int16_t> ring;
+            int64_t capacity;
+            int32_t channelCount;
+            int64_t frameCount;
+
+            // The write position and its generation are packed together, such that the mixer sees them at once
+            std::atomic_uint64_t writeState = 0;
+            std::atomic_int64_t readFrame = 0;
+
+            std::atomic_uint32_t requestedGeneration = 0;
+            std::atomic_int64_t requestedFrame = 0;
+
+            // Only written before the write state of the generation is published
+            std::atomic_int64_t generationStartFrame = 0;
+            std::atomic_int64_t generationSeekFrame = 0;
+
+            std::atomic_bool loop = false;
+
+            JobGroup jobGroup { JobPriority::Low };
+
+            // Only accessed by the decode job
+            std::ifstream file;
+            SDL_AudioStream* converter = nullptr;
+            std::vector<uint8_t> sourceBlock;
+            std::vector<int16_t> convertedBlock;
+            uint32_t generation = 0;
+            int64_t sourceFrame = 0;
+            int64_t skipFrameCount = 0;
+            bool endOfData = false;
+
+        };
+
+    }
+
+}
@@ -2,6 +2,7 @@
 
 #include <functional>
 #include <cstdint>
+#include <cstring>
 
 namespace Atlas {
 
@@ -13,4 +14,27 @@ namespace Atlas {
         hash ^= hasher(v) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
     }
 
+    /**
+     * Hashes raw memory. In contrast to std::hash the result is the same for all
+     * compilers and platforms with the same endianness, so it can be persisted.
+     */
+    inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0) {
+        const uint64_t prime = 0x100000001b3;
+        auto bytes = static_cast<const uint8_t*>(data);
+
+        // FNV-1a on 8 byte words with an additional shift to mix the upper bits down
+        uint64_t hash = 0xcbf29ce484222325 ^ seed;
+        size_t offset = 0;
+        for (; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, bytes + offset, sizeof(uint64_t));
+            hash = (hash ^ word) * prime;
+            hash ^= hash >> 32;
+        }
+        for (; offset < size; offset++)
+            hash = (hash ^ bytes[offset]) * prime;
+
+        return hash ^ uint64_t(size);
+    }
+
 }
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include "MemoryMappedFile.h"
+
+#ifdef AE_OS_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <utility>
+
+namespace Atlas {
+
+    namespace Common {
+
+        MemoryMappedFile::MemoryMappedFile(const std::string& path) {
+
+#ifdef AE_OS_WINDOWS
+            auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE)
+                return;
+
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+                CloseHandle(file);
+                return;
+            }
+
+            auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!mapping) {
+                CloseHandle(file);
+                return;
+            }
+
+            auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (!view) {
+                CloseHandle(mapping);
+                CloseHandle(file);
+                return;
+            }
+
+            fileHandle = file;
+            mappingHandle = mapping;
+            data = static_cast<const uint8_t*>(view);
+            size = size_t(fileSize.QuadPart);
+#else
+            auto file = open(path.c_str(), O_RDONLY);
+            if (file < 0)
+                return;
+
+            struct stat fileStat;
+            if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0) {
+                close(file);
+                return;
+            }
+
+            auto view = mmap(nullptr, size_t(fileStat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+            // The mapping stays valid after the file descriptor is closed
+            close(file);
+
+            if (view == MAP_FAILED)
+                return;
+
+            data = static_cast<const uint8_t*>(view);
+            size = size_t(fileStat.st_size);
+#endif
+
+        }
+
+        MemoryMappedFile::MemoryMappedFile(MemoryMappedFile&& that) noexcept {
+
+            *this = std::move(that);
+
+        }
+
+        MemoryMappedFile::~MemoryMappedFile() {
+
+            Unmap();
+
+        }
+
+        MemoryMappedFile& MemoryMappedFile::operator=(MemoryMappedFile&& that) noexcept {
+
+            if (this != &that) {
+                Unmap();
+
+                data = std::exchange(that.data, nullptr);
+                size = std::exchange(that.size, 0);
+#ifdef AE_OS_WINDOWS
+                fileHandle = std::exchange(that.fileHandle, nullptr);
+                mappingHandle = std::exchange(that.mappingHandle, nullptr);
+#endif
+            }
+
+            return *this;
+
+        }
+
+        bool MemoryMappedFile::IsValid() const {
+
+            return data != nullptr;
+
+        }
+
+        const uint8_t* MemoryMappedFile::GetData() const {
+
+            return data;
+
+        }
+
+        size_t MemoryMappedFile::GetSize() const {
+
+            return size;
+
+        }
+
+        void MemoryMappedFile::Unmap() {
+
+            if (!data)
+                return;
+
+#ifdef AE_OS_WINDOWS
+            UnmapViewOfFile(data);
+            CloseHandle(mappingHandle);
+            CloseHandle(fileHandle);
+
+            fileHandle = nullptr;
+            mappingHandle = nullptr;
+#else
+            munmap(const_cast<uint8_t*>(data), size);
+#endif
+
+            data = nullptr;
+            size = 0;
+
+        }
+
+    }
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "../System.h"
+
+#include <string>
+
+namespace Atlas {
+
+    namespace Common {
+
+        /**
+         * Maps a whole file read-only into memory. Pages are loaded lazily by the operating system
+         * on first access, so opening even large files is cheap. The file must not be modified
+         * while it is mapped.
+         */
+        class MemoryMappedFile {
+
+        public:
+            MemoryMappedFile() = default;
+
+            /**
+             * Constructs a MemoryMappedFile object and maps the file.
+             * @param path The absolute path of the file
+             * @note Check IsValid() afterwards, mapping fails e.g. for missing or empty files.
+             */
+            explicit MemoryMappedFile(const std::string& path);
+
+            MemoryMappedFile(const MemoryMappedFile& that) = delete;
+
+            MemoryMappedFile(MemoryMappedFile&& that) noexcept;
+
+            ~MemoryMappedFile();
+
+            MemoryMappedFile& operator=(const MemoryMappedFile& that) = delete;
+
+            MemoryMappedFile& operator=(MemoryMappedFile&& that) noexcept;
+
+            bool IsValid() const;
+
+            const uint8_t* GetData() const;
+
+            size_t GetSize() const;
+
+            /**
+             * Unmaps the file. Needs to be called before the file is overwritten or removed.
+             */
+            void Unmap();
+
+        private:
+            const uint8_t* data = nullptr;
+            size_t size = 0;
+
+#ifdef AE_OS_WINDOWS
+            void* fileHandle = nullptr;
+            void* mappingHandle = nullptr;
+#endif
+
+        };
+
+    }
+
+}
@@ -52,6 +52,7 @@ namespace Atlas {
             entities.clear();
             destroyed.clear();
 
+            groups.clear();
             pools.data.clear();
 
         }
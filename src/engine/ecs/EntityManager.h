@@ -3,6 +3,7 @@
 #include "Entity.h"
 #include "Pools.h"
 #include "Subset.h"
+#include "Group.h"
 
 #include <optional>
 
@@ -194,6 +195,17 @@ namespace Atlas {
             template<typename... Comp>
             Subset<Comp...> GetSubset();
 
+            /**
+             * Returns a group of entities which have all Comp types. The group owns the pools of the
+             * component types, which means that their components are kept packed and in the same order.
+             * @tparam Comp The component types on which entities are selected
+             * @return A group of entities.
+             * @note The first call creates the group, which needs to sort in all existing components.
+             * Each component type can only be owned by a single group. A group isn't meant to be stored.
+             */
+            template<typename... Comp>
+            Group<Comp...> GetGroup();
+
             /**
              * Returns a reference to the internal vector of components of type Comp.
              * @note Actually changing this vector in terms of content might lead to issues. Prefer
@@ -205,6 +217,21 @@ namespace Atlas {
             template<typename Comp>
             size_t SubscribeToTopic(const Topic topic, std::function<void(const Entity, Comp&)> function);
 
+            /**
+             * Records that the component of type Comp of an entity has changed. Systems can then
+             * process just the changed components instead of iterating over all of them.
+             * @note This is thread safe. An entity might be recorded multiple times and entities
+             * might be destroyed after they were recorded.
+             */
+            template<typename Comp>
+            void MarkChanged(Entity entity);
+
+            /**
+             * Moves all entities recorded with MarkChanged() into entities and clears the record.
+             */
+            template<typename Comp>
+            void ConsumeChanged(std::vector<Entity>& entities);
+
             Iterator begin() const {
 
                 return { &entities, 0 };
@@ -222,6 +249,8 @@ namespace Atlas {
         private:
             Pools pools;
 
+            std::vector<std::pair<uint64_t, std::unique_ptr<GroupHandler>>> groups;
+
             std::vector<Entity> entities;
             std::vector<Entity> destroyed;
 
@@ -295,6 +324,26 @@ namespace Atlas {
 
         }
 
+        template<typename... Comp>
+        Group<Comp...> EntityManager::GetGroup() {
+
+            static_assert(sizeof...(Comp) > 1, "A group needs to own at least two component types");
+
+            auto pools = std::tuple { &this->pools.Get<std::decay_t<Comp>>()... };
+
+            auto idx = TypeIndex::Get<Group<std::decay_t<Comp>...>>();
+            auto find = std::find_if(groups.begin(), groups.end(), [idx](const auto& group) { return idx == group.first; });
+
+            if (find == groups.end()) {
+                std::vector<Storage*> storages = { static_cast<Storage*>(std::get<Pool<std::decay_t<Comp>>*>(pools))... };
+                groups.emplace_back(idx, std::make_unique<GroupHandler>(storages));
+                find = groups.end() - 1;
+            }
+
+            return { pools, find->second.get() };
+
+        }
+
         template<typename Comp>
         std::vector<Comp>& EntityManager::GetComponents() {
 
@@ -312,6 +361,24 @@ namespace Atlas {
 
         }
 
+        template<typename Comp>
+        void EntityManager::MarkChanged(Entity entity) {
+
+            auto& pool = pools.Get<Comp>();
+
+            pool.MarkChanged(entity);
+
+        }
+
+        template<typename Comp>
+        void EntityManager::ConsumeChanged(std::vector<Entity>& entities) {
+
+            auto& pool = pools.Get<Comp>();
+
+            pool.ConsumeChanged(entities);
+
+        }
+
     }
 
 }
\ No newline at end of file
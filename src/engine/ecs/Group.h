@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Pool.h"
+#include "GroupHandler.h"
+
+#include <tuple>
+
+namespace Atlas {
+
+    namespace ECS {
+
+        /**
+         * A group is an iterable class of all entities which have all Comp types, similar to a subset.
+         * In contrast to a subset the group owns the pools of its component types: The components of all
+         * entities in the group are tightly packed at the front of the pools and in the same order. Iterating
+         * a group is therefore a linear walk over contiguous arrays without any lookups.
+         * @tparam Comp The component types
+         */
+        template<typename... Comp>
+        class Group {
+
+        public:
+            Group() = default;
+
+            Group(std::tuple<Pool<Comp>*...> pools, const GroupHandler* handler) : pools(pools), handler(handler) {}
+
+            template<typename... Component>
+            decltype(auto) Get(const Entity entity) {
+
+                if constexpr (sizeof...(Component) == 0) {
+                    if constexpr (sizeof...(Comp) == 1) {
+                        return (std::get<Pool<Comp>*>(pools)->Get(entity), ...);
+                    }
+                    else {
+                        return std::tuple_cat(std::forward_as_tuple(std::get<Pool<Comp>*>(pools)->Get(entity))...);
+                    }
+                }
+                else {
+                    if constexpr (sizeof...(Component) == 1) {
+                        return (std::get<Pool<Component>*>(pools)->Get(entity), ...);
+                    }
+                    else {
+                        return std::tuple_cat(std::forward_as_tuple(std::get<Pool<Component>*>(pools)->Get(entity))...);
+                    }
+                }
+
+            }
+
+            /**
+             * Gets the components at an index of the group, which is valid for all owned pools.
+             * @param idx The index, needs to be smaller than Size()
+             */
+            template<typename... Component>
+            decltype(auto) GetByIndex(size_t idx) {
+
+                if constexpr (sizeof...(Component) == 0) {
+                    if constexpr (sizeof...(Comp) == 1) {
+                        return (std::get<Pool<Comp>*>(pools)->GetAll()[idx], ...);
+                    }
+                    else {
+                        return std::forward_as_tuple(std::get<Pool<Comp>*>(pools)->GetAll()[idx]...);
+                    }
+                }
+                else {
+                    if constexpr (sizeof...(Component) == 1) {
+                        return (std::get<Pool<Component>*>(pools)->GetAll()[idx], ...);
+                    }
+                    else {
+                        return std::forward_as_tuple(std::get<Pool<Component>*>(pools)->GetAll()[idx]...);
+                    }
+                }
+
+            }
+
+            /**
+             * Calls func(entity, Comp&...) for each entity of the group.
+             */
+            template<class F>
+            void Each(F&& func) {
+
+                auto entities = EntityData();
+                auto componentArrays = std::make_tuple(std::get<Pool<Comp>*>(pools)->GetAll().data()...);
+
+                for (size_t i = 0; i < Size(); i++)
+                    func(entities[i], std::get<Comp*>(componentArrays)[i]...);
+
+            }
+
+            const Entity* begin() const {
+
+                return EntityData();
+
+            }
+
+            const Entity* end() const {
+
+                return EntityData() + Size();
+
+            }
+
+            size_t Size() const {
+
+                return handler->Size();
+
+            }
+
+        private:
+            const Entity* EntityData() const {
+
+                return static_cast<const Storage*>(std::get<0>(pools))->Data();
+
+            }
+
+            std::tuple<Pool<Comp>*...> pools;
+            const GroupHandler* handler = nullptr;
+
+        };
+
+    }
+
+}
@@ -0,0 +1,58 @@
+#include "GroupHandler.h"
+
+namespace Atlas {
+
+    namespace ECS {
+
+        GroupHandler::GroupHandler(const std::vector<Storage*>& storages) : storages(storages) {
+
+            for (auto storage : storages) {
+                AE_ASSERT(storage->group == nullptr && "A component type can only be owned by one group");
+                storage->group = this;
+            }
+
+            // Sort in all entities which are already there, work with a copy since the order changes
+            std::vector<Entity> entities(storages.front()->Data(), storages.front()->Data() + storages.front()->Size());
+            for (auto entity : entities)
+                OnEmplace(entity);
+
+        }
+
+        void GroupHandler::OnEmplace(const Entity entity) {
+
+            if (!ContainsAll(entity) || storages.front()->GetIndex(entity) < size)
+                return;
+
+            for (auto storage : storages)
+                storage->Swap(storage->GetIndex(entity), size);
+
+            size++;
+
+        }
+
+        void GroupHandler::OnErase(const Entity entity) {
+
+            if (!ContainsAll(entity) || storages.front()->GetIndex(entity) >= size)
+                return;
+
+            size--;
+
+            for (auto storage : storages)
+                storage->Swap(storage->GetIndex(entity), size);
+
+        }
+
+        bool GroupHandler::ContainsAll(const Entity entity) const {
+
+            for (auto storage : storages) {
+                if (!storage->Contains(entity))
+                    return false;
+            }
+
+            return true;
+
+        }
+
+    }
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Storage.h"
+
+#include <vector>
+
+namespace Atlas {
+
+    namespace ECS {
+
+        /**
+         * Keeps the entities which have all components of a group at the front of the owned storages,
+         * in the same order for all storages. The owned storages notify the handler about changes.
+         */
+        class GroupHandler {
+
+        public:
+            GroupHandler() = default;
+
+            explicit GroupHandler(const std::vector<Storage*>& storages);
+
+            void OnEmplace(const Entity entity);
+
+            void OnErase(const Entity entity);
+
+            inline size_t Size() const;
+
+        private:
+            bool ContainsAll(const Entity entity) const;
+
+            std::vector<Storage*> storages;
+
+            size_t size = 0;
+
+        };
+
+        size_t GroupHandler::Size() const {
+
+            return size;
+
+        }
+
+    }
+
+}
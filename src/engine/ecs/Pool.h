@@ -1,9 +1,11 @@
 #pragma once
 
 #include "Storage.h"
+#include "GroupHandler.h"
 #include "Event.h"
 
 #include <vector>
+#include <mutex>
 
 namespace Atlas {
 
@@ -30,6 +32,13 @@ namespace Atlas {
 
             size_t Subscribe(const Topic topic, std::function<void(const Entity, Comp&)> function);
 
+            void MarkChanged(const Entity entity);
+
+            void ConsumeChanged(std::vector<Entity>& entities);
+
+        protected:
+            void Swap(size_t idx0, size_t idx1) override;
+
         private:
             void NotifySubscribers(const Entity entity, Comp& comp, std::vector<Subscriber<Comp>>& subscribers);
 
@@ -37,15 +46,23 @@ namespace Atlas {
             std::vector<Subscriber<Comp>> emplaceSubscribers;
             std::vector<Subscriber<Comp>> eraseSubscribers;
 
+            std::mutex changedMutex;
+            std::vector<Entity> changedEntities;
+
         };
 
         template<typename Comp>
         template<typename ...Args>
         Comp& Pool<Comp>::Emplace(const Entity entity, Args&&... args) {
 
-            auto& comp = components.emplace_back(std::forward<Args>(args)...);
+            components.emplace_back(std::forward<Args>(args)...);
             Storage::Emplace(entity);
 
+            // An owning group might move the new component to the front
+            if (group)
+                group->OnEmplace(entity);
+
+            auto& comp = components[Storage::GetIndex(entity)];
             NotifySubscribers(entity, comp, emplaceSubscribers);
 
             return comp;
@@ -70,6 +87,10 @@ namespace Atlas {
         template<typename Comp>
         void Pool<Comp>::Erase(const Entity entity) {
 
+            // Move the component out of the owning group first, such that the group stays packed
+            if (group)
+                group->OnErase(entity);
+
             auto idx = Storage::GetIndex(entity);
 
             NotifySubscribers(entity, components[idx], eraseSubscribers);
@@ -129,6 +150,36 @@ namespace Atlas {
 
         }
 
+        template<typename Comp>
+        void Pool<Comp>::Swap(size_t idx0, size_t idx1) {
+
+            if (idx0 == idx1)
+                return;
+
+            Storage::Swap(idx0, idx1);
+            std::swap(components[idx0], components[idx1]);
+
+        }
+
+        template<typename Comp>
+        void Pool<Comp>::MarkChanged(const Entity entity) {
+
+            std::scoped_lock lock(changedMutex);
+            changedEntities.push_back(entity);
+
+        }
+
+        template<typename Comp>
+        void Pool<Comp>::ConsumeChanged(std::vector<Entity>& entities) {
+
+            std::scoped_lock lock(changedMutex);
+
+            // Swap to keep the allocations of both vectors around
+            entities.clear();
+            std::swap(entities, changedEntities);
+
+        }
+
         template<typename Comp>
         void Pool<Comp>::NotifySubscribers(const Atlas::ECS::Entity entity, Comp &comp,
             std::vector<Subscriber<Comp>> &subscribers) {
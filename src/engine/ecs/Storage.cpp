@@ -48,6 +48,18 @@ namespace Atlas {
 
         }
 
+        void Storage::Swap(size_t idx0, size_t idx1) {
+
+            auto entityIdx0 = EntityToIdx(packedData[idx0]);
+            auto entityIdx1 = EntityToIdx(packedData[idx1]);
+
+            pageData[GetPage(entityIdx0)][GetOffset(entityIdx0)] = uint32_t(idx1);
+            pageData[GetPage(entityIdx1)][GetOffset(entityIdx1)] = uint32_t(idx0);
+
+            std::swap(packedData[idx0], packedData[idx1]);
+
+        }
+
     }
 
 }
\ No newline at end of file
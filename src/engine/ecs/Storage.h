@@ -9,6 +9,8 @@ namespace Atlas {
 
     namespace ECS {
 
+        class GroupHandler;
+
         class Storage {
 
             using Page = std::vector<uint32_t>;
@@ -16,6 +18,8 @@ namespace Atlas {
         public:
             Storage() {}
 
+            virtual ~Storage() = default;
+
             void Emplace(const Entity entity);
 
             virtual void Erase(const Entity entity);
@@ -28,6 +32,8 @@ namespace Atlas {
 
             inline size_t Size() const;
 
+            inline const Entity* Data() const;
+
             const uint32_t pageSize = 4096;
             const uint32_t pageSizePowOf2 = 12;
 
@@ -40,12 +46,21 @@ namespace Atlas {
 
             inline size_t TryGetIndex(const Entity entity) const;
 
+            // Swaps two entries of the packed data, derived storages need to swap their data as well
+            virtual void Swap(size_t idx0, size_t idx1);
+
+            // The group which owns this storage, if there is any
+            GroupHandler* group = nullptr;
+
         private:
             std::vector<Page> pageData;
             std::vector<Entity> packedData;
 
             size_t pageTableSize = 0;
 
+            friend GroupHandler;
+            friend class EntityManager;
+
         };
 
         Entity& Storage::operator[](size_t idx) {
@@ -76,6 +91,12 @@ namespace Atlas {
 
         }
 
+        const Entity* Storage::Data() const {
+
+            return packedData.data();
+
+        }
+
         size_t Storage::GetPage(uint32_t idx) const {
 
             return size_t(idx >> pageSizePowOf2);
@@ -147,6 +147,32 @@ namespace Atlas {
 
             }
 
+            /**
+             * Returns the number of candidates, which is the size of the smallest pool. Together with
+             * TryGetEntity() this allows to split the iteration into index ranges, e.g. to process them in parallel.
+             */
+            size_t GetCandidateCount() const {
+
+                return mainStorage->Size();
+
+            }
+
+            /**
+             * Gets the entity of a candidate if it has all components.
+             * @param idx The index of the candidate, needs to be smaller than GetCandidateCount()
+             * @param entity The entity of the candidate
+             * @return True if the entity is part of the subset, false otherwise
+             */
+            bool TryGetEntity(size_t idx, Entity& entity) const {
+
+                if (!HasAllComponents(idx))
+                    return false;
+
+                entity = (*mainStorage)[idx];
+                return true;
+
+            }
+
             bool Any() const {
 
                 size_t idx = 0;
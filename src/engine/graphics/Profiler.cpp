@@ -1,5 +1,6 @@
 #include "Profiler.h"
 #include "GraphicsDevice.h"
+#include "../jobsystem/JobProfiler.h"
 
 #include <thread>
 #include <algorithm>
@@ -59,6 +60,18 @@ namespace Atlas {
                 for (auto& query : context.queries)
                     EvaluateQuery(context, query, timeData);
 
+#ifdef AE_JOBSYSTEM_PROFILING
+                // There are no calibrated timestamps, so the first query is assumed to start at submission
+                if (!context.queries.empty()) {
+                    auto gpuStartTime = context.queries.front().timer.startTime;
+                    for (const auto& query : context.queries)
+                        gpuStartTime = std::min(gpuStartTime, query.timer.startTime);
+
+                    auto timestampPeriod = double(GraphicsDevice::DefaultDevice->deviceProperties.properties.limits.timestampPeriod);
+                    RecordGpuQueries(context, context.queries, gpuStartTime, timestampPeriod, 0);
+                }
+#endif
+
                 history.history[history.historyIdx] = context.queries;
 
                 history.historyIdx = (history.historyIdx + 1) % 64;
@@ -119,6 +132,7 @@ namespace Atlas {
             auto& context = GetThreadContext();
 
             context.isValid = false;
+            context.submitTime = JobProfiler::GetTimestamp();
             unevaluatedThreadContexts.push_back(context);
 
         }
@@ -158,6 +172,10 @@ namespace Atlas {
 
             context.commandList->Timestamp(context.queryPool, query.timer.startId);
 
+#ifdef AE_JOBSYSTEM_PROFILING
+            JobProfiler::BeginScope(name);
+#endif
+
         }
 
         void Profiler::EndQuery() {
@@ -175,6 +193,10 @@ namespace Atlas {
             auto query = context.stack.back();
             context.commandList->Timestamp(context.queryPool, query.timer.endId);
 
+#ifdef AE_JOBSYSTEM_PROFILING
+            JobProfiler::EndScope();
+#endif
+
             context.stack.pop_back();
 
             // Check if we have a root query or if a parent
@@ -317,6 +339,19 @@ namespace Atlas {
 
         }
 
+        void Profiler::RecordGpuQueries(const ThreadContext& context, const std::vector<Query>& queries,
+            uint64_t gpuStartTime, double timestampPeriod, int32_t depth) {
+
+            for (const auto& query : queries) {
+                auto startTime = context.submitTime + uint64_t(double(query.timer.startTime - gpuStartTime) * timestampPeriod);
+                auto endTime = context.submitTime + uint64_t(double(query.timer.endTime - gpuStartTime) * timestampPeriod);
+
+                JobProfiler::RecordGpuQuery(context.name, query.name, startTime, endTime, depth);
+                RecordGpuQueries(context, query.children, gpuStartTime, timestampPeriod, depth + 1);
+            }
+
+        }
+
         Profiler::ThreadContext &Profiler::GetThreadContext() {
             auto threadId = std::this_thread::get_id();
 
@@ -159,6 +159,9 @@ namespace Atlas {
 
                 size_t frameIdx = 0;
                 bool isValid = false;
+
+                // CPU time of the EndThread() call, used to place the GPU queries on the CPU timeline
+                uint64_t submitTime = 0;
             };
 
             static void EvaluateQuery(ThreadContext& context, Query& query, const std::vector<uint64_t>& timeData);
@@ -167,6 +170,9 @@ namespace Atlas {
 
             static void UpdateHistory();
 
+            static void RecordGpuQueries(const ThreadContext& context, const std::vector<Query>& queries,
+                uint64_t gpuStartTime, double timestampPeriod, int32_t depth);
+
             static void EvaluateHistory(ThreadHistory& history);
 
             static void AddQueriesToAverage(std::vector<Query>& average,
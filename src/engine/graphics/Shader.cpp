@@ -20,12 +20,17 @@ namespace Atlas {
 
         const std::string ShaderStageFile::GetGlslCode(const std::vector<std::string>& macros) const {
 
+            return GetGlslCode(macros, GetEnvironmentMacros());
+
+        }
+
+        const std::string ShaderStageFile::GetGlslCode(const std::vector<std::string>& macros,
+            const std::vector<std::string>& environmentMacros) const {
+
             std::string glslCode = "";
             glslCode.append("#version 460\n\n");
 
-            auto envMacros = GetEnvironmentMacros();
-
-            for (const auto& macro : envMacros) {
+            for (const auto& macro : environmentMacros) {
                 glslCode.append("#define " + macro + "\n");
             }
 
@@ -144,39 +149,17 @@ namespace Atlas {
 
         }
 
-        bool Shader::Reload(std::unordered_map<std::string, std::filesystem::file_time_type>& lastModifiedMap) {
+        bool Shader::Reload(const std::unordered_set<std::string>& modifiedFiles) {
 
             std::lock_guard lock(variantMutex);
 
-            std::filesystem::file_time_type maxLastModified = lastReload;
-
+            // Each change is only reported once, so a rollback after a failed reload stays in place
             bool reload = false;
             for (auto& shaderStage : shaderStageFiles) {
-                std::filesystem::file_time_type lastModified;
-                if (Loader::ShaderLoader::CheckForReload(shaderStage.filename,
-                    shaderStage.lastModified, lastModified)) {
-                    maxLastModified = std::max(maxLastModified, lastModified);
+                if (Loader::ShaderLoader::CheckForReload(shaderStage.filename, modifiedFiles))
                     reload = true;
-                }
-
-                for (auto& includePath : shaderStage.includes) {
-                    auto lastModifiedIt = lastModifiedMap.find(includePath);
-
-                    if (lastModifiedIt == lastModifiedMap.end()) continue;
-
-                    if (lastModifiedIt->second > shaderStage.lastModified)
-                        reload = true;
-
-                    maxLastModified = std::max(maxLastModified, lastModifiedIt->second);
-                }
             }
 
-            // This avoids consecutive reloads after a rollback
-            if (maxLastModified <= lastReload)
-                reload = false;
-            else
-                lastReload = maxLastModified;
-
             std::vector<ShaderStageFile> newShaderStageFiles;
             if (reload) {
                 for (auto& shaderStage : shaderStageFiles) {
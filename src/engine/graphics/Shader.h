@@ -7,6 +7,7 @@
 #include <string>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 #include <filesystem>
 
 namespace Atlas {
@@ -23,6 +24,9 @@ namespace Atlas {
 
             const std::string GetGlslCode(const std::vector<std::string>& macros) const;
 
+            const std::string GetGlslCode(const std::vector<std::string>& macros,
+                const std::vector<std::string>& environmentMacros) const;
+
             const std::vector<std::string> GetEnvironmentMacros() const;
 
             struct Extension {
@@ -128,7 +132,12 @@ namespace Atlas {
 
             Ref<ShaderVariant> GetVariant(std::vector<std::string> macros);
 
-            bool Reload(std::unordered_map<std::string, std::filesystem::file_time_type>& lastModifiedMap);
+            /**
+             * Reloads all shader stages if any of them depends on a modified file.
+             * @param modifiedFiles The modified files as returned by ShaderLoader::GetModifiedFiles()
+             * @return True if the shader was reloaded, false otherwise
+             */
+            bool Reload(const std::unordered_set<std::string>& modifiedFiles);
 
             std::string name;
 
@@ -140,8 +149,6 @@ namespace Atlas {
             std::vector<ShaderStageFile> shaderStageFiles;
             std::vector<ShaderStageFile> historyShaderStageFiles;
 
-            std::filesystem::file_time_type lastReload = std::filesystem::file_time_type::min();
-
             std::mutex variantMutex;
             std::vector<Ref<ShaderVariant>> shaderVariants;
 
@@ -2,69 +2,189 @@
 #include "GraphicsDevice.h"
 #include "Log.h"
 #include "loader/AssetLoader.h"
+#include "loader/ShaderLoader.h"
+#include "jobsystem/JobSystem.h"
+#include "common/SerializationHelper.h"
 
 #include <glslang/SPIRV/GlslangToSpv.h>
 #include <spirv-tools/optimizer.hpp>
 
+#include <map>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
 namespace Atlas {
 
     namespace Graphics {
 
         void InitBuildInResources(TBuiltInResource& Resources);
         EShLanguage FindLanguage(const VkShaderStageFlagBits shaderType);
-        void LogError(const ShaderStageFile& shaderStageFile, const std::vector<std::string>& macros,
+        void LogError(const ShaderStageFile& shaderStageFile, const std::string& glslCode,
             glslang::TShader& shader);
 
+        // Needs to be increased whenever the compiler or its options change
+        static constexpr uint32_t archiveVersion = 1;
+        static constexpr uint32_t archiveMagic = 0x56505341; // "ASPV"
+
         bool ShaderCompiler::includeDebugInfo = false;
-        std::unordered_map<size_t, ShaderCompiler::SpvCacheEntry> ShaderCompiler::cache;
+
+        Common::MemoryMappedFile ShaderCompiler::archive;
+        const ShaderCompiler::ArchiveEntry* ShaderCompiler::archiveEntries = nullptr;
+        uint64_t ShaderCompiler::archiveEntryCount = 0;
+
+        std::mutex ShaderCompiler::cacheMutex;
+        std::unordered_map<uint64_t, std::vector<uint32_t>> ShaderCompiler::compiledEntries;
+        std::unordered_set<uint64_t> ShaderCompiler::usedArchiveKeys;
+        bool ShaderCompiler::warmedUp = false;
+
+        std::mutex ShaderCompiler::variantMutex;
+        std::unordered_map<Hash, ShaderCompiler::VariantDesc> ShaderCompiler::recordedVariants;
+
         const std::string ShaderCompiler::cachePath = ".cache/";
+        const std::string ShaderCompiler::archiveFilename = "shaders.archive";
+        const std::string ShaderCompiler::variantsFilename = "shader_variants.json";
 
         void ShaderCompiler::Init() {
 
             glslang::InitializeProcess();
 
+            // Only the index is validated here, the binaries are paged in on first access
+            archive = Common::MemoryMappedFile(Loader::AssetLoader::GetFullPath(cachePath + archiveFilename));
+            if (!archive.IsValid())
+                return;
+
+            auto data = archive.GetData();
+            auto size = archive.GetSize();
+
+            ArchiveHeader header;
+            bool valid = size >= sizeof(ArchiveHeader);
+            if (valid) {
+                std::memcpy(&header, data, sizeof(ArchiveHeader));
+                valid = header.magic == archiveMagic && header.version == archiveVersion &&
+                    header.entryCount <= (size - sizeof(ArchiveHeader)) / sizeof(ArchiveEntry);
+            }
+
+            auto entries = reinterpret_cast<const ArchiveEntry*>(data + sizeof(ArchiveHeader));
+            for (uint64_t i = 0; valid && i < header.entryCount; i++) {
+                const auto& entry = entries[i];
+                valid = entry.offset % sizeof(uint32_t) == 0 && entry.offset <= size &&
+                    entry.wordCount <= (size - entry.offset) / sizeof(uint32_t) &&
+                    (i == 0 || entries[i - 1].key < entry.key);
+            }
+
+            if (!valid) {
+                Log::Warning("Shader cache archive is invalid or outdated and will be rebuilt");
+                archive.Unmap();
+                return;
+            }
+
+            archiveEntries = entries;
+            archiveEntryCount = header.entryCount;
+
         }
 
         void ShaderCompiler::Shutdown() {
 
             glslang::FinalizeProcess();
 
-            for (auto& [_, entry] : cache) {
-                if (!entry.wasModified) continue;
+            SaveArchive();
+            SaveVariants();
 
-                auto fileStream = Loader::AssetLoader::WriteFile(entry.fileName, std::ios::out | std::ios::binary);
-                if (fileStream.is_open()) {
-                    fileStream.write(reinterpret_cast<char*>(entry.spirvBinary.data()),
-                        entry.spirvBinary.size() * sizeof(uint32_t));
+            archive.Unmap();
+            archiveEntries = nullptr;
+            archiveEntryCount = 0;
 
-                    fileStream.close();
-                }
-            }
+            compiledEntries.clear();
+            usedArchiveKeys.clear();
+            recordedVariants.clear();
+
+            warmedUp = false;
 
         }
 
         std::vector<uint32_t> ShaderCompiler::Compile(const ShaderStageFile& shaderFile,
             const std::vector<std::string>& macros, bool useCache, bool& success) {
 
-            if (useCache) {
-                auto cacheHit = TryFindCacheEntry(shaderFile, macros, success);
-                if (success) {
-                    return cacheHit.spirvBinary;
-                }
+            auto device = GraphicsDevice::DefaultDevice;
+
+            VariantDesc variant = {
+                .filename = shaderFile.filename,
+                .shaderStage = shaderFile.shaderStage,
+                .macros = macros,
+                .environmentMacros = shaderFile.GetEnvironmentMacros(),
+                // Mac struggles with Spv 1.4, so use only when necessary
+                .spirv14 = device->support.hardwareRayTracing
+            };
+
+            RecordVariant(variant);
+
+            return Compile(shaderFile, variant, useCache, success);
+
+        }
+
+        size_t ShaderCompiler::WarmUpCache() {
+
+            auto variants = LoadVariants();
+
+            // Each file is loaded only once, even if there are many variants of it
+            std::unordered_map<std::string, ShaderStageFile> shaderFiles;
+            for (const auto& variant : variants) {
+                auto fileKey = variant.filename + std::to_string(variant.shaderStage);
+                if (!shaderFiles.contains(fileKey))
+                    shaderFiles[fileKey] = Loader::ShaderLoader::LoadFile(variant.filename, variant.shaderStage);
             }
 
-            auto device = GraphicsDevice::DefaultDevice;
+            std::atomic<size_t> compiledCount = 0;
+
+            JobGroup group { JobPriority::High };
+            JobSystem::ExecuteMultiple(group, int32_t(variants.size()), [&](JobData& data) {
+                const auto& variant = variants[data.idx];
+                const auto& shaderFile = shaderFiles.at(variant.filename + std::to_string(variant.shaderStage));
+
+                std::vector<uint32_t> binary;
+                auto glslCode = shaderFile.GetGlslCode(variant.macros, variant.environmentMacros);
+                if (TryFindCacheEntry(CalculateKey(glslCode, variant), binary))
+                    return;
+
+                bool success = false;
+                Compile(shaderFile, variant, false, success);
+                if (success)
+                    compiledCount++;
+            });
+            JobSystem::Wait(group);
+
+            // Every recorded variant was looked up, so the archive entries which weren't are stale
+            warmedUp = true;
+
+            Log::Message("Compiled " + std::to_string(compiledCount.load()) + " of " +
+                std::to_string(variants.size()) + " shader variants");
+
+            return compiledCount.load();
+
+        }
+
+        std::vector<uint32_t> ShaderCompiler::Compile(const ShaderStageFile& shaderFile,
+            const VariantDesc& variant, bool useCache, bool& success) {
 
             std::vector<uint32_t> spirvBinary;
 
+            auto glslCode = shaderFile.GetGlslCode(variant.macros, variant.environmentMacros);
+            auto key = CalculateKey(glslCode, variant);
+
+            if (useCache && TryFindCacheEntry(key, spirvBinary)) {
+                success = true;
+                return spirvBinary;
+            }
+
             TBuiltInResource Resources = {};
             InitBuildInResources(Resources);
 
-            EShLanguage stage = FindLanguage(shaderFile.shaderStage);
+            EShLanguage stage = FindLanguage(variant.shaderStage);
             glslang::TShader shader(stage);
 
-            if (device->support.hardwareRayTracing) {
-                // Mac struggles with Spv 1.4, so use only when necessary
+            if (variant.spirv14) {
                 shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_4);
             }
             else {
@@ -74,13 +194,12 @@ namespace Atlas {
             // Enable SPIR-V and Vulkan rules when parsing GLSL
             EShMessages messages = (EShMessages)(EShMsgSpvRules | EShMsgVulkanRules);
 
-            auto glslCode = shaderFile.GetGlslCode(macros);
             const char* shaderStrings[] = { glslCode.data() };
             shader.setStrings(shaderStrings, 1);
             shader.getIntermediate()->addSourceText(glslCode.data(), glslCode.size());
 
             if (!shader.parse(&Resources, 100, false, messages)) {
-                LogError(shaderFile, macros, shader);
+                LogError(shaderFile, glslCode, shader);
                 success = false;
                 return spirvBinary;
             }
@@ -89,7 +208,7 @@ namespace Atlas {
             program.addShader(&shader);
 
             if (!program.link(messages)) {
-                LogError(shaderFile, macros, shader);
+                LogError(shaderFile, glslCode, shader);
                 success = false;
                 return spirvBinary;
             }
@@ -108,91 +227,230 @@ namespace Atlas {
 
                 std::vector<uint32_t> optimizedBinary;
                 if (opt.Run(spirvBinary.data(), spirvBinary.size(), &optimizedBinary)) {
-                    AddCacheEntry(shaderFile, macros, optimizedBinary);
+                    AddCacheEntry(key, optimizedBinary);
                     return optimizedBinary;
                 }
             }
 
-            AddCacheEntry(shaderFile, macros, spirvBinary);
+            AddCacheEntry(key, spirvBinary);
             return spirvBinary;
 
         }
 
-        ShaderCompiler::SpvCacheEntry ShaderCompiler::TryFindCacheEntry(
-            const ShaderStageFile& shaderFile, const std::vector<std::string>& macros, bool& success) {
+        bool ShaderCompiler::TryFindCacheEntry(uint64_t key, std::vector<uint32_t>& binary) {
 
-            auto hash = CalculateHash(shaderFile, macros);
-
-            success = true;
-
-            SpvCacheEntry entry;
-            if (cache.contains(hash)) {
-                entry = cache[hash];
-            }
-            else {
-                std::string path;
-                if (includeDebugInfo)
-                    path = cachePath + std::to_string(hash) + "_debug";
-                else
-                    path = cachePath + std::to_string(hash);
-
-                if (Loader::AssetLoader::FileExists(path)) {
-                    entry.fileName = path;
-                    entry.lastModified = Loader::AssetLoader::GetFileLastModifiedTime(path, std::filesystem::file_time_type::min());
-
-                    auto fileStream = Loader::AssetLoader::ReadFile(path, std::ios::in | std::ios::binary);
-                    if (fileStream.is_open()) {
-                        auto content = Loader::AssetLoader::GetFileContent(fileStream);
-                        fileStream.close();
-
-                        // Quick and dirty memcpy
-                        entry.spirvBinary.resize(content.size() / sizeof(uint32_t));
-                        std::memcpy(entry.spirvBinary.data(), content.data(), content.size());
-                    }
-                    else {
-                        success = false;
-                    }
-                }
-                else {
-                    success = false;
+            {
+                std::lock_guard lock(cacheMutex);
+                auto it = compiledEntries.find(key);
+                if (it != compiledEntries.end()) {
+                    binary = it->second;
+                    return true;
                 }
             }
 
-            success &= shaderFile.lastModified <= entry.lastModified;
-            return entry;
+            // The archive is read-only while mapped and the index is sorted by key
+            auto end = archiveEntries + archiveEntryCount;
+            auto it = std::lower_bound(archiveEntries, end, key,
+                [](const ArchiveEntry& entry, uint64_t key) { return entry.key < key; });
+            if (it == end || it->key != key)
+                return false;
+
+            auto words = reinterpret_cast<const uint32_t*>(archive.GetData() + it->offset);
+            binary.assign(words, words + it->wordCount);
+
+            std::lock_guard lock(cacheMutex);
+            usedArchiveKeys.insert(key);
+
+            return true;
 
         }
 
-        void ShaderCompiler::AddCacheEntry(const ShaderStageFile& shaderFile,
-            const std::vector<std::string>& macros, const std::vector<uint32_t>& binary) {
+        void ShaderCompiler::AddCacheEntry(uint64_t key, const std::vector<uint32_t>& binary) {
 
-            auto hash = CalculateHash(shaderFile, macros);
+            std::lock_guard lock(cacheMutex);
+            compiledEntries[key] = binary;
 
-            SpvCacheEntry entry{
-                .fileName = includeDebugInfo ? cachePath + std::to_string(hash) + "_debug" : cachePath + std::to_string(hash),
+        }
 
-                .lastModified = shaderFile.lastModified,
-                .spirvBinary = binary,
+        uint64_t ShaderCompiler::CalculateKey(const std::string& glslCode, const VariantDesc& variant) {
 
-                .wasModified = true
+            // The source already contains all macros, so only the compiler options need to be added
+            auto key = HashBytes(glslCode.data(), glslCode.size());
+
+            uint32_t options[] = {
+                uint32_t(variant.shaderStage),
+                variant.spirv14 ? 1u : 0u,
+                includeDebugInfo ? 1u : 0u
             };
-            cache[hash] = entry;
 
-        }
+            return HashBytes(options, sizeof(options), key);
 
-        Hash ShaderCompiler::CalculateHash(const ShaderStageFile& shaderFile,
-            const std::vector<std::string>& macros) {
+        }
 
-            auto envMacros = shaderFile.GetEnvironmentMacros();
+        void ShaderCompiler::RecordVariant(const VariantDesc& variant) {
 
             Hash hash = 0;
-            HashCombine(hash, shaderFile.filename);
-            for (auto& macro : macros)
+            HashCombine(hash, variant.filename);
+            HashCombine(hash, uint32_t(variant.shaderStage));
+            for (const auto& macro : variant.macros)
                 HashCombine(hash, macro);
-            for (auto& macro : envMacros)
+            for (const auto& macro : variant.environmentMacros)
                 HashCombine(hash, macro);
+            HashCombine(hash, variant.spirv14);
+
+            std::lock_guard lock(variantMutex);
+            if (!recordedVariants.contains(hash))
+                recordedVariants[hash] = variant;
+
+        }
+
+        std::vector<ShaderCompiler::VariantDesc> ShaderCompiler::LoadVariants() {
+
+            std::vector<VariantDesc> variants;
+
+            auto fileStream = Loader::AssetLoader::ReadFile(cachePath + variantsFilename, std::ios::in);
+            if (!fileStream.is_open())
+                return variants;
+
+            auto j = json::parse(fileStream, nullptr, false);
+            fileStream.close();
+
+            if (!j.is_array()) {
+                Log::Warning("Couldn't parse recorded shader variants");
+                return variants;
+            }
+
+            auto isStringArray = [](const json& jArray) {
+                return jArray.is_array() && std::all_of(jArray.begin(), jArray.end(),
+                    [](const json& jElement) { return jElement.is_string(); });
+            };
+
+            // The file is only a hint, so damaged variants are skipped instead of failing
+            size_t skippedCount = 0;
+            for (const auto& jVariant : j) {
+                auto valid = jVariant.is_object() &&
+                    jVariant.contains("filename") && jVariant["filename"].is_string() &&
+                    jVariant.contains("shaderStage") && jVariant["shaderStage"].is_number_integer() &&
+                    jVariant.contains("macros") && isStringArray(jVariant["macros"]) &&
+                    jVariant.contains("environmentMacros") && isStringArray(jVariant["environmentMacros"]) &&
+                    jVariant.contains("spirv14") && jVariant["spirv14"].is_boolean();
+                if (!valid) {
+                    skippedCount++;
+                    continue;
+                }
+
+                VariantDesc variant;
+                int32_t shaderStage;
+
+                jVariant["filename"].get_to(variant.filename);
+                jVariant["shaderStage"].get_to(shaderStage);
+                jVariant["macros"].get_to(variant.macros);
+                jVariant["environmentMacros"].get_to(variant.environmentMacros);
+                jVariant["spirv14"].get_to(variant.spirv14);
+
+                variant.shaderStage = static_cast<VkShaderStageFlagBits>(shaderStage);
+                variants.push_back(variant);
+            }
+
+            if (skippedCount > 0)
+                Log::Warning("Skipped " + std::to_string(skippedCount) + " invalid recorded shader variants");
+
+            return variants;
+
+        }
+
+        void ShaderCompiler::SaveVariants() {
+
+            if (recordedVariants.empty())
+                return;
+
+            // Keep the variants of previous runs, they might have used other parts of the renderer
+            auto variants = LoadVariants();
+            for (const auto& variant : variants)
+                RecordVariant(variant);
+
+            if (recordedVariants.size() == variants.size())
+                return;
+
+            json j = json::array();
+            for (const auto& [_, variant] : recordedVariants) {
+                j.push_back(json {
+                    {"filename", variant.filename},
+                    {"shaderStage", int32_t(variant.shaderStage)},
+                    {"macros", variant.macros},
+                    {"environmentMacros", variant.environmentMacros},
+                    {"spirv14", variant.spirv14}
+                });
+            }
+
+            auto fileStream = Loader::AssetLoader::WriteFile(cachePath + variantsFilename, std::ios::out);
+            if (fileStream.is_open()) {
+                fileStream << j.dump();
+                fileStream.close();
+            }
+
+        }
+
+        void ShaderCompiler::SaveArchive() {
+
+            // Without a warm up this session might have used only a part of the renderer, so all entries are kept
+            auto pruneUnused = warmedUp && usedArchiveKeys.size() < archiveEntryCount;
+            if (compiledEntries.empty() && !pruneUnused)
+                return;
+
+            // Merge the existing entries with the new ones, ordered by key for the binary search
+            std::map<uint64_t, std::pair<const uint32_t*, uint64_t>> entries;
+            for (uint64_t i = 0; i < archiveEntryCount; i++) {
+                const auto& entry = archiveEntries[i];
+                if (pruneUnused && !usedArchiveKeys.contains(entry.key))
+                    continue;
+
+                auto words = reinterpret_cast<const uint32_t*>(archive.GetData() + entry.offset);
+                entries[entry.key] = { words, entry.wordCount };
+            }
+            for (const auto& [key, binary] : compiledEntries)
+                entries[key] = { binary.data(), binary.size() };
+
+            if (pruneUnused)
+                Log::Message("Removing " + std::to_string(archiveEntryCount - usedArchiveKeys.size()) +
+                    " stale entries from the shader cache archive");
+
+            ArchiveHeader header = {
+                .magic = archiveMagic,
+                .version = archiveVersion,
+                .entryCount = entries.size()
+            };
+
+            std::vector<ArchiveEntry> index;
+            auto offset = uint64_t(sizeof(ArchiveHeader) + entries.size() * sizeof(ArchiveEntry));
+            for (const auto& [key, binary] : entries) {
+                index.push_back({ key, offset, binary.second });
+                offset += binary.second * sizeof(uint32_t);
+            }
+
+            // The archive is still mapped, so write a new file and replace the old one afterwards
+            auto tempFilename = cachePath + archiveFilename + ".tmp";
+            auto fileStream = Loader::AssetLoader::WriteFile(tempFilename, std::ios::out | std::ios::binary);
+            if (!fileStream.is_open()) {
+                Log::Warning("Couldn't write shader cache archive");
+                return;
+            }
+
+            fileStream.write(reinterpret_cast<const char*>(&header), sizeof(ArchiveHeader));
+            fileStream.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(ArchiveEntry));
+            for (const auto& [key, binary] : entries)
+                fileStream.write(reinterpret_cast<const char*>(binary.first), binary.second * sizeof(uint32_t));
+            fileStream.close();
+
+            archive.Unmap();
+            archiveEntries = nullptr;
+            archiveEntryCount = 0;
 
-            return hash;
+            std::error_code errorCode;
+            std::filesystem::rename(Loader::AssetLoader::GetFullPath(tempFilename),
+                Loader::AssetLoader::GetFullPath(cachePath + archiveFilename), errorCode);
+            if (errorCode)
+                Log::Warning("Couldn't replace shader cache archive: " + errorCode.message());
 
         }
 
@@ -319,7 +577,7 @@ namespace Atlas {
             }
         }
 
-        void LogError(const ShaderStageFile& shaderStageFile, const std::vector<std::string>& macros,
+        void LogError(const ShaderStageFile& shaderStageFile, const std::string& glslCode,
             glslang::TShader& shader) {
 
             std::string log;
@@ -346,10 +604,9 @@ namespace Atlas {
             size_t pos = 0, lastPos = 0;
             log.append("\nFile: " + shaderStageFile.filename);
 
-            auto stageCode = shaderStageFile.GetGlslCode(macros);
-            while ((pos = stageCode.find('\n', lastPos)) != std::string::npos) {
+            while ((pos = glslCode.find('\n', lastPos)) != std::string::npos) {
                 log.append("[" + std::to_string(lineCount++) + "] ");
-                log.append(stageCode.substr(lastPos, pos - lastPos + 1));
+                log.append(glslCode.substr(lastPos, pos - lastPos + 1));
                 lastPos = pos + 1;
             }
 
@@ -3,15 +3,26 @@
 #include "Common.h"
 #include "Shader.h"
 #include "common/Hash.h"
+#include "common/MemoryMappedFile.h"
 
 #include <stdint.h>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
+#include <mutex>
 
 namespace Atlas {
 
     namespace Graphics {
 
+        /**
+         * Compiles GLSL shader stages to SPIR-V. Compiled binaries are cached in a single archive,
+         * which is memory mapped on Init() and rewritten on Shutdown() if new binaries were added.
+         * The cache keys are derived from the content of the final shader source, the macros and
+         * the compiler options, so changing an include invalidates exactly the affected entries.
+         * All requested variants are recorded, such that WarmUpCache() can compile them ahead of time.
+         * After a warm up, entries which none of the recorded variants needed are dropped from the archive.
+         */
         class ShaderCompiler {
 
         public:
@@ -22,33 +33,77 @@ namespace Atlas {
             static std::vector<uint32_t> Compile(const ShaderStageFile& shaderFile,
                 const std::vector<std::string>& macros, bool useCache, bool& success);
 
+            /**
+             * Compiles all variants recorded by previous runs which are not in the cache yet, in parallel
+             * on the job system. This doesn't need a graphics device and can be run headless.
+             * @return The number of newly compiled variants
+             * @note Needs to be called between Init() and Shutdown(), which stores the results and
+             * drops all stale entries of the archive.
+             */
+            static size_t WarmUpCache();
+
             static bool includeDebugInfo;
 
         private:
-            struct SpvCacheEntry {
-                std::string fileName;
+            // Everything besides the source file which influences the compiled binary
+            struct VariantDesc {
+                std::string filename;
+                VkShaderStageFlagBits shaderStage;
+
+                std::vector<std::string> macros;
+                std::vector<std::string> environmentMacros;
 
-                std::filesystem::file_time_type lastModified;
-                std::vector<uint32_t> spirvBinary;
+                bool spirv14 = false;
+            };
 
-                bool wasModified = false;
+            struct ArchiveHeader {
+                uint32_t magic;
+                uint32_t version;
+                uint64_t entryCount;
             };
 
-            static SpvCacheEntry TryFindCacheEntry(const ShaderStageFile& shaderFile,
-                const std::vector<std::string>& macros, bool& success);
+            struct ArchiveEntry {
+                uint64_t key;
+                uint64_t offset;
+                uint64_t wordCount;
+            };
+
+            static std::vector<uint32_t> Compile(const ShaderStageFile& shaderFile,
+                const VariantDesc& variant, bool useCache, bool& success);
+
+            static bool TryFindCacheEntry(uint64_t key, std::vector<uint32_t>& binary);
+
+            static void AddCacheEntry(uint64_t key, const std::vector<uint32_t>& binary);
+
+            static uint64_t CalculateKey(const std::string& glslCode, const VariantDesc& variant);
+
+            static void RecordVariant(const VariantDesc& variant);
+
+            static std::vector<VariantDesc> LoadVariants();
+
+            static void SaveVariants();
+
+            static void SaveArchive();
 
-            static void AddCacheEntry(const ShaderStageFile& shaderFile,
-                const std::vector<std::string>& macros, const std::vector<uint32_t>& binary);
+            static Common::MemoryMappedFile archive;
+            static const ArchiveEntry* archiveEntries;
+            static uint64_t archiveEntryCount;
 
-            static Hash CalculateHash(const ShaderStageFile& shaderFile,
-                const std::vector<std::string>& macros);
+            static std::mutex cacheMutex;
+            static std::unordered_map<uint64_t, std::vector<uint32_t>> compiledEntries;
+            // Keys of archive entries which were found in this session
+            static std::unordered_set<uint64_t> usedArchiveKeys;
+            static bool warmedUp;
 
-            static std::unordered_map<size_t, SpvCacheEntry> cache;
+            static std::mutex variantMutex;
+            static std::unordered_map<Hash, VariantDesc> recordedVariants;
 
             static const std::string cachePath;
+            static const std::string archiveFilename;
+            static const std::string variantsFilename;
 
         };
 
     }
 
-}
\ No newline at end of file
+}
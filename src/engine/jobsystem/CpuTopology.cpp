@@ -0,0 +1,262 @@
+#include "CpuTopology.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+
+#ifdef AE_OS_WINDOWS
+#define NOMINMAX
+#include "Windows.h"
+#endif
+
+#ifdef AE_OS_LINUX
+#include <filesystem>
+#include <sched.h>
+#endif
+
+namespace Atlas {
+
+#ifdef AE_OS_LINUX
+    static bool ReadFirstLine(const std::string& path, std::string& line) {
+
+        std::ifstream stream(path);
+        if (!stream.is_open())
+            return false;
+
+        return static_cast<bool>(std::getline(stream, line));
+
+    }
+
+    // Parses the kernel cpu list format, e.g. "0-3,8,10-11"
+    static std::vector<int32_t> ParseCpuList(const std::string& list) {
+
+        std::vector<int32_t> processors;
+
+        size_t pos = 0;
+        while (pos < list.size()) {
+            auto end = list.find(',', pos);
+            if (end == std::string::npos)
+                end = list.size();
+
+            auto range = list.substr(pos, end - pos);
+            auto separator = range.find('-');
+            if (!range.empty()) {
+                auto first = std::atoi(range.c_str());
+                auto last = separator != std::string::npos ? std::atoi(range.c_str() + separator + 1) : first;
+                for (int32_t i = first; i <= last; i++)
+                    processors.push_back(i);
+            }
+
+            pos = end + 1;
+        }
+
+        return processors;
+
+    }
+#endif
+
+    CpuTopology CpuTopology::Detect() {
+
+        CpuTopology topology;
+
+        // Node ids aren't necessarily contiguous, they are mapped to a dense range below
+        std::map<int32_t, int32_t> nodeIndices;
+        auto getNodeIndex = [&](int32_t nodeId) {
+            auto [iter, inserted] = nodeIndices.try_emplace(nodeId, int32_t(nodeIndices.size()));
+            return iter->second;
+        };
+
+#ifdef AE_OS_LINUX
+        std::string onlineList;
+        if (ReadFirstLine("/sys/devices/system/cpu/online", onlineList)) {
+            // Containers and taskset restrict the processors we can actually use
+            cpu_set_t affinity;
+            CPU_ZERO(&affinity);
+            bool hasAffinity = sched_getaffinity(0, sizeof(affinity), &affinity) == 0;
+
+            std::map<int32_t, int32_t> processorNodes;
+            std::error_code errorCode;
+            for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", errorCode)) {
+                auto name = entry.path().filename().string();
+                if (name.size() <= 4 || name.compare(0, 4, "node") != 0 || !std::isdigit(name[4]))
+                    continue;
+
+                std::string cpuList;
+                if (!ReadFirstLine((entry.path() / "cpulist").string(), cpuList))
+                    continue;
+
+                auto nodeId = std::atoi(name.c_str() + 4);
+                for (auto processor : ParseCpuList(cpuList))
+                    processorNodes[processor] = nodeId;
+            }
+
+            // Physical cores are identified by their package and core id
+            std::map<std::pair<int32_t, int32_t>, size_t> coreIndices;
+            for (auto processor : ParseCpuList(onlineList)) {
+                if (hasAffinity && (processor >= CPU_SETSIZE || !CPU_ISSET(processor, &affinity)))
+                    continue;
+
+                auto topologyPath = "/sys/devices/system/cpu/cpu" + std::to_string(processor) + "/topology/";
+
+                std::string line;
+                auto packageId = ReadFirstLine(topologyPath + "physical_package_id", line) ? std::atoi(line.c_str()) : 0;
+                auto coreId = ReadFirstLine(topologyPath + "core_id", line) ? std::atoi(line.c_str()) : processor;
+
+                auto key = std::make_pair(packageId, coreId);
+                auto iter = coreIndices.find(key);
+                if (iter == coreIndices.end()) {
+                    auto nodeIter = processorNodes.find(processor);
+                    auto nodeId = nodeIter != processorNodes.end() ? nodeIter->second : 0;
+
+                    iter = coreIndices.emplace(key, topology.cores.size()).first;
+                    topology.cores.push_back(CpuCore { .nodeId = getNodeIndex(nodeId), .logicalProcessors = {} });
+                }
+
+                topology.cores[iter->second].logicalProcessors.push_back(processor);
+            }
+        }
+#endif
+#ifdef AE_OS_WINDOWS
+        DWORD length = 0;
+        GetLogicalProcessorInformation(nullptr, &length);
+
+        std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> infos(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+        DWORD_PTR processMask = 0, systemMask = 0;
+        if (!infos.empty() && GetLogicalProcessorInformation(infos.data(), &length) &&
+            GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask)) {
+            std::vector<std::pair<ULONG_PTR, int32_t>> nodeMasks;
+            for (const auto& info : infos) {
+                if (info.Relationship == RelationNumaNode)
+                    nodeMasks.emplace_back(info.ProcessorMask, int32_t(info.NumaNode.NodeNumber));
+            }
+
+            for (const auto& info : infos) {
+                if (info.Relationship != RelationProcessorCore)
+                    continue;
+
+                auto mask = info.ProcessorMask & processMask;
+                if (!mask)
+                    continue;
+
+                int32_t nodeId = 0;
+                for (const auto& [nodeMask, node] : nodeMasks) {
+                    if (nodeMask & mask)
+                        nodeId = node;
+                }
+
+                CpuCore core { .nodeId = getNodeIndex(nodeId) };
+                for (int32_t i = 0; i < int32_t(sizeof(ULONG_PTR) * 8); i++) {
+                    if (mask & (ULONG_PTR(1) << i))
+                        core.logicalProcessors.push_back(i);
+                }
+                topology.cores.push_back(core);
+            }
+        }
+#endif
+
+        // Without any information every logical processor is treated as a physical core
+        if (topology.cores.empty()) {
+            nodeIndices.clear();
+            auto processorCount = std::max(1, int32_t(std::thread::hardware_concurrency()));
+            for (int32_t i = 0; i < processorCount; i++)
+                topology.cores.push_back(CpuCore { .nodeId = 0, .logicalProcessors = { i } });
+        }
+
+        std::sort(topology.cores.begin(), topology.cores.end(), [](const CpuCore& core0, const CpuCore& core1) {
+            return core0.logicalProcessors.front() < core1.logicalProcessors.front();
+            });
+
+        topology.nodeCount = std::max(1, int32_t(nodeIndices.size()));
+
+        return topology;
+
+    }
+
+    int32_t CpuTopology::GetLogicalProcessorCount() const {
+
+        int32_t count = 0;
+        for (const auto& core : cores)
+            count += int32_t(core.logicalProcessors.size());
+
+        return count;
+
+    }
+
+    int32_t CpuTopology::GetPhysicalCoreCount() const {
+
+        return int32_t(cores.size());
+
+    }
+
+    std::vector<CpuCore> CpuTopology::GetProcessorPlacements(int32_t count, bool skipFirst) const {
+
+        auto coreOrder = GetInterleavedCoreOrder();
+
+        size_t maxSiblingCount = 0;
+        for (const auto& core : cores)
+            maxSiblingCount = std::max(maxSiblingCount, core.logicalProcessors.size());
+
+        // First processors of all cores, then the second SMT siblings and so on
+        std::vector<CpuCore> processors;
+        for (size_t sibling = 0; sibling < maxSiblingCount; sibling++) {
+            for (auto coreIdx : coreOrder) {
+                const auto& core = cores[coreIdx];
+                if (sibling >= core.logicalProcessors.size())
+                    continue;
+
+                auto processor = core.logicalProcessors[sibling];
+                if (skipFirst && processor == cores.front().logicalProcessors.front())
+                    continue;
+
+                processors.push_back(CpuCore { .nodeId = core.nodeId, .logicalProcessors = { processor } });
+            }
+        }
+
+        // There is just a single processor, which needs to be shared with the main thread
+        if (processors.empty())
+            processors.push_back(cores.front());
+
+        std::vector<CpuCore> placements;
+        for (int32_t i = 0; i < count; i++)
+            placements.push_back(processors[i % processors.size()]);
+
+        return placements;
+
+    }
+
+    std::vector<CpuCore> CpuTopology::GetCorePlacements(int32_t count) const {
+
+        auto coreOrder = GetInterleavedCoreOrder();
+        std::reverse(coreOrder.begin(), coreOrder.end());
+
+        std::vector<CpuCore> placements;
+        for (int32_t i = 0; i < count; i++)
+            placements.push_back(cores[coreOrder[i % coreOrder.size()]]);
+
+        return placements;
+
+    }
+
+    std::vector<int32_t> CpuTopology::GetInterleavedCoreOrder() const {
+
+        std::vector<std::vector<int32_t>> nodeCores(nodeCount);
+        for (int32_t i = 0; i < int32_t(cores.size()); i++)
+            nodeCores[cores[i].nodeId].push_back(i);
+
+        std::vector<int32_t> coreOrder;
+        for (size_t i = 0; coreOrder.size() < cores.size(); i++) {
+            for (const auto& coresOfNode : nodeCores) {
+                if (i < coresOfNode.size())
+                    coreOrder.push_back(coresOfNode[i]);
+            }
+        }
+
+        return coreOrder;
+
+    }
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "../System.h"
+
+#include <vector>
+
+namespace Atlas {
+
+    struct CpuCore {
+        int32_t nodeId = 0;
+
+        // Logical processors of this physical core, more than one if SMT is enabled
+        std::vector<int32_t> logicalProcessors;
+    };
+
+    /*
+     * Processor layout of the machine, restricted to the processors the process is allowed to run on.
+     * On Linux this is read from /sys, on Windows it's queried from the OS. Otherwise every logical
+     * processor is assumed to be a physical core on a single node.
+     */
+    class CpuTopology {
+
+    public:
+        static CpuTopology Detect();
+
+        int32_t GetLogicalProcessorCount() const;
+
+        int32_t GetPhysicalCoreCount() const;
+
+        /**
+         * Distributes workers over single logical processors. Each physical core gets one worker
+         * before SMT siblings are used and consecutive workers alternate between NUMA nodes.
+         * @param count The number of workers
+         * @param skipFirst Leaves the first logical processor to the main thread
+         */
+        std::vector<CpuCore> GetProcessorPlacements(int32_t count, bool skipFirst) const;
+
+        /**
+         * Distributes workers over whole physical cores, starting from the last core. This way
+         * pools with fewer workers stay away from the main thread, which usually runs on the first core.
+         * @param count The number of workers
+         */
+        std::vector<CpuCore> GetCorePlacements(int32_t count) const;
+
+        std::vector<CpuCore> cores;
+        int32_t nodeCount = 1;
+
+    private:
+        std::vector<int32_t> GetInterleavedCoreOrder() const;
+
+    };
+
+}
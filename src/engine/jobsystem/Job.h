@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../System.h"
+#include "JobFunction.h"
 
 #include <atomic>
 #include <functional>
@@ -19,14 +20,41 @@ namespace Atlas {
         void* userData = nullptr;
     };
 
+    struct JobBatch;
+    class JobGroup;
+
     struct Job {
         int32_t idx = 0;
         JobPriority priority = JobPriority::Low;
 
-        std::atomic_int32_t* counter = 0;
-        std::function<void(JobData&)> function;
+        JobGroup* group = nullptr;
+        JobBatch* batch = nullptr;
 
         void* userData = nullptr;
     };
 
-}
\ No newline at end of file
+    /*
+     * All jobs of a single submission share one batch, such that the job function is stored only once.
+     * The jobs themselves are placed in memory right after the batch. Batches are recycled by the JobAllocator.
+     */
+    struct alignas(64) JobBatch {
+        JobFunction function;
+
+        std::atomic_int32_t refCount = 0;
+        // Number of job groups which need to finish before the batch can be submitted
+        std::atomic_int32_t dependencyCount = 0;
+
+        int32_t jobCount = 0;
+        int32_t capacity = 0;
+        int32_t sizeClass = 0;
+
+        JobBatch* next = nullptr;
+
+#ifdef AE_JOBSYSTEM_PROFILING
+        uint64_t enqueueTime = 0;
+#endif
+
+        inline Job* GetJobs() { return reinterpret_cast<Job*>(this + 1); }
+    };
+
+}
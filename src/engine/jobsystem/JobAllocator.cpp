@@ -0,0 +1,137 @@
+#include "JobAllocator.h"
+
+#include <new>
+
+namespace Atlas {
+
+    std::mutex JobAllocator::mutex;
+    JobAllocator::FreeList JobAllocator::sharedFreeLists[sizeClassCount];
+
+    thread_local JobAllocator::ThreadCache JobAllocator::threadCache;
+
+    JobBatch* JobAllocator::Allocate(int32_t jobCount) {
+
+        auto sizeClass = GetSizeClass(jobCount);
+        auto& freeList = threadCache.freeLists[sizeClass];
+
+        // Refill the thread cache in bulk to keep the shared lock rare
+        if (!freeList.head) {
+            std::scoped_lock lock(mutex);
+            auto maxCount = std::max(1, GetMaxCachedBatchCount(sizeClass) / 2);
+            MoveBatches(sharedFreeLists[sizeClass], freeList, maxCount);
+        }
+
+        if (!freeList.head)
+            return CreateBatch(sizeClass);
+
+        auto batch = freeList.head;
+        freeList.head = batch->next;
+        freeList.count--;
+
+        batch->next = nullptr;
+        return batch;
+
+    }
+
+    void JobAllocator::Free(JobBatch* batch) {
+
+        batch->function.Reset();
+
+        auto& freeList = threadCache.freeLists[batch->sizeClass];
+        batch->next = freeList.head;
+        freeList.head = batch;
+        freeList.count++;
+
+        // Batches are usually allocated by one thread and freed by another, so give
+        // half of them back to the shared list as soon as the cache runs full
+        auto maxCount = GetMaxCachedBatchCount(batch->sizeClass);
+        if (freeList.count > maxCount) {
+            std::scoped_lock lock(mutex);
+            MoveBatches(freeList, sharedFreeLists[batch->sizeClass], freeList.count / 2);
+        }
+
+    }
+
+    void JobAllocator::Trim() {
+
+        std::scoped_lock lock(mutex);
+        for (auto& freeList : sharedFreeLists) {
+            while (freeList.head) {
+                auto batch = freeList.head;
+                freeList.head = batch->next;
+                DestroyBatch(batch);
+            }
+            freeList.count = 0;
+        }
+
+    }
+
+    JobAllocator::ThreadCache::~ThreadCache() {
+
+        // Batches are freed immediately here, the shared lists might already be destroyed
+        for (auto& freeList : freeLists) {
+            while (freeList.head) {
+                auto batch = freeList.head;
+                freeList.head = batch->next;
+                DestroyBatch(batch);
+            }
+        }
+
+    }
+
+    JobBatch* JobAllocator::CreateBatch(int32_t sizeClass) {
+
+        auto capacity = int32_t(1) << sizeClass;
+        auto size = sizeof(JobBatch) + size_t(capacity) * sizeof(Job);
+
+        auto memory = ::operator new(size, std::align_val_t(alignof(JobBatch)));
+        auto batch = new (memory) JobBatch();
+        batch->capacity = capacity;
+        batch->sizeClass = sizeClass;
+
+        auto jobs = batch->GetJobs();
+        for (int32_t i = 0; i < capacity; i++)
+            new (&jobs[i]) Job();
+
+        return batch;
+
+    }
+
+    void JobAllocator::DestroyBatch(JobBatch* batch) {
+
+        batch->~JobBatch();
+        ::operator delete(batch, std::align_val_t(alignof(JobBatch)));
+
+    }
+
+    int32_t JobAllocator::GetSizeClass(int32_t jobCount) {
+
+        int32_t sizeClass = 0;
+        while ((int32_t(1) << sizeClass) < jobCount)
+            sizeClass++;
+        return sizeClass;
+
+    }
+
+    int32_t JobAllocator::GetMaxCachedBatchCount(int32_t sizeClass) {
+
+        // Keep less of the larger batches around
+        return std::max(2, 64 >> std::max(0, sizeClass - 4));
+
+    }
+
+    void JobAllocator::MoveBatches(FreeList& src, FreeList& dst, int32_t count) {
+
+        for (int32_t i = 0; i < count && src.head; i++) {
+            auto batch = src.head;
+            src.head = batch->next;
+            src.count--;
+
+            batch->next = dst.head;
+            dst.head = batch;
+            dst.count++;
+        }
+
+    }
+
+}
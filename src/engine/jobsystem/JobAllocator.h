@@ -0,0 +1,55 @@
+#pragma once
+
+#include "../System.h"
+#include "Job.h"
+
+#include <mutex>
+
+namespace Atlas {
+
+    /*
+     * Recycles job batches, such that job submission doesn't allocate in steady state.
+     * Batches are bucketed into power of two size classes by their job count. Each thread keeps
+     * a small cache of free batches, which exchanges batches with a shared free list in bulk.
+     */
+    class JobAllocator {
+
+    public:
+        static JobBatch* Allocate(int32_t jobCount);
+
+        static void Free(JobBatch* batch);
+
+        static void Trim();
+
+    private:
+        static constexpr int32_t sizeClassCount = 32;
+
+        struct FreeList {
+            JobBatch* head = nullptr;
+            int32_t count = 0;
+        };
+
+        struct ThreadCache {
+            ~ThreadCache();
+
+            FreeList freeLists[sizeClassCount];
+        };
+
+        static JobBatch* CreateBatch(int32_t sizeClass);
+
+        static void DestroyBatch(JobBatch* batch);
+
+        static int32_t GetSizeClass(int32_t jobCount);
+
+        static int32_t GetMaxCachedBatchCount(int32_t sizeClass);
+
+        static void MoveBatches(FreeList& src, FreeList& dst, int32_t count);
+
+        static std::mutex mutex;
+        static FreeList sharedFreeLists[sizeClassCount];
+
+        static thread_local ThreadCache threadCache;
+
+    };
+
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "../System.h"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Atlas {
+
+    struct JobData;
+
+    /*
+     * Type erased job callable with an inline buffer. Callables with captures up to the
+     * inline size are stored without any heap allocation, larger captures fall back to the heap.
+     * Unlike std::function this isn't copyable, since a job function is only stored once.
+     */
+    class JobFunction {
+
+    public:
+        static constexpr size_t inlineSize = 64;
+
+        JobFunction() = default;
+
+        JobFunction(const JobFunction&) = delete;
+
+        JobFunction& operator=(const JobFunction&) = delete;
+
+        ~JobFunction() {
+
+            Reset();
+
+        }
+
+        template<class F>
+        void Set(F&& func) {
+
+            using Func = std::decay_t<F>;
+
+            Reset();
+
+            if constexpr (sizeof(Func) <= inlineSize && alignof(Func) <= alignof(std::max_align_t)) {
+                new (storage) Func(std::forward<F>(func));
+                invoke = [](void* ptr, JobData& data) { (*static_cast<Func*>(ptr))(data); };
+                destroy = [](void* ptr) { static_cast<Func*>(ptr)->~Func(); };
+            }
+            else {
+                *reinterpret_cast<Func**>(storage) = new Func(std::forward<F>(func));
+                invoke = [](void* ptr, JobData& data) { (**static_cast<Func**>(ptr))(data); };
+                destroy = [](void* ptr) { delete *static_cast<Func**>(ptr); };
+            }
+
+        }
+
+        inline void Reset() {
+
+            if (destroy)
+                destroy(storage);
+
+            invoke = nullptr;
+            destroy = nullptr;
+
+        }
+
+        inline void operator()(JobData& data) {
+
+            invoke(storage, data);
+
+        }
+
+    private:
+        using InvokeFunction = void(*)(void*, JobData&);
+        using DestroyFunction = void(*)(void*);
+
+        alignas(std::max_align_t) std::byte storage[inlineSize];
+
+        InvokeFunction invoke = nullptr;
+        DestroyFunction destroy = nullptr;
+
+    };
+
+}
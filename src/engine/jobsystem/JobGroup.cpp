@@ -2,13 +2,12 @@
 
 namespace Atlas {
 
-    JobGroup::JobGroup(JobPriority priority) : priority(priority) {
-
-
-
-    }
+    JobGroup::JobGroup(JobPriority priority) : priority(priority) {}
 
     JobGroup::~JobGroup() {
+
+        // The last job of the group might still be launching continuations
+        std::scoped_lock lock(continuationMutex);
         
         AE_ASSERT(HasFinished() && "Job group destructed before every job executed");
 
@@ -20,4 +19,66 @@ namespace Atlas {
 
     }
 
-}
\ No newline at end of file
+    bool JobGroup::AddContinuation(JobBatch* batch) {
+
+        std::scoped_lock lock(continuationMutex);
+
+        auto value = counter.load();
+        do {
+            // No jobs in flight, so there is nothing to wait for
+            if ((value & jobCountMask) == 0)
+                return false;
+        } while (!counter.compare_exchange_weak(value, value | continuationFlag));
+
+        continuations.push_back(batch);
+        return true;
+
+    }
+
+    bool JobGroup::FinishJob(std::vector<JobBatch*>& readyContinuations) {
+
+        // Fast path, nothing depends on this group and nobody sleeps on it
+        auto value = counter.fetch_sub(1);
+        if ((value & jobCountMask) != 1 || (value & ~jobCountMask) == 0)
+            return false;
+
+        std::scoped_lock lock(continuationMutex);
+
+        // New jobs might have been added in the meantime, then the last of those is responsible
+        value = counter.load();
+        if ((value & jobCountMask) != 0)
+            return false;
+
+        readyContinuations.insert(readyContinuations.end(), continuations.begin(), continuations.end());
+        continuations.clear();
+
+        // Notify while holding the lock, the destructor can't free the group before
+        counter.fetch_and(jobCountMask);
+        if (value & waiterFlag)
+            counter.notify_all();
+
+        return !readyContinuations.empty();
+
+    }
+
+    void JobGroup::Sleep() {
+
+        int32_t value;
+        {
+            std::scoped_lock lock(continuationMutex);
+
+            value = counter.load();
+            do {
+                if ((value & jobCountMask) == 0)
+                    return;
+            } while (!counter.compare_exchange_weak(value, value | waiterFlag));
+
+            value |= waiterFlag;
+        }
+
+        // Returns as soon as the counter changes, so callers need to check again
+        counter.wait(value);
+
+    }
+
+}
@@ -4,6 +4,8 @@
 #include "Job.h"
 
 #include <atomic>
+#include <mutex>
+#include <vector>
 
 namespace Atlas {
 
@@ -21,6 +23,25 @@ namespace Atlas {
         JobPriority priority = JobPriority::Low;
         std::atomic_int32_t counter = 0;
 
+    private:
+        friend class JobSystem;
+
+        // Set in the counter as long as there are batches waiting for this group to finish or there are
+        // sleeping threads waiting on it. This way the last job notices atomically with its decrement
+        // that it needs to launch the continuations or wake up the threads.
+        static constexpr int32_t continuationFlag = 1 << 30;
+        static constexpr int32_t waiterFlag = 1 << 29;
+        static constexpr int32_t jobCountMask = waiterFlag - 1;
+
+        bool AddContinuation(JobBatch* batch);
+
+        bool FinishJob(std::vector<JobBatch*>& readyContinuations);
+
+        void Sleep();
+
+        std::mutex continuationMutex;
+        std::vector<JobBatch*> continuations;
+
     };
 
-}
\ No newline at end of file
+}
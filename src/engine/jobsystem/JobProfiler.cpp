@@ -0,0 +1,450 @@
+#include "JobProfiler.h"
+#include "JobSystem.h"
+#include "../Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+namespace Atlas {
+
+    std::mutex JobProfiler::threadBuffersMutex;
+    std::vector<std::unique_ptr<JobProfiler::ThreadBuffer>> JobProfiler::threadBuffers;
+
+    std::mutex JobProfiler::namesMutex;
+    std::vector<std::string> JobProfiler::names;
+    std::unordered_map<std::string, uint32_t> JobProfiler::nameIds;
+
+    std::mutex JobProfiler::gpuEventsMutex;
+    std::deque<JobProfiler::GpuEvent> JobProfiler::gpuEvents;
+
+    std::mutex JobProfiler::frameMutex;
+    size_t JobProfiler::frameIdx = -1;
+    uint64_t JobProfiler::frameStartTimes[frameHistoryCount];
+    uint64_t JobProfiler::lastCounters[static_cast<int>(JobPriority::Count)][4];
+    JobPoolStats JobProfiler::poolStats[static_cast<int>(JobPriority::Count)];
+
+    // Counters are only written by a single thread, so there is no need for an atomic read-modify-write
+    static inline void AddToCounter(std::atomic_uint64_t& counter, uint64_t value) {
+
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+
+    }
+
+    static inline float ToMilliseconds(uint64_t nanoseconds) {
+
+        return float(double(nanoseconds) / 1000000.0);
+
+    }
+
+    static std::string EscapeJson(const std::string& string) {
+
+        std::string escaped;
+        for (auto c : string) {
+            if (c == '"' || c == '\\')
+                escaped.push_back('\\');
+            if (static_cast<unsigned char>(c) < 0x20)
+                continue;
+            escaped.push_back(c);
+        }
+
+        return escaped;
+
+    }
+
+    void JobProfiler::BeginFrame() {
+
+        std::scoped_lock lock(frameMutex);
+
+        auto time = GetTimestamp();
+
+        uint64_t counters[static_cast<int>(JobPriority::Count)][4] = {};
+        uint64_t maxQueueTimes[static_cast<int>(JobPriority::Count)] = {};
+        {
+            std::scoped_lock bufferLock(threadBuffersMutex);
+            for (auto& buffer : threadBuffers) {
+                for (int32_t i = 0; i < static_cast<int>(JobPriority::Count); i++) {
+                    auto& bufferCounters = buffer->counters[i];
+                    counters[i][0] += bufferCounters.jobCount.load(std::memory_order_relaxed);
+                    counters[i][1] += bufferCounters.busyTime.load(std::memory_order_relaxed);
+                    counters[i][2] += bufferCounters.queueTime.load(std::memory_order_relaxed);
+                    counters[i][3] += bufferCounters.waitTime.load(std::memory_order_relaxed);
+                    maxQueueTimes[i] = std::max(maxQueueTimes[i], bufferCounters.maxQueueTime.exchange(0));
+                }
+            }
+        }
+
+        for (int32_t i = 0; i < static_cast<int>(JobPriority::Count); i++) {
+            auto priority = static_cast<JobPriority>(i);
+
+            // Counters only increase, the difference to the last frame is what happened in between
+            uint64_t deltas[4];
+            for (int32_t j = 0; j < 4; j++) {
+                deltas[j] = counters[i][j] - lastCounters[i][j];
+                lastCounters[i][j] = counters[i][j];
+            }
+
+            if (frameIdx == size_t(-1))
+                continue;
+
+            auto frameTime = time - frameStartTimes[frameIdx % frameHistoryCount];
+            auto workerCount = std::max(1, JobSystem::GetWorkerCount(priority));
+            poolStats[i] = JobPoolStats {
+                .queueDepth = JobSystem::GetQueuedJobCount(priority),
+                .executedJobCount = int32_t(deltas[0]),
+                .utilization = frameTime > 0 ? float(double(deltas[1]) / (double(frameTime) * double(workerCount))) : 0.0f,
+                .averageQueueTime = deltas[0] > 0 ? ToMilliseconds(deltas[2] / deltas[0]) : 0.0f,
+                .maxQueueTime = ToMilliseconds(maxQueueTimes[i]),
+                .waitTime = ToMilliseconds(deltas[3])
+            };
+        }
+
+        frameIdx++;
+        frameStartTimes[frameIdx % frameHistoryCount] = time;
+
+        // GPU events of frames which aren't in the history anymore can't be exported
+        if (frameIdx >= frameHistoryCount) {
+            auto oldestTime = frameStartTimes[(frameIdx + 1) % frameHistoryCount];
+
+            std::scoped_lock gpuLock(gpuEventsMutex);
+            while (!gpuEvents.empty() && gpuEvents.front().endTime < oldestTime)
+                gpuEvents.pop_front();
+        }
+
+    }
+
+    JobPoolStats JobProfiler::GetPoolStats(JobPriority priority) {
+
+        std::scoped_lock lock(frameMutex);
+        return poolStats[static_cast<int>(priority)];
+
+    }
+
+    size_t JobProfiler::GetFrameIndex() {
+
+        std::scoped_lock lock(frameMutex);
+        return frameIdx;
+
+    }
+
+    bool JobProfiler::ExportChromeTrace(const std::string& filename, size_t firstFrame, size_t lastFrame) {
+
+#ifndef AE_JOBSYSTEM_PROFILING
+        Log::Warning("Job system profiling isn't compiled in, the exported trace will be empty");
+#endif
+
+        uint64_t rangeStart, rangeEnd;
+        std::vector<uint64_t> frameTimes;
+        {
+            std::scoped_lock lock(frameMutex);
+
+            if (frameIdx == size_t(-1) || firstFrame > lastFrame || lastFrame >= frameIdx ||
+                frameIdx - firstFrame >= frameHistoryCount) {
+                Log::Error("Frame range isn't available for the job system trace export");
+                return false;
+            }
+
+            for (auto i = firstFrame; i <= lastFrame + 1; i++)
+                frameTimes.push_back(frameStartTimes[i % frameHistoryCount]);
+
+            rangeStart = frameTimes.front();
+            rangeEnd = frameTimes.back();
+        }
+
+        std::ofstream stream(filename);
+        if (!stream.is_open()) {
+            Log::Error("Couldn't open file " + filename + " for the job system trace export");
+            return false;
+        }
+
+        // Chrome trace timestamps are in microseconds
+        auto toMicroseconds = [&](uint64_t time) {
+            return std::to_string(double(int64_t(time - rangeStart)) / 1000.0);
+        };
+        auto toDuration = [&](uint64_t startTime, uint64_t endTime) {
+            return std::to_string(double(endTime - startTime) / 1000.0);
+        };
+
+        const char* priorityNames[] = { "High", "Medium", "Low", "All" };
+
+        bool first = true;
+        auto writeEvent = [&](const std::string& event) {
+            stream << (first ? "\n" : ",\n") << event;
+            first = false;
+        };
+
+        stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+        writeEvent("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"CPU\"}}");
+        writeEvent("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"GPU\"}}");
+        writeEvent("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Frames\"}}");
+
+        for (size_t i = 0; i + 1 < frameTimes.size(); i++) {
+            writeEvent("{\"name\":\"Frame " + std::to_string(firstFrame + i) + "\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":" +
+                toMicroseconds(frameTimes[i]) + ",\"dur\":" + toDuration(frameTimes[i], frameTimes[i + 1]) + "}");
+        }
+
+        std::vector<std::string> nameCopies;
+        {
+            std::scoped_lock lock(namesMutex);
+            nameCopies = names;
+        }
+
+        // Names registered after the copy was taken are left empty
+        auto getName = [&](uint32_t nameId) {
+            return nameId < nameCopies.size() ? EscapeJson(nameCopies[nameId]) : std::string();
+        };
+
+        std::vector<Event> events;
+        {
+            std::scoped_lock lock(threadBuffersMutex);
+            for (auto& buffer : threadBuffers) {
+                auto tid = std::to_string(buffer->threadId);
+                {
+                    std::scoped_lock nameLock(buffer->nameMutex);
+                    writeEvent("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + tid +
+                        ",\"args\":{\"name\":\"" + EscapeJson(buffer->name) + "\"}}");
+                }
+
+                events.clear();
+                ReadEvents(*buffer, events);
+
+                for (const auto& event : events) {
+                    if (event.endTime < rangeStart || event.startTime > rangeEnd)
+                        continue;
+
+                    auto type = static_cast<EventType>(event.type & 0xFF);
+                    auto priority = std::min(int32_t((event.type >> 8) & 0xFF), static_cast<int>(JobPriority::Count));
+                    auto data = uint32_t(event.type >> 32);
+
+                    auto timing = ",\"pid\":1,\"tid\":" + tid + ",\"ts\":" + toMicroseconds(event.startTime) +
+                        ",\"dur\":" + toDuration(event.startTime, event.endTime);
+
+                    switch (type) {
+                    case EventType::Job:
+                        writeEvent("{\"name\":\"Job\",\"cat\":\"" + std::string(priorityNames[priority]) + "\",\"ph\":\"X\"" +
+                            timing + ",\"args\":{\"queueTime\":" + toDuration(event.enqueueTime, event.startTime) + "}}");
+                        break;
+                    case EventType::Wait:
+                        writeEvent("{\"name\":\"Wait\",\"cat\":\"" + std::string(priorityNames[priority]) + "\",\"ph\":\"X\"" +
+                            timing + "}");
+                        break;
+                    case EventType::Scope:
+                        writeEvent("{\"name\":\"" + getName(data) +
+                            "\",\"cat\":\"Scope\",\"ph\":\"X\"" + timing + "}");
+                        break;
+                    }
+                }
+            }
+        }
+
+        {
+            std::scoped_lock lock(gpuEventsMutex);
+
+            std::vector<uint32_t> trackIds;
+            for (const auto& event : gpuEvents) {
+                if (event.endTime < rangeStart || event.startTime > rangeEnd)
+                    continue;
+
+                if (std::find(trackIds.begin(), trackIds.end(), event.trackId) == trackIds.end()) {
+                    trackIds.push_back(event.trackId);
+                    writeEvent("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":2,\"tid\":" + std::to_string(event.trackId) +
+                        ",\"args\":{\"name\":\"" + getName(event.trackId) + "\"}}");
+                }
+
+                writeEvent("{\"name\":\"" + getName(event.nameId) + "\",\"cat\":\"GPU\",\"ph\":\"X\",\"pid\":2,\"tid\":" +
+                    std::to_string(event.trackId) + ",\"ts\":" + toMicroseconds(event.startTime) + ",\"dur\":" +
+                    toDuration(event.startTime, event.endTime) + ",\"args\":{\"depth\":" + std::to_string(event.depth) + "}}");
+            }
+        }
+
+        stream << "\n]}\n";
+
+        return stream.good();
+
+    }
+
+    void JobProfiler::SetThreadName(const std::string& name) {
+
+        auto& buffer = GetThreadBuffer();
+
+        std::scoped_lock lock(buffer.nameMutex);
+        buffer.name = name;
+
+    }
+
+    void JobProfiler::BeginScope(const std::string& name) {
+
+        auto& buffer = GetThreadBuffer();
+        buffer.scopeStack.emplace_back(GetTimestamp(), GetNameId(name));
+
+    }
+
+    void JobProfiler::EndScope() {
+
+        auto& buffer = GetThreadBuffer();
+        if (buffer.scopeStack.empty())
+            return;
+
+        auto [startTime, nameId] = buffer.scopeStack.back();
+        buffer.scopeStack.pop_back();
+
+        WriteEvent(buffer, EventType::Scope, JobPriority::Count, nameId, 0, startTime, GetTimestamp());
+
+    }
+
+    void JobProfiler::RecordGpuQuery(const std::string& track, const std::string& name,
+        uint64_t startTime, uint64_t endTime, int32_t depth) {
+
+        auto trackId = GetNameId(track);
+        auto nameId = GetNameId(name);
+
+        std::scoped_lock lock(gpuEventsMutex);
+        gpuEvents.push_back(GpuEvent {
+            .trackId = trackId,
+            .nameId = nameId,
+            .startTime = startTime,
+            .endTime = endTime,
+            .depth = depth
+        });
+
+    }
+
+    uint64_t JobProfiler::GetTimestamp() {
+
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+
+    }
+
+    void JobProfiler::RecordJob(JobPriority priority, uint64_t enqueueTime, uint64_t startTime, uint64_t endTime) {
+
+        auto& buffer = GetThreadBuffer();
+        WriteEvent(buffer, EventType::Job, priority, 0, enqueueTime, startTime, endTime);
+
+        auto queueTime = startTime > enqueueTime ? startTime - enqueueTime : 0;
+
+        auto& counters = buffer.counters[static_cast<int>(priority)];
+        AddToCounter(counters.jobCount, 1);
+        AddToCounter(counters.busyTime, endTime - startTime);
+        AddToCounter(counters.queueTime, queueTime);
+
+        // The frame might reset the maximum concurrently
+        auto maxQueueTime = counters.maxQueueTime.load(std::memory_order_relaxed);
+        while (queueTime > maxQueueTime && !counters.maxQueueTime.compare_exchange_weak(maxQueueTime, queueTime,
+            std::memory_order_relaxed));
+
+    }
+
+    void JobProfiler::RecordWait(JobPriority priority, uint64_t startTime, uint64_t endTime) {
+
+        auto& buffer = GetThreadBuffer();
+        WriteEvent(buffer, EventType::Wait, priority, 0, startTime, startTime, endTime);
+
+        // Waits on all pools aren't accounted to a single pool
+        if (priority != JobPriority::Count)
+            AddToCounter(buffer.counters[static_cast<int>(priority)].waitTime, endTime - startTime);
+
+    }
+
+    void JobProfiler::WriteEvent(ThreadBuffer& buffer, EventType type, JobPriority priority, uint32_t data,
+        uint64_t enqueueTime, uint64_t startTime, uint64_t endTime) {
+
+        auto idx = buffer.writeIdx.load(std::memory_order_relaxed);
+
+        // Readers check the reserve index after reading, such that they notice overwritten events
+        buffer.reserveIdx.store(idx + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        auto& event = buffer.events[idx & (eventCapacity - 1)];
+        std::atomic_ref(event.type).store(uint64_t(type) | uint64_t(priority) << 8 | uint64_t(data) << 32, std::memory_order_relaxed);
+        std::atomic_ref(event.enqueueTime).store(enqueueTime, std::memory_order_relaxed);
+        std::atomic_ref(event.startTime).store(startTime, std::memory_order_relaxed);
+        std::atomic_ref(event.endTime).store(endTime, std::memory_order_relaxed);
+
+        buffer.writeIdx.store(idx + 1, std::memory_order_release);
+
+    }
+
+    void JobProfiler::ReadEvents(ThreadBuffer& buffer, std::vector<Event>& events) {
+
+        auto writeIdx = buffer.writeIdx.load(std::memory_order_acquire);
+        auto firstIdx = std::max(buffer.firstValidIdx.load(std::memory_order_relaxed),
+            writeIdx > eventCapacity ? writeIdx - eventCapacity : 0);
+
+        auto offset = events.size();
+        for (auto idx = firstIdx; idx < writeIdx; idx++) {
+            auto& event = buffer.events[idx & (eventCapacity - 1)];
+            events.push_back(Event {
+                .type = std::atomic_ref(event.type).load(std::memory_order_relaxed),
+                .enqueueTime = std::atomic_ref(event.enqueueTime).load(std::memory_order_relaxed),
+                .startTime = std::atomic_ref(event.startTime).load(std::memory_order_relaxed),
+                .endTime = std::atomic_ref(event.endTime).load(std::memory_order_relaxed)
+            });
+        }
+
+        // Everything the writer reserved in the meantime might have overwritten the oldest events
+        std::atomic_thread_fence(std::memory_order_acquire);
+        auto reserveIdx = buffer.reserveIdx.load(std::memory_order_relaxed);
+        if (reserveIdx > firstIdx + eventCapacity) {
+            auto overwrittenCount = std::min(size_t(reserveIdx - firstIdx - eventCapacity), events.size() - offset);
+            events.erase(events.begin() + offset, events.begin() + offset + overwrittenCount);
+        }
+
+    }
+
+    uint32_t JobProfiler::GetNameId(const std::string& name) {
+
+        std::scoped_lock lock(namesMutex);
+
+        auto [iter, inserted] = nameIds.try_emplace(name, uint32_t(names.size()));
+        if (inserted)
+            names.push_back(name);
+
+        return iter->second;
+
+    }
+
+    JobProfiler::ThreadBuffer& JobProfiler::GetThreadBuffer() {
+
+        // Gives the buffer back once the thread exits, such that threads of a restarted job system reuse them
+        struct ThreadBufferHolder {
+            ~ThreadBufferHolder() { if (buffer) buffer->inUse = false; }
+            ThreadBuffer* buffer = nullptr;
+        };
+        static thread_local ThreadBufferHolder holder;
+
+        if (holder.buffer)
+            return *holder.buffer;
+
+        std::scoped_lock lock(threadBuffersMutex);
+
+        ThreadBuffer* buffer = nullptr;
+        for (auto& threadBuffer : threadBuffers) {
+            if (!threadBuffer->inUse) {
+                buffer = threadBuffer.get();
+                buffer->firstValidIdx = buffer->writeIdx.load();
+                buffer->scopeStack.clear();
+                break;
+            }
+        }
+
+        if (!buffer) {
+            buffer = threadBuffers.emplace_back(std::make_unique<ThreadBuffer>()).get();
+            buffer->threadId = int32_t(threadBuffers.size());
+            buffer->events = std::make_unique<Event[]>(eventCapacity);
+        }
+
+        {
+            std::scoped_lock nameLock(buffer->nameMutex);
+            buffer->name = "Thread " + std::to_string(buffer->threadId);
+        }
+
+        buffer->inUse = true;
+        holder.buffer = buffer;
+
+        return *buffer;
+
+    }
+
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "../System.h"
+#include "Job.h"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Atlas {
+
+    struct JobPoolStats {
+        // Jobs which were waiting in the queues of the pool at the end of the frame
+        int32_t queueDepth = 0;
+        int32_t executedJobCount = 0;
+
+        // Time spent executing jobs relative to the frame time of all workers of the pool.
+        // Can be larger than one, since threads waiting on a group help out with the work.
+        float utilization = 0.0f;
+
+        // Times in milliseconds
+        float averageQueueTime = 0.0f;
+        float maxQueueTime = 0.0f;
+        float waitTime = 0.0f;
+    };
+
+    /*
+     * Records job enqueue, start and end times as well as waits on job groups. Each thread writes
+     * into its own lock-free ring buffer, only the oldest events are overwritten. The recording calls
+     * in the job system and the Graphics::Profiler are only compiled in with AE_JOBSYSTEM_PROFILING
+     * (ATLAS_JOBSYSTEM_PROFILING in CMake), otherwise the statistics and exports stay empty.
+     */
+    class JobProfiler {
+
+    public:
+        /**
+         * Begins a new frame and evaluates the statistics of the last frame. Is called externally by the engine.
+         */
+        static void BeginFrame();
+
+        /**
+         * Gets the statistics of a pool for the last frame
+         */
+        static JobPoolStats GetPoolStats(JobPriority priority);
+
+        /**
+         * Gets the index of the current frame, which can be used to select the range for an export
+         */
+        static size_t GetFrameIndex();
+
+        /**
+         * Exports all recorded events of a range of frames as a Chrome Trace Event file, which can
+         * be opened in chrome://tracing or Perfetto. GPU queries of the Graphics::Profiler are exported as well.
+         * @param filename The path of the resulting JSON file
+         * @param firstFrame The first frame of the range
+         * @param lastFrame The last frame of the range. Needs to be smaller than the current frame index.
+         * @return True if the export was successful
+         * @note Only the last frames are retained and the ring buffers might have overwritten older events.
+         */
+        static bool ExportChromeTrace(const std::string& filename, size_t firstFrame, size_t lastFrame);
+
+        /**
+         * Sets the name of the calling thread in the exported timeline
+         */
+        static void SetThreadName(const std::string& name);
+
+        /**
+         * Records a named scope on the calling thread, e.g. CPU side profiler queries
+         */
+        static void BeginScope(const std::string& name);
+
+        static void EndScope();
+
+        /**
+         * Records the GPU time of a query, used by the Graphics::Profiler
+         * @param track The name of the timeline, usually the thread name of the profiler
+         * @param name The name of the query
+         * @param startTime The start time on the CPU clock in nanoseconds
+         * @param endTime The end time on the CPU clock in nanoseconds
+         * @param depth The nesting level of the query
+         */
+        static void RecordGpuQuery(const std::string& track, const std::string& name,
+            uint64_t startTime, uint64_t endTime, int32_t depth);
+
+        static uint64_t GetTimestamp();
+
+        static void RecordJob(JobPriority priority, uint64_t enqueueTime, uint64_t startTime, uint64_t endTime);
+
+        static void RecordWait(JobPriority priority, uint64_t startTime, uint64_t endTime);
+
+        static constexpr size_t eventCapacity = 1 << 14;
+        static constexpr size_t frameHistoryCount = 256;
+
+    private:
+        enum class EventType : uint32_t {
+            Job = 0,
+            Wait,
+            Scope
+        };
+
+        // All members are accessed through std::atomic_ref, such that reading an event
+        // while it's overwritten isn't a data race. Torn events are detected by the write index.
+        struct Event {
+            uint64_t type = 0;
+            uint64_t enqueueTime = 0;
+            uint64_t startTime = 0;
+            uint64_t endTime = 0;
+        };
+
+        struct PoolCounters {
+            std::atomic_uint64_t jobCount = 0;
+            std::atomic_uint64_t busyTime = 0;
+            std::atomic_uint64_t queueTime = 0;
+            std::atomic_uint64_t waitTime = 0;
+            // Reset by each frame, all other counters are only increasing
+            std::atomic_uint64_t maxQueueTime = 0;
+        };
+
+        struct ThreadBuffer {
+            int32_t threadId = 0;
+
+            std::mutex nameMutex;
+            std::string name;
+
+            std::unique_ptr<Event[]> events;
+            // An event is reserved before and published after it's written
+            std::atomic_uint64_t reserveIdx = 0;
+            std::atomic_uint64_t writeIdx = 0;
+            // Events before this index belong to a thread which used the buffer before
+            std::atomic_uint64_t firstValidIdx = 0;
+
+            std::atomic_bool inUse = false;
+
+            // Only the owning thread writes the counters
+            PoolCounters counters[static_cast<int>(JobPriority::Count)];
+
+            // Start times of open scopes, only accessed by the owning thread
+            std::vector<std::pair<uint64_t, uint32_t>> scopeStack;
+        };
+
+        struct GpuEvent {
+            uint32_t trackId = 0;
+            uint32_t nameId = 0;
+            uint64_t startTime = 0;
+            uint64_t endTime = 0;
+            int32_t depth = 0;
+        };
+
+        // The type, priority and data are packed into the type member of the event
+        static void WriteEvent(ThreadBuffer& buffer, EventType type, JobPriority priority, uint32_t data,
+            uint64_t enqueueTime, uint64_t startTime, uint64_t endTime);
+
+        static void ReadEvents(ThreadBuffer& buffer, std::vector<Event>& events);
+
+        static uint32_t GetNameId(const std::string& name);
+
+        static ThreadBuffer& GetThreadBuffer();
+
+        static std::mutex threadBuffersMutex;
+        static std::vector<std::unique_ptr<ThreadBuffer>> threadBuffers;
+
+        static std::mutex namesMutex;
+        static std::vector<std::string> names;
+        static std::unordered_map<std::string, uint32_t> nameIds;
+
+        static std::mutex gpuEventsMutex;
+        static std::deque<GpuEvent> gpuEvents;
+
+        static std::mutex frameMutex;
+        static size_t frameIdx;
+        static uint64_t frameStartTimes[frameHistoryCount];
+        static uint64_t lastCounters[static_cast<int>(JobPriority::Count)][4];
+        static JobPoolStats poolStats[static_cast<int>(JobPriority::Count)];
+
+    };
+
+}
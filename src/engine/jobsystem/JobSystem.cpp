@@ -1,6 +1,8 @@
 #include "JobSystem.h"
 #include "Log.h"
 
+#include <chrono>
+
 #ifdef AE_OS_WINDOWS
 #define NOMINMAX
 #include "Windows.h"
@@ -13,16 +15,55 @@
 namespace Atlas {
 
     PriorityPool JobSystem::priorityPools[static_cast<int>(JobPriority::Count)];
+    int32_t JobSystem::idleSpinMicroseconds = 0;
+    CpuTopology JobSystem::cpuTopology;
+
+    std::atomic_int32_t JobSystem::outstandingJobCount = 0;
+    std::atomic_int32_t JobSystem::waitAllThreadCount = 0;
 
     void JobSystem::Init(const JobSystemConfig& config) {
 
-        auto highPrioThreadCount = std::max(1, config.highPriorityThreadCount);
-        auto mediumPrioThreadCount = std::max(1, config.mediumPriorityThreadCount);
-        auto lowPrioThreadCount = std::max(1, config.lowPriorityThreadCount);
+        cpuTopology = CpuTopology::Detect();
+
+        auto logicalProcessorCount = cpuTopology.GetLogicalProcessorCount();
+        auto physicalCoreCount = cpuTopology.GetPhysicalCoreCount();
+
+        // Lower priority pools share cores with the high priority pool instead of each getting a full set
+        auto highPrioThreadCount = config.highPriorityThreadCount > 0 ?
+            config.highPriorityThreadCount : std::max(1, logicalProcessorCount - 1);
+        auto mediumPrioThreadCount = config.mediumPriorityThreadCount > 0 ?
+            config.mediumPriorityThreadCount : std::max(1, physicalCoreCount / 2);
+        auto lowPrioThreadCount = config.lowPriorityThreadCount > 0 ?
+            config.lowPriorityThreadCount : std::max(1, physicalCoreCount / 4);
+
+        idleSpinMicroseconds = std::max(0, config.idleSpinMicroseconds);
+
+        // Worker counts and placements are set per pool below
+        PriorityPoolConfig poolConfig = {
+            .workerCount = 0,
+            .idleSpinMicroseconds = idleSpinMicroseconds,
+            .useRealtimePriority = config.useRealtimePriorities,
+            .useIdleScheduling = config.useIdleScheduling,
+            .workerPlacements = {}
+        };
+
+        poolConfig.workerCount = highPrioThreadCount;
+        if (config.pinWorkers)
+            poolConfig.workerPlacements = cpuTopology.GetProcessorPlacements(highPrioThreadCount, true);
+        priorityPools[static_cast<int>(JobPriority::High)].Init(JobPriority::High, poolConfig);
+
+        poolConfig.workerCount = mediumPrioThreadCount;
+        if (config.pinWorkers)
+            poolConfig.workerPlacements = cpuTopology.GetCorePlacements(mediumPrioThreadCount);
+        priorityPools[static_cast<int>(JobPriority::Medium)].Init(JobPriority::Medium, poolConfig);
 
-        priorityPools[static_cast<int>(JobPriority::High)].Init(highPrioThreadCount, JobPriority::High);
-        priorityPools[static_cast<int>(JobPriority::Medium)].Init(mediumPrioThreadCount, JobPriority::Medium);
-        priorityPools[static_cast<int>(JobPriority::Low)].Init(lowPrioThreadCount, JobPriority::Low);
+        poolConfig.workerCount = lowPrioThreadCount;
+        if (config.pinWorkers)
+            poolConfig.workerPlacements = cpuTopology.GetCorePlacements(lowPrioThreadCount);
+        priorityPools[static_cast<int>(JobPriority::Low)].Init(JobPriority::Low, poolConfig);
+
+        if (!config.useRealtimePriorities)
+            return;
 
         bool success = false;
         // Need to set our own main thread priority, otherwise we will loose when in contention with other threads
@@ -45,90 +86,210 @@ namespace Atlas {
     void JobSystem::Shutdown() {
 
         int32_t poolCount = static_cast<int>(JobPriority::Count);
+        for (int32_t i = 0; i < poolCount; i++) {
+            priorityPools[i].StopWorkers();
+        }
+
+        // Queued jobs still need to run, otherwise their groups never finish. Continuations
+        // might be enqueued into any pool, so we repeat until all of them are empty.
+        bool ranJobs = true;
+        while (ranJobs) {
+            ranJobs = false;
+            for (int32_t i = 0; i < poolCount; i++)
+                ranJobs |= priorityPools[i].RunRemainingJobs();
+        }
+
         for (int32_t i = 0; i < poolCount; i++) {
             priorityPools[i].Shutdown();
         }
 
+        JobAllocator::Trim();
+
     }
 
-    void JobSystem::Execute(JobGroup& group, std::function<void(JobData&)> func, void* userData) {
+    const CpuTopology& JobSystem::GetCpuTopology() {
 
-        auto& priorityPool = priorityPools[static_cast<int>(group.priority)];
-        group.counter.fetch_add(1);
+        return cpuTopology;
 
-        Job job = {
-            .priority = group.priority,
-            .counter = &group.counter,
-            .function = func,
-            .userData = userData
-        };
+    }
 
-        auto& worker = priorityPool.GetNextWorker();
-        worker.queue.Push(job);
-        worker.semaphore.release();
+    JobBatch* JobSystem::CreateBatch(JobGroup& group, int32_t count, void* userData) {
+
+        auto batch = JobAllocator::Allocate(count);
+        batch->refCount.store(count, std::memory_order_relaxed);
+        batch->jobCount = count;
+
+        auto jobs = batch->GetJobs();
+        for (int32_t i = 0; i < count; i++) {
+            jobs[i] = Job {
+                .idx = i,
+                .priority = group.priority,
+                .group = &group,
+                .batch = batch,
+                .userData = userData
+            };
+        }
+
+        return batch;
 
     }
 
-    void JobSystem::ExecuteMultiple(JobGroup& group, int32_t count, std::function<void(JobData&)> func, void* userData) {
+    void JobSystem::Submit(JobGroup& group, JobBatch* batch, int32_t count) {
 
-        auto& priorityPool = priorityPools[static_cast<int>(group.priority)];
+        outstandingJobCount += count;
         group.counter += count;
 
-        Job job = {
-            .priority = group.priority,
-            .counter = &group.counter,
-            .function = func,
-            .userData = userData
-        };
+        Enqueue(batch);
+
+    }
+
+    void JobSystem::SubmitAfter(JobGroup* const* dependencies, size_t dependencyCount,
+        JobGroup& group, JobBatch* batch, int32_t count) {
+
+        // The group already counts the jobs, such that waiting on it also waits for the dependencies
+        outstandingJobCount += count;
+        group.counter += count;
+
+        // One additional dependency guards against launching the batch before all continuations are registered
+        batch->dependencyCount.store(int32_t(dependencyCount) + 1);
+
+        int32_t finishedDependencyCount = 1;
+        for (size_t i = 0; i < dependencyCount; i++) {
+            if (!dependencies[i]->AddContinuation(batch))
+                finishedDependencyCount++;
+        }
+
+        if (batch->dependencyCount.fetch_sub(finishedDependencyCount) == finishedDependencyCount)
+            Enqueue(batch);
+
+    }
+
+    void JobSystem::Enqueue(JobBatch* batch) {
+
+        auto jobs = batch->GetJobs();
+        auto count = batch->jobCount;
+
+        auto& priorityPool = priorityPools[static_cast<int>(jobs[0].priority)];
+
+#ifdef AE_JOBSYSTEM_PROFILING
+        batch->enqueueTime = JobProfiler::GetTimestamp();
+#endif
+
+        // There are no workers after a shutdown, so the jobs run right away on this thread
+        if (priorityPool.workerCount == 0) {
+            for (int32_t i = 0; i < count; i++)
+                Worker::RunJob(&jobs[i]);
+            return;
+        }
+
+        // Workers push into their own deque lock-free and wake up siblings which can steal
+        auto currentWorker = priorityPool.GetCurrentWorker();
+        if (currentWorker != nullptr) {
+            for (int32_t i = 0; i < count; i++)
+                currentWorker->deque.Push(&jobs[i]);
+
+            priorityPool.WakeUp(std::min(count, priorityPool.workerCount - 1));
+            return;
+        }
 
         if (count <= priorityPool.workerCount) {
             for (int32_t i = 0; i < count; i++) {
                 auto& worker = priorityPool.GetNextWorker();
+                worker.queue.Push(&jobs[i]);
+            }
+        }
+        else {
+            // Jobs are contiguous in the batch, so each worker gets a range of them
+            int32_t totalCount = 0;
+            int32_t jobCountPerWorker = count / priorityPool.workerCount;
+            for (int32_t i = 0; i < priorityPool.workerCount; i++) {
+                auto jobsToPush = jobCountPerWorker;
+                if (i == priorityPool.workerCount - 1)
+                    jobsToPush = count - totalCount;
+
+                auto& worker = priorityPool.GetNextWorker();
+                worker.queue.PushMultiple(&jobs[totalCount], jobsToPush);
 
-                job.idx = i;
-                worker.queue.Push(job);
-                worker.semaphore.release();
+                totalCount += jobsToPush;
             }
-            return;
         }
 
-        int32_t totalCount = 0;
-        int32_t remainingJobs = count;
-        int32_t jobCountPerWorker = count / priorityPool.workerCount;
-        std::vector<Job> jobs;
-        for (int32_t i = 0; i < priorityPool.workerCount; i++) {
-            auto jobsToPush = jobCountPerWorker;
-            if (i == priorityPool.workerCount - 1 && remainingJobs != jobsToPush)
-                jobsToPush = remainingJobs;
+        priorityPool.WakeUp(std::min(count, priorityPool.workerCount));
+
+    }
 
-            jobs.reserve(jobsToPush);
+    void JobSystem::FinishJob(JobGroup* group) {
 
-            for (int32_t j = 0; j < jobsToPush; j++) {
-                job.idx = totalCount++;
-                jobs.push_back(job);
-            }
+        thread_local std::vector<JobBatch*> readyContinuations;
 
-            auto& worker = priorityPool.GetNextWorker();
-            worker.queue.PushMultiple(jobs);
-            worker.semaphore.release();
-            jobs.clear();
+        // The group might already be destroyed after this call
+        if (group->FinishJob(readyContinuations)) {
+            for (auto batch : readyContinuations) {
+                if (batch->dependencyCount.fetch_sub(1) == 1)
+                    Enqueue(batch);
+            }
 
-            remainingJobs -= jobsToPush;
+            readyContinuations.clear();
         }
 
+        // Only notify if someone is actually waiting, both sides use sequentially consistent operations
+        if (outstandingJobCount.fetch_sub(1) == 1 && waitAllThreadCount.load() > 0)
+            outstandingJobCount.notify_all();
+
+    }
+
+    int32_t JobSystem::GetWorkerCount(JobPriority priority) {
+
+        return priorityPools[static_cast<int>(priority)].workerCount;
+
+    }
+
+    int32_t JobSystem::GetQueuedJobCount(JobPriority priority) {
+
+        return priorityPools[static_cast<int>(priority)].GetQueuedJobCount();
+
     }
 
     void JobSystem::Wait(JobGroup& group) {
 
-        if (!group.HasFinished()) {
-            auto& priorityPool = priorityPools[static_cast<int>(group.priority)];
+        if (group.HasFinished())
+            return;
 
-            auto& worker = priorityPool.GetNextWorker();
-            priorityPool.Work(worker.workerId);
+#ifdef AE_JOBSYSTEM_PROFILING
+        auto waitStartTime = JobProfiler::GetTimestamp();
+#endif
+
+        auto& priorityPool = priorityPools[static_cast<int>(group.priority)];
+        auto currentWorker = priorityPool.GetCurrentWorker();
+
+        // After a shutdown nothing is left which could finish the group
+        if (priorityPool.workerCount == 0)
+            return;
+
+        auto spinStart = std::chrono::steady_clock::now();
+        auto spinDuration = std::chrono::microseconds(idleSpinMicroseconds);
+
+        // Help out with the work instead of blocking. Workers of the pool can still use
+        // their own deque, every other thread can only steal.
+        while (!group.HasFinished()) {
+            if (currentWorker != nullptr)
+                priorityPool.Work(currentWorker->workerId);
+            else
+                while (!group.HasFinished() && priorityPool.Steal(-1));
+
+            if (group.HasFinished())
+                break;
+
+            // Remaining jobs of the group are already in flight on other threads
+            if (std::chrono::steady_clock::now() - spinStart < spinDuration)
+                std::this_thread::yield();
+            else
+                group.Sleep();
         }
 
-        while (!group.HasFinished())
-            std::this_thread::yield();
+#ifdef AE_JOBSYSTEM_PROFILING
+        JobProfiler::RecordWait(group.priority, waitStartTime, JobProfiler::GetTimestamp());
+#endif
 
     }
 
@@ -136,6 +297,12 @@ namespace Atlas {
 
         auto& priorityPool = priorityPools[static_cast<int>(group.priority)];
 
+        // Workers of the pool might have the jobs of the group in their own deque
+        if (priorityPool.GetCurrentWorker() != nullptr) {
+            Wait(group);
+            return;
+        }
+
         auto spinCount = priorityPool.spinCounter.fetch_sub(1);
 
         // We can't let the thread pool run dry while everything is spinning
@@ -152,8 +319,42 @@ namespace Atlas {
 
     void JobSystem::WaitAll() {
 
+        AE_ASSERT(Worker::currentWorker == nullptr && "WaitAll can't be called from within a job");
+
+        if (outstandingJobCount.load() == 0)
+            return;
+
+#ifdef AE_JOBSYSTEM_PROFILING
+        auto waitStartTime = JobProfiler::GetTimestamp();
+#endif
+
+        auto spinStart = std::chrono::steady_clock::now();
+        auto spinDuration = std::chrono::microseconds(idleSpinMicroseconds);
+
+        while (outstandingJobCount.load() > 0) {
+            for (auto& priorityPool : priorityPools)
+                while (priorityPool.Steal(-1));
+
+            auto count = outstandingJobCount.load();
+            if (count == 0)
+                break;
 
+            if (std::chrono::steady_clock::now() - spinStart < spinDuration) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            waitAllThreadCount.fetch_add(1);
+            count = outstandingJobCount.load();
+            if (count > 0)
+                outstandingJobCount.wait(count);
+            waitAllThreadCount.fetch_sub(1);
+        }
+
+#ifdef AE_JOBSYSTEM_PROFILING
+        JobProfiler::RecordWait(JobPriority::Count, waitStartTime, JobProfiler::GetTimestamp());
+#endif
 
     }
 
-}
\ No newline at end of file
+}
@@ -11,13 +11,46 @@
 #include "Job.h"
 #include "JobGroup.h"
 #include "PriorityPool.h"
+#include "JobAllocator.h"
+#include "CpuTopology.h"
+#include "JobProfiler.h"
+
+#include <algorithm>
+#include <initializer_list>
+#include <vector>
 
 namespace Atlas {
 
     struct JobSystemConfig {
-        int32_t highPriorityThreadCount = int32_t(std::thread::hardware_concurrency()) - 1;
-        int32_t mediumPriorityThreadCount = int32_t(std::thread::hardware_concurrency()) - 3;
-        int32_t lowPriorityThreadCount = int32_t(std::thread::hardware_concurrency()) - 4;
+        /**
+         * Worker count of each pool. Zero or less means the count is derived from the CPU topology:
+         * The high priority pool gets all logical processors except the one of the main thread,
+         * while the medium and low priority pools get half and a quarter of the physical cores.
+         */
+        int32_t highPriorityThreadCount = 0;
+        int32_t mediumPriorityThreadCount = 0;
+        int32_t lowPriorityThreadCount = 0;
+
+        /**
+         * Pins the workers to cores. High priority workers get one logical processor each, preferring
+         * distinct physical cores. Medium and low priority workers share whole physical cores with them,
+         * starting from the last core. Workers of all pools are spread evenly over the NUMA nodes.
+         */
+        bool pinWorkers = false;
+
+        /**
+         * Tries to run workers with real-time priorities, which usually requires privileges. If they aren't available,
+         * the low priority pool is niced instead, or uses idle scheduling if useIdleScheduling is enabled.
+         */
+        bool useRealtimePriorities = true;
+        bool useIdleScheduling = false;
+
+        /**
+         * Time in microseconds idle workers and waiting threads keep looking for work before they go to sleep.
+         * Higher values lower the latency of new jobs, but burn CPU time when there isn't enough work.
+         * Zero means that threads go to sleep right away.
+         */
+        int32_t idleSpinMicroseconds = 50;
     };
     
     class JobSystem {
@@ -26,22 +59,197 @@ namespace Atlas {
         static void Init(const JobSystemConfig& config);
 
         static void Shutdown();
+
+        static const CpuTopology& GetCpuTopology();
         
-        static void Execute(JobGroup& group, std::function<void(JobData&)> func, 
-            void* userData = nullptr);
+        template<class F>
+        static void Execute(JobGroup& group, F&& func, void* userData = nullptr);
 
+        template<class F>
         static void ExecuteMultiple(JobGroup& group, int32_t count, 
-            std::function<void(JobData&)> func, void* userData = nullptr);
+            F&& func, void* userData = nullptr);
+
+        /**
+         * Executes a job as soon as all dependencies have finished, without blocking the caller.
+         * @param dependencies The job groups which need to finish before the job is started.
+         * @param group The job group the job is added to. It is counted as unfinished right away.
+         * @param func The function of the job.
+         * @param userData Optional user data which is passed to the job.
+         */
+        template<class F>
+        static void ExecuteAfter(std::initializer_list<JobGroup*> dependencies, JobGroup& group,
+            F&& func, void* userData = nullptr);
+
+        template<class F>
+        static void ExecuteAfter(const std::vector<JobGroup*>& dependencies, JobGroup& group,
+            F&& func, void* userData = nullptr);
+
+        template<class F>
+        static void ExecuteMultipleAfter(std::initializer_list<JobGroup*> dependencies, JobGroup& group,
+            int32_t count, F&& func, void* userData = nullptr);
+
+        /**
+         * Executes func(rangeBegin, rangeEnd) in parallel over the index range [begin, end).
+         * @param group The job group the range jobs are added to.
+         * @param begin The first index of the range.
+         * @param end One past the last index of the range.
+         * @param grainSize The minimum number of indices per chunk. If <= 0, it is chosen based on the worker count.
+         * @param func The function which processes a chunk, with the signature void(int32_t, int32_t).
+         * @note Only one job per worker is created. Each job repeatedly claims a chunk of the remaining
+         * range, which gets smaller the less indices are left. That way idle workers keep taking over work.
+         */
+        template<class F>
+        static void ParallelFor(JobGroup& group, int32_t begin, int32_t end,
+            int32_t grainSize, F&& func);
+
+        static int32_t GetWorkerCount(JobPriority priority);
+
+        static int32_t GetQueuedJobCount(JobPriority priority);
 
         static void Wait(JobGroup& group);
 
         static void WaitSpin(JobGroup& group);
 
+        /**
+         * Waits until all submitted jobs of all priorities have finished.
+         * @note Must not be called from within a job, since that job would never finish.
+         */
         static void WaitAll();
     
     private:
+        template<class F>
+        struct ParallelForFunction {
+            ParallelForFunction(F&& func, int32_t begin, int32_t end, int32_t grainSize, int32_t workerCount)
+                : func(std::forward<F>(func)), next(begin), end(end), grainSize(grainSize), workerCount(workerCount) {}
+
+            // Only moved once into the job batch, before any job runs
+            ParallelForFunction(ParallelForFunction&& other) : func(std::move(other.func)),
+                next(other.next.load()), end(other.end), grainSize(other.grainSize), workerCount(other.workerCount) {}
+
+            void operator()(JobData&) {
+                auto rangeBegin = next.load(std::memory_order_relaxed);
+                while (rangeBegin < end) {
+                    // Guided scheduling: claim a part of what is left, but at least the grain size
+                    auto chunkSize = std::max(grainSize, (end - rangeBegin) / (2 * workerCount));
+                    auto rangeEnd = std::min(end, rangeBegin + chunkSize);
+                    if (next.compare_exchange_weak(rangeBegin, rangeEnd, std::memory_order_relaxed)) {
+                        func(rangeBegin, rangeEnd);
+                        rangeBegin = rangeEnd;
+                    }
+                }
+            }
+
+            std::decay_t<F> func;
+
+            std::atomic_int32_t next;
+            int32_t end;
+            int32_t grainSize;
+            int32_t workerCount;
+        };
+
+        static JobBatch* CreateBatch(JobGroup& group, int32_t count, void* userData);
+
+        static void Submit(JobGroup& group, JobBatch* batch, int32_t count);
+
+        static void SubmitAfter(JobGroup* const* dependencies, size_t dependencyCount,
+            JobGroup& group, JobBatch* batch, int32_t count);
+
+        static void Enqueue(JobBatch* batch);
+
+        static void FinishJob(JobGroup* group);
+
+        friend class Worker;
+
         static PriorityPool priorityPools[static_cast<int>(JobPriority::Count)];
+        static int32_t idleSpinMicroseconds;
+        static CpuTopology cpuTopology;
+
+        // All jobs which were submitted but haven't finished yet, including the ones waiting for dependencies
+        static std::atomic_int32_t outstandingJobCount;
+        static std::atomic_int32_t waitAllThreadCount;
 
     };
 
+    template<class F>
+    void JobSystem::Execute(JobGroup& group, F&& func, void* userData) {
+
+        auto batch = CreateBatch(group, 1, userData);
+        batch->function.Set(std::forward<F>(func));
+
+        Submit(group, batch, 1);
+
+    }
+
+    template<class F>
+    void JobSystem::ExecuteMultiple(JobGroup& group, int32_t count, F&& func, void* userData) {
+
+        if (count <= 0)
+            return;
+
+        // The function is stored once and shared by all jobs of the batch
+        auto batch = CreateBatch(group, count, userData);
+        batch->function.Set(std::forward<F>(func));
+
+        Submit(group, batch, count);
+
+    }
+
+    template<class F>
+    void JobSystem::ExecuteAfter(std::initializer_list<JobGroup*> dependencies, JobGroup& group,
+        F&& func, void* userData) {
+
+        auto batch = CreateBatch(group, 1, userData);
+        batch->function.Set(std::forward<F>(func));
+
+        SubmitAfter(dependencies.begin(), dependencies.size(), group, batch, 1);
+
+    }
+
+    template<class F>
+    void JobSystem::ExecuteAfter(const std::vector<JobGroup*>& dependencies, JobGroup& group,
+        F&& func, void* userData) {
+
+        auto batch = CreateBatch(group, 1, userData);
+        batch->function.Set(std::forward<F>(func));
+
+        SubmitAfter(dependencies.data(), dependencies.size(), group, batch, 1);
+
+    }
+
+    template<class F>
+    void JobSystem::ExecuteMultipleAfter(std::initializer_list<JobGroup*> dependencies, JobGroup& group,
+        int32_t count, F&& func, void* userData) {
+
+        if (count <= 0)
+            return;
+
+        auto batch = CreateBatch(group, count, userData);
+        batch->function.Set(std::forward<F>(func));
+
+        SubmitAfter(dependencies.begin(), dependencies.size(), group, batch, count);
+
+    }
+
+    template<class F>
+    void JobSystem::ParallelFor(JobGroup& group, int32_t begin, int32_t end, int32_t grainSize, F&& func) {
+
+        auto count = end - begin;
+        if (count <= 0)
+            return;
+
+        auto workerCount = GetWorkerCount(group.priority);
+        if (grainSize <= 0)
+            grainSize = std::max(1, count / (workerCount * 16));
+
+        // There is no point in having more jobs than chunks
+        auto jobCount = std::min(workerCount, (count + grainSize - 1) / grainSize);
+
+        auto batch = CreateBatch(group, jobCount, nullptr);
+        batch->function.Set(ParallelForFunction<F>(std::forward<F>(func),
+            begin, end, grainSize, workerCount));
+
+        Submit(group, batch, jobCount);
+
+    }
+
 }
\ No newline at end of file
@@ -1,47 +1,186 @@
 #include "PriorityPool.h"
 
+#include <chrono>
+
 namespace Atlas {
 
-    void PriorityPool::Init(int32_t workerCount, JobPriority priority) {
+    void PriorityPool::Init(JobPriority priority, const PriorityPoolConfig& config) {
 
-        this->workerCount = workerCount;
+        this->workerCount = config.workerCount;
         this->priority = priority;
         this->spinCounter = workerCount;
+        this->idleSpinMicroseconds = config.idleSpinMicroseconds;
+
+        shutdown = false;
+        hasMultipleNodes = false;
 
+        workers.reserve(workerCount);
         for (int32_t i = 0; i < workerCount; i++) {
-            workers.emplace_back(i, priority);
+            auto& worker = workers.emplace_back(i, priority);
+            worker.useRealtimePriority = config.useRealtimePriority;
+            worker.useIdleScheduling = config.useIdleScheduling;
+
+            if (i < int32_t(config.workerPlacements.size())) {
+                worker.nodeId = config.workerPlacements[i].nodeId;
+                worker.affinity = config.workerPlacements[i].logicalProcessors;
+                hasMultipleNodes |= worker.nodeId != workers.front().nodeId;
+            }
         }
 
         for (int32_t i = 0; i < workerCount; i++) {
             workers[i].Start([&](Worker& worker) {
                 while (!shutdown) {
-                    worker.semaphore.acquire();
                     Work(worker.workerId);
+                    WaitForWork();
                 }
                 });
         }
 
     }
 
-    void PriorityPool::Shutdown() {
+    void PriorityPool::StopWorkers() {
 
         shutdown = true;
+
+        sleepEpoch.fetch_add(1);
+        sleepEpoch.notify_all();
+
         for (auto& worker : workers) {
-            worker.semaphore.release();
-            worker.thread.join();
+            if (worker.thread.joinable())
+                worker.thread.join();
         }
 
     }
 
+    bool PriorityPool::RunRemainingJobs() {
+
+        // The worker threads are stopped, so this thread can take over their deques.
+        // Jobs might enqueue new jobs, e.g. continuations, which need to run as well.
+        bool ranJobs = false;
+        while (HasWork()) {
+            for (auto& worker : workers)
+                worker.Work();
+            ranJobs = true;
+        }
+
+        return ranJobs;
+
+    }
+
+    void PriorityPool::Shutdown() {
+
+        StopWorkers();
+        RunRemainingJobs();
+
+        // Without workers, steals find nothing and new jobs are run by the submitting thread
+        workerCount = 0;
+        workers.clear();
+
+    }
+
     void PriorityPool::Work(int32_t workerId) {
 
         auto& worker = workers[workerId];
-        worker.Work();
 
-        for (int32_t i = 1; i < workerCount; i++) {
-            auto stealIdx = (-i + workerId + workerCount) % workerCount;
-            auto& stealFrom = workers[stealIdx];
-            stealFrom.Work();
+        // After each stolen job we check our own deque again, since the
+        // stolen job might have spawned new jobs
+        do {
+            worker.Work();
+        } while (Steal(workerId));
+
+    }
+
+    bool PriorityPool::Steal(int32_t workerId) {
+
+        if (workerCount == 0)
+            return false;
+
+        // Start with a different victim for each thief to spread contention
+        auto offset = workerId >= 0 ? workerId + 1 : int32_t(workerCounter.load() % workerCount);
+
+        auto stealFrom = [&](auto filter) {
+            for (int32_t i = 0; i < workerCount; i++) {
+                auto stealIdx = (offset + i) % workerCount;
+                if (stealIdx == workerId || !filter(workers[stealIdx]))
+                    continue;
+
+                if (workers[stealIdx].Steal())
+                    return true;
+            }
+            return false;
+        };
+
+        if (workerId < 0 || !hasMultipleNodes)
+            return stealFrom([](const Worker&) { return true; });
+
+        // Prefer victims on the same NUMA node, the data of their jobs is more likely to be close
+        auto nodeId = workers[workerId].nodeId;
+        return stealFrom([nodeId](const Worker& worker) { return worker.nodeId == nodeId; }) ||
+            stealFrom([nodeId](const Worker& worker) { return worker.nodeId != nodeId; });
+
+    }
+
+    bool PriorityPool::HasWork() {
+
+        for (auto& worker : workers) {
+            if (!worker.deque.IsEmpty() || !worker.queue.IsEmpty())
+                return true;
+        }
+
+        return false;
+
+    }
+
+    int32_t PriorityPool::GetQueuedJobCount() {
+
+        size_t count = 0;
+        for (auto& worker : workers)
+            count += worker.deque.Size() + worker.queue.Size();
+
+        return int32_t(count);
+
+    }
+
+    void PriorityPool::WaitForWork() {
+
+        // Spin for a short time first, since new jobs are often submitted right after
+        auto spinStart = std::chrono::steady_clock::now();
+        auto spinDuration = std::chrono::microseconds(idleSpinMicroseconds);
+        while (std::chrono::steady_clock::now() - spinStart < spinDuration) {
+            if (HasWork() || shutdown)
+                return;
+            std::this_thread::yield();
+        }
+
+        // The epoch needs to be read before announcing that we go to sleep. If a job gets
+        // submitted after this point, the epoch changes and the wait returns immediately.
+        auto epoch = sleepEpoch.load();
+        sleepingWorkerCount.fetch_add(1);
+
+        if (!HasWork() && !shutdown)
+            sleepEpoch.wait(epoch);
+
+        sleepingWorkerCount.fetch_sub(1);
+
+    }
+
+    void PriorityPool::WakeUp(int32_t count) {
+
+        // Pairs with announcing sleep in WaitForWork(): Either the sleeping worker sees the
+        // new jobs or we see the sleeping worker here
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        auto sleepingCount = sleepingWorkerCount.load();
+        if (sleepingCount == 0 || count <= 0)
+            return;
+
+        sleepEpoch.fetch_add(1);
+        if (count >= sleepingCount) {
+            sleepEpoch.notify_all();
+        }
+        else {
+            for (int32_t i = 0; i < count; i++)
+                sleepEpoch.notify_one();
         }
 
     }
@@ -54,10 +193,20 @@ namespace Atlas {
 
     }
 
+    Worker* PriorityPool::GetCurrentWorker() {
+
+        auto worker = Worker::currentWorker;
+        if (worker == nullptr || worker->priority != priority)
+            return nullptr;
+
+        return worker;
+
+    }
+
     std::vector<Worker>& PriorityPool::GetAllWorkers() {
 
         return workers;
 
     }
 
-}
\ No newline at end of file
+}
@@ -3,33 +3,67 @@
 #include "../System.h"
 #include "Job.h"
 #include "Worker.h"
+#include "CpuTopology.h"
 
 #include <vector>
 
 namespace Atlas {
-    
+
+    struct PriorityPoolConfig {
+        int32_t workerCount = 1;
+        int32_t idleSpinMicroseconds = 0;
+
+        bool useRealtimePriority = true;
+        bool useIdleScheduling = false;
+
+        // Optional, pins each worker to the logical processors of its entry
+        std::vector<CpuCore> workerPlacements;
+    };
+
     class PriorityPool {
 
     public:
-        void Init(int32_t workerCount, JobPriority priority);
+        void Init(JobPriority priority, const PriorityPoolConfig& config);
+
+        void StopWorkers();
+
+        bool RunRemainingJobs();
 
         void Shutdown();
 
         void Work(int32_t workerId);
 
+        bool Steal(int32_t workerId);
+
+        bool HasWork();
+
+        int32_t GetQueuedJobCount();
+
+        void WaitForWork();
+
+        void WakeUp(int32_t count);
+
         Worker& GetNextWorker();
 
+        Worker* GetCurrentWorker();
+
         std::vector<Worker>& GetAllWorkers();
 
         JobPriority priority;
         int32_t workerCount;
         std::atomic_uint32_t spinCounter = 0;
+        int32_t idleSpinMicroseconds = 0;
 
     private:
         std::vector<Worker> workers;
         std::atomic_uint32_t workerCounter = 0;
         std::atomic_bool shutdown = false;
+        bool hasMultipleNodes = false;
+
+        // Idle workers sleep on the epoch, which is incremented to wake them up
+        std::atomic_uint32_t sleepEpoch = 0;
+        std::atomic_int32_t sleepingWorkerCount = 0;
 
     };
 
-}
\ No newline at end of file
+}
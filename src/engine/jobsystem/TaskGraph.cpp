@@ -0,0 +1,92 @@
+#include "TaskGraph.h"
+#include "JobSystem.h"
+
+namespace Atlas {
+
+    TaskGraph::TaskGraph(JobPriority priority) : priority(priority) {}
+
+    TaskGraph::~TaskGraph() {
+
+        Wait();
+
+    }
+
+    TaskGraph::TaskHandle TaskGraph::AddTask(const std::string& name, std::function<void(JobGroup&)> function,
+        std::initializer_list<TaskHandle> dependencies) {
+
+        auto handle = TaskHandle(tasks.size());
+
+        auto& task = tasks.emplace_back(std::make_unique<Task>(priority));
+        task->name = name;
+        task->function = function;
+
+        for (auto dependency : dependencies)
+            AddDependency(handle, dependency);
+
+        return handle;
+
+    }
+
+    void TaskGraph::AddDependency(TaskHandle task, TaskHandle dependency) {
+
+        AE_ASSERT(task < TaskHandle(tasks.size()) && "Invalid task handle");
+        AE_ASSERT(dependency < task && "Tasks can only depend on tasks added before");
+
+        tasks[task]->dependencies.push_back(dependency);
+
+    }
+
+    void TaskGraph::Execute() {
+
+        Wait();
+
+        // Tasks are ordered such that dependencies are always launched first
+        for (auto& task : tasks) {
+            dependencyGroups.clear();
+            for (auto dependency : task->dependencies)
+                dependencyGroups.push_back(&tasks[dependency]->group);
+
+            JobSystem::ExecuteAfter(dependencyGroups, task->group, [task = task.get()](JobData&) {
+                task->function(task->group);
+            });
+        }
+
+    }
+
+    void TaskGraph::Wait() {
+
+        for (auto& task : tasks)
+            JobSystem::Wait(task->group);
+
+    }
+
+    bool TaskGraph::HasFinished() {
+
+        for (auto& task : tasks)
+            if (!task->group.HasFinished())
+                return false;
+
+        return true;
+
+    }
+
+    const std::string& TaskGraph::GetTaskName(TaskHandle task) const {
+
+        return tasks[task]->name;
+
+    }
+
+    size_t TaskGraph::GetTaskCount() const {
+
+        return tasks.size();
+
+    }
+
+    void TaskGraph::Clear() {
+
+        Wait();
+        tasks.clear();
+
+    }
+
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "../System.h"
+#include "JobGroup.h"
+
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+namespace Atlas {
+
+    /*
+     * Describes the work of e.g. a frame as a directed acyclic graph of tasks. Each task is launched
+     * as soon as its dependencies have finished, such that the graph is executed as wide as possible
+     * without any blocking wait in between. The graph can be executed repeatedly.
+     */
+    class TaskGraph {
+
+    public:
+        using TaskHandle = int32_t;
+
+        TaskGraph(JobPriority priority = JobPriority::High);
+
+        TaskGraph(const TaskGraph&) = delete;
+
+        TaskGraph& operator=(const TaskGraph&) = delete;
+
+        ~TaskGraph();
+
+        /**
+         * Adds a task to the graph.
+         * @param name The name of the task.
+         * @param function The function of the task. Jobs which are added to the passed
+         * job group are considered part of the task, e.g. for a ParallelFor.
+         * @param dependencies Tasks which need to finish before this task is started.
+         * @return A handle to the task.
+         * @note Only tasks which were added before can be dependencies, which keeps the graph acyclic.
+         */
+        TaskHandle AddTask(const std::string& name, std::function<void(JobGroup&)> function,
+            std::initializer_list<TaskHandle> dependencies = {});
+
+        void AddDependency(TaskHandle task, TaskHandle dependency);
+
+        /**
+         * Launches all tasks of the graph and returns immediately.
+         * @note If a previous execution is still running, it is waited for.
+         */
+        void Execute();
+
+        void Wait();
+
+        bool HasFinished();
+
+        const std::string& GetTaskName(TaskHandle task) const;
+
+        size_t GetTaskCount() const;
+
+        void Clear();
+
+    private:
+        struct Task {
+            Task(JobPriority priority) : group(priority) {}
+
+            std::string name;
+            std::function<void(JobGroup&)> function;
+            std::vector<TaskHandle> dependencies;
+
+            JobGroup group;
+        };
+
+        JobPriority priority;
+
+        std::vector<std::unique_ptr<Task>> tasks;
+        std::vector<JobGroup*> dependencyGroups;
+
+    };
+
+}
@@ -2,31 +2,63 @@
 
 namespace Atlas {
 
-    void ThreadSafeJobQueue::Push(const Job& job) {
+    void ThreadSafeJobQueue::Push(Job* job) {
 
         std::scoped_lock lock(mutex);
         jobs.push_back(job);
+        size = jobs.size() - head;
     
     }
 
-    void ThreadSafeJobQueue::PushMultiple(const std::vector<Job>& newJobs) {
+    void ThreadSafeJobQueue::PushMultiple(Job* newJobs, int32_t count) {
 
         std::scoped_lock lock(mutex);
-        jobs.insert(jobs.end(), newJobs.begin(), newJobs.end());
+        for (int32_t i = 0; i < count; i++)
+            jobs.push_back(&newJobs[i]);
+        size = jobs.size() - head;
 
     }
 
-    std::optional<Job> ThreadSafeJobQueue::Pop() {
+    std::optional<Job*> ThreadSafeJobQueue::Pop() {
+
+        if (IsEmpty())
+            return std::nullopt;
 
         std::scoped_lock lock(mutex);
-        if (jobs.empty())
+        if (head == jobs.size())
             return std::nullopt;
             
-        auto job = jobs.front();
-        jobs.pop_front();
+        auto job = jobs[head++];
+        if (head == jobs.size()) {
+            jobs.clear();
+            head = 0;
+        }
+        size = jobs.size() - head;
 
         return job;
 
-    } 
+    }
+
+    void ThreadSafeJobQueue::PopAll(std::vector<Job*>& poppedJobs) {
+
+        std::scoped_lock lock(mutex);
+        poppedJobs.insert(poppedJobs.end(), jobs.begin() + head, jobs.end());
+        jobs.clear();
+        head = 0;
+        size = 0;
+
+    }
+
+    bool ThreadSafeJobQueue::IsEmpty() {
+
+        return size.load() == 0;
+
+    }
+
+    size_t ThreadSafeJobQueue::Size() {
+
+        return size.load();
+
+    }
 
-}
\ No newline at end of file
+}
@@ -5,7 +5,8 @@
 
 #include <mutex>
 #include <optional>
-#include <deque>
+#include <vector>
+#include <atomic>
 
 namespace Atlas {
     
@@ -14,16 +15,28 @@ namespace Atlas {
     public:
         ThreadSafeJobQueue() = default;
 
-        void Push(const Job& job);
+        void Push(Job* job);
         
-        void PushMultiple(const std::vector<Job>& jobs);
+        void PushMultiple(Job* jobs, int32_t count);
         
-        std::optional<Job> Pop();
+        std::optional<Job*> Pop();
+
+        void PopAll(std::vector<Job*>& jobs);
+
+        bool IsEmpty();
+
+        size_t Size();
 
     private:
         std::mutex mutex;
-        std::deque<Job> jobs;
+
+        // A vector keeps its capacity when cleared, so no allocations in steady state
+        std::vector<Job*> jobs;
+        size_t head = 0;
+
+        // Allows to check for jobs without taking the lock
+        std::atomic_size_t size = 0;
 
     };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include "../System.h"
+
+#include <atomic>
+#include <optional>
+#include <vector>
+#include <type_traits>
+
+namespace Atlas {
+
+    /*
+     * Lock-free Chase-Lev work stealing deque, implemented after
+     * "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al., 2013).
+     * Only the owning thread is allowed to call Push() and Pop(), which operate on the bottom
+     * of the deque. Any other thread might call Steal(), which takes elements from the top.
+     * Elements need to be trivially copyable, since a stealing thread might read an element
+     * which is concurrently overwritten. Usually this is a pointer to the actual data.
+     */
+    template<typename T>
+    class WorkStealingDeque {
+
+        static_assert(std::is_trivially_copyable_v<T>, "Work stealing deque elements need to be trivially copyable");
+
+    public:
+        explicit WorkStealingDeque(int64_t capacity = 1024);
+
+        WorkStealingDeque(const WorkStealingDeque&) = delete;
+
+        WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+        ~WorkStealingDeque();
+
+        void Push(T item);
+
+        std::optional<T> Pop();
+
+        std::optional<T> Steal();
+
+        bool IsEmpty() const;
+
+        size_t Size() const;
+
+    private:
+        struct Array {
+            Array(int64_t capacity) : capacity(capacity), mask(capacity - 1),
+                data(new std::atomic<T>[capacity]) {}
+
+            ~Array() { delete[] data; }
+
+            inline void Put(int64_t idx, T item) {
+                data[idx & mask].store(item, std::memory_order_relaxed);
+            }
+
+            inline T Get(int64_t idx) const {
+                return data[idx & mask].load(std::memory_order_relaxed);
+            }
+
+            int64_t capacity;
+            int64_t mask;
+            std::atomic<T>* data;
+        };
+
+        Array* Grow(Array* array, int64_t bottom, int64_t top);
+
+        // Keep top and bottom on separate cache lines, thieves only touch top
+        alignas(64) std::atomic_int64_t top = 0;
+        alignas(64) std::atomic_int64_t bottom = 0;
+        alignas(64) std::atomic<Array*> array;
+
+        // Old arrays might still be read by thieves, only delete them with the deque
+        std::vector<Array*> retiredArrays;
+
+    };
+
+    template<typename T>
+    WorkStealingDeque<T>::WorkStealingDeque(int64_t capacity) {
+
+        // Capacity needs to be a power of two for the index mask to work
+        int64_t powerOfTwoCapacity = 1;
+        while (powerOfTwoCapacity < capacity)
+            powerOfTwoCapacity <<= 1;
+
+        array.store(new Array(powerOfTwoCapacity), std::memory_order_relaxed);
+
+    }
+
+    template<typename T>
+    WorkStealingDeque<T>::~WorkStealingDeque() {
+
+        for (auto retiredArray : retiredArrays)
+            delete retiredArray;
+
+        delete array.load(std::memory_order_relaxed);
+
+    }
+
+    template<typename T>
+    void WorkStealingDeque<T>::Push(T item) {
+
+        auto b = bottom.load(std::memory_order_relaxed);
+        auto t = top.load(std::memory_order_acquire);
+        auto a = array.load(std::memory_order_relaxed);
+
+        if (b - t > a->capacity - 1) {
+            a = Grow(a, b, t);
+        }
+
+        a->Put(b, item);
+        bottom.store(b + 1, std::memory_order_release);
+
+    }
+
+    template<typename T>
+    std::optional<T> WorkStealingDeque<T>::Pop() {
+
+        auto b = bottom.load(std::memory_order_relaxed) - 1;
+        auto a = array.load(std::memory_order_relaxed);
+        // Sequential consistency is needed such that the store of bottom and the load
+        // of top can't be reordered, otherwise we might race against thieves unnoticed
+        bottom.store(b, std::memory_order_seq_cst);
+        auto t = top.load(std::memory_order_seq_cst);
+
+        // Deque was already empty, restore bottom
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+
+        auto item = a->Get(b);
+        if (t != b)
+            return item;
+
+        // This was the last element, race against thieves for it
+        bool won = top.compare_exchange_strong(t, t + 1,
+            std::memory_order_seq_cst, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_relaxed);
+
+        if (!won)
+            return std::nullopt;
+        return item;
+
+    }
+
+    template<typename T>
+    std::optional<T> WorkStealingDeque<T>::Steal() {
+
+        while (true) {
+            auto t = top.load(std::memory_order_seq_cst);
+            auto b = bottom.load(std::memory_order_seq_cst);
+
+            if (t >= b)
+                return std::nullopt;
+
+            auto a = array.load(std::memory_order_acquire);
+            auto item = a->Get(t);
+
+            if (top.compare_exchange_strong(t, t + 1,
+                std::memory_order_seq_cst, std::memory_order_relaxed))
+                return item;
+
+            // Lost the race against the owner or another thief, just try again
+        }
+
+    }
+
+    template<typename T>
+    bool WorkStealingDeque<T>::IsEmpty() const {
+
+        auto b = bottom.load(std::memory_order_relaxed);
+        auto t = top.load(std::memory_order_relaxed);
+        return b <= t;
+
+    }
+
+    template<typename T>
+    size_t WorkStealingDeque<T>::Size() const {
+
+        auto b = bottom.load(std::memory_order_relaxed);
+        auto t = top.load(std::memory_order_relaxed);
+        return b > t ? size_t(b - t) : 0;
+
+    }
+
+    template<typename T>
+    typename WorkStealingDeque<T>::Array* WorkStealingDeque<T>::Grow(Array* oldArray, int64_t b, int64_t t) {
+
+        auto newArray = new Array(oldArray->capacity * 2);
+        for (int64_t i = t; i < b; i++)
+            newArray->Put(i, oldArray->Get(i));
+
+        retiredArrays.push_back(oldArray);
+        array.store(newArray, std::memory_order_release);
+
+        return newArray;
+
+    }
+
+}
@@ -1,4 +1,5 @@
 #include "Worker.h"
+#include "JobSystem.h"
 #include "../Log.h"
 
 #ifdef AE_OS_WINDOWS
@@ -9,49 +10,148 @@
 #include <pthread.h>
 #endif
 
+#ifdef AE_OS_LINUX
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+#include <atomic>
 
 namespace Atlas {
 
-    Worker::Worker(int32_t workerId, JobPriority priority) : workerId(workerId), priority(priority) {
+    thread_local Worker* Worker::currentWorker = nullptr;
 
-        
+    // Each warning is only logged once, not once per worker
+    static std::atomic_bool priorityWarningLogged = false;
+    static std::atomic_bool affinityWarningLogged = false;
 
-    }
+    Worker::Worker(int32_t workerId, JobPriority priority) : workerId(workerId), priority(priority) {}
+
+    Worker::Worker(Worker&& worker) : workerId(worker.workerId), priority(worker.priority),
+        nodeId(worker.nodeId), affinity(std::move(worker.affinity)), useRealtimePriority(worker.useRealtimePriority),
+        useIdleScheduling(worker.useIdleScheduling) {}
 
-    Worker::Worker(Worker&& worker) : workerId(worker.workerId), priority(worker.priority) {
+    void Worker::Start(std::function<void(Worker&)> function) {
 
+        thread = std::thread([this, function] {
+            currentWorker = this;
+            ApplyThreadSettings();
+#ifdef AE_JOBSYSTEM_PROFILING
+            const char* priorityNames[] = { "High", "Medium", "Low" };
+            JobProfiler::SetThreadName(std::string(priorityNames[static_cast<int>(priority)]) +
+                " priority worker " + std::to_string(workerId));
+#endif
+            function(*this);
+            });
 
     }
 
-    void Worker::Start(std::function<void(Worker&)> function) {
-
-        thread = std::thread([this, function] { function(*this); });
+    void Worker::ApplyThreadSettings() {
 
         bool success = true;
 #ifdef AE_OS_WINDOWS
-        HANDLE threadHandle = static_cast<HANDLE>(thread.native_handle());
+        HANDLE threadHandle = GetCurrentThread();
         switch (priority) {
-            case JobPriority::High: success &= SetThreadPriority(threadHandle, THREAD_PRIORITY_HIGHEST); break;
-            case JobPriority::Low: success &= SetThreadPriority(threadHandle, THREAD_PRIORITY_LOWEST); break;
+            case JobPriority::High: success &= SetThreadPriority(threadHandle, THREAD_PRIORITY_HIGHEST) > 0; break;
+            case JobPriority::Low: success &= SetThreadPriority(threadHandle,
+                useIdleScheduling ? THREAD_PRIORITY_IDLE : THREAD_PRIORITY_LOWEST) > 0; break;
             default: break;
-        }       
+        }
 #endif
 #if defined(AE_OS_MACOS) || defined(AE_OS_LINUX)
-        auto minPriority = sched_get_priority_min(SCHED_RR);
-        auto maxPriority = sched_get_priority_max(SCHED_RR);
+        success = false;
+        if (useRealtimePriority) {
+            auto minPriority = sched_get_priority_min(SCHED_RR);
+            auto maxPriority = sched_get_priority_max(SCHED_RR);
+
+            sched_param params = {};
+            switch (priority) {
+                case JobPriority::High: params.sched_priority = maxPriority; break;
+                case JobPriority::Low: params.sched_priority = minPriority; break;
+                default: params.sched_priority = (maxPriority + minPriority) / 2; break;
+            }
+            success = pthread_setschedparam(pthread_self(), SCHED_RR, &params) == 0;
+        }
 
-        sched_param params = {};
-        
-        switch (priority) {
-            case JobPriority::High: params.sched_priority = maxPriority; break;
-            case JobPriority::Low: params.sched_priority = minPriority; break;
-            default: params.sched_priority = (maxPriority + minPriority) / 2; break;
+        // Real-time priorities need privileges. Without them the high and medium priority pools keep
+        // the default priority, but the low priority pool should at least not compete with them.
+        if (!success && priority == JobPriority::Low) {
+#ifdef AE_OS_LINUX
+            if (useIdleScheduling) {
+                sched_param params = {};
+                success = pthread_setschedparam(pthread_self(), SCHED_IDLE, &params) == 0;
+            }
+            // On Linux the nice value is per thread, the gettid() wrapper needs glibc 2.30 or newer
+            if (!success)
+                success = setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10) == 0;
+#else
+            sched_param params = {};
+            params.sched_priority = sched_get_priority_min(SCHED_OTHER);
+            success = pthread_setschedparam(pthread_self(), SCHED_OTHER, &params) == 0;
+#endif
+        }
+        else if (!useRealtimePriority) {
+            success = true;
         }
-        success = pthread_setschedparam(thread.native_handle(), SCHED_RR, &params) == 0;
 #endif
-        if (!success)
-            Log::Warning("Couldn't set thread priority");
+        if (!success && !priorityWarningLogged.exchange(true))
+            Log::Warning("Couldn't set thread priority of job system workers");
+
+        if (affinity.empty())
+            return;
+
+        success = true;
+#ifdef AE_OS_WINDOWS
+        DWORD_PTR mask = 0;
+        for (auto processor : affinity)
+            mask |= processor < int32_t(sizeof(DWORD_PTR) * 8) ? DWORD_PTR(1) << processor : 0;
+        success = mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#endif
+#ifdef AE_OS_LINUX
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for (auto processor : affinity) {
+            if (processor < CPU_SETSIZE)
+                CPU_SET(processor, &cpuSet);
+        }
+        success = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+#endif
+        // MacOS has no way to pin threads, the affinity is just ignored there
+        if (!success && !affinityWarningLogged.exchange(true))
+            Log::Warning("Couldn't pin job system workers to their cores");
+
+    }
+
+    void Worker::RunJob(Job* job) {
+
+        JobData data = {
+            .idx = job->idx,
+            .userData = job->userData
+        };
+
+        auto batch = job->batch;
+        auto group = job->group;
+
+#ifdef AE_JOBSYSTEM_PROFILING
+        auto startTime = JobProfiler::GetTimestamp();
+#endif
+
+        batch->function(data);
+
+#ifdef AE_JOBSYSTEM_PROFILING
+        JobProfiler::RecordJob(job->priority, batch->enqueueTime, startTime, JobProfiler::GetTimestamp());
+#endif
+
+        // The job memory belongs to the batch, which is given back by the last job.
+        // This happens before the group counter is decremented, such that the function
+        // captures are already released once a wait on the group returns.
+        if (batch->refCount.fetch_sub(1) == 1)
+            JobAllocator::Free(batch);
+
+        JobSystem::FinishJob(group);
 
     }
 
-}
\ No newline at end of file
+}
@@ -3,9 +3,10 @@
 #include "../System.h"
 
 #include "ThreadSafeJobQueue.h"
+#include "WorkStealingDeque.h"
+#include "JobAllocator.h"
 
 #include <thread>
-#include <semaphore>
 
 namespace Atlas {
 
@@ -22,8 +23,17 @@ namespace Atlas {
 
         inline void Work() {
 
+            // Move jobs which were submitted from other threads into the local deque.
+            // This way they can be stolen lock-free by the other workers of the pool
+            if (!queue.IsEmpty()) {
+                queue.PopAll(inboxJobs);
+                for (auto job : inboxJobs)
+                    deque.Push(job);
+                inboxJobs.clear();
+            }
+
             while(true) {
-                auto job = queue.Pop();
+                auto job = deque.Pop();
                 if (job == std::nullopt)
                     break;
 
@@ -32,27 +42,46 @@ namespace Atlas {
 
         }
 
+        inline bool Steal() {
+
+            auto job = deque.Steal();
+            if (job == std::nullopt)
+                job = queue.Pop();
+
+            if (job == std::nullopt)
+                return false;
+
+            RunJob(job.value());
+            return true;
+
+        }
+
         int32_t workerId;
         JobPriority priority;
 
+        int32_t nodeId = 0;
+        // Logical processors the worker is pinned to, empty means no pinning
+        std::vector<int32_t> affinity;
+
+        bool useRealtimePriority = true;
+        bool useIdleScheduling = false;
+
         std::thread thread;
-        std::binary_semaphore semaphore{0};
-        ThreadSafeJobQueue queue;
 
-    private:
-        inline void RunJob(Job& job) {
+        // Only the worker thread itself is allowed to push and pop from the deque
+        WorkStealingDeque<Job*> deque;
+        // Jobs submitted by threads which don't belong to this worker
+        ThreadSafeJobQueue queue;
 
-            JobData data = {
-                .idx = job.idx,
-                .userData = job.userData
-            };
+        static thread_local Worker* currentWorker;
 
-            job.function(data);
+        static void RunJob(Job* job);
 
-            job.counter->fetch_sub(1);
+    private:
+        void ApplyThreadSettings();
 
-        }
+        std::vector<Job*> inboxJobs;
 
     };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,114 @@
+#include "BVHCacheLoader.h"
+#include "AssetLoader.h"
+#include "../Log.h"
+
+namespace Atlas::Loader {
+
+    bool BVHCacheLoader::LoadBVH(const std::string& filename, uint64_t hash,
+        const std::vector<Volume::BVHTriangle>& triangles, Volume::BVH& bvh) {
+
+        // Missing cache files are expected, so don't try to unpack them like other assets
+        std::error_code errorCode;
+        if (!std::filesystem::exists(AssetLoader::GetFullPath(filename), errorCode))
+            return false;
+
+        auto fileStream = AssetLoader::ReadFile(filename, std::ios::in | std::ios::binary);
+        if (!fileStream.is_open())
+            return false;
+
+        auto fileSize = AssetLoader::GetFileSize(fileStream);
+
+        Header header;
+        if (fileSize < sizeof(Header) || !fileStream.read(reinterpret_cast<char*>(&header), sizeof(Header)))
+            return false;
+
+        // A different hash means the mesh data changed since the cache was written
+        if (header.magic != magic || header.version != version || header.hash != hash)
+            return false;
+
+        auto expectedSize = sizeof(Header) + header.nodeCount * sizeof(Volume::BVHNode) +
+            header.triangleCount * sizeof(uint32_t);
+        if (fileSize != expectedSize) {
+            Log::Warning("Invalid BVH cache file " + filename);
+            return false;
+        }
+
+        std::vector<Volume::BVHNode> nodes(header.nodeCount);
+        std::vector<uint32_t> triangleRefs(header.triangleCount);
+
+        fileStream.read(reinterpret_cast<char*>(nodes.data()), nodes.size() * sizeof(Volume::BVHNode));
+        fileStream.read(reinterpret_cast<char*>(triangleRefs.data()), triangleRefs.size() * sizeof(uint32_t));
+        if (!fileStream) {
+            Log::Warning("Couldn't read BVH cache file " + filename);
+            return false;
+        }
+
+        fileStream.close();
+
+        // Everything needs to be in range, otherwise the traversal on the GPU reads out of bounds
+        auto isValidPtr = [&](int32_t ptr) {
+            return ptr < 0 ? size_t(~ptr) < triangleRefs.size() : size_t(ptr) < nodes.size();
+        };
+        for (const auto& node : nodes) {
+            if (!isValidPtr(node.leftPtr) || !isValidPtr(node.rightPtr)) {
+                Log::Warning("Invalid BVH cache file " + filename);
+                return false;
+            }
+        }
+
+        std::vector<Volume::BVHTriangle> data(triangleRefs.size());
+        std::vector<Volume::AABB> aabbs(triangleRefs.size());
+        for (size_t i = 0; i < triangleRefs.size(); i++) {
+            auto idx = triangleRefs[i] & ~endOfNodeBit;
+            if (idx >= triangles.size()) {
+                Log::Warning("Invalid BVH cache file " + filename);
+                return false;
+            }
+
+            auto& triangle = data[i];
+            triangle = triangles[idx];
+            triangle.endOfNode = triangleRefs[i] & endOfNodeBit;
+
+            auto min = glm::min(glm::min(triangle.v0, triangle.v1), triangle.v2);
+            auto max = glm::max(glm::max(triangle.v0, triangle.v1), triangle.v2);
+            aabbs[i] = Volume::AABB(min, max);
+        }
+
+        bvh.nodes = std::move(nodes);
+        bvh.data = std::move(data);
+        bvh.aabbs = std::move(aabbs);
+
+        return true;
+
+    }
+
+    void BVHCacheLoader::SaveBVH(const std::string& filename, uint64_t hash, const Volume::BVH& bvh) {
+
+        auto fileStream = AssetLoader::WriteFile(filename, std::ios::out | std::ios::binary);
+
+        if (!fileStream.is_open()) {
+            Log::Warning("Couldn't write BVH cache file " + filename);
+            return;
+        }
+
+        Header header = {
+            .magic = magic,
+            .version = version,
+            .hash = hash,
+            .nodeCount = bvh.nodes.size(),
+            .triangleCount = bvh.data.size()
+        };
+
+        std::vector<uint32_t> triangleRefs(bvh.data.size());
+        for (size_t i = 0; i < bvh.data.size(); i++)
+            triangleRefs[i] = bvh.data[i].idx | (bvh.data[i].endOfNode ? endOfNodeBit : 0u);
+
+        fileStream.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        fileStream.write(reinterpret_cast<const char*>(bvh.nodes.data()), bvh.nodes.size() * sizeof(Volume::BVHNode));
+        fileStream.write(reinterpret_cast<const char*>(triangleRefs.data()), triangleRefs.size() * sizeof(uint32_t));
+
+        fileStream.close();
+
+    }
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "../System.h"
+#include "../volume/BVH.h"
+
+#include <string>
+
+namespace Atlas::Loader {
+
+    /**
+     * Stores built triangle BVHs in a binary file, such that they can be loaded with a few bulk reads
+     * instead of being rebuilt. The file contains the nodes and the order of the triangles and is keyed
+     * by a content hash of the data the BVH was built from.
+     */
+    class BVHCacheLoader {
+
+    public:
+        /**
+         * Loads a cached BVH.
+         * @param filename The path of the cache file
+         * @param hash The content hash the cache has to match
+         * @param triangles The triangles the BVH was built for, in the original order
+         * @param bvh The BVH which receives the nodes and the ordered triangles
+         * @return True if the cache was valid, false otherwise
+         */
+        static bool LoadBVH(const std::string& filename, uint64_t hash,
+            const std::vector<Volume::BVHTriangle>& triangles, Volume::BVH& bvh);
+
+        /**
+         * Stores a BVH in a cache file.
+         * @param filename The path of the cache file
+         * @param hash The content hash of the data the BVH was built from
+         * @param bvh The BVH, which needs to be built with triangle data
+         */
+        static void SaveBVH(const std::string& filename, uint64_t hash, const Volume::BVH& bvh);
+
+    private:
+        struct Header {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t hash;
+            uint64_t nodeCount;
+            uint64_t triangleCount;
+        };
+
+        static constexpr uint32_t magic = 0x48564241; // "ABVH"
+        static constexpr uint32_t version = 1;
+
+        static constexpr uint32_t endOfNodeBit = 1u << 31;
+
+    };
+
+}
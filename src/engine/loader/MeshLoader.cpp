@@ -31,6 +31,9 @@ namespace Atlas::Loader {
         auto mesh = CreateRef<Mesh::Mesh>();
         from_json(j, *mesh);
 
+        // The BVH is cached next to the mesh file
+        mesh->data.bvhCachePath = path + ".bvh";
+
         return mesh;
 
     }
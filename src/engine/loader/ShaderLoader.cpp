@@ -3,6 +3,9 @@
 
 #include "graphics/Extensions.h"
 #include "../common/Path.h"
+#include "../common/Hash.h"
+
+#include <sstream>
 
 namespace Atlas {
 
@@ -10,45 +13,95 @@ namespace Atlas {
 
         std::string ShaderLoader::sourceDirectory = "";
 
-        Graphics::ShaderStageFile ShaderLoader::LoadFile(const std::string& filename, VkShaderStageFlagBits shaderStage) {
-
-            auto path = sourceDirectory.length() != 0 ? sourceDirectory + "/" : "";
-            path += filename;
+        std::mutex ShaderLoader::sourceFilesMutex;
+        std::unordered_map<std::string, ShaderLoader::SourceFile> ShaderLoader::sourceFiles;
 
-            std::vector<std::string> includes;
-            std::vector<Graphics::ShaderStageFile::Extension> extensions;
-            std::filesystem::file_time_type lastModified = std::filesystem::file_time_type::min();
-            auto code = ReadShaderFile(path, true, includes, extensions, lastModified);
-
-            // Erase all versioning qualifiers, will be filled automatically
-            std::string removeVersion = "#version";
-            auto pos = code.find(removeVersion);
-            while (pos != std::string::npos) {
-                code.erase(pos, removeVersion.length() + size_t(4));
-                pos = code.find(removeVersion);
-            }
+        Graphics::ShaderStageFile ShaderLoader::LoadFile(const std::string& filename, VkShaderStageFlagBits shaderStage) {
 
             Graphics::ShaderStageFile shaderStageFile;
 
             shaderStageFile.filename = filename;
-            shaderStageFile.code = code;
-            shaderStageFile.includes = includes;
-            shaderStageFile.extensions = extensions;
             shaderStageFile.shaderStage = shaderStage;
-            shaderStageFile.lastModified = lastModified;
+            shaderStageFile.lastModified = std::filesystem::file_time_type::min();
+
+            std::unordered_set<std::string> includedFiles;
+            std::vector<const std::string*> chunks;
+
+            // The chunks are owned by the cache, so the code needs to be built while holding the lock
+            std::lock_guard lock(sourceFilesMutex);
+
+            auto path = GetSourcePath(filename);
+            includedFiles.insert(path);
+            CollectSourceFile(path, includedFiles, chunks, shaderStageFile);
+
+            size_t codeLength = 0;
+            for (auto chunk : chunks)
+                codeLength += chunk->length();
+
+            shaderStageFile.code.reserve(codeLength);
+            for (auto chunk : chunks)
+                shaderStageFile.code.append(*chunk);
 
             return shaderStageFile;
 
         }
 
-        bool ShaderLoader::CheckForReload(const std::string& filename, const std::filesystem::file_time_type fileTime,
-            std::filesystem::file_time_type& pathLastModified) {
+        std::unordered_set<std::string> ShaderLoader::GetModifiedFiles() {
 
-            auto path = sourceDirectory.length() != 0 ? sourceDirectory + "/" : "";
-            path += filename;
+            std::unordered_set<std::string> modifiedFiles;
+
+            std::lock_guard lock(sourceFilesMutex);
+
+            for (auto& [path, sourceFile] : sourceFiles) {
+                std::error_code errorCode;
+                auto lastModified = std::filesystem::last_write_time(path, errorCode);
+                if (errorCode || lastModified == sourceFile.lastModified)
+                    continue;
+
+                // Keep the old version if the file can't be read, e.g. because it is still being written
+                SourceFile newSourceFile;
+                if (!ReadSourceFile(path, newSourceFile))
+                    continue;
+
+                if (newSourceFile.contentHash != sourceFile.contentHash)
+                    modifiedFiles.insert(path);
+
+                sourceFile = std::move(newSourceFile);
+            }
+
+            if (modifiedFiles.empty())
+                return modifiedFiles;
+
+            // Walk the include graph in reverse to find all files which depend on the modified ones
+            std::unordered_map<std::string, std::vector<std::string>> includedBy;
+            for (const auto& [path, sourceFile] : sourceFiles) {
+                for (const auto& include : sourceFile.includes)
+                    includedBy[include].push_back(path);
+            }
+
+            std::vector<std::string> stack(modifiedFiles.begin(), modifiedFiles.end());
+            while (!stack.empty()) {
+                auto path = stack.back();
+                stack.pop_back();
+
+                auto it = includedBy.find(path);
+                if (it == includedBy.end())
+                    continue;
+
+                for (const auto& dependentPath : it->second) {
+                    if (modifiedFiles.insert(dependentPath).second)
+                        stack.push_back(dependentPath);
+                }
+            }
+
+            return modifiedFiles;
 
-            pathLastModified = AssetLoader::GetFileLastModifiedTime(Loader::AssetLoader::GetFullPath(path), fileTime);
-            return pathLastModified > fileTime;
+        }
+
+        bool ShaderLoader::CheckForReload(const std::string& filename,
+            const std::unordered_set<std::string>& modifiedFiles) {
+
+            return modifiedFiles.contains(GetSourcePath(filename));
 
         }
 
@@ -58,89 +111,120 @@ namespace Atlas {
 
         }
 
-        std::string ShaderLoader::ReadShaderFile(const std::string& filename, bool mainFile,
-            std::vector<std::string>& includes, std::vector<Graphics::ShaderStageFile::Extension>& extensions,
-            std::filesystem::file_time_type& lastModified) {
+        void ShaderLoader::Clear() {
 
-            std::string shaderCode;
-            std::ifstream shaderFile;
-            std::stringstream shaderStream;
+            std::lock_guard lock(sourceFilesMutex);
+            sourceFiles.clear();
 
-            if (mainFile)
-                lastModified = AssetLoader::GetFileLastModifiedTime(Loader::AssetLoader::GetFullPath(filename), lastModified);
+        }
 
-            shaderFile = Loader::AssetLoader::ReadFile(filename, std::ios::in);
+        std::string ShaderLoader::GetSourcePath(const std::string& filename) {
 
-            if (!shaderFile.is_open()) {
-                Log::Error("Shader file not found " + filename);
-                return "";
-            }
+            auto path = sourceDirectory.length() != 0 ? sourceDirectory + "/" : "";
+            path += filename;
 
-            shaderStream << shaderFile.rdbuf();
+            return Common::Path::Normalize(AssetLoader::GetFullPath(path));
 
-            std::string line;
-            std::vector<std::string> lines;
-            while (std::getline(shaderStream, line)) lines.push_back(line);
-
-            shaderFile.close();
+        }
 
-            lines = ExtractExtensions(lines, extensions);
+        const ShaderLoader::SourceFile* ShaderLoader::GetSourceFile(const std::string& path) {
 
-            for (auto& codeLine : lines) {
-                shaderCode += codeLine + "\n\r";
-            }
+            auto it = sourceFiles.find(path);
+            if (it != sourceFiles.end())
+                return &it->second;
 
-            shaderCode = ExtractIncludes(filename, shaderCode, includes, extensions, lastModified);
+            SourceFile sourceFile;
+            if (!ReadSourceFile(path, sourceFile))
+                return nullptr;
 
-            return shaderCode;
+            // References to elements of an unordered map stay valid on insertion
+            return &(sourceFiles[path] = std::move(sourceFile));
 
         }
 
-        std::string ShaderLoader::ExtractIncludes(const std::string& filename, std::string& code,
-            std::vector<std::string>& includes, std::vector<Graphics::ShaderStageFile::Extension>& extensions,
-            std::filesystem::file_time_type& lastModified) {
+        bool ShaderLoader::ReadSourceFile(const std::string& path, SourceFile& sourceFile) {
 
-            auto directory = Common::Path::GetDirectory(filename) + "/";
+            auto fileStream = AssetLoader::ReadFile(path, std::ios::in);
 
-            // Copy all includes into the code
-            while (code.find("#include ") != std::string::npos) {
+            if (!fileStream.is_open()) {
+                Log::Error("Shader file not found " + path);
+                return false;
+            }
 
-                size_t includePosition = code.find("#include ");
-                size_t lineBreakPosition = code.find("\n", includePosition);
+            std::stringstream stream;
+            stream << fileStream.rdbuf();
+            fileStream.close();
 
-                size_t filenamePosition = code.find_first_of("\"<", includePosition) + 1;
-                size_t filenameEndPosition = code.find_first_of("\">", filenamePosition);
+            auto content = stream.str();
+            sourceFile.contentHash = HashBytes(content.data(), content.size());
+            sourceFile.lastModified = AssetLoader::GetFileLastModifiedTime(path,
+                std::filesystem::file_time_type::min());
 
-                auto includeFilename = code.substr(filenamePosition, filenameEndPosition - filenamePosition);
-                auto includePath = directory + includeFilename;
+            std::string line;
+            std::vector<std::string> lines;
+            while (std::getline(stream, line)) lines.push_back(line);
 
-                includePath = Loader::AssetLoader::GetFullPath(includePath);
-                includePath = Common::Path::Normalize(includePath);
+            lines = ExtractExtensions(lines, sourceFile.extensions);
 
-                auto codeBeforeInclude = code.substr(0, includePosition);
-                auto codeAfterInclude = code.substr(lineBreakPosition, code.length() - 1);
+            auto directory = Common::Path::GetDirectory(path) + "/";
 
-                // Check for multiple includes of a file
-                if (std::find(includes.begin(), includes.end(), includePath) == includes.end()) {
+            std::string chunk;
+            chunk.reserve(content.length());
+            for (const auto& codeLine : lines) {
+                auto includePosition = codeLine.find("#include ");
+                auto commentPosition = codeLine.find("//");
 
-                    includes.push_back(includePath);
+                if (includePosition != std::string::npos && includePosition < commentPosition) {
+                    size_t filenamePosition = codeLine.find_first_of("\"<", includePosition) + 1;
+                    size_t filenameEndPosition = codeLine.find_first_of("\">", filenamePosition);
 
-                    auto includeLastModified = AssetLoader::GetFileLastModifiedTime(includePath, lastModified);
-                    lastModified = includeLastModified > lastModified ? includeLastModified : lastModified;
-                    auto includeCode = ReadShaderFile(includePath, false, includes, extensions, lastModified);
+                    auto includeFilename = codeLine.substr(filenamePosition, filenameEndPosition - filenamePosition);
 
-                    code = codeBeforeInclude + includeCode + codeAfterInclude;
+                    sourceFile.chunks.push_back(std::move(chunk));
+                    sourceFile.includes.push_back(Common::Path::Normalize(directory + includeFilename));
 
+                    chunk = std::string();
+                    continue;
                 }
-                else {
-
-                    code = codeBeforeInclude + codeAfterInclude;
 
-                }
+                // Versioning qualifiers will be filled in automatically
+                if (codeLine.find("#version") != std::string::npos)
+                    continue;
 
+                chunk.append(codeLine);
+                chunk.push_back('\n');
             }
 
-            return code;
+            sourceFile.chunks.push_back(std::move(chunk));
+
+            return true;
+
+        }
+
+        void ShaderLoader::CollectSourceFile(const std::string& path, std::unordered_set<std::string>& includedFiles,
+            std::vector<const std::string*>& chunks, Graphics::ShaderStageFile& shaderStageFile) {
+
+            auto sourceFile = GetSourceFile(path);
+            if (!sourceFile)
+                return;
+
+            shaderStageFile.lastModified = std::max(shaderStageFile.lastModified, sourceFile->lastModified);
+            shaderStageFile.extensions.insert(shaderStageFile.extensions.end(),
+                sourceFile->extensions.begin(), sourceFile->extensions.end());
+
+            for (size_t i = 0; i < sourceFile->chunks.size(); i++) {
+                chunks.push_back(&sourceFile->chunks[i]);
+
+                if (i >= sourceFile->includes.size())
+                    continue;
+
+                // Files are only copied into the code at their first include
+                const auto& includePath = sourceFile->includes[i];
+                if (includedFiles.insert(includePath).second) {
+                    shaderStageFile.includes.push_back(includePath);
+                    CollectSourceFile(includePath, includedFiles, chunks, shaderStageFile);
+                }
+            }
 
         }
 
@@ -4,38 +4,75 @@
 #include "../graphics/Shader.h"
 
 #include <vector>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 #include <filesystem>
 
 namespace Atlas {
 
     namespace Loader {
 
+        /**
+         * Loads shader stage files and resolves their includes. Every file is read and split at its
+         * include directives only once per session, such that common headers aren't parsed again for
+         * each shader. The includes of the cached files form a dependency graph, which is used to find
+         * all shader files affected by a change on disk.
+         */
         class ShaderLoader {
 
         public:
             static Graphics::ShaderStageFile LoadFile(const std::string& filename, VkShaderStageFlagBits shaderStage);
 
-            static bool CheckForReload(const std::string& filename, const std::filesystem::file_time_type fileTime,
-                std::filesystem::file_time_type& pathLastModified);
+            /**
+             * Checks all cached files for changes on disk and updates the cache. Files which were only
+             * touched, but whose content is the same, don't count as modified.
+             * @return The full paths of all modified files and of all files which include them transitively
+             */
+            static std::unordered_set<std::string> GetModifiedFiles();
+
+            /**
+             * Checks whether a shader file needs to be reloaded.
+             * @param filename The filename of the shader file, relative to the source directory
+             * @param modifiedFiles The result of GetModifiedFiles()
+             * @return True if the file or any of its includes was modified, false otherwise
+             */
+            static bool CheckForReload(const std::string& filename, const std::unordered_set<std::string>& modifiedFiles);
 
             static void SetSourceDirectory(const std::string& sourceDirectory);
 
+            static void Clear();
+
         private:
-            static std::string ReadShaderFile(const std::string& filename, bool mainFile,
-                std::vector<std::string>& includes, std::vector<Graphics::ShaderStageFile::Extension>& extensions,
-                std::filesystem::file_time_type& lastModified);
+            struct SourceFile {
+                // The code is split at the include directives, such that include i follows chunk i
+                std::vector<std::string> chunks;
+                std::vector<std::string> includes;
+                std::vector<Graphics::ShaderStageFile::Extension> extensions;
+
+                std::filesystem::file_time_type lastModified;
+                uint64_t contentHash = 0;
+            };
+
+            static std::string GetSourcePath(const std::string& filename);
 
-            static std::string ExtractIncludes(const std::string& filename, std::string& code,
-                std::vector<std::string>& includes, std::vector<Graphics::ShaderStageFile::Extension>& extensions,
-                std::filesystem::file_time_type& lastModified);
+            static const SourceFile* GetSourceFile(const std::string& path);
+
+            static bool ReadSourceFile(const std::string& path, SourceFile& sourceFile);
+
+            static void CollectSourceFile(const std::string& path, std::unordered_set<std::string>& includedFiles,
+                std::vector<const std::string*>& chunks, Graphics::ShaderStageFile& shaderStageFile);
 
             static std::vector<std::string> ExtractExtensions(std::vector<std::string> codeLines,
                 std::vector<Graphics::ShaderStageFile::Extension>& extensions);
 
             static std::string sourceDirectory;
 
+            static std::mutex sourceFilesMutex;
+            static std::unordered_map<std::string, SourceFile> sourceFiles;
+
         };
 
     }
 
-}
\ No newline at end of file
+}
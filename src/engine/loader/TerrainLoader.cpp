@@ -4,19 +4,16 @@
 #include "../Log.h"
 
 #include "../common/Path.h"
+#include "../terrain/TerrainTileArchive.h"
+
+#include <cstring>
+#include <filesystem>
 
 namespace Atlas {
 
     namespace Loader {
 
-        void TerrainLoader::SaveTerrain(Ref<Terrain::Terrain> terrain, std::string filename) {
-
-            auto fileStream = AssetLoader::WriteFile(filename, std::ios::out | std::ios::binary);
-
-            if (!fileStream.is_open()) {
-                Log::Error("Couldn't write terrain file " + filename);
-                return;
-            }
+        bool TerrainLoader::SaveTerrain(Ref<Terrain::Terrain> terrain, std::string filename) {
 
             auto materials = terrain->storage.GetMaterials();
 
@@ -38,8 +35,6 @@ namespace Atlas {
             header.append(std::to_string(terrain->heightScale) + " ");
             header.append(std::to_string(terrain->bakeResolution) + "\n");
 
-            fileStream << header;
-
             body.append(std::to_string(terrain->tessellationFactor) + " ");
             body.append(std::to_string(terrain->tessellationSlope) + " ");
             body.append(std::to_string(terrain->tessellationShift) + " ");
@@ -71,44 +66,118 @@ namespace Atlas {
                 count++;
             }
 
-            fileStream << body;
+            // The archive is replaced, so the storage can't stream from it any more
+            terrain->streamer.WaitForCompletion();
+            auto oldTileArchive = terrain->storage.tileArchive;
+            terrain->storage.tileArchive = nullptr;
 
-            // Iterate over all LoD level
-            for (int32_t i = 0; i < terrain->LoDCount; i++) {
+            auto tileResolution = 8 * terrain->patchSizeFactor + 1;
+            if (oldTileArchive && !oldTileArchive->IsCompatible(terrain->rootNodeSideCount,
+                terrain->LoDCount, tileResolution))
+                oldTileArchive = nullptr;
+
+            // Terrains without an archive still have their cells in the terrain file they were loaded from
+            std::ifstream legacyStream;
+            std::streamoff legacyCellDataOffset = 0;
+            if (!oldTileArchive && !terrain->filename.empty()) {
+                legacyStream = AssetLoader::ReadFile(terrain->filename, std::ios::in | std::ios::binary);
+                if (legacyStream.is_open() && SkipLegacyHeader(legacyStream))
+                    legacyCellDataOffset = legacyStream.tellg();
+                else
+                    legacyStream.close();
+            }
 
-                int32_t cellSideCount = (int32_t)sqrtf((float)terrain->storage.GetCellCount(i));
+            std::vector<uint16_t> heightData;
+            std::vector<uint8_t> normalData, splatData;
+            Common::Image<uint8_t> normalImage;
 
-                auto isLeaf = i == terrain->LoDCount - 1;
+            auto tileFilename = Terrain::TerrainTileArchive::GetFilename(filename);
+            auto getTile = [&](int32_t x, int32_t y, int32_t LoD, Terrain::TerrainTileArchive::Tile& tile) {
+                auto cell = terrain->storage.GetCell(x, y, LoD);
+                if (cell->IsLoaded() && cell->splatMap.IsValid()) {
+                    heightData = cell->heightField.GetData<uint16_t>();
+                    normalData = cell->normalMap.GetData<uint8_t>();
+                    splatData = cell->splatMap.GetData<uint8_t>();
 
-                for (int32_t x = 0; x < cellSideCount; x++) {
-                    for (int32_t y = 0; y < cellSideCount; y++) {
+                    tile.resolution = cell->heightField.width;
+                    tile.normalResolution = cell->normalMap.width;
+                }
+                else if (oldTileArchive) {
+                    // Streamed out cells haven't changed since they were written to the old archive.
+                    // The tile is copied, since the old archive is unmapped before it's replaced.
+                    if (!oldTileArchive->GetTile(x, y, LoD, tile))
+                        return false;
+
+                    auto texelCount = size_t(tile.resolution) * size_t(tile.resolution);
+                    auto normalTexelCount = size_t(tile.normalResolution) * size_t(tile.normalResolution);
+
+                    heightData.resize(texelCount);
+                    normalData.resize(normalTexelCount * 4);
+                    splatData.resize(texelCount);
+
+                    std::memcpy(heightData.data(), tile.heightField, texelCount * 2);
+                    std::memcpy(normalData.data(), tile.normalMap, normalTexelCount * 4);
+                    std::memcpy(splatData.data(), tile.splatMap, texelCount);
+                }
+                else {
+                    if (!legacyStream.is_open() || !ReadLegacyTile(legacyStream, legacyCellDataOffset,
+                        terrain.get(), x, y, LoD, heightData, normalImage, splatData))
+                        return false;
 
-                        auto cell = terrain->storage.GetCell(x, y, i);
+                    normalData = normalImage.GetData();
 
-                        if (isLeaf) {
-                            // fileStream.write((char*)cell->materialIndices, sizeof(cell->materialIndices));
-                        }
+                    tile.resolution = tileResolution;
+                    tile.normalResolution = normalImage.width;
+                }
 
-                        // Here we assume that all cells are present
-                        auto heightData = cell->heightField.GetData<uint16_t>();
+                tile.heightField = reinterpret_cast<const uint8_t*>(heightData.data());
+                tile.normalMap = normalData.data();
+                tile.splatMap = splatData.data();
 
-                        fileStream.write(reinterpret_cast<char*>(heightData.data()), heightData.size() * 2);
+                return true;
+            };
 
-                        auto data = cell->normalMap.GetData<uint8_t>();
+            auto success = Terrain::TerrainTileArchive::Write(tileFilename, terrain->rootNodeSideCount,
+                terrain->LoDCount, tileResolution, getTile, true, [&]() { oldTileArchive = nullptr; });
 
-                        fileStream.write(reinterpret_cast<char*>(data.data()), data.size());
+            legacyStream.close();
 
-                        data = cell->splatMap.GetData<uint8_t>();
+            // If the archive couldn't be written, the cells are streamed from the old one again
+            auto tileArchive = !success && oldTileArchive ? oldTileArchive :
+                CreateRef<Terrain::TerrainTileArchive>(tileFilename);
+            if (tileArchive->IsCompatible(terrain->rootNodeSideCount, terrain->LoDCount, tileResolution))
+                terrain->storage.tileArchive = tileArchive;
 
-                        fileStream.write(reinterpret_cast<char*>(data.data()), data.size());
+            // The terrain file might still hold the only copy of the cells, so it's kept in that case
+            if (!success) {
+                Log::Error("Couldn't save the cells of terrain " + filename);
+                return false;
+            }
 
-                    }
-                }
+            auto tempFilename = filename + ".tmp";
+            auto fileStream = AssetLoader::WriteFile(tempFilename, std::ios::out | std::ios::binary);
 
+            if (!fileStream.is_open()) {
+                Log::Error("Couldn't write terrain file " + filename);
+                return false;
             }
 
+            fileStream << header;
+            fileStream << body;
+
             fileStream.close();
 
+            std::error_code errorCode;
+            std::filesystem::rename(AssetLoader::GetFullPath(tempFilename),
+                AssetLoader::GetFullPath(filename), errorCode);
+            if (errorCode) {
+                Log::Error("Couldn't replace terrain file " + filename + ": " + errorCode.message());
+                AssetLoader::RemoveFile(tempFilename);
+                return false;
+            }
+
+            return true;
+
         }
 
         Ref<Terrain::Terrain> TerrainLoader::LoadTerrain(std::string filename) {
@@ -191,6 +260,14 @@ namespace Atlas {
 
             terrain->filename = filename;
 
+            // All cells are loaded from this mapping later on
+            auto tileFilename = Terrain::TerrainTileArchive::GetFilename(filename);
+            auto tileArchive = CreateRef<Terrain::TerrainTileArchive>(tileFilename);
+            if (tileArchive->IsCompatible(rootNodeSideCount, LoDCount, 8 * patchSizeFactor + 1))
+                terrain->storage.tileArchive = tileArchive;
+            else
+                Log::Warning("No matching tile archive " + tileFilename + ", cells are read from the terrain file");
+
             return terrain;
 
         }
@@ -198,11 +275,58 @@ namespace Atlas {
         void TerrainLoader::LoadStorageCell(Ref<Terrain::Terrain> terrain, Terrain::TerrainStorageCell* cell,
                 std::string filename, bool initWithHeightData) {
 
+            LoadStorageCell(terrain.get(), cell, filename, initWithHeightData);
+
+        }
+
+        void TerrainLoader::LoadStorageCell(Terrain::Terrain* terrain, Terrain::TerrainStorageCell* cell,
+                std::string filename, bool initWithHeightData) {
+
+            auto tileArchive = terrain->storage.tileArchive;
+            if (!tileArchive) {
+                LoadLegacyStorageCell(terrain, cell, filename, initWithHeightData);
+                return;
+            }
+
+            Terrain::TerrainTileArchive::Tile tile;
+            if (!tileArchive->GetTile(cell->x, cell->y, cell->LoD, tile)) {
+                Log::Error("Couldn't read terrain tile from archive of " + filename);
+                return;
+            }
+
+            // The tiles are stored in the texture formats, so they are uploaded directly from the mapping
+            cell->heightField = Texture::Texture2D(tile.resolution, tile.resolution,
+                VK_FORMAT_R16_UINT, Texture::Wrapping::ClampToEdge, Texture::Filtering::Nearest);
+            cell->heightField.SetData(tile.heightField);
+
+            cell->normalMap = Texture::Texture2D(tile.normalResolution, tile.normalResolution,
+                VK_FORMAT_R8G8B8A8_UNORM, Texture::Wrapping::ClampToEdge, Texture::Filtering::Anisotropic);
+            cell->normalMap.SetData(tile.normalMap);
+
+            cell->splatMap = Texture::Texture2D(tile.resolution, tile.resolution,
+                VK_FORMAT_R8_UINT, Texture::Wrapping::ClampToEdge, Texture::Filtering::Nearest);
+            cell->splatMap.SetData(tile.splatMap);
+
+            if (initWithHeightData) {
+                cell->heightData.resize(size_t(tile.resolution) * size_t(tile.resolution));
+
+                for (size_t i = 0; i < cell->heightData.size(); i++) {
+                    uint16_t height;
+                    std::memcpy(&height, tile.heightField + i * sizeof(uint16_t), sizeof(uint16_t));
+                    cell->heightData[i] = (float)height / 65535.0f;
+                }
+                cell->UpdateHeightBounds();
+            }
+
+        }
+
+        bool TerrainLoader::ConvertTerrain(std::string filename, bool compress) {
+
             auto fileStream = AssetLoader::ReadFile(filename, std::ios::in | std::ios::binary);
 
             if (!fileStream.is_open()) {
                 Log::Error("Couldn't read terrain file " + filename);
-                return;
+                return false;
             }
 
             std::string header, body;
@@ -210,10 +334,127 @@ namespace Atlas {
             std::getline(fileStream, header);
 
             if (header.compare(0, 4, "AET ") != 0) {
+                Log::Error("File isn't a terrain file " + filename);
+                return false;
+            }
+
+            size_t offset = 4;
+            auto materialCount = ReadInt(" ", header, offset);
+            auto rootNodeSideCount = ReadInt(" ", header, offset);
+            auto LoDCount = ReadInt(" ", header, offset);
+            auto patchSizeFactor = ReadInt(" ", header, offset);
+            ReadFloat(" ", header, offset);
+            ReadFloat(" ", header, offset);
+            auto bakeResolution = ReadInt("\r\n", header, offset);
+
+            // Skip the body
+            for (int32_t i = 0; i < materialCount + 2; i++)
+                std::getline(fileStream, body);
+
+            auto tileResolution = 8 * patchSizeFactor + 1;
+            std::vector<uint16_t> heightFieldData(tileResolution * tileResolution);
+            std::vector<uint8_t> splatMapData(heightFieldData.size());
+            Common::Image<uint8_t> image;
+
+            // The archive stores the cells in the same order, so the terrain file is read front to back
+            auto getTile = [&](int32_t x, int32_t y, int32_t LoD, Terrain::TerrainTileArchive::Tile& tile) {
+                auto downsample = 1 << (LoDCount - LoD - 1);
+                auto sizeFactor = glm::min(downsample, bakeResolution / (tileResolution - 1));
+                auto normalDataResolution = (tileResolution - 1) * sizeFactor + 3;
+
+                fileStream.read(reinterpret_cast<char*>(heightFieldData.data()), heightFieldData.size() * 2);
+
+                image = Common::Image<uint8_t>(normalDataResolution, normalDataResolution, 3);
+                fileStream.read(reinterpret_cast<char*>(image.GetData().data()), image.GetData().size());
+                image.ExpandToChannelCount(4, 255);
+
+                fileStream.read(reinterpret_cast<char*>(splatMapData.data()), splatMapData.size());
+
+                if (!fileStream)
+                    return false;
+
+                tile.resolution = tileResolution;
+                tile.normalResolution = normalDataResolution;
+                tile.heightField = reinterpret_cast<const uint8_t*>(heightFieldData.data());
+                tile.normalMap = image.GetData().data();
+                tile.splatMap = splatMapData.data();
+
+                return true;
+            };
+
+            auto tileFilename = Terrain::TerrainTileArchive::GetFilename(filename);
+            auto success = Terrain::TerrainTileArchive::Write(tileFilename, rootNodeSideCount, LoDCount,
+                tileResolution, getTile, compress);
+
+            fileStream.close();
+
+            if (success)
+                Log::Message("Converted terrain " + filename + " to tile archive " + tileFilename);
+
+            return success;
+
+        }
+
+        void TerrainLoader::LoadLegacyStorageCell(Terrain::Terrain* terrain, Terrain::TerrainStorageCell* cell,
+                std::string filename, bool initWithHeightData) {
+
+            auto fileStream = AssetLoader::ReadFile(filename, std::ios::in | std::ios::binary);
+
+            if (!fileStream.is_open()) {
+                Log::Error("Couldn't read terrain file " + filename);
+                return;
+            }
+
+            if (!SkipLegacyHeader(fileStream)) {
                 Log::Error("File isn't a terrain file " + filename);
                 return;
             }
 
+            auto tileResolution = 8 * terrain->patchSizeFactor + 1;
+
+            std::vector<uint16_t> heightFieldData;
+            std::vector<uint8_t> splatMapData;
+            Common::Image<uint8_t> image;
+
+            if (!ReadLegacyTile(fileStream, fileStream.tellg(), terrain, cell->x, cell->y, cell->LoD,
+                heightFieldData, image, splatMapData)) {
+                Log::Error("Couldn't read terrain cell from " + filename);
+                return;
+            }
+
+            cell->heightField = Texture::Texture2D(tileResolution, tileResolution,
+                VK_FORMAT_R16_UINT, Texture::Wrapping::ClampToEdge, Texture::Filtering::Nearest);
+            cell->heightField.SetData(heightFieldData);
+
+            cell->normalMap = Texture::Texture2D(image.width, image.height,
+                VK_FORMAT_R8G8B8A8_UNORM, Texture::Wrapping::ClampToEdge, Texture::Filtering::Anisotropic);
+            cell->normalMap.SetData(image.GetData());
+
+            cell->splatMap = Texture::Texture2D(tileResolution, tileResolution,
+                VK_FORMAT_R8_UINT, Texture::Wrapping::ClampToEdge, Texture::Filtering::Nearest);
+            cell->splatMap.SetData(splatMapData);
+            
+            if (initWithHeightData) {
+                cell->heightData.resize(tileResolution * tileResolution);
+
+                for (uint32_t i = 0; i < uint32_t(cell->heightData.size()); i++)
+                    cell->heightData[i] = (float)heightFieldData[i] / 65535.0f;
+                cell->UpdateHeightBounds();
+            }
+
+            fileStream.close();
+
+        }
+
+        bool TerrainLoader::SkipLegacyHeader(std::ifstream& fileStream) {
+
+            std::string header, body;
+
+            std::getline(fileStream, header);
+
+            if (header.compare(0, 4, "AET ") != 0)
+                return false;
+
             auto position = header.find_first_of(' ', 4);
             int32_t materialCount = std::stoi(header.substr(4, position - 4));
 
@@ -221,7 +462,14 @@ namespace Atlas {
             for (int32_t i = 0; i < materialCount + 2; i++)
                 std::getline(fileStream, body);
 
-            auto isLeaf = cell->LoD == terrain->LoDCount - 1;
+            return bool(fileStream);
+
+        }
+
+        bool TerrainLoader::ReadLegacyTile(std::ifstream& fileStream, std::streamoff cellDataOffset,
+            Terrain::Terrain* terrain, int32_t x, int32_t y, int32_t LoD, std::vector<uint16_t>& heightFieldData,
+            Common::Image<uint8_t>& normalImage, std::vector<uint8_t>& splatMapData) {
+
             auto tileResolution = 8 * terrain->patchSizeFactor + 1;
 
             // Height map + splat map
@@ -234,15 +482,15 @@ namespace Atlas {
             auto currPos = int64_t(0);
 
             // Different resolutions for each LoD
-            for (int32_t i = 0; i <= cell->LoD; i++) {
+            for (int32_t i = 0; i <= LoD; i++) {
                 auto sizeFactor = int64_t(glm::min(downsample, 
                     terrain->bakeResolution / (tileResolution - 1)));
                 normalDataResolution = int64_t(tileResolution - 1) * sizeFactor + 3;
                 auto nodeSize = nodeDataCount + normalDataResolution
                     * normalDataResolution * 3;
 
-                if (cell->LoD == i) {
-                    currPos += (cell->x * tileSideCount + cell->y) * nodeSize;
+                if (LoD == i) {
+                    currPos += (x * tileSideCount + y) * nodeSize;
                     break;
                 }
                 
@@ -252,35 +500,19 @@ namespace Atlas {
                 tileSideCount *= 2;
             }
 
-            fileStream.seekg(currPos, std::ios_base::cur);
+            fileStream.seekg(cellDataOffset + currPos, std::ios_base::beg);
 
-            std::vector<uint16_t> heightFieldData(tileResolution * tileResolution);
+            heightFieldData.resize(size_t(tileResolution) * size_t(tileResolution));
             fileStream.read(reinterpret_cast<char*>(heightFieldData.data()), heightFieldData.size() * 2);
-            cell->heightField = Texture::Texture2D(tileResolution, tileResolution,
-                VK_FORMAT_R16_UINT, Texture::Wrapping::ClampToEdge, Texture::Filtering::Nearest);
-            cell->heightField.SetData(heightFieldData);
 
-            Common::Image<uint8_t> image(normalDataResolution, normalDataResolution, 3);
-            fileStream.read(reinterpret_cast<char*>(image.GetData().data()), image.GetData().size());
-            image.ExpandToChannelCount(4, 255);
-            cell->normalMap = Texture::Texture2D(normalDataResolution, normalDataResolution,
-                VK_FORMAT_R8G8B8A8_UNORM, Texture::Wrapping::ClampToEdge, Texture::Filtering::Anisotropic);
-            cell->normalMap.SetData(image.GetData());
+            normalImage = Common::Image<uint8_t>(int32_t(normalDataResolution), int32_t(normalDataResolution), 3);
+            fileStream.read(reinterpret_cast<char*>(normalImage.GetData().data()), normalImage.GetData().size());
+            normalImage.ExpandToChannelCount(4, 255);
 
-            std::vector<uint8_t> splatMapData(heightFieldData.size());
+            splatMapData.resize(heightFieldData.size());
             fileStream.read(reinterpret_cast<char*>(splatMapData.data()), splatMapData.size());
-            cell->splatMap = Texture::Texture2D(tileResolution, tileResolution,
-                VK_FORMAT_R8_UINT, Texture::Wrapping::ClampToEdge, Texture::Filtering::Nearest);
-            cell->splatMap.SetData(splatMapData);
-            
-            if (initWithHeightData) {
-                cell->heightData.resize(tileResolution * tileResolution);
 
-                for (uint32_t i = 0; i < uint32_t(cell->heightData.size()); i++)
-                    cell->heightData[i] = (float)heightFieldData[i] / 65535.0f;
-            }
-
-            fileStream.close();
+            return bool(fileStream);
 
         }
 
@@ -2,6 +2,9 @@
 
 #include "../System.h"
 #include "../terrain/Terrain.h"
+#include "../common/Image.h"
+
+#include <fstream>
 
 namespace Atlas {
 
@@ -22,9 +25,12 @@ namespace Atlas {
              * Stores the terrain in a directory on the hard drive
              * @param terrain
              * @param filename
-             * @warning All storage cells of the terrain must be loaded.
+             * @return True if the terrain and all of its cells were written, false otherwise
+             * @note The cells are stored in a tile archive next to the terrain file. Cells which aren't
+             * loaded are taken from the archive or the terrain file the terrain was loaded from.
+             * The terrain file is only replaced once all cells were written.
              */
-            static void SaveTerrain(Ref<Terrain::Terrain> terrain, std::string filename);
+            static bool SaveTerrain(Ref<Terrain::Terrain> terrain, std::string filename);
 
             /**
              *
@@ -36,7 +42,36 @@ namespace Atlas {
             static void LoadStorageCell(Ref<Terrain::Terrain> terrain, Terrain::TerrainStorageCell* cell,
                 std::string filename, bool initWithHeightData = false);
 
+            /**
+             * Loads a storage cell without touching anything else of the terrain, can be called from any thread.
+             * @param terrain
+             * @param cell
+             * @param filename
+             * @param initWithHeightData
+             */
+            static void LoadStorageCell(Terrain::Terrain* terrain, Terrain::TerrainStorageCell* cell,
+                std::string filename, bool initWithHeightData = false);
+
+            /**
+             * Converts the cells of a terrain file in the old format, which stores them after the
+             * header, into a tile archive next to the terrain file.
+             * @param filename The terrain file
+             * @param compress Whether tiles are compressed where it saves memory
+             * @return True if the tile archive was written, false otherwise
+             * @note Doesn't need a graphics device.
+             */
+            static bool ConvertTerrain(std::string filename, bool compress = true);
+
         private:
+            static void LoadLegacyStorageCell(Terrain::Terrain* terrain, Terrain::TerrainStorageCell* cell,
+                std::string filename, bool initWithHeightData);
+
+            static bool SkipLegacyHeader(std::ifstream& fileStream);
+
+            static bool ReadLegacyTile(std::ifstream& fileStream, std::streamoff cellDataOffset,
+                Terrain::Terrain* terrain, int32_t x, int32_t y, int32_t LoD, std::vector<uint16_t>& heightFieldData,
+                Common::Image<uint8_t>& normalImage, std::vector<uint8_t>& splatMapData);
+
             static int32_t ReadInt(const char* ptr, std::string line, size_t& offset);
 
             static float ReadFloat(const char* ptr, std::string line, size_t& offset);
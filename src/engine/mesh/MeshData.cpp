@@ -1,6 +1,8 @@
 #include "MeshData.h"
 
 #include "../volume/BVH.h"
+#include "../loader/BVHCacheLoader.h"
+#include "../common/Hash.h"
 
 namespace Atlas {
 
@@ -158,11 +160,20 @@ namespace Atlas {
 
             }
 
+            // The binary BVH is needed for the CPU queries as well, even if the GPU uses hardware ray tracing.
+            // Building is expensive for larger meshes, so a cached BVH is used as long as the data didn't change.
             Volume::BVH bvh;
-            if (!hardwareRayTracing) {
-                // Generate BVH
+            auto hash = CalculateBVHHash();
+            if (bvhCachePath.empty() || !Loader::BVHCacheLoader::LoadBVH(bvhCachePath, hash, bvhTriangles, bvh)) {
                 bvh = Volume::BVH(aabbs, bvhTriangles, parallelBuild);
 
+                if (!bvhCachePath.empty())
+                    Loader::BVHCacheLoader::SaveBVH(bvhCachePath, hash, bvh);
+            }
+
+            cpuBvh = Volume::WideBVH(bvh);
+
+            if (!hardwareRayTracing) {
                 bvhTriangles.clear();
                 bvhTriangles.shrink_to_fit();
             }
@@ -276,6 +287,23 @@ namespace Atlas {
 
         }
 
+        uint64_t MeshData::CalculateBVHHash() const {
+
+            // The build only depends on the positions and the triangles of the sub data
+            const auto& vertexData = vertices.data;
+            const auto& indexData = indices.data;
+
+            auto hash = HashBytes(vertexData.data(), vertexData.size() * sizeof(vec3));
+            hash = HashBytes(indexData.data(), indexData.size() * sizeof(uint32_t), hash);
+            for (const auto& sub : subData) {
+                hash = HashBytes(&sub.indicesOffset, sizeof(sub.indicesOffset), hash);
+                hash = HashBytes(&sub.indicesCount, sizeof(sub.indicesCount), hash);
+            }
+
+            return hash;
+
+        }
+
         void MeshData::DeepCopy(const MeshData& that) {
 
             name = that.name;
@@ -2,6 +2,7 @@
 
 #include "../System.h"
 #include "../volume/AABB.h"
+#include "../volume/WideBVH.h"
 #include "raytracing/RTStructures.h"
 #include "resource/Resource.h"
 #include "DataComponent.h"
@@ -111,9 +112,23 @@ namespace Atlas {
             Volume::AABB aabb;
             float radius = 0.0f;
 
+            /**
+             * Path of the file BuildBVH() caches the BVH in. The cache is only used if it still
+             * matches the vertex and index data. Empty if no cache should be used.
+             */
+            std::string bvhCachePath;
+
+            /**
+             * BVH for ray queries on the CPU, e.g. picking. Built by BuildBVH(), the hits
+             * reference the triangles in the order of the index data.
+             */
+            Volume::WideBVH cpuBvh;
+
         private:
             void DeepCopy(const MeshData& that);
 
+            uint64_t CalculateBVHHash() const;
+
             int32_t indexCount = 0;
             int32_t vertexCount = 0;
 
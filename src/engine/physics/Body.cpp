@@ -17,6 +17,13 @@ namespace Atlas::Physics {
 
     }
 
+    bool Body::IsActive() {
+
+        AE_ASSERT(world != nullptr && "Physics world is invalid");
+        return world->IsBodyActive(bodyId);
+
+    }
+
     void Body::SetMotionQuality(Physics::MotionQuality quality) {
 
         AE_ASSERT(world != nullptr && "Physics world is invalid");
@@ -19,6 +19,9 @@ namespace Atlas::Physics {
 
         mat4 GetMatrix();
 
+        // Bodies which came to rest are inactive and aren't moved by the simulation
+        bool IsActive();
+
         void SetMotionQuality(MotionQuality quality);
 
         MotionQuality GetMotionQuality();
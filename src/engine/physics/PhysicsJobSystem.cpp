@@ -0,0 +1,78 @@
+#include "PhysicsJobSystem.h"
+
+#include <thread>
+
+namespace Atlas {
+
+    namespace Physics {
+
+        PhysicsJobSystem::PhysicsJobSystem(uint32_t maxJobCount, uint32_t maxBarrierCount, JobPriority priority) :
+            JPH::JobSystemWithBarrier(maxBarrierCount), jobGroup(priority) {
+
+            jobs.Init(maxJobCount, maxJobCount);
+
+        }
+
+        PhysicsJobSystem::~PhysicsJobSystem() {
+
+            Atlas::JobSystem::Wait(jobGroup);
+
+        }
+
+        int PhysicsJobSystem::GetMaxConcurrency() const {
+
+            // The thread which waits for a barrier executes jobs as well
+            return Atlas::JobSystem::GetWorkerCount(jobGroup.priority) + 1;
+
+        }
+
+        JPH::JobHandle PhysicsJobSystem::CreateJob(const char* name, JPH::ColorArg color,
+            const JobFunction& function, JPH::uint32 dependencyCount) {
+
+            // The number of jobs is bounded by the physics system, so this should never have to wait
+            uint32_t idx;
+            while ((idx = jobs.ConstructObject(name, color, this, function, dependencyCount)) == JobList::cInvalidObjectIndex) {
+                AE_ASSERT(false && "Too many physics jobs");
+                std::this_thread::yield();
+            }
+
+            auto job = &jobs.Get(idx);
+
+            // The handle keeps a reference, since the queued job might finish and release right away
+            JobHandle handle(job);
+
+            if (dependencyCount == 0)
+                QueueJob(job);
+
+            return handle;
+
+        }
+
+        void PhysicsJobSystem::QueueJob(Job* job) {
+
+            // Released by the worker after the job executed
+            job->AddRef();
+
+            Atlas::JobSystem::Execute(jobGroup, [job](JobData&) {
+                job->Execute();
+                job->Release();
+            });
+
+        }
+
+        void PhysicsJobSystem::QueueJobs(Job** queuedJobs, JPH::uint jobCount) {
+
+            for (JPH::uint i = 0; i < jobCount; i++)
+                QueueJob(queuedJobs[i]);
+
+        }
+
+        void PhysicsJobSystem::FreeJob(Job* job) {
+
+            jobs.DestructObject(job);
+
+        }
+
+    }
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "../System.h"
+#include "../jobsystem/JobSystem.h"
+
+#include <Jolt/Jolt.h>
+
+#include <Jolt/Core/JobSystemWithBarrier.h>
+#include <Jolt/Core/FixedSizeFreeList.h>
+
+namespace Atlas {
+
+    namespace Physics {
+
+        /**
+         * Runs the jobs of the physics simulation on the workers of the engine job system, such that
+         * physics and the rest of the engine don't compete for the cores with separate thread pools.
+         * Barriers are handled by Jolt, threads waiting on a barrier help executing its jobs.
+         */
+        class PhysicsJobSystem : public JPH::JobSystemWithBarrier {
+
+        public:
+            /**
+             * Constructs a PhysicsJobSystem object.
+             * @param maxJobCount The maximum number of jobs which can exist at the same time
+             * @param maxBarrierCount The maximum number of barriers which can exist at the same time
+             * @param priority The priority of the job system pool the jobs run on
+             */
+            PhysicsJobSystem(uint32_t maxJobCount, uint32_t maxBarrierCount, JobPriority priority = JobPriority::High);
+
+            ~PhysicsJobSystem() override;
+
+            int GetMaxConcurrency() const override;
+
+            JobHandle CreateJob(const char* name, JPH::ColorArg color, const JobFunction& function,
+                JPH::uint32 dependencyCount = 0) override;
+
+        protected:
+            void QueueJob(Job* job) override;
+
+            void QueueJobs(Job** queuedJobs, JPH::uint jobCount) override;
+
+            void FreeJob(Job* job) override;
+
+        private:
+            using JobList = JPH::FixedSizeFreeList<Job>;
+
+            JobList jobs;
+            JobGroup jobGroup;
+
+        };
+
+    }
+
+}
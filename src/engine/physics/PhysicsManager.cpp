@@ -11,8 +11,7 @@ namespace Atlas {
 
         using namespace JPH;
 
-        Ref<TempAllocatorImpl> PhysicsManager::tempAllocator = nullptr;
-        Ref<JobSystemThreadPool> PhysicsManager::jobSystemThreadPool = nullptr;
+        Ref<PhysicsJobSystem> PhysicsManager::jobSystem = nullptr;
 
         std::mutex PhysicsManager::updateMutex;
 
@@ -28,9 +27,8 @@ namespace Atlas {
             // Register all Jolt physics types
             RegisterTypes();
 
-            tempAllocator = Atlas::CreateRef<TempAllocatorImpl>(100 * 1024 * 1024);
-            jobSystemThreadPool = Atlas::CreateRef<JobSystemThreadPool>(cMaxPhysicsJobs,
-                cMaxPhysicsBarriers, std::min(thread::hardware_concurrency() - 1u, 12u));
+            // Physics steps are part of the frame, so they run with high priority next to the other frame work
+            jobSystem = Atlas::CreateRef<PhysicsJobSystem>(cMaxPhysicsJobs, cMaxPhysicsBarriers, JobPriority::High);
 
         }
 
@@ -42,9 +40,8 @@ namespace Atlas {
             delete Factory::sInstance;
             Factory::sInstance = nullptr;
 
-            // Do an explicit release on shutdown
-            tempAllocator.reset();
-            jobSystemThreadPool.reset();
+            // Do an explicit release on shutdown, which waits for the physics jobs while the job system still runs
+            jobSystem.reset();
 
         }
 
@@ -53,7 +50,7 @@ namespace Atlas {
             std::scoped_lock<std::mutex> lock(updateMutex);
 
             uint32_t collisionSteps = std::min(std::max(uint32_t(float(physicsWorld->simulationStepsPerSecond) * deltaTime), 1u), 8u);
-            physicsWorld->system->Update(deltaTime, collisionSteps, tempAllocator.get(), jobSystemThreadPool.get());
+            physicsWorld->system->Update(deltaTime, collisionSteps, physicsWorld->tempAllocator.get(), jobSystem.get());
 
         }
 
@@ -3,8 +3,8 @@
 #include "../System.h"
 
 #include "PhysicsWorld.h"
+#include "PhysicsJobSystem.h"
 
-#include <Jolt/Core/JobSystemThreadPool.h>
 #include <mutex>
 
 namespace Atlas {
@@ -20,8 +20,7 @@ namespace Atlas {
 
             static void ExecuteUpdate(PhysicsWorld* physicsWorld, float deltaTime);
 
-            static Ref<JPH::TempAllocatorImpl> tempAllocator;
-            static Ref<JPH::JobSystemThreadPool> jobSystemThreadPool;
+            static Ref<PhysicsJobSystem> jobSystem;
 
         private:
             static std::mutex updateMutex;
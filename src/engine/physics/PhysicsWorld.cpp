@@ -1,6 +1,7 @@
 #include "PhysicsWorld.h"
 #include "PhysicsManager.h"
 #include "MathConversion.h"
+#include "../Log.h"
 
 #include <Jolt/Physics/Body/BodyCreationSettings.h>
 #include <Jolt/Physics/Collision/Shape/ScaledShape.h>
@@ -13,6 +14,13 @@ namespace Atlas {
 
     namespace Physics {
 
+        // Upper estimates of the temporary memory a simulation step needs, which include the broad phase,
+        // island and solver data. Contact constraints dominate, since each one holds up to four contact points.
+        static constexpr size_t tempMemoryPerBody = 256;
+        static constexpr size_t tempMemoryPerBodyPair = 16;
+        static constexpr size_t tempMemoryPerContactConstraint = 512;
+        static constexpr size_t minTempMemory = 4 * 1024 * 1024;
+
         PhysicsWorld::PhysicsWorld(uint32_t maxBodyCount, uint32_t bodyMutexesCount, uint32_t maxBodyPairCount,
             uint32_t maxContactConstraintCount, Ref<JPH::ObjectLayerPairFilter> objectLayerFilter,
             Ref<JPH::BroadPhaseLayerInterface> broadPhaseLayerInterface,
@@ -34,6 +42,16 @@ namespace Atlas {
 
             state = CreateRef<JPH::StateRecorderImpl>();
 
+            auto tempMemory = minTempMemory + size_t(maxBodyCount) * tempMemoryPerBody +
+                size_t(maxBodyPairCount) * tempMemoryPerBodyPair +
+                size_t(maxContactConstraintCount) * tempMemoryPerContactConstraint;
+            // The allocator size is 32 bit, huge body or contact counts can't get more than that
+            if (tempMemory > size_t(UINT32_MAX)) {
+                Log::Warning("Physics temporary memory is limited to 4 GB, the simulation might run out of memory");
+                tempMemory = size_t(UINT32_MAX);
+            }
+            tempAllocator = CreateRef<JPH::TempAllocatorImpl>(uint32_t(tempMemory));
+
             //contactListener = CreateRef<MyContactListener>();
             //system.SetContactListener(contactListener.get());
 
@@ -131,6 +149,13 @@ namespace Atlas {
 
         }
 
+        bool PhysicsWorld::IsBodyActive(BodyID bodyId) {
+
+            auto& bodyInterface = system->GetBodyInterface();
+            return bodyInterface.IsActive(bodyId);
+
+        }
+
         MotionQuality PhysicsWorld::GetMotionQuality(BodyID bodyId) {
 
             auto& bodyInterface = system->GetBodyInterface();
@@ -9,6 +9,7 @@
 
 #include "InterfaceImplementations.h"
 #include <Jolt/Physics/StateRecorderImpl.h>
+#include <Jolt/Core/TempAllocator.h>
 
 namespace Atlas {
 
@@ -46,6 +47,8 @@ namespace Atlas {
 
             mat4 GetBodyMatrix(BodyID bodyId);
 
+            bool IsBodyActive(BodyID bodyId);
+
             void SetMotionQuality(BodyID bodyId, MotionQuality quality);
 
             MotionQuality GetMotionQuality(BodyID bodyId);
@@ -85,6 +88,8 @@ namespace Atlas {
             void RestoreState();
 
             Ref<JPH::PhysicsSystem> system = nullptr;
+            // Sized from the limits of the world, only used by one update at a time
+            Ref<JPH::TempAllocatorImpl> tempAllocator = nullptr;
 
             int32_t simulationStepsPerSecond = 60;
             bool pauseSimulation = false;
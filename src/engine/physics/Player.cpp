@@ -120,7 +120,7 @@ namespace Atlas::Physics {
         const auto& physicsSettings = system->GetPhysicsSettings();
         const auto& broadPhaseLayerFilter = system->GetDefaultBroadPhaseLayerFilter(Layers::Movable);
         const auto& defaultLayerFilter = system->GetDefaultLayerFilter(Physics::Layers::Movable);
-        const auto& tempAllocator = Physics::PhysicsManager::tempAllocator;
+        const auto& tempAllocator = world->tempAllocator;
 
         character->SetShape(shape->ref, physicsSettings.mPenetrationSlop * 1.5f, broadPhaseLayerFilter,
             defaultLayerFilter, {}, {}, *tempAllocator);
@@ -136,7 +136,7 @@ namespace Atlas::Physics {
         const auto& physicsSettings = system->GetPhysicsSettings();
         const auto& broadPhaseLayerFilter = system->GetDefaultBroadPhaseLayerFilter(Layers::Movable);
         const auto& defaultLayerFilter = system->GetDefaultLayerFilter(Physics::Layers::Movable);
-        const auto& tempAllocator = Physics::PhysicsManager::tempAllocator;
+        const auto& tempAllocator = world->tempAllocator;
 
         auto gravityVector = -GetUp() * glm::length(world->GetGravity());
 
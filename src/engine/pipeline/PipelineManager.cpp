@@ -47,29 +47,16 @@ namespace Atlas {
             JobSystem::Execute(hotReloadGroup, [&](JobData&) {
                 std::shared_lock lock(shaderToVariantsMutex);
 
-                std::unordered_map<std::string, std::filesystem::file_time_type> modifiedMap;
-
-                for (auto& [_, variants] : shaderToVariantsMap) {
-                    std::lock_guard innerLock(variants->variantsMutex);
-
-                    for (auto& stageFile : variants->shader->shaderStageFiles) {
-                        for (auto& includePath : stageFile.includes) {
-                            if (modifiedMap.find(includePath) != modifiedMap.end())
-                                continue;
-
-                            std::error_code errorCode;
-                            auto lastModified = std::filesystem::last_write_time(includePath, errorCode);
-                            if (!errorCode)
-                                modifiedMap[includePath] = lastModified;
-                        }
-                    }
-                }
+                // Every file is checked only once, no matter how many shaders include it
+                auto modifiedFiles = Loader::ShaderLoader::GetModifiedFiles();
+                if (modifiedFiles.empty())
+                    return;
 
                 // Do check for hot reload only once per frame
                 for (auto& [hash, variants] : shaderToVariantsMap) {
                     std::lock_guard innerLock(variants->variantsMutex);
 
-                    if (hotReload && variants->shader->Reload(modifiedMap)) {
+                    if (hotReload && variants->shader->Reload(modifiedFiles)) {
                         // Clear variants on hot reload
                         variants->pipelines.clear();
                     }
@@ -8,6 +8,7 @@
 
 #include <unordered_map>
 #include <set>
+#include <algorithm>
 
 namespace Atlas {
 
@@ -29,7 +30,13 @@ namespace Atlas {
 
         }
 
-        void RayTracingWorld::Update(Scene::Subset<MeshComponent, TransformComponent> subset, bool updateTriangleLights) {
+        void RayTracingWorld::Update(Scene::Subset<MeshComponent, TransformComponent> subset,
+            const std::vector<ECS::Entity>& updatedEntities, const std::vector<ECS::Entity>& removedEntities,
+            bool updateTriangleLights) {
+
+            // Keep the changes around, even if they can't be processed in this update
+            pendingEntities.insert(pendingEntities.end(), updatedEntities.begin(), updatedEntities.end());
+            pendingRemovedEntities.insert(pendingRemovedEntities.end(), removedEntities.begin(), removedEntities.end());
 
             auto device = Graphics::GraphicsDevice::DefaultDevice;
 
@@ -41,6 +48,9 @@ namespace Atlas {
             auto meshes = scene->GetMeshes();
             int32_t meshCount = 0;
 
+            // If any mesh related data changes all instances need to be updated
+            bool meshDataChanged = false;
+
             JobSystem::Wait(scene->bindlessMeshMapUpdateJob);
 
             for (auto& mesh : meshes) {
@@ -54,13 +64,19 @@ namespace Atlas {
                 }
 
                 auto &meshInfo = meshInfos[mesh.GetID()];
-                meshInfo.offset = int32_t(scene->meshIdToBindlessIdx[mesh.GetID()]);
+                auto offset = int32_t(scene->meshIdToBindlessIdx[mesh.GetID()]);
+                meshDataChanged |= meshInfo.offset != offset;
+                meshInfo.offset = offset;
+
+                meshDataChanged |= meshInfo.castShadow != mesh->castShadow;
+                meshInfo.castShadow = mesh->castShadow;
 
                 // Some extra path for hardware raytracing, don't want to do work twice
                 if (hardwareRayTracing) {
                     if (mesh->needsBvhRefresh) {
                         blases.push_back(mesh->blas);
                         mesh->needsBvhRefresh = false;
+                        meshDataChanged = true;
                     }
 
                     meshInfo.blas = mesh->blas;
@@ -74,78 +90,119 @@ namespace Atlas {
                     asBuilder.BuildBLAS(blases);
             }
 
-            for (auto& [_, meshInfo] : meshInfos) {
-                meshInfo.instanceIndices.clear();
-                meshInfo.matrices.clear();
-            }
-
-            hardwareInstances.clear();
-            gpuBvhInstances.clear();
-            actorAABBs.clear();
-            lastMatrices.clear();
-
             JobSystem::Wait(scene->bindlessTextureMapUpdateJob);
 
+            std::unordered_map<size_t, int32_t> materialOffsets;
+            for (auto& [meshId, meshInfo] : meshInfos)
+                materialOffsets[meshId] = meshInfo.materialOffset;
+
             UpdateMaterials();
 
-            for (auto entity : subset) {
-                const auto& [meshComponent, transformComponent] = subset.Get(entity);
+            for (auto& [meshId, meshInfo] : meshInfos)
+                meshDataChanged |= materialOffsets[meshId] != meshInfo.materialOffset;
 
-                if (!scene->meshIdToBindlessIdx.contains(meshComponent.mesh.GetID()))
-                    continue;
+            // Only the first update after a clear needs to go through all entities
+            if (rebuildInstances) {
+                tlasBvh.Clear();
+                entityToInstance.clear();
+                instanceInfos.clear();
+                hardwareInstances.clear();
+                gpuBvhInstances.clear();
+                lastMatrices.clear();
 
-                actorAABBs.push_back(meshComponent.aabb);
-                auto &meshInfo = meshInfos[meshComponent.mesh.GetID()];
+                pendingEntities.clear();
+                pendingRemovedEntities.clear();
+                lastUpdatedEntities.clear();
 
-                auto inverseMatrix = mat3x4(glm::transpose(transformComponent.inverseGlobalMatrix));
+                for (auto entity : subset)
+                    pendingEntities.push_back(entity);
 
-                uint32_t mask = InstanceCullMasks::MaskAll;
-                mask |= meshComponent.mesh->castShadow ? InstanceCullMasks::MaskShadow : 0;
+                rebuildInstances = false;
+            }
 
-                GPUBVHInstance gpuBvhInstance = {
-                    .inverseMatrix = inverseMatrix,
-                    .meshOffset = meshInfo.offset,
-                    .materialOffset = meshInfo.materialOffset,
-                    .mask = mask
-                };
+            for (auto entity : pendingRemovedEntities)
+                RemoveInstance(entity);
+            pendingRemovedEntities.clear();
 
-                meshInfo.matrices.emplace_back(transformComponent.globalMatrix);
-                meshInfo.instanceIndices.push_back(uint32_t(gpuBvhInstances.size()));
-                gpuBvhInstances.push_back(gpuBvhInstance);
+            // Instances which were updated in the last update might have stopped moving since,
+            // which means their last matrix is now equal to their current one
+            for (auto entity : lastUpdatedEntities) {
+                auto iter = entityToInstance.find(entity);
+                auto transformComponent = scene->entityManager.TryGet<TransformComponent>(entity);
+                if (iter == entityToInstance.end() || !transformComponent)
+                    continue;
 
-                if (includeObjectHistory)
-                    lastMatrices.emplace_back(glm::transpose(transformComponent.lastGlobalMatrix));
+                lastMatrices[iter->second] = mat3x4(glm::transpose(transformComponent->lastGlobalMatrix));
+            }
+            lastUpdatedEntities.clear();
 
-                // Some extra path for hardware raytracing, don't want to do work twice
-                if (hardwareRayTracing) {
-                    VkAccelerationStructureInstanceKHR inst = {};
-                    VkTransformMatrixKHR transform;
-
-                    auto transposed = glm::transpose(transformComponent.globalMatrix);
-                    std::memcpy(&transform, &transposed, sizeof(VkTransformMatrixKHR));
-
-                    inst.transform = transform;
-                    inst.instanceCustomIndex = meshInfo.offset;
-                    inst.accelerationStructureReference = meshInfo.blas->bufferDeviceAddress;
-                    inst.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
-                    inst.mask = mask;
-                    inst.instanceShaderBindingTableRecordOffset = 0;
-                    hardwareInstances.push_back(inst);
+            // Meshes can be swapped without the entity being reported as updated, e.g. in the editor
+            for (int32_t i = 0; i < int32_t(instanceInfos.size()); i++) {
+                if (!tlasBvh.IsLeafValid(i))
+                    continue;
+
+                const auto& instanceInfo = instanceInfos[i];
+                auto meshComponent = scene->entityManager.TryGet<MeshComponent>(instanceInfo.entity);
+                if (!meshComponent || meshComponent->mesh.GetID() != instanceInfo.meshId)
+                    pendingEntities.push_back(instanceInfo.entity);
+            }
+
+            if (meshDataChanged) {
+                for (int32_t i = 0; i < int32_t(tlasBvh.GetLeafCapacity()); i++) {
+                    if (tlasBvh.IsLeafValid(i))
+                        UpdateInstanceMeshData(i);
                 }
             }
 
-            if (gpuBvhInstances.empty())
+            std::vector<ECS::Entity> entities;
+            entities.swap(pendingEntities);
+            std::sort(entities.begin(), entities.end());
+            entities.erase(std::unique(entities.begin(), entities.end()), entities.end());
+
+            for (auto entity : entities) {
+                // Entities might have lost their components in the meantime
+                auto meshComponent = scene->entityManager.TryGet<MeshComponent>(entity);
+                auto transformComponent = scene->entityManager.TryGet<TransformComponent>(entity);
+                if (!meshComponent || !transformComponent) {
+                    RemoveInstance(entity);
+                    continue;
+                }
+
+                UpdateInstance(entity, *meshComponent, *transformComponent);
+            }
+
+            if (!tlasBvh.GetLeafCount()) {
+                ClearInstanceBuffers();
                 return;
+            }
 
             if (hardwareRayTracing) {
-                UpdateForHardwareRayTracing(subset, gpuBvhInstances.size());
+                UpdateForHardwareRayTracing();
             }
             else {
-                UpdateForSoftwareRayTracing(gpuBvhInstances, lastMatrices, actorAABBs);
+                UpdateForSoftwareRayTracing();
             }
 
-            if (updateTriangleLights)
+            if (updateTriangleLights) {
+                for (auto& [_, meshInfo] : meshInfos) {
+                    meshInfo.instanceIndices.clear();
+                    meshInfo.matrices.clear();
+                }
+
+                for (int32_t i = 0; i < int32_t(instanceInfos.size()); i++) {
+                    if (!tlasBvh.IsLeafValid(i))
+                        continue;
+
+                    const auto& instanceInfo = instanceInfos[i];
+                    auto& meshInfo = meshInfos[instanceInfo.meshId];
+                    const auto& transformComponent = scene->entityManager.Get<TransformComponent>(instanceInfo.entity);
+
+                    meshInfo.matrices.emplace_back(transformComponent.globalMatrix);
+                    meshInfo.instanceIndices.push_back(uint32_t(i));
+                }
+
                 UpdateTriangleLights();
+            }
 
             if (bvhInstanceBuffer.GetElementCount() < gpuBvhInstances.size()) {
                 bvhInstanceBuffer.SetSize(gpuBvhInstances.size());
@@ -253,6 +310,7 @@ namespace Atlas {
         void RayTracingWorld::Clear() {
 
             meshInfos.clear();
+            rebuildInstances = true;
 
         }
 
@@ -264,12 +322,135 @@ namespace Atlas {
 
         }
 
-        void RayTracingWorld::UpdateForSoftwareRayTracing(std::vector<GPUBVHInstance>& gpuBvhInstances,
-            std::vector<mat3x4>& lastMatrices, std::vector<Volume::AABB>& actorAABBs) {
+        void RayTracingWorld::UpdateInstance(ECS::Entity entity, const MeshComponent& meshComponent,
+            const TransformComponent& transformComponent) {
+
+            auto meshId = meshComponent.mesh.GetID();
+            if (!scene->meshIdToBindlessIdx.contains(meshId) || !meshInfos.contains(meshId)) {
+                // Try again in the next update, the mesh might be available then. An existing
+                // instance is removed in the meantime, since it still references the old mesh.
+                RemoveInstance(entity);
+                pendingEntities.push_back(entity);
+                return;
+            }
+
+            int32_t instanceIdx;
+            auto iter = entityToInstance.find(entity);
+            if (iter != entityToInstance.end()) {
+                instanceIdx = iter->second;
+                tlasBvh.Update(instanceIdx, meshComponent.aabb);
+            }
+            else {
+                instanceIdx = tlasBvh.Insert(meshComponent.aabb);
+                entityToInstance[entity] = instanceIdx;
+
+                auto capacity = tlasBvh.GetLeafCapacity();
+                if (instanceInfos.size() < capacity) {
+                    instanceInfos.resize(capacity);
+                    hardwareInstances.resize(capacity);
+                    gpuBvhInstances.resize(capacity);
+                    lastMatrices.resize(capacity);
+                }
+            }
+
+            instanceInfos[instanceIdx] = { .entity = entity, .meshId = meshId };
+            WriteInstance(instanceIdx, meshComponent, transformComponent);
+
+            lastUpdatedEntities.push_back(entity);
+
+        }
+
+        void RayTracingWorld::RemoveInstance(ECS::Entity entity) {
+
+            auto iter = entityToInstance.find(entity);
+            if (iter == entityToInstance.end())
+                return;
+
+            auto instanceIdx = iter->second;
+            entityToInstance.erase(iter);
+
+            tlasBvh.Remove(instanceIdx);
+
+            // The slot stays in the instance buffers until it is reused, make sure it is never hit
+            instanceInfos[instanceIdx] = InstanceInfo();
+            gpuBvhInstances[instanceIdx].mask = 0;
+            hardwareInstances[instanceIdx].mask = 0;
+            hardwareInstances[instanceIdx].accelerationStructureReference = 0;
+
+        }
+
+        void RayTracingWorld::WriteInstance(int32_t instanceIdx, const MeshComponent& meshComponent,
+            const TransformComponent& transformComponent) {
+
+            auto& meshInfo = meshInfos[meshComponent.mesh.GetID()];
+
+            auto inverseMatrix = mat3x4(glm::transpose(transformComponent.inverseGlobalMatrix));
+
+            uint32_t mask = InstanceCullMasks::MaskAll;
+            mask |= meshInfo.castShadow ? InstanceCullMasks::MaskShadow : 0;
+
+            // Each leaf of the top level BVH contains exactly one instance
+            gpuBvhInstances[instanceIdx] = {
+                .inverseMatrix = inverseMatrix,
+                .meshOffset = meshInfo.offset,
+                .materialOffset = meshInfo.materialOffset,
+                .nextInstance = -1,
+                .mask = mask
+            };
+
+            lastMatrices[instanceIdx] = mat3x4(glm::transpose(transformComponent.lastGlobalMatrix));
+
+            // Some extra path for hardware raytracing, don't want to do work twice
+            if (hardwareRayTracing) {
+                VkAccelerationStructureInstanceKHR inst = {};
+                VkTransformMatrixKHR transform;
+
+                auto transposed = glm::transpose(transformComponent.globalMatrix);
+                std::memcpy(&transform, &transposed, sizeof(VkTransformMatrixKHR));
+
+                inst.transform = transform;
+                inst.instanceCustomIndex = meshInfo.offset;
+                inst.accelerationStructureReference = meshInfo.blas->bufferDeviceAddress;
+                inst.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
+                inst.mask = mask;
+                inst.instanceShaderBindingTableRecordOffset = 0;
+                hardwareInstances[instanceIdx] = inst;
+            }
+
+        }
+
+        void RayTracingWorld::UpdateInstanceMeshData(int32_t instanceIdx) {
+
+            // Instances with a mesh which isn't available anymore are updated later on with their new mesh
+            auto iter = meshInfos.find(instanceInfos[instanceIdx].meshId);
+            if (iter == meshInfos.end())
+                return;
+
+            const auto& meshInfo = iter->second;
+
+            uint32_t mask = InstanceCullMasks::MaskAll;
+            mask |= meshInfo.castShadow ? InstanceCullMasks::MaskShadow : 0;
+
+            gpuBvhInstances[instanceIdx].meshOffset = meshInfo.offset;
+            gpuBvhInstances[instanceIdx].materialOffset = meshInfo.materialOffset;
+            gpuBvhInstances[instanceIdx].mask = mask;
+
+            if (hardwareRayTracing) {
+                hardwareInstances[instanceIdx].instanceCustomIndex = meshInfo.offset;
+                hardwareInstances[instanceIdx].accelerationStructureReference = meshInfo.blas->bufferDeviceAddress;
+                hardwareInstances[instanceIdx].mask = mask;
+            }
+
+        }
+
+        void RayTracingWorld::UpdateForSoftwareRayTracing() {
 
-            auto bvh = Volume::BVH(actorAABBs);
+            // Only rebuild when incremental updates have degraded the tree too much. This happens
+            // within the frame, so the faster linear build is used, the treelets recover most of the quality.
+            if (tlasBvh.NeedsRebuild())
+                tlasBvh.Rebuild(true, Volume::BVHBuildMode::LinearOptimized);
 
-            auto& nodes = bvh.GetTree();
+            auto& nodes = tlasBvh.GetTree();
             auto gpuBvhNodes = std::vector<GPUBVHNode>(nodes.size());
             // Copy to GPU format
             for (size_t i = 0; i < nodes.size(); i++) {
@@ -283,31 +464,15 @@ namespace Atlas {
                 gpuBvhNodes[i].rightAABB.max = nodes[i].rightAABB.max;
             }
 
-            // Order after the BVH build to fit the node indices
-            std::vector<GPUBVHInstance> orderedGpuBvhInstances(bvh.refs.size());
-            std::vector<mat3x4> orderedLastMatrices(bvh.refs.size());
-            for (size_t i = 0; i < bvh.refs.size(); i++) {
-                const auto& ref = bvh.refs[i];
-                if (includeObjectHistory)
-                    orderedLastMatrices[i] = lastMatrices[bvh.refs[i].idx];
-                orderedGpuBvhInstances[i] = gpuBvhInstances[bvh.refs[i].idx];
-                orderedGpuBvhInstances[i].nextInstance = ref.endOfNode ? -1 : int32_t(i) + 1;
-            }
-
             if (tlasNodeBuffer.GetElementCount() < gpuBvhNodes.size()) {
                 tlasNodeBuffer.SetSize(gpuBvhNodes.size());
             }
 
             tlasNodeBuffer.SetData(gpuBvhNodes.data(), 0, gpuBvhNodes.size());
 
-            gpuBvhInstances = orderedGpuBvhInstances;
-            if (includeObjectHistory)
-                lastMatrices = orderedLastMatrices;
-
         }
 
-        void RayTracingWorld::UpdateForHardwareRayTracing(Scene::Subset<MeshComponent,
-            TransformComponent>& entitySubset, size_t instanceCount) {
+        void RayTracingWorld::UpdateForHardwareRayTracing() {
 
             auto device = Graphics::GraphicsDevice::DefaultDevice;
 
@@ -319,6 +484,46 @@ namespace Atlas {
 
         }
 
+        void RayTracingWorld::ClearInstanceBuffers() {
+
+            // The buffers still contain the instances of the last update, so they are replaced
+            // by a single instance which is masked out and can't be hit
+            GPUBVHInstance gpuBvhInstance = {
+                .inverseMatrix = mat3x4(1.0f),
+                .meshOffset = 0,
+                .materialOffset = 0,
+                .nextInstance = -1,
+                .mask = 0
+            };
+
+            if (bvhInstanceBuffer.GetElementCount() < 1)
+                bvhInstanceBuffer.SetSize(1);
+            bvhInstanceBuffer.SetData(&gpuBvhInstance, 0, 1);
+
+            if (hardwareRayTracing) {
+                auto device = Graphics::GraphicsDevice::DefaultDevice;
+
+                // Instances without an acceleration structure are inactive
+                std::vector<VkAccelerationStructureInstanceKHR> instances(1);
+
+                Graphics::ASBuilder asBuilder;
+                auto tlasDesc = Graphics::TLASDesc();
+                tlas = device->CreateTLAS(tlasDesc);
+
+                asBuilder.BuildTLAS(tlas, instances);
+            }
+            else {
+                GPUBVHNode gpuBvhNode = {};
+                gpuBvhNode.leftPtr = ~0;
+                gpuBvhNode.rightPtr = ~0;
+
+                if (tlasNodeBuffer.GetElementCount() < 1)
+                    tlasNodeBuffer.SetSize(1);
+                tlasNodeBuffer.SetData(&gpuBvhNode, 0, 1);
+            }
+
+        }
+
         void RayTracingWorld::BuildTriangleLightsForMesh(ResourceHandle<Mesh::Mesh> &mesh) {
 
             auto& gpuTriangles = mesh->data.gpuTriangles;
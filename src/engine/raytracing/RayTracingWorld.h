@@ -9,6 +9,7 @@
 #include "scene/components/TransformComponent.h"
 
 #include "texture/TextureAtlas.h"
+#include "volume/DynamicBVH.h"
 
 #include <vector>
 #include <unordered_map>
@@ -36,7 +37,18 @@ namespace Atlas {
         public:
             RayTracingWorld();
 
-            void Update(Scene::Subset<MeshComponent, TransformComponent> subset, bool updateTriangleLights);
+            /**
+             * Updates the instances of the top level acceleration structure.
+             * @param subset All entities which might be part of the acceleration structure
+             * @param updatedEntities Entities which were added or whose bounds have changed since the last call
+             * @param removedEntities Entities whose mesh component was removed since the last call
+             * @param updateTriangleLights Whether the triangle lights should be updated
+             * @note Only the first update after construction or Clear() goes through the whole subset.
+             * Afterwards only the updated and removed entities are processed.
+             */
+            void Update(Scene::Subset<MeshComponent, TransformComponent> subset,
+                const std::vector<ECS::Entity>& updatedEntities, const std::vector<ECS::Entity>& removedEntities,
+                bool updateTriangleLights);
 
             void UpdateMaterials();
 
@@ -55,18 +67,35 @@ namespace Atlas {
 
                 int32_t idx = 0;
 
+                bool castShadow = true;
+
                 std::vector<GPULight> triangleLights;
                 std::vector<uint32_t> instanceIndices;
                 std::vector<mat4x3> matrices;
             };
 
+            struct InstanceInfo {
+                ECS::Entity entity = ECS::EntityConfig::InvalidEntity;
+                size_t meshId = 0;
+            };
+
             void UpdateMaterials(std::vector<GPUMaterial>& materials);
 
-            void UpdateForSoftwareRayTracing(std::vector<GPUBVHInstance>& gpuBvhInstances,
-                std::vector<mat3x4>& lastMatrices, std::vector<Volume::AABB>& actorAABBs);
+            void UpdateInstance(ECS::Entity entity, const MeshComponent& meshComponent,
+                const TransformComponent& transformComponent);
+
+            void RemoveInstance(ECS::Entity entity);
+
+            void WriteInstance(int32_t instanceIdx, const MeshComponent& meshComponent,
+                const TransformComponent& transformComponent);
 
-            void UpdateForHardwareRayTracing(Scene::Subset<MeshComponent,
-                TransformComponent>& entitySubset, size_t instanceCount);
+            void UpdateInstanceMeshData(int32_t instanceIdx);
+
+            void UpdateForSoftwareRayTracing();
+
+            void UpdateForHardwareRayTracing();
+
+            void ClearInstanceBuffers();
 
             void BuildTriangleLightsForMesh(ResourceHandle<Mesh::Mesh>& mesh);
 
@@ -82,16 +111,28 @@ namespace Atlas {
             Buffer::Buffer tlasNodeBuffer;
             Buffer::Buffer lastMatricesBuffer;
 
+            // All instance data is indexed by the leaf index of the instance in the top level BVH.
+            // Slots of removed instances are masked out until they are reused.
             std::vector<VkAccelerationStructureInstanceKHR> hardwareInstances;
             std::vector<GPUBVHInstance> gpuBvhInstances;
-            std::vector<Volume::AABB> actorAABBs;
             std::vector<mat3x4> lastMatrices;
+            std::vector<InstanceInfo> instanceInfos;
+
+            Volume::DynamicBVH tlasBvh;
+            std::unordered_map<ECS::Entity, int32_t> entityToInstance;
+
+            // Changes which weren't processed yet, e.g. because the mesh isn't available to the ray tracer
+            std::vector<ECS::Entity> pendingEntities;
+            std::vector<ECS::Entity> pendingRemovedEntities;
+            // The last matrices of these need to be updated once more after they stopped moving
+            std::vector<ECS::Entity> lastUpdatedEntities;
 
             std::vector<GPULight> triangleLights;
 
             std::unordered_map<size_t, MeshInfo> meshInfos;
 
             bool hardwareRayTracing = false;
+            bool rebuildInstances = true;
 
             std::atomic_bool isValid = true;
             std::mutex mutex;
@@ -4,12 +4,34 @@
 #include "components/Components.h"
 #include "components/LuaScriptComponent.h"
 
+#include "../jobsystem/TaskGraph.h"
+
 namespace Atlas {
 
     namespace Scene {
 
         using namespace Components;
 
+        // Number of components processed by a single job in the parallel parts of the timestep
+        static constexpr int32_t componentChunkSize = 1024;
+        static constexpr int32_t hierarchyChunkSize = 64;
+
+        // Runs func(begin, end) over chunks of [0, count). Small ranges aren't worth distributing to the workers.
+        template<class F>
+        static void ParallelForChunks(size_t count, int32_t chunkSize, F&& func) {
+
+            if (count <= size_t(chunkSize)) {
+                if (count > 0)
+                    func(0, int32_t(count));
+                return;
+            }
+
+            JobGroup group { JobPriority::High };
+            JobSystem::ParallelFor(group, 0, int32_t(count), chunkSize, func);
+            JobSystem::Wait(group);
+
+        }
+
         Scene::~Scene() {
 
             Clear();
@@ -116,46 +138,53 @@ namespace Atlas {
 
             TransformComponent rootTransform = {};
 
-            auto hierarchyTransformSubset = entityManager.GetSubset<HierarchyComponent, TransformComponent>();
-            // Update hierarchy and their entities
-            for (auto entity : hierarchyTransformSubset) {
-                const auto& [hierarchyComponent, transformComponent] = hierarchyTransformSubset.Get(entity);
-
-                if (hierarchyComponent.root) {
-                    auto parentChanged = transformComponent.changed;
-                    transformComponent.Update(rootTransform, false);
-                    hierarchyComponent.Update(transformComponent, parentChanged);
-                }
-            }
-
-            // Update hierarchy components which are not part of a root hierarchy that also has a transform component
-            // This might be the case if there is an entity that has just a hierarchy without a tranform for, e.g. grouping entities
-            for (auto entity : hierarchyTransformSubset) {
-                const auto& [hierarchyComponent, transformComponent] = hierarchyTransformSubset.Get(entity);
-
-                if (!hierarchyComponent.updated) {
-                    auto parentChanged = transformComponent.changed;
-                    transformComponent.Update(rootTransform, false);
-                    hierarchyComponent.Update(transformComponent, parentChanged);
-                }
-            }
+            // Make sure all pools exist, since pools can't be created safely from within jobs
+            entityManager.GetSubset<HierarchyComponent, TransformComponent>();
+            entityManager.GetSubset<MeshComponent>();
+            auto playerSubset = entityManager.GetSubset<PlayerComponent, TransformComponent>();
+            auto rigidBodySubset = entityManager.GetSubset<RigidBodyComponent, TransformComponent>();
+            auto lightSubset = entityManager.GetSubset<LightComponent>();
+            auto cameraSubset = entityManager.GetSubset<CameraComponent, TransformComponent>();
+            auto textSubset = entityManager.GetSubset<TextComponent, TransformComponent>();
 
-            auto transformSubset = entityManager.GetSubset<TransformComponent>();
+            // The stages of the timestep run as a graph, such that stages which only depend on the final
+            // transforms run next to each other. Each stage still distributes its own work to the workers.
+            TaskGraph timestepGraph;
 
-            // Update all other transforms not affected by the hierarchy (entities don't need to be in hierarchy)
-            for (auto entity : transformSubset) {
-                auto& transformComponent = entityManager.Get<TransformComponent>(entity);
+            auto transformTask = timestepGraph.AddTask("Transforms", [&](JobGroup&) {
+                // Transforms which changed in the last timestep but not since then need to catch up their last matrix
+                ParallelForChunks(changedTransformEntities.size(), componentChunkSize, [&](int32_t begin, int32_t end) {
+                    for (int32_t i = begin; i < end; i++) {
+                        auto transformComponent = entityManager.TryGet<TransformComponent>(changedTransformEntities[i]);
+                        if (!transformComponent || transformComponent->changed)
+                            continue;
 
-                if (!transformComponent.updated) {
-                    transformComponent.Update(rootTransform, false);
-                }
-            }
+                        transformComponent->lastGlobalMatrix = transformComponent->globalMatrix;
+                        transformComponent->wasStatic = transformComponent->isStatic;
+                    }
+                    });
+
+                // Only transforms which changed since the last timestep, including new ones, and the hierarchies
+                // below them are updated. All others keep their global matrix, such that the work of all passes
+                // which depend on transforms is proportional to the number of changes instead of the scene size.
+                entityManager.ConsumeChanged<TransformComponent>(changedTransformEntities);
+
+                // Components might have been recorded multiple times or were erased in the meanwhile
+                std::sort(changedTransformEntities.begin(), changedTransformEntities.end());
+                changedTransformEntities.erase(std::unique(changedTransformEntities.begin(),
+                    changedTransformEntities.end()), changedTransformEntities.end());
+                changedTransformEntities.erase(std::remove_if(changedTransformEntities.begin(), changedTransformEntities.end(),
+                    [&](ECS::Entity entity) { return !entityManager.TryGet<TransformComponent>(entity); }),
+                    changedTransformEntities.end());
+
+                UpdateChangedTransforms(rootTransform);
+                });
 
-            // Wait for transform updates to finish
-            if (physicsWorld != nullptr) {
+            auto physicsTask = timestepGraph.AddTask("Physics", [&](JobGroup&) {
+                if (physicsWorld == nullptr)
+                    return;
 
                 // This part (updating physics transforms) is required regardless of the simulation running
-                auto playerSubset = entityManager.GetSubset<PlayerComponent, TransformComponent>();
                 for (auto entity : playerSubset) {
                     const auto& [playerComponent, transformComponent] = playerSubset.Get(entity);
 
@@ -175,8 +204,6 @@ namespace Atlas {
                     playerComponent.Update(deltaTime);
                 }
 
-                auto rigidBodySubset = entityManager.GetSubset<RigidBodyComponent, TransformComponent>();
-
                 for (auto entity : rigidBodySubset) {
                     const auto& [rigidBodyComponent, transformComponent] = rigidBodySubset.Get(entity);
 
@@ -195,26 +222,49 @@ namespace Atlas {
                 if (!physicsWorld->pauseSimulation) {
                     physicsWorld->Update(deltaTime);
 
-                    for (auto entity : rigidBodySubset) {
-                        const auto& [rigidBodyComponent, transformComponent] = rigidBodySubset.Get(entity);
+                    std::mutex changedEntitiesMutex;
 
-                        if (!rigidBodyComponent.IsValid() || transformComponent.isStatic ||
-                            rigidBodyComponent.layer == Physics::Layers::Static)
-                            continue;
+                    // Reading back the bodies is thread safe, so the matrix computations can be done in parallel
+                    ParallelForChunks(rigidBodySubset.GetCandidateCount(), componentChunkSize, [&](int32_t begin, int32_t end) {
+                        std::vector<ECS::Entity> chunkChangedEntities;
+                        for (int32_t i = begin; i < end; i++) {
+                            ECS::Entity entity;
+                            if (!rigidBodySubset.TryGetEntity(size_t(i), entity))
+                                continue;
 
-                        // This happens if no change was triggered by the user, then we still need
-                        // to update the last global matrix, since it might have changed due to physics simulation
-                        if (!transformComponent.changed)
-                            transformComponent.lastGlobalMatrix = transformComponent.globalMatrix;
+                            const auto& [rigidBodyComponent, transformComponent] = rigidBodySubset.Get(entity);
 
-                        // Need to set changed to true such that the space partitioning is updated
-                        transformComponent.changed = true;
-                        transformComponent.updated = true;
+                            if (!rigidBodyComponent.IsValid() || transformComponent.isStatic ||
+                                rigidBodyComponent.layer == Physics::Layers::Static)
+                                continue;
 
-                        // Physics are updated in global space, so we don't need the parent transform
-                        transformComponent.globalMatrix = rigidBodyComponent.GetMatrix();
-                        transformComponent.inverseGlobalMatrix = glm::inverse(transformComponent.globalMatrix);
-                    }
+                            // Sleeping bodies didn't move
+                            if (!rigidBodyComponent.IsActive())
+                                continue;
+
+                            // This happens if no change was triggered by the user, then we still need
+                            // to update the last global matrix, since it might have changed due to physics simulation
+                            if (!transformComponent.changed)
+                                transformComponent.lastGlobalMatrix = transformComponent.globalMatrix;
+
+                            // Need to set changed to true such that the space partitioning is updated
+                            if (!transformComponent.changed)
+                                chunkChangedEntities.push_back(entity);
+                            transformComponent.changed = true;
+                            transformComponent.updated = true;
+
+                            // Physics are updated in global space, so we don't need the parent transform
+                            transformComponent.globalMatrix = rigidBodyComponent.GetMatrix();
+                            transformComponent.inverseGlobalMatrix = glm::inverse(transformComponent.globalMatrix);
+                        }
+
+                        if (chunkChangedEntities.empty())
+                            return;
+
+                        std::scoped_lock lock(changedEntitiesMutex);
+                        changedTransformEntities.insert(changedTransformEntities.end(),
+                            chunkChangedEntities.begin(), chunkChangedEntities.end());
+                        });
 
                     // Player update needs to be performed after normal rigid bodies, such that
                     // player can override rigid body behaviour
@@ -230,6 +280,8 @@ namespace Atlas {
                             transformComponent.lastGlobalMatrix = transformComponent.globalMatrix;
 
                         // Need to set changed to true such that the space partitioning is updated
+                        if (!transformComponent.changed)
+                            changedTransformEntities.push_back(entity);
                         transformComponent.changed = true;
                         transformComponent.updated = true;
 
@@ -238,92 +290,259 @@ namespace Atlas {
                         transformComponent.inverseGlobalMatrix = glm::inverse(transformComponent.globalMatrix);
                     }
                 }
-            }
+                }, { transformTask });
+
+            // Filled by the space partitioning, the ray tracing world only needs to update these
+            std::vector<ECS::Entity> changedMeshEntities;
+            auto spacePartitioningTask = timestepGraph.AddTask("Space partitioning", [&](JobGroup&) {
+                // Do the space partitioning update here (ofc also update AABBs)
+                // Only meshes with a changed transform and new meshes, which couldn't be inserted yet, need an update
+                std::vector<ECS::Entity> meshEntities = changedTransformEntities;
+                meshEntities.insert(meshEntities.end(), pendingMeshEntities.begin(), pendingMeshEntities.end());
+                std::sort(meshEntities.begin(), meshEntities.end());
+                meshEntities.erase(std::unique(meshEntities.begin(), meshEntities.end()), meshEntities.end());
+                pendingMeshEntities.clear();
+
+                // The bounding boxes are computed in parallel, while the space partitioning is updated in batches afterwards.
+                // Entities are grouped by their partition, moved entities are updated in place.
+                constexpr size_t partitionCount = 3;
+                std::vector<ECS::Entity> insertedEntities[partitionCount], updatedEntities[partitionCount];
+                std::vector<Volume::AABB> insertedAABBs[partitionCount], lastAABBs[partitionCount], updatedAABBs[partitionCount];
+                std::mutex spacePartitioningMutex;
+
+                ParallelForChunks(meshEntities.size(), componentChunkSize, [&](int32_t begin, int32_t end) {
+                    std::vector<ECS::Entity> chunkInsertedEntities[partitionCount], chunkUpdatedEntities[partitionCount];
+                    std::vector<Volume::AABB> chunkInsertedAABBs[partitionCount], chunkLastAABBs[partitionCount];
+                    std::vector<Volume::AABB> chunkUpdatedAABBs[partitionCount];
+                    std::vector<ECS::Entity> chunkPendingEntities;
+                    bool chunkChanged = false;
+
+                    for (int32_t i = begin; i < end; i++) {
+                        auto entity = meshEntities[i];
+
+                        auto meshComponent = entityManager.TryGet<MeshComponent>(entity);
+                        auto transformComponent = entityManager.TryGet<TransformComponent>(entity);
+                        if (!meshComponent || !transformComponent)
+                            continue;
 
-            // Do the space partitioning update here (ofc also update AABBs)
-            auto meshSubset = entityManager.GetSubset<MeshComponent, TransformComponent>();
-            for (auto entity : meshSubset) {
-                auto& meshComponent = entityManager.Get<MeshComponent>(entity);
-                auto& transformComponent = entityManager.Get<TransformComponent>(entity);
-                if (!meshComponent.mesh.IsLoaded()) {
-                    // We can't update the transform yet
-                    transformComponent.updated = false;
-                    continue;
-                }
+                        if (!meshComponent->mesh.IsLoaded()) {
+                            // We can't update the bounding box yet, try again in the next timestep
+                            chunkPendingEntities.push_back(entity);
+                            continue;
+                        }
 
-                if (!transformComponent.changed && meshComponent.inserted)
-                    continue;
+                        if (!transformComponent->changed && meshComponent->inserted)
+                            continue;
 
-                if (meshComponent.inserted)
-                    SpacePartitioning::RemoveRenderableEntity(ToSceneEntity(entity), meshComponent);
+                        auto lastAABB = meshComponent->aabb;
+                        meshComponent->aabb = meshComponent->mesh->data.aabb.Transform(transformComponent->globalMatrix);
 
-                meshComponent.aabb = meshComponent.mesh->data.aabb.Transform(transformComponent.globalMatrix);
+                        auto partition = meshComponent->dontCull ? RenderablePartition::Uncullable :
+                            transformComponent->isStatic ? RenderablePartition::Static : RenderablePartition::Movable;
+                        auto partitionIdx = size_t(partition);
 
-                SpacePartitioning::InsertRenderableEntity(ToSceneEntity(entity), meshComponent);
-                meshComponent.inserted = true;
-            }
+                        if (meshComponent->inserted) {
+                            chunkUpdatedEntities[partitionIdx].push_back(entity);
+                            chunkLastAABBs[partitionIdx].push_back(lastAABB);
+                            chunkUpdatedAABBs[partitionIdx].push_back(meshComponent->aabb);
+                        }
+                        else {
+                            chunkInsertedEntities[partitionIdx].push_back(entity);
+                            chunkInsertedAABBs[partitionIdx].push_back(meshComponent->aabb);
+                        }
+
+                        meshComponent->inserted = true;
+                        chunkChanged = true;
+                    }
 
-            // After everything we need to reset transform component changed and prepare the updated for next frame
-            for (auto entity : transformSubset) {
-                auto& transformComponent = entityManager.Get<TransformComponent>(entity);
+                    if (!chunkChanged && chunkPendingEntities.empty())
+                        return;
 
-                if (transformComponent.updated) {
-                    transformComponent.changed = false;
-                    transformComponent.updated = false;
+                    std::scoped_lock lock(spacePartitioningMutex);
+                    for (size_t j = 0; j < partitionCount; j++) {
+                        insertedEntities[j].insert(insertedEntities[j].end(), chunkInsertedEntities[j].begin(), chunkInsertedEntities[j].end());
+                        insertedAABBs[j].insert(insertedAABBs[j].end(), chunkInsertedAABBs[j].begin(), chunkInsertedAABBs[j].end());
+                        updatedEntities[j].insert(updatedEntities[j].end(), chunkUpdatedEntities[j].begin(), chunkUpdatedEntities[j].end());
+                        lastAABBs[j].insert(lastAABBs[j].end(), chunkLastAABBs[j].begin(), chunkLastAABBs[j].end());
+                        updatedAABBs[j].insert(updatedAABBs[j].end(), chunkUpdatedAABBs[j].begin(), chunkUpdatedAABBs[j].end());
+                    }
+                    pendingMeshEntities.insert(pendingMeshEntities.end(), chunkPendingEntities.begin(), chunkPendingEntities.end());
+                    });
+
+                // All meshes with new bounds, regardless of their partition
+                for (size_t i = 0; i < partitionCount; i++) {
+                    auto partition = RenderablePartition(i);
+                    SpacePartitioning::UpdateRenderableEntities(updatedEntities[i], lastAABBs[i], updatedAABBs[i], partition);
+                    SpacePartitioning::InsertRenderableEntities(insertedEntities[i], insertedAABBs[i], partition);
+
+                    changedMeshEntities.insert(changedMeshEntities.end(), insertedEntities[i].begin(), insertedEntities[i].end());
+                    changedMeshEntities.insert(changedMeshEntities.end(), updatedEntities[i].begin(), updatedEntities[i].end());
                 }
-            }
+                }, { physicsTask });
 
-            auto lightSubset = entityManager.GetSubset<LightComponent>();
-            for (auto entity : lightSubset) {
-                auto& lightComponent = lightSubset.Get(entity);
+            timestepGraph.AddTask("Transform reset", [&](JobGroup&) {
+                // After everything we need to reset transform component changed and prepare the updated for next frame.
+                // The changed entities are kept, such that their last global matrix can be updated in the next timestep.
+                ParallelForChunks(changedTransformEntities.size(), componentChunkSize, [&](int32_t begin, int32_t end) {
+                    for (int32_t i = begin; i < end; i++) {
+                        auto& transformComponent = entityManager.Get<TransformComponent>(changedTransformEntities[i]);
 
-                auto transformComponent = entityManager.TryGet<TransformComponent>(entity);
+                        transformComponent.changed = false;
+                        transformComponent.updated = false;
+                    }
+                    });
+                }, { spacePartitioningTask });
+
+            timestepGraph.AddTask("Lights", [&](JobGroup&) {
+                ParallelForChunks(lightSubset.GetCandidateCount(), componentChunkSize, [&](int32_t begin, int32_t end) {
+                    for (int32_t i = begin; i < end; i++) {
+                        ECS::Entity entity;
+                        if (!lightSubset.TryGetEntity(size_t(i), entity))
+                            continue;
 
-                lightComponent.Update(transformComponent);
-            }
+                        auto& lightComponent = lightSubset.Get(entity);
+
+                        auto transformComponent = entityManager.TryGet<TransformComponent>(entity);
+
+                        lightComponent.Update(transformComponent);
+                    }
+                    });
+                }, { physicsTask });
 
 #ifdef AE_BINDLESS
             auto rayTracingSubset = GetSubset<MeshComponent, TransformComponent>();
-            JobSystem::Execute(rayTracingWorldUpdateJob, [this, rayTracingSubset](JobData&) {
-                // Need to wait before updating graphic resources
-                Graphics::GraphicsDevice::DefaultDevice->WaitForPreviousFrameSubmission();
-                if (rayTracingWorld) {
-                    rayTracingWorld->scene = this;
-                    // Don't update triangle lights for now (second argument)
-                    rayTracingWorld->Update(rayTracingSubset, false);
-                }
-                rtDataValid = rayTracingWorld != nullptr && rayTracingWorld->IsValid();
-                });          
+            timestepGraph.AddTask("Ray tracing world", [&](JobGroup&) {
+                // Only meshes with new bounds and removed meshes need to be updated in the acceleration structure
+                std::vector<ECS::Entity> rayTracingRemovedEntities;
+                rayTracingRemovedEntities.swap(removedMeshEntities);
+                // The update needs the bindless maps, launch it when they are ready instead of waiting in the job
+                JobSystem::ExecuteAfter({ &bindlessMeshMapUpdateJob, &bindlessTextureMapUpdateJob },
+                    rayTracingWorldUpdateJob, [this, rayTracingSubset, rayTracingUpdatedEntities = std::move(changedMeshEntities),
+                        rayTracingRemovedEntities](JobData&) {
+                    if (rayTracingWorld) {
+                        // Need to wait before updating graphic resources
+                        Graphics::GraphicsDevice::DefaultDevice->WaitForPreviousFrameSubmission();
+                        rayTracingWorld->scene = this;
+                        // Don't update triangle lights for now (last argument)
+                        rayTracingWorld->Update(rayTracingSubset, rayTracingUpdatedEntities,
+                            rayTracingRemovedEntities, false);
+                    }
+                    rtDataValid = rayTracingWorld != nullptr && rayTracingWorld->IsValid();
+                    });
+                }, { spacePartitioningTask });
+#else
+            removedMeshEntities.clear();
 #endif
 
-            // We also need to reset the hierarchy components as well
-            auto hierarchySubset = entityManager.GetSubset<HierarchyComponent>();
-            for (auto entity : hierarchySubset) {
-                auto& hierarchyComponent = hierarchySubset.Get(entity);
-
-                hierarchyComponent.updated = false;
-            }
+            timestepGraph.AddTask("Cameras and texts", [&](JobGroup&) {
+                // Everything below assumes that entities themselves have a transform
+                // Without it they won't be transformed when they are in a hierarchy
+                for (auto entity : cameraSubset) {
+                    const auto& [cameraComponent, transformComponent] = cameraSubset.Get(entity);
 
-            // Everything below assumes that entities themselves have a transform
-            // Without it they won't be transformed when they are in a hierarchy
-            auto cameraSubset = entityManager.GetSubset<CameraComponent, TransformComponent>();
-            for (auto entity : cameraSubset) {
-                const auto& [cameraComponent, transformComponent] = cameraSubset.Get(entity);
+                    cameraComponent.parentTransform = transformComponent.globalMatrix;
+                }
 
-                cameraComponent.parentTransform = transformComponent.globalMatrix;
-            }
+                for (auto entity : textSubset) {
+                    const auto& [textComponent, transformComponent] = textSubset.Get(entity);
 
-            auto textSubset = entityManager.GetSubset<TextComponent, TransformComponent>();
-            for (auto entity : textSubset) {
-                const auto& [textComponent, transformComponent] = textSubset.Get(entity);
+                    textComponent.Update(transformComponent);
+                }
+                }, { physicsTask });
 
-                textComponent.Update(transformComponent);
-            }
+            timestepGraph.Execute();
+            timestepGraph.Wait();
 
             firstTimestep = false;
 
         }
 
+        void Scene::UpdateChangedTransforms(const TransformComponent& rootTransform) {
+
+            // The closest parent with a transform, hierarchies without a transform just pass it through
+            auto getParentTransform = [&](ECS::Entity entity) -> const TransformComponent* {
+                for (auto iter = childToParentMap.find(entity); iter != childToParentMap.end();
+                    iter = childToParentMap.find(iter->second)) {
+                    auto transformComponent = entityManager.TryGet<TransformComponent>(iter->second);
+                    if (transformComponent)
+                        return transformComponent;
+                }
+                return &rootTransform;
+            };
+
+            // Changed transforms with a changed ancestor are updated together with the hierarchy of the ancestor
+            std::vector<uint8_t> isChangeRoot(changedTransformEntities.size());
+            ParallelForChunks(changedTransformEntities.size(), componentChunkSize, [&](int32_t begin, int32_t end) {
+                for (int32_t i = begin; i < end; i++) {
+                    bool hasChangedAncestor = false;
+                    for (auto iter = childToParentMap.find(changedTransformEntities[i]);
+                        iter != childToParentMap.end() && !hasChangedAncestor; iter = childToParentMap.find(iter->second)) {
+                        auto transformComponent = entityManager.TryGet<TransformComponent>(iter->second);
+                        hasChangedAncestor = transformComponent && transformComponent->changed;
+                    }
+                    isChangeRoot[i] = hasChangedAncestor ? 0 : 1;
+                }
+                });
+
+            std::vector<HierarchyComponent::PendingUpdate> hierarchyUpdates;
+            std::mutex hierarchyUpdatesMutex;
+
+            // The parents of the change roots didn't change, which means they can all be updated in parallel
+            ParallelForChunks(changedTransformEntities.size(), componentChunkSize, [&](int32_t begin, int32_t end) {
+                std::vector<HierarchyComponent::PendingUpdate> chunkHierarchyUpdates;
+                for (int32_t i = begin; i < end; i++) {
+                    if (!isChangeRoot[i])
+                        continue;
+
+                    auto entity = changedTransformEntities[i];
+                    auto& transformComponent = entityManager.Get<TransformComponent>(entity);
+                    transformComponent.Update(*getParentTransform(entity), false);
+
+                    auto hierarchyComponent = entityManager.TryGet<HierarchyComponent>(entity);
+                    if (hierarchyComponent)
+                        chunkHierarchyUpdates.push_back({ hierarchyComponent, &transformComponent, true });
+                }
+
+                if (chunkHierarchyUpdates.empty())
+                    return;
+
+                std::scoped_lock lock(hierarchyUpdatesMutex);
+                hierarchyUpdates.insert(hierarchyUpdates.end(), chunkHierarchyUpdates.begin(), chunkHierarchyUpdates.end());
+                });
+
+            UpdateHierarchies(hierarchyUpdates);
+
+        }
+
+        void Scene::UpdateHierarchies(std::vector<HierarchyComponent::PendingUpdate>& hierarchyUpdates) {
+
+            std::vector<HierarchyComponent::PendingUpdate> nextLevelUpdates;
+            std::mutex nextLevelMutex;
+
+            // All hierarchies of a level are independent of each other, each level depends on the previous one
+            while (!hierarchyUpdates.empty()) {
+                ParallelForChunks(hierarchyUpdates.size(), hierarchyChunkSize, [&](int32_t begin, int32_t end) {
+                    std::vector<HierarchyComponent::PendingUpdate> childUpdates;
+                    std::vector<ECS::Entity> changedEntities;
+                    for (int32_t i = begin; i < end; i++) {
+                        const auto& update = hierarchyUpdates[i];
+                        update.hierarchy->Update(*update.transform, update.parentChanged, childUpdates, changedEntities);
+                    }
+
+                    if (childUpdates.empty() && changedEntities.empty())
+                        return;
+
+                    std::scoped_lock lock(nextLevelMutex);
+                    nextLevelUpdates.insert(nextLevelUpdates.end(), childUpdates.begin(), childUpdates.end());
+                    changedTransformEntities.insert(changedTransformEntities.end(), changedEntities.begin(), changedEntities.end());
+                    });
+
+                hierarchyUpdates.clear();
+                std::swap(hierarchyUpdates, nextLevelUpdates);
+            }
+
+        }
+
         void Scene::Update() {
 
             mainCameraEntity = Entity();
@@ -354,20 +573,8 @@ namespace Atlas {
 
             auto& mainCamera = mainCameraEntity.GetComponent<CameraComponent>();
 
-            auto audioSubset = entityManager.GetSubset<AudioComponent, TransformComponent>();
-            for (auto entity : audioSubset) {
-                const auto& [audioComponent, transformComponent] = audioSubset.Get(entity);
-
-                audioComponent.Update(deltaTime, transformComponent, mainCamera.GetLocation(),
-                    mainCamera.GetLastLocation(), mainCamera.right);
-            }
-
-            auto audioVolumeSubset = entityManager.GetSubset<AudioVolumeComponent, TransformComponent>();
-            for (auto entity : audioVolumeSubset) {
-                const auto& [audioComponent, transformComponent] = audioVolumeSubset.Get(entity);
-
-                audioComponent.Update(transformComponent, mainCamera.GetLocation());
-            }
+            auto paused = physicsWorld && physicsWorld->pauseSimulation;
+            spatialAudio.Update(entityManager, mainCamera, deltaTime, paused);
 
             auto lightSubset = entityManager.GetSubset<LightComponent>();
             for (auto entity : lightSubset) {
@@ -483,6 +690,24 @@ namespace Atlas {
                         if (result.valid && entityManager.Contains<RigidBodyComponent>(entity))
                             continue;
 
+                        // Meshes with a BVH are tested against their triangles in object space. The direction
+                        // isn't normalized after the transformation, such that the hit distance stays the same.
+                        auto transformComp = entityManager.TryGet<TransformComponent>(entity);
+                        if (transformComp && meshComp.mesh.IsLoaded() && !meshComp.mesh->data.cpuBvh.nodes.empty()) {
+                            const auto& inverseMatrix = transformComp->inverseGlobalMatrix;
+                            Volume::Ray localRay(vec3(inverseMatrix * vec4(ray.origin, 1.0f)),
+                                vec3(inverseMatrix * vec4(ray.direction, 0.0f)), ray.tMin, result.hitDistance);
+
+                            Volume::RayResult<uint32_t> triangleResult;
+                            if (meshComp.mesh->data.cpuBvh.GetIntersection(localRay, triangleResult)) {
+                                result.valid = true;
+                                result.data = { entity, &entityManager };
+                                result.hitDistance = triangleResult.hitDistance;
+                                result.normal = glm::normalize(glm::transpose(mat3(inverseMatrix)) * triangleResult.normal);
+                            }
+                            continue;
+                        }
+
                         // Accept all hits greater equal if they were within the updated hit distance
                         if (dist > 0.0f) {
                             result.valid = true;
@@ -528,23 +753,7 @@ namespace Atlas {
 
             auto cameraPos = mainCameraEntity.GetComponent<CameraComponent>().GetLocation();
 
-            // This is much quicker presumably due to cache coherency (need better hierarchical data structure)
-            auto subset = entityManager.GetSubset<MeshComponent, TransformComponent>();
-            for (auto& entity : subset) {
-                auto& comp = subset.Get<MeshComponent>(entity);
-
-                if (!comp.mesh.IsLoaded())
-                    continue;
-
-                auto diff = comp.aabb.GetCenter() - cameraPos;
-
-                float dist2 = glm::dot(diff, diff);
-                float cullingDist = pass->type == RenderList::RenderPassType::Main ? comp.mesh->distanceCulling : comp.mesh->shadowDistanceCulling;
-                float cullingDist2 = cullingDist * cullingDist;
-
-                if (comp.dontCull || comp.visible && dist2 < cullingDist2 && frustum.Intersects(comp.aabb))
-                    pass->Add(entity, comp);
-            }
+            SpacePartitioning::GetRenderList(frustum, pass, cameraPos);
 
         }
 
@@ -598,6 +807,7 @@ namespace Atlas {
 
             ClearRTStructures();
             entityManager.Clear();
+            SpacePartitioning::ClearRenderableEntities();
 
             CleanupUnusedResources();
 
@@ -707,15 +917,25 @@ namespace Atlas {
 
         void Scene::RegisterSubscribers() {
 
+            // New transforms always need an update, the same goes for the bounding boxes of new meshes
+            entityManager.SubscribeToTopic<TransformComponent>(ECS::Topic::ComponentEmplace,
+                [this](const ECS::Entity entity, TransformComponent& transformComponent) {
+                    transformComponent.changed = true;
+                    transformComponent.updated = false;
+                    entityManager.MarkChanged<TransformComponent>(entity);
+                });
+
             // Each resource type needs to count references
             entityManager.SubscribeToTopic<MeshComponent>(ECS::Topic::ComponentEmplace,
                 [this](const ECS::Entity entity, const MeshComponent& meshComponent) {
                     RegisterResource(registeredMeshes, meshComponent.mesh);
+                    pendingMeshEntities.push_back(entity);
                 });
 
             entityManager.SubscribeToTopic<MeshComponent>(ECS::Topic::ComponentErase,
                 [this](const ECS::Entity entity, const MeshComponent& meshComponent) {
                     UnregisterResource(registeredMeshes, meshComponent.mesh);
+                    removedMeshEntities.push_back(entity);
 
                     if (meshComponent.inserted) {
                         SpacePartitioning::RemoveRenderableEntity(ToSceneEntity(entity), meshComponent);
@@ -24,6 +24,7 @@
 #include "SpacePartitioning.h"
 #include "Subset.h"
 #include "Wind.h"
+#include "SpatialAudio.h"
 
 #include "components/Components.h"
 #include "prefabs/Prefabs.h"
@@ -133,6 +134,7 @@ namespace Atlas {
             Ref<RayTracing::RayTracingWorld> rayTracingWorld = nullptr;            
 
             Wind wind;
+            SpatialAudio spatialAudio;
             Lighting::Sky sky;
             Ref<Lighting::Fog> fog = nullptr;
             Ref<Lighting::IrradianceVolume> irradianceVolume = nullptr;
@@ -149,6 +151,10 @@ namespace Atlas {
         private:
             void UpdateBindlessIndexMaps();
 
+            void UpdateChangedTransforms(const TransformComponent& rootTransform);
+
+            void UpdateHierarchies(std::vector<HierarchyComponent::PendingUpdate>& hierarchyUpdates);
+
             Entity ToSceneEntity(ECS::Entity entity);
 
             void RegisterSubscribers();
@@ -169,6 +175,13 @@ namespace Atlas {
             ECS::EntityManager entityManager = ECS::EntityManager(this);
 
             std::unordered_map<ECS::Entity, ECS::Entity> childToParentMap;
+
+            // Entities of all transforms which changed in the last timestep
+            std::vector<ECS::Entity> changedTransformEntities;
+            // Meshes which weren't inserted into the space partitioning yet
+            std::vector<ECS::Entity> pendingMeshEntities;
+            // Meshes which were removed since the last timestep, needed to keep the ray tracing world up to date
+            std::vector<ECS::Entity> removedMeshEntities;
             std::map<Hash, RegisteredResource<Mesh::Mesh>> registeredMeshes;
             std::map<Hash, RegisteredResource<Audio::AudioData>> registeredAudios;
 
@@ -190,6 +203,7 @@ namespace Atlas {
             friend SpacePartitioning;
             friend RayTracing::RayTracingWorld;
             friend HierarchyComponent;
+            friend TransformComponent;
             friend MeshComponent;
             friend AudioVolumeComponent;
             friend AudioComponent;
@@ -8,84 +8,168 @@ namespace Atlas {
 	namespace Scene {
 
 		SpacePartitioning::SpacePartitioning(Scene* scene, vec3 min, vec3 max, int32_t depth) :
-            scene(scene), aabb(min, max), depth(depth) {
+			scene(scene), aabb(min, max), depth(depth) {
 
-			renderableStaticEntityOctree = Volume::Octree<ECS::Entity>(aabb, depth);
-			renderableMovableEntityOctree = Volume::Octree<ECS::Entity>(aabb, depth);
+			// The cells of the grids correspond to the leaves of an octree with the given depth. Unlike the octree,
+			// the grids store an index for every cell, so their resolution is limited independently of the depth.
+			auto resolution = 1 << glm::clamp(depth, 0, maxGridResolutionLog2);
+
+			renderableStaticEntityGrid = Volume::LooseGrid<ECS::Entity>(aabb, resolution);
+			renderableMovableEntityGrid = Volume::LooseGrid<ECS::Entity>(aabb, resolution);
 
 		}
 
 		void SpacePartitioning::InsertRenderableEntity(Entity entity, const MeshComponent& transform) {
 
-			if (false) {
-				renderableStaticEntityOctree.Insert(entity, transform.aabb);
-			}
-			else {
-				renderableMovableEntityOctree.Insert(entity, transform.aabb);
-			}
+			InsertRenderableEntityInternal(entity, transform.aabb, GetRenderablePartition(entity, transform));
 
 		}
 
 		void SpacePartitioning::RemoveRenderableEntity(Entity entity, const MeshComponent& transform) {
 
-			if (false) {
-				renderableStaticEntityOctree.Remove(entity, transform.aabb);
+			RemoveRenderableEntityInternal(entity, transform.aabb);
+
+			renderableStaticEntityGrid.Refit();
+			renderableMovableEntityGrid.Refit();
+
+		}
+
+		void SpacePartitioning::InsertRenderableEntities(const std::vector<ECS::Entity>& entities,
+			const std::vector<Volume::AABB>& aabbs, RenderablePartition partition) {
+
+			for (size_t i = 0; i < entities.size(); i++)
+				InsertRenderableEntityInternal(entities[i], aabbs[i], partition);
+
+		}
+
+		void SpacePartitioning::RemoveRenderableEntities(const std::vector<ECS::Entity>& entities,
+			const std::vector<Volume::AABB>& aabbs) {
+
+			if (entities.empty())
+				return;
+
+			for (size_t i = 0; i < entities.size(); i++)
+				RemoveRenderableEntityInternal(entities[i], aabbs[i]);
+
+			renderableStaticEntityGrid.Refit();
+			renderableMovableEntityGrid.Refit();
+
+		}
+
+		void SpacePartitioning::UpdateRenderableEntities(const std::vector<ECS::Entity>& entities,
+			const std::vector<Volume::AABB>& lastAABBs, const std::vector<Volume::AABB>& aabbs,
+			RenderablePartition partition) {
+
+			if (entities.empty())
+				return;
+
+			for (size_t i = 0; i < entities.size(); i++) {
+				auto entity = entities[i];
+
+				if (partition == RenderablePartition::Uncullable) {
+					if (std::find(uncullableEntities.begin(), uncullableEntities.end(), entity) != uncullableEntities.end())
+						continue;
+				}
+				else {
+					auto& grid = partition == RenderablePartition::Static ?
+						renderableStaticEntityGrid : renderableMovableEntityGrid;
+					if (grid.Update(entity, lastAABBs[i], aabbs[i]))
+						continue;
+				}
+
+				// The entity changed its partition
+				RemoveRenderableEntityInternal(entity, lastAABBs[i]);
+				InsertRenderableEntityInternal(entity, aabbs[i], partition);
 			}
-			else {
-				renderableMovableEntityOctree.Remove(entity, transform.aabb);
+
+			renderableStaticEntityGrid.Refit();
+			renderableMovableEntityGrid.Refit();
+
+		}
+
+		void SpacePartitioning::ClearRenderableEntities() {
+
+			renderableStaticEntityGrid.Clear();
+			renderableMovableEntityGrid.Clear();
+			uncullableEntities.clear();
+
+		}
+
+		void SpacePartitioning::GetRenderList(const Volume::Frustum& frustum, const Ref<RenderList::Pass>& pass,
+			vec3 cameraLocation) {
+
+			auto& entityManager = scene->entityManager;
+
+			std::vector<ECS::Entity> entities;
+			renderableStaticEntityGrid.QueryFrustum(entities, frustum);
+			renderableMovableEntityGrid.QueryFrustum(entities, frustum);
+
+			for (auto entity : entities) {
+				auto meshComp = entityManager.TryGet<MeshComponent>(entity);
+				if (!meshComp || !meshComp->mesh.IsLoaded())
+					continue;
+
+				auto diff = meshComp->aabb.GetCenter() - cameraLocation;
+
+				float dist2 = glm::dot(diff, diff);
+				float cullingDist = pass->type == RenderList::RenderPassType::Main ?
+					meshComp->mesh->distanceCulling : meshComp->mesh->shadowDistanceCulling;
+				float cullingDist2 = cullingDist * cullingDist;
+
+				if (meshComp->dontCull || meshComp->visible && dist2 < cullingDist2)
+					pass->Add(entity, *meshComp);
+			}
+
+			for (auto entity : uncullableEntities) {
+				auto meshComp = entityManager.TryGet<MeshComponent>(entity);
+				if (!meshComp)
+					continue;
+
+				pass->Add(entity, *meshComp);
 			}
 
 		}
 
-        void SpacePartitioning::GetRenderList(Volume::Frustum frustum, RenderList& renderList) {
+		SpacePartitioning::RenderablePartition SpacePartitioning::GetRenderablePartition(Entity entity,
+			const MeshComponent& meshComponent) {
 
-            /*
-            auto entityManager = &scene->entityManager;
+			if (meshComponent.dontCull)
+				return RenderablePartition::Uncullable;
 
-            std::vector<ECS::Entity> staticEntities;
-            std::vector<ECS::Entity> insideStaticEntities;
-            std::vector<ECS::Entity> movableEntities;
-            std::vector<ECS::Entity> insideMovableEntities;
+			auto transformComponent = entity.TryGetComponent<TransformComponent>();
+			if (transformComponent && transformComponent->IsStatic())
+				return RenderablePartition::Static;
 
-            renderableStaticEntityOctree.QueryFrustum(staticEntities,
-                insideStaticEntities, frustum);
-            renderableMovableEntityOctree.QueryFrustum(movableEntities,
-                insideMovableEntities, frustum);
+			return RenderablePartition::Movable;
 
-            for (auto entity : staticEntities) {
-                auto meshComp = entityManager->TryGet<MeshComponent>(entity);
-                if (!meshComp) continue;
+		}
 
-                if (meshComp->dontCull || meshComp->visible && frustum.Intersects(meshComp->aabb))
-                    renderList.Add(entity, *meshComp);
-            }
+		void SpacePartitioning::InsertRenderableEntityInternal(ECS::Entity entity, const Volume::AABB& aabb,
+			RenderablePartition partition) {
 
-            for (auto entity : insideStaticEntities) {
-                auto meshComp = entityManager->TryGet<MeshComponent>(entity);
-                if (!meshComp) continue;
+			switch (partition) {
+			case RenderablePartition::Static: renderableStaticEntityGrid.Insert(entity, aabb); break;
+			case RenderablePartition::Movable: renderableMovableEntityGrid.Insert(entity, aabb); break;
+			case RenderablePartition::Uncullable: uncullableEntities.push_back(entity); break;
+			}
+
+		}
 
-                if (meshComp->visible)
-                    renderList.Add(entity, *meshComp);
-            }
+		bool SpacePartitioning::RemoveRenderableEntityInternal(ECS::Entity entity, const Volume::AABB& aabb) {
 
-            for (auto entity : movableEntities) {
-                auto meshComp = entityManager->TryGet<MeshComponent>(entity);
-                if (!meshComp) continue;
+			if (renderableMovableEntityGrid.Remove(entity, aabb) || renderableStaticEntityGrid.Remove(entity, aabb))
+				return true;
 
-                if (meshComp->dontCull || meshComp->visible && frustum.Intersects(meshComp->aabb))
-                    renderList.Add(entity, *meshComp);
-            }
+			auto iter = std::find(uncullableEntities.begin(), uncullableEntities.end(), entity);
+			if (iter == uncullableEntities.end())
+				return false;
 
-            for (auto entity : insideMovableEntities) {
-                auto meshComp = entityManager->TryGet<MeshComponent>(entity);
-                if (!meshComp) continue;
+			*iter = uncullableEntities.back();
+			uncullableEntities.pop_back();
 
-                if (meshComp->visible)
-                    renderList.Add(entity, *meshComp);
-            }
-            */
+			return true;
 
-        }
+		}
 
 	}
 
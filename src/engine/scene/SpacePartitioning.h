@@ -1,7 +1,7 @@
 #pragma once
 
 #include "../System.h"
-#include "../volume/Octree.h"
+#include "../volume/LooseGrid.h"
 #include "../renderer/helper/RenderList.h"
 
 #include "components/TransformComponent.h"
@@ -16,22 +16,81 @@ namespace Atlas {
 		class SpacePartitioning {
 
 		public:
+			/**
+			 * The partitions of renderable entities. Static entities are kept apart from movable ones,
+			 * such that moving entities never touch the cells of a mostly static world. Entities which
+			 * shouldn't be culled are kept in a plain list.
+			 */
+			enum class RenderablePartition {
+				Static = 0,
+				Movable,
+				Uncullable
+			};
+
 			SpacePartitioning(Scene* scene, vec3 min, vec3 max, int32_t depth);
 
 			void InsertRenderableEntity(Entity entity, const MeshComponent& transform);
 
 			void RemoveRenderableEntity(Entity entity, const MeshComponent& transform);
 
-			void GetRenderList(Volume::Frustum frustum, RenderList& renderList);
+			/**
+			 * Inserts many entities at once.
+			 * @param entities The entities to insert
+			 * @param aabbs The world space bounding boxes of the entities, index aligned with entities
+			 * @param partition The partition the entities are inserted into
+			 */
+			void InsertRenderableEntities(const std::vector<ECS::Entity>& entities, const std::vector<Volume::AABB>& aabbs,
+				RenderablePartition partition);
+
+			/**
+			 * Removes many entities at once.
+			 * @param entities The entities to remove
+			 * @param aabbs The bounding boxes the entities were inserted with, index aligned with entities
+			 */
+			void RemoveRenderableEntities(const std::vector<ECS::Entity>& entities, const std::vector<Volume::AABB>& aabbs);
+
+			/**
+			 * Updates the bounding boxes of many inserted entities at once. Entities which stay in their
+			 * cell are updated in place, entities which changed their partition are moved over.
+			 * @param entities The entities to update
+			 * @param lastAABBs The bounding boxes the entities were inserted with, index aligned with entities
+			 * @param aabbs The new bounding boxes of the entities, index aligned with entities
+			 * @param partition The partition the entities should be in
+			 */
+			void UpdateRenderableEntities(const std::vector<ECS::Entity>& entities, const std::vector<Volume::AABB>& lastAABBs,
+				const std::vector<Volume::AABB>& aabbs, RenderablePartition partition);
+
+			void ClearRenderableEntities();
+
+			/**
+			 * Adds all visible entities to a render pass.
+			 * @param frustum The frustum to cull against
+			 * @param pass The render pass the entities are added to
+			 * @param cameraLocation The location used for the distance culling of the meshes
+			 * @note This can be called concurrently for different passes.
+			 */
+			void GetRenderList(const Volume::Frustum& frustum, const Ref<RenderList::Pass>& pass, vec3 cameraLocation);
 
-            const Volume::AABB aabb;
-            const float depth;
+			const Volume::AABB aabb;
+			const float depth;
 
 		private:
+			RenderablePartition GetRenderablePartition(Entity entity, const MeshComponent& meshComponent);
+
+			void InsertRenderableEntityInternal(ECS::Entity entity, const Volume::AABB& aabb, RenderablePartition partition);
+
+			bool RemoveRenderableEntityInternal(ECS::Entity entity, const Volume::AABB& aabb);
+
+			// At most 64^3 cells per grid, which keeps the dense cell index table at 1 MB
+			static constexpr int32_t maxGridResolutionLog2 = 6;
+
 			Scene* scene;
 
-			Volume::Octree<ECS::Entity> renderableMovableEntityOctree;
-			Volume::Octree<ECS::Entity> renderableStaticEntityOctree;
+			// The cells of the grids are the leaves of an octree of the same depth, see the constructor
+			Volume::LooseGrid<ECS::Entity> renderableMovableEntityGrid;
+			Volume::LooseGrid<ECS::Entity> renderableStaticEntityGrid;
+
+			std::vector<ECS::Entity> uncullableEntities;
 
 		};
 
@@ -0,0 +1,262 @@
+#include "SpatialAudio.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Atlas {
+
+    namespace Scene {
+
+        using namespace Components;
+
+        static constexpr float epsilon = 0.00001f;
+
+        void SpatialAudio::Update(ECS::EntityManager& entityManager, const CameraComponent& listener,
+            float deltaTime, bool paused) {
+
+            Gather(entityManager, paused);
+            Cull(listener.GetLocation());
+            Attenuate();
+            Apply(listener, deltaTime);
+
+        }
+
+        int32_t SpatialAudio::GetEmitterCount() const {
+
+            return emitterCount;
+
+        }
+
+        int32_t SpatialAudio::GetAudibleCount() const {
+
+            return int32_t(audibleEmitters.size());
+
+        }
+
+        int32_t SpatialAudio::GetRealCount() const {
+
+            return realCount;
+
+        }
+
+        void SpatialAudio::Emitters::Resize(size_t count) {
+
+            for (auto array : { &minX, &minY, &minZ, &maxX, &maxY, &maxZ, &rangeSquared, &distanceSquared })
+                array->resize(count);
+
+            audioComponents.resize(count);
+            audioVolumeComponents.resize(count);
+            transforms.resize(count);
+            streams.resize(count);
+            isReal.resize(count);
+
+        }
+
+        void SpatialAudio::Gather(ECS::EntityManager& entityManager, bool paused) {
+
+            auto audioSubset = entityManager.GetSubset<AudioComponent, TransformComponent>();
+            auto audioVolumeSubset = entityManager.GetSubset<AudioVolumeComponent, TransformComponent>();
+
+            emitters.Resize(audioSubset.GetCandidateCount() + audioVolumeSubset.GetCandidateCount());
+
+            int32_t count = 0;
+            for (auto entity : audioSubset) {
+                const auto& [audioComponent, transformComponent] = audioSubset.Get(entity);
+
+                auto location = vec3(transformComponent.globalMatrix[3]);
+                auto muted = !audioComponent.stream || (paused && !audioComponent.permanentPlay);
+
+                emitters.minX[count] = emitters.maxX[count] = location.x;
+                emitters.minY[count] = emitters.maxY[count] = location.y;
+                emitters.minZ[count] = emitters.maxZ[count] = location.z;
+                // Muted emitters are never in range, but still get their volume reset
+                emitters.rangeSquared[count] = muted ? -1.0f : GetRangeSquared(audioComponent.falloffFactor,
+                    audioComponent.falloffPower, audioComponent.cutoff);
+
+                emitters.audioComponents[count] = &audioComponent;
+                emitters.audioVolumeComponents[count] = nullptr;
+                emitters.transforms[count] = &transformComponent;
+                emitters.streams[count] = audioComponent.stream.get();
+                emitters.isReal[count] = 0;
+                count++;
+            }
+
+            for (auto entity : audioVolumeSubset) {
+                const auto& [audioVolumeComponent, transformComponent] = audioVolumeSubset.Get(entity);
+
+                // The box is kept on the component, since it can be queried
+                auto& aabb = audioVolumeComponent.transformedAABB;
+                aabb = audioVolumeComponent.aabb.Transform(transformComponent.globalMatrix);
+                auto muted = !audioVolumeComponent.stream || (paused && !audioVolumeComponent.permanentPlay);
+
+                emitters.minX[count] = aabb.min.x;
+                emitters.minY[count] = aabb.min.y;
+                emitters.minZ[count] = aabb.min.z;
+                emitters.maxX[count] = aabb.max.x;
+                emitters.maxY[count] = aabb.max.y;
+                emitters.maxZ[count] = aabb.max.z;
+                emitters.rangeSquared[count] = muted ? -1.0f : GetRangeSquared(audioVolumeComponent.falloffFactor,
+                    audioVolumeComponent.falloffPower, audioVolumeComponent.cutoff);
+
+                emitters.audioComponents[count] = nullptr;
+                emitters.audioVolumeComponents[count] = &audioVolumeComponent;
+                emitters.transforms[count] = &transformComponent;
+                emitters.streams[count] = audioVolumeComponent.stream.get();
+                emitters.isReal[count] = 0;
+                count++;
+            }
+
+            emitterCount = count;
+
+        }
+
+        void SpatialAudio::Cull(vec3 listenerLocation) {
+
+            const auto minX = emitters.minX.data(), minY = emitters.minY.data(), minZ = emitters.minZ.data();
+            const auto maxX = emitters.maxX.data(), maxY = emitters.maxY.data(), maxZ = emitters.maxZ.data();
+            auto distanceSquared = emitters.distanceSquared.data();
+
+            // Branch free distance of the listener to each box, which the compiler can vectorize
+            for (int32_t i = 0; i < emitterCount; i++) {
+                auto x = std::max(std::max(minX[i] - listenerLocation.x, listenerLocation.x - maxX[i]), 0.0f);
+                auto y = std::max(std::max(minY[i] - listenerLocation.y, listenerLocation.y - maxY[i]), 0.0f);
+                auto z = std::max(std::max(minZ[i] - listenerLocation.z, listenerLocation.z - maxZ[i]), 0.0f);
+                distanceSquared[i] = x * x + y * y + z * z;
+            }
+
+            audibleEmitters.clear();
+            const auto rangeSquared = emitters.rangeSquared.data();
+            for (int32_t i = 0; i < emitterCount; i++) {
+                if (distanceSquared[i] < rangeSquared[i])
+                    audibleEmitters.push_back(i);
+            }
+
+        }
+
+        void SpatialAudio::Attenuate() {
+
+            candidates.resize(audibleEmitters.size());
+
+            for (size_t i = 0; i < audibleEmitters.size(); i++) {
+                auto emitterIdx = audibleEmitters[i];
+
+                auto audioComponent = emitters.audioComponents[emitterIdx];
+                auto audioVolumeComponent = emitters.audioVolumeComponents[emitterIdx];
+
+                auto distance = std::max(epsilon, std::sqrt(emitters.distanceSquared[emitterIdx]));
+                auto distanceVolume = audioComponent ?
+                    GetDistanceVolume(distance, audioComponent->falloffFactor, audioComponent->falloffPower) :
+                    GetDistanceVolume(distance, audioVolumeComponent->falloffFactor, audioVolumeComponent->falloffPower);
+                auto volume = audioComponent ? audioComponent->volume : audioVolumeComponent->volume;
+
+                // Same measure the mixer uses to pick its real voices
+                auto loudness = distanceVolume * volume * emitters.streams[emitterIdx]->GetPriority();
+
+                candidates[i] = { emitterIdx, distanceVolume, loudness };
+            }
+
+            realCount = std::min(int32_t(candidates.size()), maxRealVoiceCount);
+            if (int32_t(candidates.size()) > realCount) {
+                std::nth_element(candidates.begin(), candidates.begin() + realCount, candidates.end(),
+                    [](const Candidate& candidate0, const Candidate& candidate1) {
+                        return candidate0.loudness > candidate1.loudness;
+                    });
+            }
+
+        }
+
+        void SpatialAudio::Apply(const CameraComponent& listener, float deltaTime) {
+
+            auto listenerLocation = listener.GetLocation();
+            auto lastListenerLocation = listener.GetLastLocation();
+
+            deltaTime = std::max(deltaTime, epsilon);
+
+            for (int32_t i = 0; i < realCount; i++) {
+                const auto& candidate = candidates[i];
+                auto emitterIdx = candidate.emitterIdx;
+
+                auto stream = emitters.streams[emitterIdx];
+                emitters.isReal[emitterIdx] = 1;
+
+                auto audioVolumeComponent = emitters.audioVolumeComponents[emitterIdx];
+                if (audioVolumeComponent) {
+                    stream->SetVolume(candidate.distanceVolume * audioVolumeComponent->volume);
+                    continue;
+                }
+
+                auto audioComponent = emitters.audioComponents[emitterIdx];
+                auto transformComponent = emitters.transforms[emitterIdx];
+
+                auto objectLocation = vec3(transformComponent->globalMatrix[3]);
+                auto lastObjectLocation = vec3(transformComponent->lastGlobalMatrix[3]);
+
+                auto distance = glm::distance(objectLocation, listenerLocation);
+
+                auto mix = 0.5f;
+                if (distance > epsilon) {
+                    auto direction = (objectLocation - listenerLocation) / distance;
+                    mix = 0.5f * glm::dot(direction, -listener.right) + 0.5f;
+                }
+
+                auto lastDistance = glm::distance(lastObjectLocation, lastListenerLocation);
+                auto velocity = (lastDistance - distance) / deltaTime;
+
+                // Avoids high pitch when there is no movement history
+                if (audioComponent->initialState) {
+                    audioComponent->initialState = false;
+                    velocity = 0.0f;
+                }
+
+                auto pitch = 1.0 + velocity / 333.3;
+                pitch = pitch >= 0.0 ? pitch : 0.0;
+
+                stream->SetVolume(candidate.distanceVolume * audioComponent->volume);
+
+                stream->SetChannelVolume(Audio::Channel::Left, mix);
+                stream->SetChannelVolume(Audio::Channel::Right, 1.0f - mix);
+
+                stream->SetPitch(pitch);
+            }
+
+            // Inaudible and virtualized emitters are silenced, most of them already are
+            for (int32_t i = 0; i < emitterCount; i++) {
+                auto stream = emitters.streams[i];
+                if (!emitters.isReal[i] && stream && stream->GetVolume() != 0.0f)
+                    stream->SetVolume(0.0f);
+            }
+
+        }
+
+        float SpatialAudio::GetRangeSquared(float falloffFactor, float falloffPower, float cutoff) {
+
+            // Inverse of the distance volume at the cutoff, with quick paths for "normal" powers
+            auto range = falloffFactor / std::max(cutoff, epsilon);
+            if (falloffPower == 2.0f)
+                return range;
+            else if (falloffPower == 1.0f)
+                return range * range;
+
+            range = falloffPower == 3.0f ? std::cbrt(range) : powf(range, 1.0f / falloffPower);
+            return range * range;
+
+        }
+
+        float SpatialAudio::GetDistanceVolume(float distance, float falloffFactor, float falloffPower) {
+
+            // Use quick paths for "normal" powers and do nothing for the power=1 case
+            auto powerDistance = distance;
+            if (falloffPower == 2.0f)
+                powerDistance *= powerDistance;
+            else if (falloffPower == 3.0f)
+                powerDistance *= powerDistance * powerDistance;
+            else if (falloffPower != 1.0f)
+                powerDistance = powf(powerDistance, falloffPower);
+
+            return std::min(1.0f, falloffFactor / powerDistance);
+
+        }
+
+    }
+
+}
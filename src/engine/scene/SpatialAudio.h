@@ -0,0 +1,101 @@
+#pragma once
+
+#include "../System.h"
+#include "../ecs/EntityManager.h"
+
+#include "components/AudioComponent.h"
+#include "components/AudioVolumeComponent.h"
+#include "components/CameraComponent.h"
+
+#include <vector>
+
+namespace Atlas {
+
+    namespace Scene {
+
+        /**
+         * Spatializes the audio components of a scene relative to a listener. All emitters are gathered
+         * into flat arrays each update, culled against their audible range and attenuated in batches.
+         * Only the loudest emitters up to maxRealVoiceCount get a volume, the others are virtualized
+         * by setting their volume to zero, which means the mixer only advances them.
+         */
+        class SpatialAudio {
+
+        public:
+            SpatialAudio() = default;
+
+            /**
+             * Updates the volume, panning and pitch of all audio components.
+             * @param entityManager The entity manager of the scene
+             * @param listener The camera which acts as the listener
+             * @param deltaTime The time since the last update in seconds
+             * @param paused Whether the simulation is paused, which mutes all components without permanent play
+             */
+            void Update(ECS::EntityManager& entityManager, const Components::CameraComponent& listener,
+                float deltaTime, bool paused);
+
+            /**
+             * Returns the number of emitters of the last update.
+             */
+            int32_t GetEmitterCount() const;
+
+            /**
+             * Returns the number of emitters within their audible range in the last update.
+             */
+            int32_t GetAudibleCount() const;
+
+            /**
+             * Returns the number of emitters which got a volume in the last update.
+             */
+            int32_t GetRealCount() const;
+
+            int32_t maxRealVoiceCount = 64;
+
+        private:
+            // Point emitters have an empty box, such that points and volumes share the distance test
+            struct Emitters {
+                std::vector<float> minX, minY, minZ;
+                std::vector<float> maxX, maxY, maxZ;
+                std::vector<float> rangeSquared;
+                std::vector<float> distanceSquared;
+
+                // Each emitter is either an audio or an audio volume component, the other one is nullptr
+                std::vector<Components::AudioComponent*> audioComponents;
+                std::vector<Components::AudioVolumeComponent*> audioVolumeComponents;
+                std::vector<const Components::TransformComponent*> transforms;
+                std::vector<Audio::AudioStream*> streams;
+                std::vector<uint8_t> isReal;
+
+                void Resize(size_t count);
+            };
+
+            struct Candidate {
+                int32_t emitterIdx;
+                float distanceVolume;
+                float loudness;
+            };
+
+            void Gather(ECS::EntityManager& entityManager, bool paused);
+
+            void Cull(vec3 listenerLocation);
+
+            void Attenuate();
+
+            void Apply(const Components::CameraComponent& listener, float deltaTime);
+
+            static float GetRangeSquared(float falloffFactor, float falloffPower, float cutoff);
+
+            static float GetDistanceVolume(float distance, float falloffFactor, float falloffPower);
+
+            Emitters emitters;
+            std::vector<int32_t> audibleEmitters;
+            std::vector<Candidate> candidates;
+
+            int32_t emitterCount = 0;
+            int32_t realCount = 0;
+
+        };
+
+    }
+
+}
@@ -12,6 +12,7 @@ namespace Atlas {
 	namespace Scene {
 
         class Scene;
+        class SpatialAudio;
 
 		namespace Components {
 
@@ -37,14 +38,12 @@ namespace Atlas {
                 bool permanentPlay = false;
 
             private:
-                void Update(float deltaTime, const TransformComponent& transformComponent,
-                    vec3 listenerLocation, vec3 lastListenerLocation, vec3 listenerRight);
-
                 Scene* scene = nullptr;
 
                 bool initialState = true;
 
                 friend Scene;
+                friend SpatialAudio;
 
 			};
 
@@ -58,42 +58,6 @@ namespace Atlas {
 
             }
 
-            void AudioVolumeComponent::Update(const TransformComponent &transformComponent, vec3 listenerLocation) {
-
-                if (!stream)
-                    return;
-
-                if (scene->physicsWorld->pauseSimulation && !permanentPlay) {
-                    stream->SetVolume(0.0f);
-                    return;
-                }
-
-                const float epsilon = 0.00001f;
-
-                transformedAABB = aabb.Transform(transformComponent.globalMatrix);
-                auto distance = glm::max(epsilon, transformedAABB.GetDistance(listenerLocation));
-
-                // Use quick paths for "normal" powers and do nothing for the power=1 case
-                auto powerDistance = distance;
-                if (falloffPower == 2.0f)
-                    powerDistance *= powerDistance;
-                else if (falloffPower == 3.0f)
-                    powerDistance *= powerDistance * powerDistance;
-                else if (falloffPower != 1.0f)
-                    powerDistance = powf(powerDistance, falloffPower);
-
-                float distanceVolume = glm::min(1.0f, falloffFactor / powerDistance);
-                auto audible = distanceVolume > cutoff;
-
-                if (audible) {
-                    stream->SetVolume(distanceVolume * volume);
-                }
-                else {
-                    stream->SetVolume(0.0f);
-                }
-
-            }
-
         }
 
     }
@@ -12,6 +12,7 @@ namespace Atlas {
     namespace Scene {
 
         class Scene;
+        class SpatialAudio;
 
         namespace Components {
 
@@ -41,13 +42,12 @@ namespace Atlas {
                 bool permanentPlay = true;
 
             private:
-                void Update(const TransformComponent& transformComponent, vec3 listenerLocation);
-
                 Scene* scene = nullptr;
 
                 Volume::AABB transformedAABB;
 
                 friend Scene;
+                friend SpatialAudio;
 
             };
 
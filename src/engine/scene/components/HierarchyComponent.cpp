@@ -17,6 +17,11 @@ namespace Atlas {
 				scene->childToParentMap[entity] = owningEntity;
 				entities.push_back(entity);
 
+				// The global matrix of the child needs to be relative to the new parent
+				auto transformComponent = entity.TryGetComponent<TransformComponent>();
+				if (transformComponent)
+					transformComponent->MarkChanged();
+
 			}
 
 			void HierarchyComponent::RemoveChild(Entity entity) {
@@ -26,6 +31,10 @@ namespace Atlas {
 				if (it != entities.end()) {
 					scene->childToParentMap.erase(entity);
 					entities.erase(it);
+
+					auto transformComponent = entity.TryGetComponent<TransformComponent>();
+					if (transformComponent)
+						transformComponent->MarkChanged();
 				}
 
 			}
@@ -36,9 +45,8 @@ namespace Atlas {
 
 			}
 
-			void HierarchyComponent::Update(const TransformComponent& transform, bool parentChanged) {
-
-                updated = true;
+			void HierarchyComponent::Update(const TransformComponent& transform, bool parentChanged,
+				std::vector<PendingUpdate>& childUpdates, std::vector<ECS::Entity>& changedEntities) {
 
 				globalMatrix = transform.globalMatrix;
 
@@ -46,18 +54,21 @@ namespace Atlas {
                     bool transformChanged = parentChanged;
 
 					auto transformComponent = entity.TryGetComponent<TransformComponent>();
-					auto cameraComponent = entity.TryGetComponent<CameraComponent>();
 					auto hierarchyComponent = entity.TryGetComponent<HierarchyComponent>();
 
 					if (transformComponent) {
+                        // Changed transforms are already known to the scene
+                        if (parentChanged && !transformComponent->changed)
+                            changedEntities.push_back(entity);
+
                         transformChanged |= transformComponent->changed;
 						transformComponent->Update(transform, parentChanged);
 					}
 
 					if (hierarchyComponent) {
 						AE_ASSERT(!hierarchyComponent->root && "A child hierarchy should never also be a root hierarchy");
-						hierarchyComponent->Update(transformComponent ? *transformComponent : transform,
-                            transformChanged);
+						childUpdates.push_back({ hierarchyComponent, transformComponent ? transformComponent : &transform,
+                            transformChanged });
 					}
 				}
 
@@ -32,11 +32,20 @@ namespace Atlas {
                 glm::mat4 globalMatrix {1.0f};            
 
             protected:
-                void Update(const TransformComponent& transform, bool parentChanged);
+                struct PendingUpdate {
+                    HierarchyComponent* hierarchy = nullptr;
+                    const TransformComponent* transform = nullptr;
+                    bool parentChanged = false;
+                };
+
+                // Updates the direct children only, child hierarchies are appended to the pending updates.
+                // This way the scene can process a whole level of the hierarchy in parallel. Children which
+                // weren't changed themselves, but were updated due to their parent, are added to changedEntities.
+                void Update(const TransformComponent& transform, bool parentChanged,
+                    std::vector<PendingUpdate>& childUpdates, std::vector<ECS::Entity>& changedEntities);
 
                 std::vector<Entity> entities;
 
-                bool updated = false;
                 Entity owningEntity;
 
                 Scene* scene = nullptr;
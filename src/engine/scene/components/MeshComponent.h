@@ -28,6 +28,7 @@ namespace Atlas {
                 ResourceHandle<Mesh::Mesh> mesh = ResourceHandle<Mesh::Mesh>();
 
                 bool visible = true;
+                // Applied once the entity is inserted into the space partitioning again, e.g. after a transform change
                 bool dontCull = false;
 
                 Volume::AABB aabb = Volume::AABB{ vec3{-1.0f}, vec3{1.0f} };
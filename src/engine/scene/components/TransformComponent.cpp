@@ -22,16 +22,14 @@ namespace Atlas {
 			void TransformComponent::Set(const glm::mat4& matrix) {
 
 				this->matrix = matrix;
-				changed = true;
-                updated = false;
+				MarkChanged();
 
 			}
 			
 			void TransformComponent::Translate(glm::vec3 translation) {
 
 				this->matrix = glm::translate(matrix, translation);
-				changed = true;
-                updated = false;
+				MarkChanged();
 
 			}
 
@@ -67,6 +65,18 @@ namespace Atlas {
 
 			}
 
+            void TransformComponent::MarkChanged() {
+
+                // Components are recorded once until the scene resets the changed flag in the next timestep.
+                // Default constructed components, e.g. temporary ones, don't belong to any scene.
+                if (!changed && entity.IsValid())
+                    entity.GetScene()->entityManager.MarkChanged<TransformComponent>(entity);
+
+                changed = true;
+                updated = false;
+
+            }
+
             bool TransformComponent::IsStatic() const {
 
                 return isStatic;
@@ -56,6 +56,9 @@ namespace Atlas {
             protected:
                 void Update(const TransformComponent& parentTransform, bool parentChanged);
 
+                // Records the change in the scene, such that only changed transforms are updated
+                void MarkChanged();
+
                 Entity entity;
 
                 bool changed = true;
@@ -68,6 +68,8 @@ namespace Atlas {
                 node.Update(camera, LoDDistances,
                     leafList, LoDImage);
 
+            streamer.Update(camera.GetLocation());
+
         }
 
         void Terrain::UpdateRenderlist(const Volume::Frustum& frustum, vec3 location) {
@@ -273,6 +275,30 @@ namespace Atlas {
 
         }
 
+        void Terrain::GetHeights(const std::vector<vec2>& positions, std::vector<float>& heights,
+            std::vector<vec3>* normals) {
+
+            GetHeightQuery().GetHeights(positions, heights, normals);
+
+        }
+
+        Volume::RayResult<TerrainStorageCell*> Terrain::Intersect(const Volume::Ray& ray) {
+
+            return GetHeightQuery().Intersect(ray);
+
+        }
+
+        TerrainHeightQuery Terrain::GetHeightQuery() {
+
+            auto cellSideCount = rootNodeSideCount * (1 << (LoDCount - 1));
+            auto cellSideLength = 8.0f * patchSizeFactor * resolution;
+            auto tileResolution = 8 * patchSizeFactor + 1;
+
+            return TerrainHeightQuery(storage.GetCell(0, 0, LoDCount - 1), cellSideCount,
+                cellSideLength, tileResolution, heightScale);
+
+        }
+
         vec2 Terrain::GetGradient(float x, float z) {
 
             vec3 normal, forward;
@@ -3,6 +3,8 @@
 #include "../System.h"
 #include "TerrainNode.h"
 #include "TerrainStorage.h"
+#include "TerrainStreamer.h"
+#include "TerrainHeightQuery.h"
 
 #include "buffer/VertexArray.h"
 
@@ -44,10 +46,9 @@ namespace Atlas {
             /**
              * Updates the terrain and the storage queues.
              * @param camera
-             * @note After calling this method the storage->requestedCells list contains all the
-             * StorageCells which are needed by the terrain. If these StorageCells aren't loaded the terrain
-             * can't increase the level of detail of the specific nodes. The storage->unusedCells list contains
-             * all the cells which aren't needed any more at the moment. (Caching might be needed)
+             * @note The storage cells the terrain requests are loaded by the streamer, if the terrain
+             * has a filename. Otherwise the storage->requestedCells and storage->unusedCells lists are
+             * cleared after every update.
              */
             void Update(const CameraComponent& camera);
 
@@ -113,6 +114,31 @@ namespace Atlas {
             */
             float GetHeight(float x, float y, vec3& normal, vec3& forward);
 
+            /**
+             * Gets the heights and normals for a batch of points on the terrain.
+             * @param positions The x and z components of the points relative to the terrain origin
+             * @param heights Receives the height of each point
+             * @param normals Optional, receives the normal of each point
+             * @note Much faster than calling GetHeight() for each point. Points in cells
+             * which aren't loaded get a height of zero.
+             */
+            void GetHeights(const std::vector<vec2>& positions, std::vector<float>& heights,
+                std::vector<vec3>* normals = nullptr);
+
+            /**
+             * Intersects a ray with the terrain.
+             * @param ray The ray relative to the terrain origin
+             * @return The closest hit. The data is the storage cell of the highest level of detail that was hit.
+             * @note Only loaded cells of the highest level of detail are hit.
+             */
+            Volume::RayResult<TerrainStorageCell*> Intersect(const Volume::Ray& ray);
+
+            /**
+             * Returns a query object for batched height queries and ray casts on the highest level of detail.
+             * @note The query is only valid as long as no cells are loaded or evicted.
+             */
+            TerrainHeightQuery GetHeightQuery();
+
             /**
             * Gets the gradient at a specific point on the terrain.
             * @param x The x component of the point relative to the terrain origin
@@ -141,6 +167,7 @@ namespace Atlas {
             Common::Image<float> GetHeightField(int32_t LoD);
 
             TerrainStorage storage;
+            TerrainStreamer streamer { this };
 
             Texture::Texture2D shoreLine;
 
@@ -179,6 +206,8 @@ namespace Atlas {
             bool wireframe = false;
 
         private:
+            friend TerrainStreamer;
+
             void SortNodes(std::vector<TerrainNode*>& nodes, vec3 cameraLocation);
 
             void GeneratePatchVertexBuffer();
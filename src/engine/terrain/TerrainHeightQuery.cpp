@@ -0,0 +1,405 @@
+#include "TerrainHeightQuery.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AE_TERRAIN_SSE
+#include <emmintrin.h>
+#endif
+
+namespace Atlas {
+
+    namespace Terrain {
+
+        // Points of a cell are gathered into blocks of this size, which are then evaluated at once
+        static constexpr int32_t blockSize = 64;
+
+        // A cell can't have more samples per side than this
+        static constexpr int32_t maxLevelCount = 16;
+
+        struct Block {
+            // Position within the quad in between the four samples
+            float u[blockSize], v[blockSize];
+
+            // The samples at (x, z), (x + 1, z), (x, z + 1) and (x + 1, z + 1)
+            float height00[blockSize], height10[blockSize];
+            float height01[blockSize], height11[blockSize];
+
+            float height[blockSize];
+            float normalX[blockSize], normalY[blockSize], normalZ[blockSize];
+        };
+
+        // Each quad is split into two triangles along its diagonal, on which the height is linear:
+        // height = height00 + u * slopeX + v * slopeZ. This is what Terrain::GetHeight() computes.
+        static void Evaluate(Block& block, int32_t count, float heightScale) {
+
+            int32_t i = 0;
+#ifdef AE_TERRAIN_SSE
+            auto scale = _mm_set1_ps(heightScale);
+            auto one = _mm_set1_ps(1.0f);
+            for (; i + 4 <= count; i += 4) {
+                auto u = _mm_loadu_ps(block.u + i);
+                auto v = _mm_loadu_ps(block.v + i);
+                auto height00 = _mm_mul_ps(_mm_loadu_ps(block.height00 + i), scale);
+                auto height10 = _mm_mul_ps(_mm_loadu_ps(block.height10 + i), scale);
+                auto height01 = _mm_mul_ps(_mm_loadu_ps(block.height01 + i), scale);
+                auto height11 = _mm_mul_ps(_mm_loadu_ps(block.height11 + i), scale);
+
+                // Select the slopes of the triangle the point is in without branching
+                auto upper = _mm_cmpgt_ps(u, v);
+                auto slopeX = _mm_or_ps(_mm_and_ps(upper, _mm_sub_ps(height10, height00)),
+                    _mm_andnot_ps(upper, _mm_sub_ps(height11, height01)));
+                auto slopeZ = _mm_or_ps(_mm_and_ps(upper, _mm_sub_ps(height11, height10)),
+                    _mm_andnot_ps(upper, _mm_sub_ps(height01, height00)));
+
+                auto height = _mm_add_ps(height00, _mm_add_ps(_mm_mul_ps(u, slopeX), _mm_mul_ps(v, slopeZ)));
+                _mm_storeu_ps(block.height + i, height);
+
+                auto lengthSquared = _mm_add_ps(one, _mm_add_ps(_mm_mul_ps(slopeX, slopeX), _mm_mul_ps(slopeZ, slopeZ)));
+                auto inverseLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSquared));
+                _mm_storeu_ps(block.normalX + i, _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), slopeX), inverseLength));
+                _mm_storeu_ps(block.normalY + i, inverseLength);
+                _mm_storeu_ps(block.normalZ + i, _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), slopeZ), inverseLength));
+            }
+#endif
+            for (; i < count; i++) {
+                auto height00 = block.height00[i] * heightScale, height10 = block.height10[i] * heightScale;
+                auto height01 = block.height01[i] * heightScale, height11 = block.height11[i] * heightScale;
+
+                auto upper = block.u[i] > block.v[i];
+                auto slopeX = upper ? height10 - height00 : height11 - height01;
+                auto slopeZ = upper ? height11 - height10 : height01 - height00;
+
+                block.height[i] = height00 + block.u[i] * slopeX + block.v[i] * slopeZ;
+
+                auto inverseLength = 1.0f / std::sqrt(1.0f + slopeX * slopeX + slopeZ * slopeZ);
+                block.normalX[i] = -slopeX * inverseLength;
+                block.normalY[i] = inverseLength;
+                block.normalZ[i] = -slopeZ * inverseLength;
+            }
+
+        }
+
+        // Restricts [t0, t1] to the part where the ray is in between min and max along one axis
+        static bool ClipSlab(float origin, float direction, float min, float max, float& t0, float& t1) {
+
+            if (direction == 0.0f)
+                return origin >= min && origin <= max;
+
+            auto tMin = (min - origin) / direction;
+            auto tMax = (max - origin) / direction;
+            if (tMin > tMax)
+                std::swap(tMin, tMax);
+
+            t0 = std::max(t0, tMin);
+            t1 = std::min(t1, tMax);
+
+            return t0 <= t1;
+
+        }
+
+        TerrainHeightQuery::TerrainHeightQuery(TerrainStorageCell* cells, int32_t cellSideCount, float cellSideLength,
+            int32_t tileResolution, float heightScale) : cells(cells), cellSideCount(cellSideCount),
+            cellSideLength(cellSideLength), tileResolution(tileResolution), heightScale(heightScale) {}
+
+        void TerrainHeightQuery::GetHeights(const std::vector<vec2>& positions, std::vector<float>& heights,
+            std::vector<vec3>* normals) const {
+
+            auto count = int32_t(positions.size());
+
+            heights.resize(positions.size());
+            if (normals)
+                normals->resize(positions.size());
+
+            // Reused by all queries on a thread, such that queries don't allocate after the first ones
+            thread_local std::vector<int32_t> cellIndices, cellOffsets, order;
+
+            // Points outside of the terrain are put into an additional cell at the end
+            auto cellCount = cellSideCount * cellSideCount;
+            auto inverseCellSideLength = 1.0f / cellSideLength;
+
+            cellIndices.resize(positions.size());
+            for (int32_t i = 0; i < count; i++) {
+                auto x = positions[i].x * inverseCellSideLength;
+                auto z = positions[i].y * inverseCellSideLength;
+
+                auto inside = x >= 0.0f && z >= 0.0f && x <= float(cellSideCount) && z <= float(cellSideCount);
+
+                // Points on the far edges belong to the last cells
+                auto cellX = std::min(int32_t(x), cellSideCount - 1);
+                auto cellZ = std::min(int32_t(z), cellSideCount - 1);
+                cellIndices[i] = inside ? cellX * cellSideCount + cellZ : cellCount;
+            }
+
+            // Counting sort by cell, afterwards cellOffsets[i] is the end of cell i in the order
+            cellOffsets.assign(size_t(cellCount) + 2, 0);
+            for (int32_t i = 0; i < count; i++)
+                cellOffsets[cellIndices[i] + 1]++;
+            for (int32_t i = 1; i < cellCount + 2; i++)
+                cellOffsets[i] += cellOffsets[i - 1];
+
+            order.resize(positions.size());
+            for (int32_t i = 0; i < count; i++)
+                order[cellOffsets[cellIndices[i]]++] = i;
+
+            auto quadCount = tileResolution - 1;
+            auto quadsPerLength = float(quadCount) / cellSideLength;
+
+            Block block;
+            for (int32_t cellIdx = 0; cellIdx <= cellCount; cellIdx++) {
+                auto begin = cellIdx == 0 ? 0 : cellOffsets[cellIdx - 1];
+                auto end = cellOffsets[cellIdx];
+                if (begin == end)
+                    continue;
+
+                auto cell = cellIdx < cellCount ? cells + cellIdx : nullptr;
+                if (!cell || !HasHeightData(cell)) {
+                    for (int32_t i = begin; i < end; i++) {
+                        heights[order[i]] = 0.0f;
+                        if (normals)
+                            (*normals)[order[i]] = vec3(0.0f, 1.0f, 0.0f);
+                    }
+                    continue;
+                }
+
+                auto heightData = cell->heightData.data();
+                auto cellOrigin = vec2(float(cellIdx / cellSideCount), float(cellIdx % cellSideCount)) * cellSideLength;
+
+                for (int32_t blockBegin = begin; blockBegin < end; blockBegin += blockSize) {
+                    auto blockCount = std::min(blockSize, end - blockBegin);
+
+                    for (int32_t i = 0; i < blockCount; i++) {
+                        auto position = (positions[order[blockBegin + i]] - cellOrigin) * quadsPerLength;
+
+                        auto x = std::clamp(int32_t(position.x), 0, quadCount - 1);
+                        auto z = std::clamp(int32_t(position.y), 0, quadCount - 1);
+
+                        block.u[i] = std::clamp(position.x - float(x), 0.0f, 1.0f);
+                        block.v[i] = std::clamp(position.y - float(z), 0.0f, 1.0f);
+
+                        auto idx = x + z * tileResolution;
+                        block.height00[i] = heightData[idx];
+                        block.height10[i] = heightData[idx + 1];
+                        block.height01[i] = heightData[idx + tileResolution];
+                        block.height11[i] = heightData[idx + tileResolution + 1];
+                    }
+
+                    Evaluate(block, blockCount, heightScale);
+
+                    for (int32_t i = 0; i < blockCount; i++) {
+                        auto pointIdx = order[blockBegin + i];
+                        heights[pointIdx] = block.height[i];
+                        if (normals)
+                            (*normals)[pointIdx] = vec3(block.normalX[i], block.normalY[i], block.normalZ[i]);
+                    }
+                }
+            }
+
+        }
+
+        Volume::RayResult<TerrainStorageCell*> TerrainHeightQuery::Intersect(const Volume::Ray& ray) const {
+
+            Volume::RayResult<TerrainStorageCell*> result;
+            result.data = nullptr;
+
+            // Only the part of the ray within the bounds of the terrain is marched
+            auto terrainSideLength = cellSideLength * float(cellSideCount);
+            auto tEnter = ray.tMin, tExit = ray.tMax;
+            if (!ClipSlab(ray.origin.x, ray.direction.x, 0.0f, terrainSideLength, tEnter, tExit) ||
+                !ClipSlab(ray.origin.z, ray.direction.z, 0.0f, terrainSideLength, tEnter, tExit) ||
+                !ClipSlab(ray.origin.y, ray.direction.y, 0.0f, heightScale, tEnter, tExit))
+                return result;
+
+            auto start = ray.Get(tEnter);
+            auto cellX = std::clamp(int32_t(start.x / cellSideLength), 0, cellSideCount - 1);
+            auto cellZ = std::clamp(int32_t(start.z / cellSideLength), 0, cellSideCount - 1);
+
+            // Step through the cells along the ray like a line rasterization
+            const auto infinity = std::numeric_limits<float>::infinity();
+            auto stepX = ray.direction.x > 0.0f ? 1 : -1;
+            auto stepZ = ray.direction.z > 0.0f ? 1 : -1;
+            auto tDeltaX = ray.direction.x != 0.0f ? std::abs(cellSideLength / ray.direction.x) : infinity;
+            auto tDeltaZ = ray.direction.z != 0.0f ? std::abs(cellSideLength / ray.direction.z) : infinity;
+            auto tNextX = ray.direction.x != 0.0f ? (float(cellX + (stepX > 0 ? 1 : 0)) * cellSideLength -
+                ray.origin.x) / ray.direction.x : infinity;
+            auto tNextZ = ray.direction.z != 0.0f ? (float(cellZ + (stepZ > 0 ? 1 : 0)) * cellSideLength -
+                ray.origin.z) / ray.direction.z : infinity;
+
+            auto t = tEnter;
+            while (t <= tExit) {
+                auto tCellExit = std::min({ tNextX, tNextZ, tExit });
+
+                float hitDistance;
+                vec3 hitNormal;
+                if (IntersectCell(ray, cellX, cellZ, t, tCellExit, hitDistance, hitNormal)) {
+                    result.valid = true;
+                    result.hitDistance = hitDistance;
+                    result.normal = hitNormal;
+                    result.data = cells + cellX * cellSideCount + cellZ;
+                    return result;
+                }
+
+                if (tNextX < tNextZ) {
+                    cellX += stepX;
+                    t = tNextX;
+                    tNextX += tDeltaX;
+                }
+                else {
+                    cellZ += stepZ;
+                    t = tNextZ;
+                    tNextZ += tDeltaZ;
+                }
+
+                if (cellX < 0 || cellZ < 0 || cellX >= cellSideCount || cellZ >= cellSideCount)
+                    break;
+            }
+
+            return result;
+
+        }
+
+        bool TerrainHeightQuery::IntersectCell(const Volume::Ray& ray, int32_t cellX, int32_t cellZ, float tEnter,
+            float tExit, float& hitDistance, vec3& hitNormal) const {
+
+            auto cell = cells + cellX * cellSideCount + cellZ;
+            if (!HasHeightData(cell))
+                return false;
+
+            // Work in the space of the quads of the cell, such that a quad has a side length of one
+            auto quadCount = tileResolution - 1;
+            auto quadsPerLength = float(quadCount) / cellSideLength;
+            auto origin = vec2(ray.origin.x - float(cellX) * cellSideLength,
+                ray.origin.z - float(cellZ) * cellSideLength) * quadsPerLength;
+            auto direction = vec2(ray.direction.x, ray.direction.z) * quadsPerLength;
+
+            int32_t levelSizes[maxLevelCount], levelOffsets[maxLevelCount];
+            int32_t levelCount = 0, offset = 0;
+            for (auto size = quadCount; levelCount < maxLevelCount; size = (size + 1) / 2) {
+                levelSizes[levelCount] = size;
+                levelOffsets[levelCount++] = offset;
+                offset += size * size;
+                if (size == 1)
+                    break;
+            }
+
+            // Without the pyramid every quad along the ray is tested, which is still correct
+            auto heightData = cell->heightData.data();
+            auto heightBounds = cell->heightBounds.size() == size_t(offset) ? cell->heightBounds.data() : nullptr;
+
+            struct Node {
+                int32_t level;
+                int32_t x, z;
+                float tEnter, tExit;
+            };
+
+            // Children are pushed far to near, such that the first hit is the closest one
+            Node stack[4 * maxLevelCount];
+            int32_t stackSize = 0;
+
+            auto rootEnter = tEnter, rootExit = tExit;
+            if (!ClipSlab(origin.x, direction.x, 0.0f, float(quadCount), rootEnter, rootExit) ||
+                !ClipSlab(origin.y, direction.y, 0.0f, float(quadCount), rootEnter, rootExit))
+                return false;
+            stack[stackSize++] = { levelCount - 1, 0, 0, rootEnter, rootExit };
+
+            while (stackSize > 0) {
+                auto node = stack[--stackSize];
+
+                auto heightEnter = ray.origin.y + ray.direction.y * node.tEnter;
+                auto heightExit = ray.origin.y + ray.direction.y * node.tExit;
+                if (heightBounds) {
+                    auto bounds = heightBounds[levelOffsets[node.level] + node.x + node.z * levelSizes[node.level]];
+                    if (std::min(heightEnter, heightExit) > bounds.y * heightScale ||
+                        std::max(heightEnter, heightExit) < bounds.x * heightScale)
+                        continue;
+                }
+
+                if (node.level == 0) {
+                    auto idx = node.x + node.z * tileResolution;
+                    auto height00 = heightData[idx] * heightScale;
+                    auto height10 = heightData[idx + 1] * heightScale;
+                    auto height01 = heightData[idx + tileResolution] * heightScale;
+                    auto height11 = heightData[idx + tileResolution + 1] * heightScale;
+
+                    auto localOrigin = origin - vec2(float(node.x), float(node.z));
+
+                    auto hit = false;
+                    for (int32_t i = 0; i < 2; i++) {
+                        auto upper = i == 0;
+                        auto slopeX = upper ? height10 - height00 : height11 - height01;
+                        auto slopeZ = upper ? height11 - height10 : height01 - height00;
+
+                        // Intersection with the plane of the triangle
+                        auto denominator = ray.direction.y - slopeX * direction.x - slopeZ * direction.y;
+                        if (denominator == 0.0f)
+                            continue;
+                        auto t = (height00 + slopeX * localOrigin.x + slopeZ * localOrigin.y - ray.origin.y) / denominator;
+
+                        const auto epsilon = 0.0001f;
+                        if (t < node.tEnter - epsilon || t > node.tExit + epsilon)
+                            continue;
+
+                        auto position = localOrigin + direction * t;
+                        if (upper ? position.x < position.y - epsilon : position.x > position.y + epsilon)
+                            continue;
+
+                        if (!hit || t < hitDistance) {
+                            hitDistance = std::clamp(t, node.tEnter, node.tExit);
+                            hitNormal = glm::normalize(vec3(-slopeX, 1.0f, -slopeZ));
+                            hit = true;
+                        }
+                    }
+
+                    if (hit)
+                        return true;
+
+                    continue;
+                }
+
+                auto childLevel = node.level - 1;
+                auto childSize = levelSizes[childLevel];
+
+                Node children[4];
+                int32_t childCount = 0;
+                for (int32_t i = 0; i < 4; i++) {
+                    auto childX = 2 * node.x + (i & 1);
+                    auto childZ = 2 * node.z + (i >> 1);
+                    if (childX >= childSize || childZ >= childSize)
+                        continue;
+
+                    // The area of a child in quads, the last ones might be cut off
+                    auto minX = float(childX << childLevel), minZ = float(childZ << childLevel);
+                    auto maxX = float(std::min((childX + 1) << childLevel, quadCount));
+                    auto maxZ = float(std::min((childZ + 1) << childLevel, quadCount));
+
+                    auto childEnter = node.tEnter, childExit = node.tExit;
+                    if (!ClipSlab(origin.x, direction.x, minX, maxX, childEnter, childExit) ||
+                        !ClipSlab(origin.y, direction.y, minZ, maxZ, childEnter, childExit))
+                        continue;
+
+                    // Insertion sort, far to near
+                    auto j = childCount++;
+                    for (; j > 0 && children[j - 1].tEnter < childEnter; j--)
+                        children[j] = children[j - 1];
+                    children[j] = { childLevel, childX, childZ, childEnter, childExit };
+                }
+
+                for (int32_t i = 0; i < childCount; i++)
+                    stack[stackSize++] = children[i];
+            }
+
+            return false;
+
+        }
+
+        bool TerrainHeightQuery::HasHeightData(const TerrainStorageCell* cell) const {
+
+            return cell->heightData.size() == size_t(tileResolution) * size_t(tileResolution);
+
+        }
+
+    }
+
+}
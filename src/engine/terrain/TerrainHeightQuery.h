@@ -0,0 +1,70 @@
+#pragma once
+
+#include "../System.h"
+#include "../volume/Ray.h"
+#include "TerrainStorageCell.h"
+
+#include <vector>
+
+namespace Atlas {
+
+    namespace Terrain {
+
+        /**
+         * Batched height queries and ray casts against the height data of the cells of one level of detail.
+         * The query only references the cells, so it's cheap to create whenever it's needed. All methods can
+         * be called from multiple threads at once, as long as the height data of the cells doesn't change.
+         * @note The height and normal at a point are the same as the ones of Terrain::GetHeight().
+         */
+        class TerrainHeightQuery {
+
+        public:
+            /**
+             * Constructs a TerrainHeightQuery object.
+             * @param cells The cells of the level of detail, indexed by x * cellSideCount + y like in the storage
+             * @param cellSideCount The number of cells per side
+             * @param cellSideLength The side length of a cell in world units
+             * @param tileResolution The number of height samples per cell side
+             * @param heightScale The maximum height of the terrain
+             */
+            TerrainHeightQuery(TerrainStorageCell* cells, int32_t cellSideCount, float cellSideLength,
+                int32_t tileResolution, float heightScale);
+
+            /**
+             * Gets the heights and normals for a batch of points.
+             * @param positions The x and z components of the points relative to the terrain origin
+             * @param heights Is resized to the number of points and receives their heights
+             * @param normals Optional, is resized to the number of points and receives their normals
+             * @note Points are grouped by their cell and evaluated in SIMD batches. Points outside the terrain
+             * or in cells without height data get a height of zero and an upward normal.
+             */
+            void GetHeights(const std::vector<vec2>& positions, std::vector<float>& heights,
+                std::vector<vec3>* normals = nullptr) const;
+
+            /**
+             * Intersects a ray with the height data.
+             * @param ray The ray relative to the terrain origin. Only hits in between tMin and tMax are reported.
+             * @return The closest hit with its distance, normal and cell, if there is any.
+             * @note Cells are visited along the ray. Within a cell, the min/max pyramid of the height data
+             * is used to skip over areas the ray passes above, see TerrainStorageCell::UpdateHeightBounds().
+             * Only cells with height data are hit.
+             */
+            Volume::RayResult<TerrainStorageCell*> Intersect(const Volume::Ray& ray) const;
+
+        private:
+            bool IntersectCell(const Volume::Ray& ray, int32_t cellX, int32_t cellZ, float tEnter, float tExit,
+                float& hitDistance, vec3& hitNormal) const;
+
+            bool HasHeightData(const TerrainStorageCell* cell) const;
+
+            TerrainStorageCell* cells;
+            int32_t cellSideCount;
+            float cellSideLength;
+            int32_t tileResolution;
+            float heightScale;
+
+        };
+
+    }
+
+}
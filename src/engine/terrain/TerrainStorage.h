@@ -2,6 +2,7 @@
 
 #include "../System.h"
 #include "TerrainStorageCell.h"
+#include "TerrainTileArchive.h"
 
 #include <vector>
 
@@ -89,6 +90,12 @@ namespace Atlas {
              */
             std::vector<TerrainStorageCell*> unusedCells;
 
+            /**
+             * The tiles of all storage cells, which is mapped once when the terrain is loaded.
+             * Equals nullptr if the terrain has no tile archive.
+             */
+            Ref<TerrainTileArchive> tileArchive = nullptr;
+
             Texture::Texture2DArray baseColorMaps;
             Texture::Texture2DArray roughnessMaps;
             Texture::Texture2DArray aoMaps;
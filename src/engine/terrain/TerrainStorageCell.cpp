@@ -1,6 +1,10 @@
 #include "TerrainStorageCell.h"
 #include "TerrainStorage.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 namespace Atlas {
 
     namespace Terrain {
@@ -23,6 +27,54 @@ namespace Atlas {
 
         }
 
+        void TerrainStorageCell::UpdateHeightBounds() {
+
+            heightBounds.clear();
+
+            auto resolution = int32_t(std::lround(std::sqrt(float(heightData.size()))));
+            if (resolution < 2 || size_t(resolution * resolution) != heightData.size())
+                return;
+
+            auto size = resolution - 1;
+            heightBounds.resize(size_t(size) * size_t(size));
+
+            for (int32_t z = 0; z < size; z++) {
+                for (int32_t x = 0; x < size; x++) {
+                    auto idx = x + z * resolution;
+                    auto height0 = heightData[idx], height1 = heightData[idx + 1];
+                    auto height2 = heightData[idx + resolution], height3 = heightData[idx + resolution + 1];
+                    heightBounds[x + z * size] = vec2(std::min({ height0, height1, height2, height3 }),
+                        std::max({ height0, height1, height2, height3 }));
+                }
+            }
+
+            // Each level halves the size, odd sizes are rounded up
+            size_t offset = 0;
+            while (size > 1) {
+                auto nextSize = (size + 1) / 2;
+                auto nextOffset = heightBounds.size();
+                heightBounds.resize(nextOffset + size_t(nextSize) * size_t(nextSize));
+
+                for (int32_t z = 0; z < nextSize; z++) {
+                    for (int32_t x = 0; x < nextSize; x++) {
+                        auto bounds = vec2(std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest());
+                        for (int32_t i = 0; i < 4; i++) {
+                            auto childX = 2 * x + (i & 1), childZ = 2 * z + (i >> 1);
+                            if (childX >= size || childZ >= size)
+                                continue;
+                            auto childBounds = heightBounds[offset + childX + childZ * size];
+                            bounds = vec2(std::min(bounds.x, childBounds.x), std::max(bounds.y, childBounds.y));
+                        }
+                        heightBounds[nextOffset + x + z * nextSize] = bounds;
+                    }
+                }
+
+                offset = nextOffset;
+                size = nextSize;
+            }
+
+        }
+
     }
 
 }
\ No newline at end of file
@@ -23,6 +23,13 @@ namespace Atlas {
 
             bool IsLoaded();
 
+            /**
+             * Builds the min/max pyramid of the height data, which lets ray casts skip over large parts of the cell.
+             * @note Needs to be called whenever the height data changes. Ray casts still work without
+             * the pyramid, they are just slower.
+             */
+            void UpdateHeightBounds();
+
             int32_t x = 0;
             int32_t y = 0;
             int32_t LoD = 0;
@@ -33,6 +40,13 @@ namespace Atlas {
 
             std::vector<float> heightData;
 
+            /**
+             * The min/max pyramid of the height data. The first level holds the bounds of each quad in between
+             * four height samples, each further level the bounds of 2x2 entries of the level below, down to a
+             * single entry. Levels are stored one after another with x as the fast index.
+             */
+            std::vector<vec2> heightBounds;
+
             Texture::Texture2D heightField;
             Texture::Texture2D normalMap;
             Texture::Texture2D splatMap;
@@ -0,0 +1,277 @@
+#include "TerrainStreamer.h"
+#include "Terrain.h"
+
+#include "../loader/TerrainLoader.h"
+#include "../graphics/Format.h"
+
+#include <algorithm>
+
+namespace Atlas {
+
+    namespace Terrain {
+
+        // A failed load is retried after this many frames, doubling with every further failure
+        static constexpr uint64_t retryFrameCount = 60;
+        static constexpr int32_t maxRetryBackoff = 6;
+
+        TerrainStreamer::TerrainStreamer(Terrain* terrain) : terrain(terrain) {}
+
+        TerrainStreamer::~TerrainStreamer() {
+
+            // The jobs write into the loads, so they need to finish before the loads are destroyed
+            for (auto& load : loads)
+                JobSystem::Wait(load->jobGroup);
+
+        }
+
+        void TerrainStreamer::Update(vec3 cameraLocation) {
+
+            frame++;
+
+            FinishLoads(false);
+
+            auto& storage = terrain->storage;
+            if (terrain->filename.empty()) {
+                storage.requestedCells.clear();
+                storage.unusedCells.clear();
+                return;
+            }
+
+            MarkUsedCells();
+            StartLoads(cameraLocation);
+
+            // Nodes are created as temporaries and copied around, which means cells in here might still be
+            // in use. Eviction relies on the node tree instead, see MarkUsedCells().
+            storage.requestedCells.clear();
+            storage.unusedCells.clear();
+
+        }
+
+        void TerrainStreamer::WaitForCompletion() {
+
+            FinishLoads(true);
+
+        }
+
+        size_t TerrainStreamer::GetMemoryUsage() const {
+
+            return memoryUsage;
+
+        }
+
+        int32_t TerrainStreamer::GetLoadedCellCount() const {
+
+            return int32_t(loadedCells.size());
+
+        }
+
+        int32_t TerrainStreamer::GetInFlightCount() const {
+
+            return int32_t(loads.size());
+
+        }
+
+        void TerrainStreamer::FinishLoads(bool wait) {
+
+            for (size_t i = 0; i < loads.size();) {
+                auto& load = loads[i];
+
+                if (wait)
+                    JobSystem::Wait(load->jobGroup);
+
+                if (!load->jobGroup.HasFinished()) {
+                    i++;
+                    continue;
+                }
+
+                // Publishing happens here such that the nodes never see a partially loaded cell
+                auto cell = load->cell;
+                auto& result = load->result;
+                if (result->IsLoaded()) {
+                    cell->heightField = result->heightField;
+                    cell->normalMap = result->normalMap;
+                    cell->splatMap = result->splatMap;
+                    cell->heightData = std::move(result->heightData);
+                    cell->heightBounds = std::move(result->heightBounds);
+
+                    auto memory = GetCellMemory(*cell);
+                    loadedCells.push_back({ cell, memory, frame });
+                    memoryUsage += memory;
+
+                    failedLoads.erase(cell);
+                }
+                else {
+                    // Missing or damaged data would otherwise be read again in every frame
+                    auto& failedLoad = failedLoads[cell];
+                    auto backoff = std::min(failedLoad.failureCount++, maxRetryBackoff);
+                    failedLoad.retryFrame = frame + (retryFrameCount << backoff);
+                }
+
+                loads[i] = std::move(loads.back());
+                loads.pop_back();
+            }
+
+        }
+
+        void TerrainStreamer::StartLoads(vec3 cameraLocation) {
+
+            auto& storage = terrain->storage;
+            auto location = vec2(cameraLocation.x, cameraLocation.z);
+
+            // Cells are requested by every node in each frame until they are loaded
+            requests.clear();
+            for (auto cell : storage.requestedCells) {
+                if (!cell || cell->IsLoaded() || IsLoading(cell))
+                    continue;
+
+                auto failedLoad = failedLoads.find(cell);
+                if (failedLoad != failedLoads.end() && failedLoad->second.retryFrame > frame)
+                    continue;
+
+                auto duplicate = std::any_of(requests.begin(), requests.end(),
+                    [cell](const Request& request) { return request.cell == cell; });
+                if (duplicate)
+                    continue;
+
+                requests.push_back({ cell, glm::distance(GetCellCenter(cell), location) });
+            }
+
+            // Coarse cells first, a node can only be refined once its parent is loaded
+            std::sort(requests.begin(), requests.end(), [](const Request& request0, const Request& request1) {
+                if (request0.cell->LoD != request1.cell->LoD)
+                    return request0.cell->LoD < request1.cell->LoD;
+                return request0.distance < request1.distance;
+            });
+
+            for (const auto& request : requests) {
+                if (int32_t(loads.size()) >= maxInFlightCount)
+                    break;
+
+                auto cell = request.cell;
+
+                // Approximate the size of the new cell with the size of an already loaded one of the same LoD
+                size_t requiredMemory = 0;
+                for (const auto& loadedCell : loadedCells) {
+                    if (loadedCell.cell->LoD == cell->LoD) {
+                        requiredMemory = loadedCell.memory;
+                        break;
+                    }
+                }
+
+                if (memoryUsage + requiredMemory > memoryBudget) {
+                    Evict(memoryUsage + requiredMemory - memoryBudget);
+                    // Refining is stopped when the budget is exhausted, the terrain is still complete without it
+                    if (memoryUsage + requiredMemory > memoryBudget && cell->LoD > 0)
+                        break;
+                }
+
+                auto load = std::make_unique<Load>();
+                load->cell = cell;
+                load->result = std::make_unique<TerrainStorageCell>(&storage);
+                load->result->x = cell->x;
+                load->result->y = cell->y;
+                load->result->LoD = cell->LoD;
+                load->result->position = cell->position;
+
+                auto result = load->result.get();
+                JobSystem::Execute(load->jobGroup, [this, result](JobData&) {
+                    Loader::TerrainLoader::LoadStorageCell(terrain, result, terrain->filename, initWithHeightData);
+                });
+
+                loads.push_back(std::move(load));
+            }
+
+        }
+
+        void TerrainStreamer::MarkUsedCells() {
+
+            auto& storage = terrain->storage;
+
+            // A collapsing node falls back to its parent, so all ancestors of the leaves are in use as well
+            usedCells.clear();
+            for (auto node : terrain->leafList) {
+                auto cell = node->cell;
+                for (int32_t i = 0; i <= cell->LoD; i++) {
+                    auto usedCell = storage.GetCell(cell->x >> i, cell->y >> i, cell->LoD - i);
+                    if (!usedCell || !usedCells.insert(usedCell).second)
+                        break;
+                }
+            }
+
+            for (auto& loadedCell : loadedCells) {
+                if (usedCells.contains(loadedCell.cell))
+                    loadedCell.lastUsedFrame = frame;
+            }
+
+        }
+
+        void TerrainStreamer::Evict(size_t requiredMemory) {
+
+            // Cells of the lowest level of detail are never evicted, so they are kept in front
+            auto getPriority = [](const LoadedCell& loadedCell) {
+                return loadedCell.cell->LoD == 0 ? UINT64_MAX : loadedCell.lastUsedFrame;
+            };
+            std::sort(loadedCells.begin(), loadedCells.end(),
+                [&](const LoadedCell& cell0, const LoadedCell& cell1) {
+                    return getPriority(cell0) > getPriority(cell1);
+                });
+
+            size_t freedMemory = 0;
+            while (!loadedCells.empty() && freedMemory < requiredMemory) {
+                auto& loadedCell = loadedCells.back();
+                if (getPriority(loadedCell) >= frame)
+                    break;
+
+                auto cell = loadedCell.cell;
+                cell->heightField = Texture::Texture2D();
+                cell->normalMap = Texture::Texture2D();
+                cell->splatMap = Texture::Texture2D();
+                cell->heightData.clear();
+                cell->heightData.shrink_to_fit();
+                cell->heightBounds.clear();
+                cell->heightBounds.shrink_to_fit();
+
+                freedMemory += loadedCell.memory;
+                memoryUsage -= loadedCell.memory;
+                loadedCells.pop_back();
+            }
+
+        }
+
+        bool TerrainStreamer::IsLoading(TerrainStorageCell* cell) const {
+
+            return std::any_of(loads.begin(), loads.end(),
+                [cell](const Scope<Load>& load) { return load->cell == cell; });
+
+        }
+
+        vec2 TerrainStreamer::GetCellCenter(TerrainStorageCell* cell) const {
+
+            // Same layout as the nodes, see Terrain::Terrain(), but in world space like the camera
+            auto cellSideLength = terrain->sideLength / float(terrain->rootNodeSideCount * (1 << cell->LoD));
+            auto translation = vec2(terrain->translation.x, terrain->translation.z);
+            return (vec2(float(cell->x), float(cell->y)) + 0.5f) * cellSideLength + translation;
+
+        }
+
+        size_t TerrainStreamer::GetCellMemory(const TerrainStorageCell& cell) {
+
+            size_t memory = cell.heightData.size() * sizeof(float) + cell.heightBounds.size() * sizeof(vec2);
+            for (auto texture : { &cell.heightField, &cell.normalMap, &cell.splatMap }) {
+                if (!texture->IsValid())
+                    continue;
+
+                auto size = size_t(texture->width) * size_t(texture->height) * Graphics::GetFormatSize(texture->format);
+                // A full mip chain adds about a third
+                if (texture->image->mipLevels > 1)
+                    size += size / 3;
+                memory += size;
+            }
+
+            return memory;
+
+        }
+
+    }
+
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "../System.h"
+#include "../jobsystem/JobSystem.h"
+#include "TerrainStorageCell.h"
+
+#include <vector>
+#include <unordered_set>
+#include <unordered_map>
+
+namespace Atlas {
+
+    namespace Terrain {
+
+        class Terrain;
+
+        /**
+         * Loads the storage cells the terrain requests from the terrain file. Requests are ordered by their
+         * level of detail and their distance to the camera and are loaded on low priority jobs, with a limited
+         * number of loads in flight. Loaded cells are only made visible to the terrain in Update(), such that
+         * the frame never waits for a load. Cells which aren't used by any node are evicted least recently used
+         * first, as soon as the memory of the loaded cells exceeds the budget. Failed loads are retried with
+         * an increasing delay.
+         */
+        class TerrainStreamer {
+
+        public:
+            explicit TerrainStreamer(Terrain* terrain);
+
+            TerrainStreamer(const TerrainStreamer&) = delete;
+
+            TerrainStreamer& operator=(const TerrainStreamer&) = delete;
+
+            ~TerrainStreamer();
+
+            /**
+             * Consumes the request queues of the terrain storage, finishes completed loads and starts new ones.
+             * @param cameraLocation The location the requests are prioritized by
+             * @note Called by the terrain after its nodes were updated.
+             */
+            void Update(vec3 cameraLocation);
+
+            /**
+             * Waits until all loads in flight have finished and makes their cells available.
+             */
+            void WaitForCompletion();
+
+            size_t GetMemoryUsage() const;
+
+            int32_t GetLoadedCellCount() const;
+
+            int32_t GetInFlightCount() const;
+
+            /**
+             * The number of cells which are loaded at the same time.
+             */
+            int32_t maxInFlightCount = 4;
+
+            /**
+             * The memory of all streamed cells in bytes, after which unused cells are evicted.
+             * Cells of the lowest level of detail are always loaded, even if the budget is exceeded.
+             */
+            size_t memoryBudget = 512 * 1024 * 1024;
+
+            /**
+             * Whether the loaded cells keep their height data on the CPU as well.
+             */
+            bool initWithHeightData = false;
+
+        private:
+            struct Load {
+                TerrainStorageCell* cell;
+                Scope<TerrainStorageCell> result;
+                JobGroup jobGroup { JobPriority::Low };
+            };
+
+            struct Request {
+                TerrainStorageCell* cell;
+                float distance;
+            };
+
+            struct LoadedCell {
+                TerrainStorageCell* cell;
+                size_t memory;
+                uint64_t lastUsedFrame;
+            };
+
+            struct FailedLoad {
+                int32_t failureCount = 0;
+                uint64_t retryFrame = 0;
+            };
+
+            void FinishLoads(bool wait);
+
+            void StartLoads(vec3 cameraLocation);
+
+            void MarkUsedCells();
+
+            void Evict(size_t requiredMemory);
+
+            bool IsLoading(TerrainStorageCell* cell) const;
+
+            vec2 GetCellCenter(TerrainStorageCell* cell) const;
+
+            static size_t GetCellMemory(const TerrainStorageCell& cell);
+
+            Terrain* const terrain;
+
+            std::vector<Scope<Load>> loads;
+            std::vector<Request> requests;
+            std::vector<LoadedCell> loadedCells;
+            std::unordered_set<TerrainStorageCell*> usedCells;
+            std::unordered_map<TerrainStorageCell*, FailedLoad> failedLoads;
+
+            size_t memoryUsage = 0;
+            uint64_t frame = 0;
+
+        };
+
+    }
+
+}
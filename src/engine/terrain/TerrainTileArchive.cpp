@@ -0,0 +1,324 @@
+#include "TerrainTileArchive.h"
+
+#include "../Log.h"
+#include "../loader/AssetLoader.h"
+#include "../common/Path.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+namespace Atlas {
+
+    namespace Terrain {
+
+        // Needs to be increased whenever the layout of the tiles changes
+        static constexpr uint32_t archiveVersion = 1;
+        static constexpr uint32_t archiveMagic = 0x54544541; // "AETT"
+
+        // A terrain can't have more than 2^16 nodes
+        static constexpr int32_t maxLoDCount = 16;
+
+        // Bounds the size of decompressed tiles, normal maps are limited to the largest texture size
+        static constexpr int32_t maxTileResolution = 4097;
+        static constexpr int64_t maxNormalResolution = 16384;
+
+        // Tiles start at multiples of this, such that the height fields are aligned
+        static constexpr uint64_t tileAlignment = 16;
+
+        // Runs of equal values are stored as a 16 bit count followed by the value
+        template<typename T>
+        static void EncodeRuns(const uint8_t* src, size_t count, std::vector<uint8_t>& dest) {
+
+            size_t i = 0;
+            while (i < count) {
+                size_t runLength = 1;
+                while (i + runLength < count && runLength < UINT16_MAX &&
+                    std::memcmp(src + i * sizeof(T), src + (i + runLength) * sizeof(T), sizeof(T)) == 0)
+                    runLength++;
+
+                auto offset = dest.size();
+                dest.resize(offset + sizeof(uint16_t) + sizeof(T));
+
+                auto runLength16 = uint16_t(runLength);
+                std::memcpy(dest.data() + offset, &runLength16, sizeof(uint16_t));
+                std::memcpy(dest.data() + offset + sizeof(uint16_t), src + i * sizeof(T), sizeof(T));
+
+                i += runLength;
+            }
+
+        }
+
+        template<typename T>
+        static bool DecodeRuns(const uint8_t*& src, const uint8_t* srcEnd, uint8_t* dest, size_t count) {
+
+            size_t i = 0;
+            while (i < count) {
+                if (size_t(srcEnd - src) < sizeof(uint16_t) + sizeof(T))
+                    return false;
+
+                uint16_t runLength;
+                std::memcpy(&runLength, src, sizeof(uint16_t));
+                if (runLength == 0 || i + runLength > count)
+                    return false;
+
+                auto value = src + sizeof(uint16_t);
+                for (size_t j = 0; j < runLength; j++)
+                    std::memcpy(dest + (i + j) * sizeof(T), value, sizeof(T));
+
+                src += sizeof(uint16_t) + sizeof(T);
+                i += runLength;
+            }
+
+            return true;
+
+        }
+
+        TerrainTileArchive::TerrainTileArchive(const std::string& filename) {
+
+            file = Common::MemoryMappedFile(Loader::AssetLoader::GetFullPath(filename));
+            if (!file.IsValid())
+                return;
+
+            auto data = file.GetData();
+            auto size = file.GetSize();
+
+            bool valid = size >= sizeof(Header);
+            if (valid) {
+                std::memcpy(&header, data, sizeof(Header));
+                valid = header.magic == archiveMagic && header.version == archiveVersion &&
+                    header.rootNodeSideCount > 0 && header.LoDCount > 0 && header.LoDCount <= maxLoDCount &&
+                    header.tileResolution > 0 && header.tileResolution <= maxTileResolution &&
+                    header.tileCount == GetTileCount(header.rootNodeSideCount, header.LoDCount) &&
+                    header.tileCount <= (size - sizeof(Header)) / sizeof(Entry);
+            }
+
+            // Normal maps are baked with at most one texel per vertex of the highest LoD plus a border
+            int64_t tileNormalResolution = 0;
+            if (valid) {
+                tileNormalResolution = std::min(int64_t(header.tileResolution - 1) *
+                    (int64_t(1) << (header.LoDCount - 1)) + 3, maxNormalResolution);
+            }
+
+            // Validating the table once keeps the lookups free of checks
+            auto tableEntries = reinterpret_cast<const Entry*>(data + sizeof(Header));
+            for (uint64_t i = 0; valid && i < header.tileCount; i++) {
+                const auto& entry = tableEntries[i];
+                valid = entry.offset <= size && entry.size <= size - entry.offset &&
+                    entry.normalResolution > 0 && entry.normalResolution <= tileNormalResolution &&
+                    (entry.compression == Compression::RunLength || (entry.compression == Compression::None &&
+                    entry.size == GetTileSize(header.tileResolution, entry.normalResolution)));
+            }
+
+            if (!valid) {
+                Log::Warning("Terrain tile archive " + filename + " is invalid or outdated");
+                file.Unmap();
+                return;
+            }
+
+            entries = tableEntries;
+
+        }
+
+        bool TerrainTileArchive::IsValid() const {
+
+            return entries != nullptr;
+
+        }
+
+        bool TerrainTileArchive::IsCompatible(int32_t rootNodeSideCount, int32_t LoDCount, int32_t tileResolution) const {
+
+            return IsValid() && header.rootNodeSideCount == rootNodeSideCount &&
+                header.LoDCount == LoDCount && header.tileResolution == tileResolution;
+
+        }
+
+        bool TerrainTileArchive::GetTile(int32_t x, int32_t y, int32_t LoD, Tile& tile) const {
+
+            if (!IsValid() || LoD < 0 || LoD >= header.LoDCount)
+                return false;
+
+            auto sideCount = int64_t(header.rootNodeSideCount) << LoD;
+            if (x < 0 || y < 0 || x >= sideCount || y >= sideCount)
+                return false;
+
+            // All tiles of lower LoDs come first: rootNodeCount * (4^LoD - 1) / 3
+            auto rootNodeCount = uint64_t(header.rootNodeSideCount) * uint64_t(header.rootNodeSideCount);
+            auto index = rootNodeCount * (((uint64_t(1) << (2 * LoD)) - 1) / 3) + uint64_t(x * sideCount + y);
+            const auto& entry = entries[index];
+
+            tile.resolution = header.tileResolution;
+            tile.normalResolution = entry.normalResolution;
+
+            auto texelCount = size_t(tile.resolution) * size_t(tile.resolution);
+            auto normalTexelCount = size_t(tile.normalResolution) * size_t(tile.normalResolution);
+
+            const uint8_t* data = file.GetData() + entry.offset;
+            if (entry.compression == Compression::RunLength) {
+                // Reused by every load on this thread, so decompressing doesn't allocate after the first tiles
+                thread_local std::vector<uint8_t> decompressed;
+                decompressed.resize(GetTileSize(tile.resolution, tile.normalResolution));
+
+                auto dest = decompressed.data();
+                auto dataEnd = data + entry.size;
+                auto valid = DecodeRuns<uint16_t>(data, dataEnd, dest, texelCount) &&
+                    DecodeRuns<uint32_t>(data, dataEnd, dest + texelCount * 2, normalTexelCount) &&
+                    DecodeRuns<uint8_t>(data, dataEnd, dest + texelCount * 2 + normalTexelCount * 4, texelCount);
+                if (!valid)
+                    return false;
+
+                data = dest;
+            }
+
+            tile.heightField = data;
+            tile.normalMap = data + texelCount * 2;
+            tile.splatMap = data + texelCount * 2 + normalTexelCount * 4;
+
+            return true;
+
+        }
+
+        bool TerrainTileArchive::Write(const std::string& filename, int32_t rootNodeSideCount, int32_t LoDCount,
+            int32_t tileResolution, const std::function<bool(int32_t, int32_t, int32_t, Tile&)>& getTile,
+            bool compress, const std::function<void()>& beforeReplace) {
+
+            Header header = {
+                .magic = archiveMagic,
+                .version = archiveVersion,
+                .rootNodeSideCount = rootNodeSideCount,
+                .LoDCount = LoDCount,
+                .tileResolution = tileResolution,
+                .reserved = 0,
+                .tileCount = GetTileCount(rootNodeSideCount, LoDCount)
+            };
+
+            std::vector<Entry> table(size_t(header.tileCount));
+
+            // The old archive might still be in use until the new one is complete
+            auto tempFilename = filename + ".tmp";
+            auto fileStream = Loader::AssetLoader::WriteFile(tempFilename, std::ios::out | std::ios::binary);
+            if (!fileStream.is_open()) {
+                Log::Error("Couldn't write terrain tile archive " + filename);
+                return false;
+            }
+
+            // An incomplete archive is never left behind
+            auto removeTempFile = [&]() {
+                fileStream.close();
+                Loader::AssetLoader::RemoveFile(tempFilename);
+            };
+
+            // The table is written last, once all offsets are known
+            fileStream.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+            fileStream.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(Entry));
+
+            auto offset = uint64_t(sizeof(Header) + table.size() * sizeof(Entry));
+            std::vector<uint8_t> compressed;
+
+            size_t tileIdx = 0;
+            for (int32_t LoD = 0; LoD < LoDCount; LoD++) {
+                auto sideCount = rootNodeSideCount << LoD;
+                for (int32_t x = 0; x < sideCount; x++) {
+                    for (int32_t y = 0; y < sideCount; y++) {
+                        Tile tile;
+                        if (!getTile(x, y, LoD, tile) || tile.resolution != tileResolution) {
+                            Log::Error("Missing tile for terrain tile archive " + filename);
+                            removeTempFile();
+                            return false;
+                        }
+
+                        auto texelCount = size_t(tile.resolution) * size_t(tile.resolution);
+                        auto normalTexelCount = size_t(tile.normalResolution) * size_t(tile.normalResolution);
+                        auto tileSize = GetTileSize(tile.resolution, tile.normalResolution);
+
+                        compressed.clear();
+                        if (compress) {
+                            EncodeRuns<uint16_t>(tile.heightField, texelCount, compressed);
+                            EncodeRuns<uint32_t>(tile.normalMap, normalTexelCount, compressed);
+                            EncodeRuns<uint8_t>(tile.splatMap, texelCount, compressed);
+                        }
+
+                        // Only worth it if it saves a decent amount, uncompressed tiles are uploaded without a copy
+                        auto& entry = table[tileIdx++];
+                        auto padding = (tileAlignment - offset % tileAlignment) % tileAlignment;
+                        entry.offset = offset + padding;
+                        entry.normalResolution = tile.normalResolution;
+                        entry.reserved = 0;
+
+                        const char zeros[tileAlignment] = {};
+                        fileStream.write(zeros, std::streamsize(padding));
+
+                        if (compress && compressed.size() < tileSize * 3 / 4) {
+                            entry.size = uint32_t(compressed.size());
+                            entry.compression = Compression::RunLength;
+                            fileStream.write(reinterpret_cast<const char*>(compressed.data()), compressed.size());
+                        }
+                        else {
+                            entry.size = uint32_t(tileSize);
+                            entry.compression = Compression::None;
+                            fileStream.write(reinterpret_cast<const char*>(tile.heightField), texelCount * 2);
+                            fileStream.write(reinterpret_cast<const char*>(tile.normalMap), normalTexelCount * 4);
+                            fileStream.write(reinterpret_cast<const char*>(tile.splatMap), texelCount);
+                        }
+
+                        offset = entry.offset + entry.size;
+                    }
+                }
+            }
+
+            fileStream.seekp(sizeof(Header));
+            fileStream.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(Entry));
+            fileStream.close();
+
+            if (!fileStream) {
+                Log::Error("Couldn't write terrain tile archive " + filename);
+                removeTempFile();
+                return false;
+            }
+
+            if (beforeReplace)
+                beforeReplace();
+
+            std::error_code errorCode;
+            std::filesystem::rename(Loader::AssetLoader::GetFullPath(tempFilename),
+                Loader::AssetLoader::GetFullPath(filename), errorCode);
+            if (errorCode) {
+                Log::Error("Couldn't replace terrain tile archive " + filename + ": " + errorCode.message());
+                removeTempFile();
+                return false;
+            }
+
+            return true;
+
+        }
+
+        std::string TerrainTileArchive::GetFilename(const std::string& terrainFilename) {
+
+            auto directory = Common::Path::GetDirectory(terrainFilename);
+            auto filename = Common::Path::GetFileNameWithoutExtension(terrainFilename) + ".aetiles";
+
+            return directory.empty() ? filename : directory + "/" + filename;
+
+        }
+
+        uint64_t TerrainTileArchive::GetTileCount(int32_t rootNodeSideCount, int32_t LoDCount) {
+
+            auto rootNodeCount = uint64_t(rootNodeSideCount) * uint64_t(rootNodeSideCount);
+            return rootNodeCount * (((uint64_t(1) << (2 * LoDCount)) - 1) / 3);
+
+        }
+
+        size_t TerrainTileArchive::GetTileSize(int32_t resolution, int32_t normalResolution) {
+
+            auto texelCount = size_t(resolution) * size_t(resolution);
+            auto normalTexelCount = size_t(normalResolution) * size_t(normalResolution);
+
+            // Height field (R16), normal map (RGBA8) and splat map (R8)
+            return texelCount * 2 + normalTexelCount * 4 + texelCount;
+
+        }
+
+    }
+
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "../System.h"
+#include "../common/MemoryMappedFile.h"
+
+#include <string>
+#include <functional>
+
+namespace Atlas {
+
+    namespace Terrain {
+
+        /**
+         * Binary container for the tiles of all storage cells of a terrain. The file starts with a header and a
+         * table with one entry per cell, ordered by LoD and then by the cell index of the storage. Each tile holds
+         * the height field (R16), the normal map (RGBA8) and the splat map (R8) in the formats of the textures,
+         * so an uncompressed tile can be uploaded straight from the mapping. Tiles can be run length encoded
+         * individually, which pays off for flat areas and large areas with a single material.
+         */
+        class TerrainTileArchive {
+
+        public:
+            enum class Compression : uint32_t {
+                None = 0,
+                RunLength
+            };
+
+            /**
+             * A tile as it is stored in the archive.
+             * @note The data is only valid as long as the archive is mapped. For compressed tiles it is only
+             * valid until the next call to GetTile() on the same thread.
+             */
+            struct Tile {
+                int32_t resolution = 0;
+                int32_t normalResolution = 0;
+
+                const uint8_t* heightField = nullptr;
+                const uint8_t* normalMap = nullptr;
+                const uint8_t* splatMap = nullptr;
+            };
+
+            TerrainTileArchive() = default;
+
+            /**
+             * Maps a tile archive.
+             * @param filename The filename of the archive relative to the asset directory
+             * @note Check IsValid() afterwards, the archive is invalid if it is missing, damaged or outdated.
+             */
+            explicit TerrainTileArchive(const std::string& filename);
+
+            bool IsValid() const;
+
+            /**
+             * Checks whether the archive contains the tiles of a terrain with the given layout.
+             */
+            bool IsCompatible(int32_t rootNodeSideCount, int32_t LoDCount, int32_t tileResolution) const;
+
+            /**
+             * Finds a tile in the archive. Can be called from any thread.
+             * @param x The x index of the storage cell
+             * @param y The y index of the storage cell
+             * @param LoD The level of detail of the storage cell
+             * @param tile The tile, which points into the archive
+             * @return True if the tile could be read, false otherwise
+             */
+            bool GetTile(int32_t x, int32_t y, int32_t LoD, Tile& tile) const;
+
+            /**
+             * Writes a tile archive. Tiles are requested in the order they are stored in.
+             * @param filename The filename of the archive relative to the asset directory
+             * @param rootNodeSideCount The root node side count of the terrain
+             * @param LoDCount The level of detail count of the terrain
+             * @param tileResolution The resolution of the height field and splat map of each tile
+             * @param getTile Fills the tile for a storage cell, returns false if the tile isn't available
+             * @param compress Whether tiles are compressed where it saves memory
+             * @param beforeReplace Called after all tiles are written and before the existing archive is replaced
+             * @return True if the archive was written, false otherwise
+             * @note The tiles are written to a temporary file first, so the existing archive can be used as a
+             * source of tiles. It must be unmapped at the latest in beforeReplace().
+             */
+            static bool Write(const std::string& filename, int32_t rootNodeSideCount, int32_t LoDCount,
+                int32_t tileResolution, const std::function<bool(int32_t, int32_t, int32_t, Tile&)>& getTile,
+                bool compress = true, const std::function<void()>& beforeReplace = nullptr);
+
+            /**
+             * Returns the filename of the tile archive which belongs to a terrain file.
+             */
+            static std::string GetFilename(const std::string& terrainFilename);
+
+        private:
+            struct Header {
+                uint32_t magic;
+                uint32_t version;
+                int32_t rootNodeSideCount;
+                int32_t LoDCount;
+                int32_t tileResolution;
+                uint32_t reserved;
+                uint64_t tileCount;
+            };
+
+            struct Entry {
+                uint64_t offset;
+                uint32_t size;
+                Compression compression;
+                int32_t normalResolution;
+                uint32_t reserved;
+            };
+
+            static uint64_t GetTileCount(int32_t rootNodeSideCount, int32_t LoDCount);
+
+            static size_t GetTileSize(int32_t resolution, int32_t normalResolution);
+
+            Common::MemoryMappedFile file;
+
+            Header header = {};
+            const Entry* entries = nullptr;
+
+        };
+
+    }
+
+}
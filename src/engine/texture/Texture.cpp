@@ -58,6 +58,13 @@ namespace Atlas {
 
         }
 
+        void Texture::SetData(const void* data) {
+
+            // The image only reads from the data to upload it
+            image->SetData(const_cast<void*>(data), 0, 0, 0, size_t(width), size_t(height), size_t(depth));
+
+        }
+
         void Texture::GenerateMipmap() {
 
             // TODO...
@@ -88,6 +88,12 @@ namespace Atlas {
              */
             void SetData(std::vector<float>& data);
 
+            /**
+             * Sets the data of the texture
+             * @param data The new data, which needs to be in the format of the texture and cover all texels.
+             */
+            void SetData(const void* data);
+
             /**
              * Retrieves the data of the texture from the GPU.
              * @param depth The depth where the data should be retrieved.
@@ -24,73 +24,18 @@ namespace Atlas {
         RayIntersection RayCasting::MouseRayTerrainIntersection(Ref<Viewport> viewport, Ref<Terrain::Terrain> terrain,
             const CameraComponent& camera, vec2 mouseOffset) {
 
-            const float linearStepLength = 1.0f;
-
             auto ray = CalculateRay(viewport, camera, mouseOffset);
 
-            auto distance = linearStepLength;
-
-            vec3 position = ray.origin;
-            vec3 nextPosition;
-
-            while (distance < camera.farPlane) {
-                nextPosition = ray.origin + ray.direction * distance;
-                if (!IsUnderground(position, terrain) && IsUnderground(nextPosition, terrain)) {
-                    return BinarySearch(ray, terrain, distance - linearStepLength, distance, 10);
-                }
-                position = nextPosition;
-                distance += linearStepLength;
-            }
-
             RayIntersection intersection;
-            intersection.hasIntersected = false;
-            intersection.location = vec3(0.0f);
-            intersection.distance = 0.0f;
-            return intersection;
-
-        }
-
-        RayIntersection RayCasting::BinarySearch(Volume::Ray ray, Ref<Terrain::Terrain>& terrain, float start,
-                float finish, int count) {
-
-            float half = start + (finish - start) / 2.0f;
-
-            if (count == 0) {
-                auto position = ray.origin + ray.direction * half;
-                RayIntersection intersection;
-                intersection.location = position;
-                intersection.distance = half;
+            auto result = terrain->Intersect(Volume::Ray(ray.origin, ray.direction, 0.0f, camera.farPlane));
+            if (result.valid) {
+                intersection.location = ray.Get(result.hitDistance);
+                intersection.normal = result.normal;
+                intersection.distance = result.hitDistance;
                 intersection.hasIntersected = true;
-                return intersection;
-            }
-
-            if (IntersectionInRange(ray, terrain, start, half)) {
-                return BinarySearch(ray, terrain, start, half, count - 1);
-            }
-            else {
-                return BinarySearch(ray, terrain, half, finish, count - 1);
-            }
-
-        }
-
-        bool RayCasting::IntersectionInRange(Volume::Ray ray, Ref<Terrain::Terrain>& terrain, float start, float finish) {
-
-            auto startPosition = ray.origin + ray.direction * start;
-            auto finishPosition = ray.origin + ray.direction * finish;
-
-            if (!IsUnderground(startPosition, terrain) && IsUnderground(finishPosition, terrain)) {
-                return true;
             }
 
-            return false;
-
-        }
-
-        bool RayCasting::IsUnderground(vec3 position, Ref<Terrain::Terrain>& terrain) {
-
-            float height = terrain->GetHeight(position.x, position.z);
-
-            return (height > position.y);
+            return intersection;
 
         }
 
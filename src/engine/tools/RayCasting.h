@@ -29,13 +29,6 @@ namespace Atlas {
                 const CameraComponent& camera, vec2 mouseOffset = vec2(0.0f));
 
         private:
-            RayIntersection BinarySearch(Volume::Ray ray, Ref<Terrain::Terrain>& terrain, float start,
-                                         float finish, int count);
-
-            bool IntersectionInRange(Volume::Ray ray, Ref<Terrain::Terrain>& terrain, float start, float finish);
-
-            bool IsUnderground(vec3 position, Ref<Terrain::Terrain>& terrain);
-
             Volume::Ray CalculateRay(const Ref<Viewport>& viewport,
                 const CameraComponent& camera, vec2 mouseOffset);
 
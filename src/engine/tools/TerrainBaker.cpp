@@ -0,0 +1,253 @@
+#include "TerrainBaker.h"
+#include "../jobsystem/JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AE_TERRAIN_SSE
+#include <emmintrin.h>
+#endif
+
+namespace Atlas {
+
+    namespace Tools {
+
+        // Encodes normalize(slopeX, 1, slopeZ) into RGBA8 texels, the same way the bake always did
+        static void EncodeNormals(const float* slopeX, const float* slopeZ, int32_t count, uint8_t* dest) {
+
+            int32_t i = 0;
+#ifdef AE_TERRAIN_SSE
+            auto one = _mm_set1_ps(1.0f);
+            auto half = _mm_set1_ps(0.5f);
+            auto scale = _mm_set1_ps(255.0f);
+            auto alpha = _mm_set1_epi32(int32_t(0xFF000000));
+            for (; i + 4 <= count; i += 4) {
+                auto x = _mm_loadu_ps(slopeX + i);
+                auto z = _mm_loadu_ps(slopeZ + i);
+
+                auto lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), one), _mm_mul_ps(z, z));
+                auto inverseLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSquared));
+
+                auto r = _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(half,
+                    _mm_mul_ps(x, inverseLength)), half), scale));
+                auto g = _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(half,
+                    inverseLength), half), scale));
+                auto b = _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(half,
+                    _mm_mul_ps(z, inverseLength)), half), scale));
+
+                // Four texels with one byte per channel
+                auto texels = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)),
+                    _mm_or_si128(_mm_slli_epi32(b, 16), alpha));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 4 * i), texels);
+            }
+#endif
+            for (; i < count; i++) {
+                auto normal = glm::normalize(vec3(slopeX[i], 1.0f, slopeZ[i]));
+                normal = (0.5f * normal + 0.5f) * 255.0f;
+
+                dest[4 * i] = (uint8_t)normal.x;
+                dest[4 * i + 1] = (uint8_t)normal.y;
+                dest[4 * i + 2] = (uint8_t)normal.z;
+                dest[4 * i + 3] = 255;
+            }
+
+        }
+
+        TerrainBaker::TerrainBaker(int32_t rootNodeSideCount, int32_t LoDCount, int32_t patchSizeFactor,
+            int32_t bakeResolution, float heightScale) : LoDCount(LoDCount), bakeResolution(bakeResolution),
+            heightScale(heightScale) {
+
+            tileResolution = 8 * patchSizeFactor + 1;
+            tileSideCount = rootNodeSideCount << (LoDCount - 1);
+
+            heightData.resize(size_t(tileSideCount) * size_t(tileSideCount), nullptr);
+            splatData.resize(heightData.size(), nullptr);
+
+        }
+
+        void TerrainBaker::SetCell(int32_t x, int32_t y, const float* heightData, const uint8_t* splatData) {
+
+            auto idx = size_t(x) * size_t(tileSideCount) + size_t(y);
+            this->heightData[idx] = heightData;
+            this->splatData[idx] = splatData;
+
+        }
+
+        std::vector<TerrainBaker::Tile> TerrainBaker::Bake() const {
+
+            return Bake(ivec2(0), ivec2(GetResolution() - 1));
+
+        }
+
+        std::vector<TerrainBaker::Tile> TerrainBaker::Bake(ivec2 min, ivec2 max) const {
+
+            std::vector<Tile> tiles;
+
+            min = glm::max(min, ivec2(0));
+            max = glm::min(max, ivec2(GetResolution() - 1));
+            if (min.x > max.x || min.y > max.y)
+                return tiles;
+
+            auto quadCount = tileResolution - 1;
+            for (int32_t LoD = 0; LoD < LoDCount; LoD++) {
+                auto downsample = 1 << (LoDCount - 1 - LoD);
+                auto sideCount = tileSideCount >> (LoDCount - 1 - LoD);
+                auto tileSideLength = quadCount * downsample;
+
+                // Normals depend on the neighbouring texels and are sampled up to one texel outside
+                // of the tile, so the region is extended on all sides
+                auto first = glm::max(min - 1 - downsample, ivec2(0)) / tileSideLength;
+                auto last = glm::min((max + 1 + downsample) / tileSideLength, ivec2(sideCount - 1));
+
+                for (int32_t x = first.x; x <= last.x; x++) {
+                    for (int32_t y = first.y; y <= last.y; y++) {
+                        Tile tile;
+                        tile.x = x;
+                        tile.y = y;
+                        tile.LoD = LoD;
+                        tiles.push_back(std::move(tile));
+                    }
+                }
+            }
+
+            BakeTiles(tiles);
+
+            return tiles;
+
+        }
+
+        int32_t TerrainBaker::GetResolution() const {
+
+            return tileSideCount * (tileResolution - 1) + 1;
+
+        }
+
+        int32_t TerrainBaker::GetTileResolution() const {
+
+            return tileResolution;
+
+        }
+
+        void TerrainBaker::BakeTiles(std::vector<Tile>& tiles) const {
+
+            auto bakeSplatMap = std::all_of(splatData.begin(), splatData.end(),
+                [](const uint8_t* data) { return data != nullptr; });
+
+            JobGroup group { JobPriority::Medium };
+            JobSystem::ExecuteMultiple(group, int32_t(tiles.size()), [&](JobData& data) {
+                BakeTile(tiles[data.idx], bakeSplatMap);
+            });
+
+            JobSystem::Wait(group);
+
+        }
+
+        void TerrainBaker::BakeTile(Tile& tile, bool bakeSplatMap) const {
+
+            auto quadCount = tileResolution - 1;
+            auto downsample = 1 << (LoDCount - 1 - tile.LoD);
+            auto sideCount = tileSideCount >> (LoDCount - 1 - tile.LoD);
+            auto resolution = GetResolution();
+
+            tile.resolution = tileResolution;
+
+            // Heights and splats are point sampled from the highest LoD
+            std::vector<AxisTexel> columns(tileResolution), rows(tileResolution);
+            for (int32_t i = 0; i < tileResolution; i++) {
+                columns[i] = Locate((tile.x * quadCount + i) * downsample);
+                rows[i] = Locate((tile.y * quadCount + i) * downsample);
+            }
+
+            tile.heightField.resize(size_t(tileResolution) * size_t(tileResolution));
+            for (int32_t y = 0; y < tileResolution; y++) {
+                auto dest = tile.heightField.data() + y * tileResolution;
+                for (int32_t x = 0; x < tileResolution; x++)
+                    dest[x] = (uint16_t)(GetHeight(columns[x], rows[y]) * 65535.0f);
+            }
+
+            if (bakeSplatMap) {
+                tile.splatMap.resize(tile.heightField.size());
+                for (int32_t y = 0; y < tileResolution; y++) {
+                    auto dest = tile.splatMap.data() + y * tileResolution;
+                    for (int32_t x = 0; x < tileResolution; x++) {
+                        auto column = columns[x], row = rows[y];
+                        dest[x] = splatData[column.cell * tileSideCount + row.cell][column.texel + row.texel * tileResolution];
+                    }
+                }
+            }
+
+            // We need to keep the normal maps at a higher resolution to make the terrain
+            // look realistic enough when having low triangle count in the distance
+            auto sizeFactor = glm::max(1, glm::min(downsample, bakeResolution / quadCount));
+            auto normalResolution = quadCount * sizeFactor + 3;
+            auto normalDownsample = downsample / sizeFactor;
+
+            // The normals are sampled from a normal map of the whole terrain at the normal resolution,
+            // including a border of one texel, which is clamped at the edges of the terrain
+            auto sampledResolution = normalDownsample == 1 ? resolution : sideCount * (normalResolution - 3) + 1;
+            auto getCoord = [&](int32_t tileCoord, int32_t i) {
+                auto coord = glm::clamp(tileCoord * (normalResolution - 3) + i - 1, 0, sampledResolution - 1);
+                return coord * normalDownsample;
+            };
+
+            struct NormalTexel {
+                AxisTexel previous, center, next;
+            };
+
+            auto locateNormalTexel = [&](int32_t coord) {
+                return NormalTexel {
+                    Locate(glm::max(coord - 1, 0)), Locate(coord), Locate(glm::min(coord + 1, resolution - 1))
+                };
+            };
+
+            std::vector<NormalTexel> normalColumns(normalResolution);
+            for (int32_t i = 0; i < normalResolution; i++)
+                normalColumns[i] = locateNormalTexel(getCoord(tile.x, i));
+
+            std::vector<float> slopeX(normalResolution), slopeZ(normalResolution);
+            tile.normalResolution = normalResolution;
+            tile.normalMap.resize(size_t(normalResolution) * size_t(normalResolution) * 4);
+            for (int32_t y = 0; y < normalResolution; y++) {
+                auto row = locateNormalTexel(getCoord(tile.y, y));
+                for (int32_t x = 0; x < normalResolution; x++) {
+                    const auto& column = normalColumns[x];
+                    slopeX[x] = GetQuantizedHeight(column.previous, row.center) -
+                        GetQuantizedHeight(column.next, row.center);
+                    slopeZ[x] = GetQuantizedHeight(column.center, row.previous) -
+                        GetQuantizedHeight(column.center, row.next);
+                }
+
+                EncodeNormals(slopeX.data(), slopeZ.data(), normalResolution,
+                    tile.normalMap.data() + size_t(y) * size_t(normalResolution) * 4);
+            }
+
+        }
+
+        TerrainBaker::AxisTexel TerrainBaker::Locate(int32_t coord) const {
+
+            // Texels on the edge between two cells are taken from the second one
+            auto quadCount = tileResolution - 1;
+            auto cell = glm::min(coord / quadCount, tileSideCount - 1);
+
+            return AxisTexel { cell, coord - cell * quadCount };
+
+        }
+
+        float TerrainBaker::GetHeight(AxisTexel x, AxisTexel y) const {
+
+            return heightData[x.cell * tileSideCount + y.cell][x.texel + y.texel * tileResolution];
+
+        }
+
+        float TerrainBaker::GetQuantizedHeight(AxisTexel x, AxisTexel y) const {
+
+            // Normals are calculated from the heights as they are stored in the height fields
+            auto height = (uint16_t)(GetHeight(x, y) * 65535.0f);
+            return (float)height / 65535.0f * heightScale;
+
+        }
+
+    }
+
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "../System.h"
+
+#include <vector>
+
+namespace Atlas {
+
+    namespace Tools {
+
+        /**
+         * Bakes the height fields, normal maps and splat maps of all storage cells of a terrain from the
+         * height and splat data of the cells of the highest level of detail. Every tile is baked as an
+         * independent job and reads the source data directly, so there is no need to assemble the whole
+         * terrain in one image first. This is only the CPU side, see TerrainTool for uploading the tiles.
+         */
+        class TerrainBaker {
+
+        public:
+            /**
+             * A baked tile in the formats of the textures of a storage cell.
+             */
+            struct Tile {
+                int32_t x = 0;
+                int32_t y = 0;
+                int32_t LoD = 0;
+
+                int32_t resolution = 0;
+                int32_t normalResolution = 0;
+
+                // R16, RGBA8 and R8. The splat map is empty if the baker has no splat data.
+                std::vector<uint16_t> heightField;
+                std::vector<uint8_t> normalMap;
+                std::vector<uint8_t> splatMap;
+            };
+
+            /**
+             * Constructs a TerrainBaker object for a terrain with the given layout.
+             * @param rootNodeSideCount The root node side count of the terrain
+             * @param LoDCount The level of detail count of the terrain
+             * @param patchSizeFactor The patch size factor of the terrain
+             * @param bakeResolution The maximum resolution of the normal maps, see Terrain::bakeResolution
+             * @param heightScale The height scale of the terrain
+             */
+            TerrainBaker(int32_t rootNodeSideCount, int32_t LoDCount, int32_t patchSizeFactor,
+                int32_t bakeResolution, float heightScale);
+
+            /**
+             * Sets the source data of a cell of the highest level of detail.
+             * @param x The x index of the storage cell
+             * @param y The y index of the storage cell
+             * @param heightData The normalized height data of the cell, see TerrainStorageCell::heightData
+             * @param splatData Optional, the splat map data of the cell
+             * @note The data isn't copied and needs to stay valid while baking. Splat maps are
+             * only baked if the splat data of every cell is set.
+             */
+            void SetCell(int32_t x, int32_t y, const float* heightData, const uint8_t* splatData = nullptr);
+
+            /**
+             * Bakes the tiles of all levels of detail.
+             * @return The baked tiles, ordered by LoD and storage cell index
+             */
+            std::vector<Tile> Bake() const;
+
+            /**
+             * Bakes only the tiles which are affected by changes in a region of the source data.
+             * @param min The minimum texel of the region, in texels of the whole terrain at the highest LoD
+             * @param max The maximum texel of the region, in texels of the whole terrain at the highest LoD
+             * @return The baked tiles, ordered by LoD and storage cell index
+             * @note This includes the tiles of lower levels of detail whose heights or normals are sampled
+             * from the region.
+             */
+            std::vector<Tile> Bake(ivec2 min, ivec2 max) const;
+
+            /**
+             * Returns the number of texels per side of the whole terrain at the highest LoD.
+             */
+            int32_t GetResolution() const;
+
+            /**
+             * Returns the number of height samples per side of each tile.
+             */
+            int32_t GetTileResolution() const;
+
+        private:
+            // The location of a texel along one axis, as the cell index and the texel index in the cell
+            struct AxisTexel {
+                int32_t cell;
+                int32_t texel;
+            };
+
+            void BakeTiles(std::vector<Tile>& tiles) const;
+
+            void BakeTile(Tile& tile, bool bakeSplatMap) const;
+
+            AxisTexel Locate(int32_t coord) const;
+
+            float GetHeight(AxisTexel x, AxisTexel y) const;
+
+            float GetQuantizedHeight(AxisTexel x, AxisTexel y) const;
+
+            int32_t LoDCount;
+            int32_t tileResolution;
+            int32_t tileSideCount;
+            int32_t bakeResolution;
+            float heightScale;
+
+            std::vector<const float*> heightData;
+            std::vector<const uint8_t*> splatData;
+
+        };
+
+    }
+
+}
@@ -2,6 +2,7 @@
 #include "../loader/AssetLoader.h"
 #include "../loader/ImageLoader.h"
 #include "../Log.h"
+#include "../jobsystem/JobSystem.h"
 
 #include <stb_image_resize.h>
 
@@ -48,53 +49,37 @@ namespace Atlas {
             tileResolution += 1;
             int32_t tileResolutionSquared = tileResolution * tileResolution;
 
-            std::vector<uint16_t> cellHeightData(tileResolutionSquared);
-            std::vector<uint8_t> cellSplatData(tileResolutionSquared);
+            // The splat map is empty, every cell can use the same data
+            std::vector<uint8_t> cellSplatData(tileResolutionSquared, 0);
 
-            for (size_t i = 0; i < cellSplatData.size(); i++)
-                cellSplatData[i] = 0;
-
-            // i is in x direction, j in y direction
-            for (int32_t i = 0; i < maxNodesPerSide; i++) {
-                for (int32_t j = 0; j < maxNodesPerSide; j++) {
-                    auto cell = terrain->storage.GetCell(i, j, LoDCount - 1);
-
-                    /*
-                    // Create the data structures for the cell
-                    cell->heightData.resize(tileResolutionSquared);
-                    cell->heightField = new Texture::Texture2D(tileResolution, 
-                        tileResolution, AE_R16UI, GL_CLAMP_TO_EDGE, GL_NEAREST, false, false);
-                    cell->normalMap = new Texture::Texture2D(tileResolution, 
-                        tileResolution, AE_RGB8, GL_CLAMP_TO_EDGE, GL_LINEAR, false, false);
-                    cell->splatMap = new Texture::Texture2D(tileResolution,
-                        tileResolution, AE_R8UI, GL_CLAMP_TO_EDGE, GL_NEAREST, false, false);
-                     */
-
-                    // Now copy a tile of the original image
-                    // We make sure that every tile has the same size
-                    // We also increased resolution to make sure that
-                    // adjacent cells connect to each other
-                    for (int32_t y = 0; y < tileResolution; y++) {
-                        for (int32_t x = 0; x < tileResolution; x++) {
-                            int32_t cellOffset = y * tileResolution + x;
-                            int32_t xImage = i * (tileResolution - 1) + x;
-                            int32_t yImage = j * (tileResolution - 1) + y;
-
-                            auto sample = (uint16_t)heightMap.Sample(xImage, yImage).r;
-                            
-                            cell->heightData[cellOffset] = (float)sample / 65535.0f;
-                            cellHeightData[cellOffset] = sample;
-
-                        }
+            // Every cell copies its own tile of the original image. We increased the
+            // resolution to make sure that adjacent cells connect to each other.
+            JobGroup group { JobPriority::Medium };
+            JobSystem::ExecuteMultiple(group, maxNodesPerSide * maxNodesPerSide, [&](JobData& data) {
+                // i is in x direction, j in y direction
+                auto i = data.idx / maxNodesPerSide;
+                auto j = data.idx % maxNodesPerSide;
+                auto cell = terrain->storage.GetCell(i, j, LoDCount - 1);
+
+                cell->heightData.resize(tileResolutionSquared);
+                for (int32_t y = 0; y < tileResolution; y++) {
+                    for (int32_t x = 0; x < tileResolution; x++) {
+                        int32_t cellOffset = y * tileResolution + x;
+                        int32_t xImage = i * (tileResolution - 1) + x;
+                        int32_t yImage = j * (tileResolution - 1) + y;
+
+                        auto sample = (uint16_t)heightMap.Sample(xImage, yImage).r;
+                        cell->heightData[cellOffset] = (float)sample / 65535.0f;
                     }
+                }
 
-                    cell->heightField.SetData(cellHeightData);
-                    cell->splatMap.SetData(cellSplatData);
+                cell->UpdateHeightBounds();
+            });
 
-                }
-            }
+            JobSystem::Wait(group);
 
-            BakeTerrain(terrain);
+            std::vector<const uint8_t*> splatData(maxNodesPerSide * maxNodesPerSide, cellSplatData.data());
+            BakeTerrain(terrain, splatData);
 
             return terrain;
 
@@ -145,52 +130,43 @@ namespace Atlas {
             tileResolution += 1;
             int32_t tileResolutionSquared = tileResolution * tileResolution;
 
-            std::vector<uint16_t> cellHeightData(tileResolutionSquared);
-            std::vector<uint8_t> cellSplatData(tileResolutionSquared);
-
-            // i is in x direction, j in y direction
-            for (int32_t i = 0; i < maxNodesPerSide; i++) {
-                for (int32_t j = 0; j < maxNodesPerSide; j++) {
-                    auto cell = terrain->storage.GetCell(i, j, LoDCount - 1);
-
-                    /*
-                    // Create the data structures for the cell
-                    cell->heightData.resize(tileResolutionSquared);
-                    cell->heightField = new Texture::Texture2D(tileResolution,
-                        tileResolution, AE_R16UI, GL_CLAMP_TO_EDGE, GL_NEAREST, false, false);
-                    cell->normalMap = new Texture::Texture2D(tileResolution,
-                        tileResolution, AE_RGB8, GL_CLAMP_TO_EDGE, GL_LINEAR, false, false);
-                    cell->splatMap = new Texture::Texture2D(tileResolution,
-                        tileResolution, AE_R8UI, GL_CLAMP_TO_EDGE, GL_NEAREST, false, false);
-                    */
+            std::vector<std::vector<uint8_t>> cellSplatData(maxNodesPerSide * maxNodesPerSide);
 
-                    // Now copy a tile of the original image
-                    // We make sure that every tile has the same size
-                    // We also increased resolution to make sure that
-                    // adjacent cells connect to each other
-                    for (int32_t y = 0; y < tileResolution; y++) {
-                        for (int32_t x = 0; x < tileResolution; x++) {
-                            int32_t cellOffset = y * tileResolution + x;
-                            int32_t xImage = i * (tileResolution - 1) + x;
-                            int32_t yImage = j * (tileResolution - 1) + y;
-
-                            auto height = (uint16_t)heightMap.Sample(xImage, yImage).r;
-                            auto splat = (uint8_t)splatMap.Sample(xImage, yImage).r;
-
-                            cell->heightData[cellOffset] = (float)height / 65535.0f;
-                            cellHeightData[cellOffset] = height;
-                            cellSplatData[cellOffset] = splat;
-
-                        }
+            // Every cell copies its own tile of the original images. We increased the
+            // resolution to make sure that adjacent cells connect to each other.
+            JobGroup group { JobPriority::Medium };
+            JobSystem::ExecuteMultiple(group, maxNodesPerSide * maxNodesPerSide, [&](JobData& data) {
+                // i is in x direction, j in y direction
+                auto i = data.idx / maxNodesPerSide;
+                auto j = data.idx % maxNodesPerSide;
+                auto cell = terrain->storage.GetCell(i, j, LoDCount - 1);
+
+                auto& splatData = cellSplatData[data.idx];
+                splatData.resize(tileResolutionSquared);
+                cell->heightData.resize(tileResolutionSquared);
+                for (int32_t y = 0; y < tileResolution; y++) {
+                    for (int32_t x = 0; x < tileResolution; x++) {
+                        int32_t cellOffset = y * tileResolution + x;
+                        int32_t xImage = i * (tileResolution - 1) + x;
+                        int32_t yImage = j * (tileResolution - 1) + y;
+
+                        auto height = (uint16_t)heightMap.Sample(xImage, yImage).r;
+                        auto splat = (uint8_t)splatMap.Sample(xImage, yImage).r;
+
+                        cell->heightData[cellOffset] = (float)height / 65535.0f;
+                        splatData[cellOffset] = splat;
                     }
+                }
 
-                    cell->heightField.SetData(cellHeightData);
-                    cell->splatMap.SetData(cellSplatData);
+                cell->UpdateHeightBounds();
+            });
 
-                }
-            }
+            JobSystem::Wait(group);
 
-            BakeTerrain(terrain);
+            std::vector<const uint8_t*> splatData;
+            for (const auto& data : cellSplatData)
+                splatData.push_back(data.data());
+            BakeTerrain(terrain, splatData);
 
             return terrain;
 
@@ -198,197 +174,21 @@ namespace Atlas {
 
         void TerrainTool::BakeTerrain(Terrain::Terrain *terrain) {
 
-            // Generate one large heightmap (assumes all tiles have the same size)
-            int32_t tileResolution = 8 * terrain->patchSizeFactor;
-            int32_t tileResolutionSquared = tileResolution * tileResolution;
-            int32_t tileCount = terrain->storage.GetCellCount(terrain->LoDCount - 1);
-
-            int32_t tileSideCount = (int32_t)sqrtf((float)tileCount);
-
-            auto heightData = std::vector<uint16_t>((tileSideCount * tileResolution + 1)
-                * (tileSideCount * tileResolution + 1));
-            auto splatData = std::vector<uint8_t>(heightData.size());
-
-            int32_t heightDataResolution = (int32_t)sqrtf((float)heightData.size());            
-
-            // i is in x direction, j in z direction
-            for (int32_t i = 0; i < tileSideCount; i++) {
-                for (int32_t j = 0; j < tileSideCount; j++) {
-                    auto cell = terrain->storage.GetCell(i, j, terrain->LoDCount - 1);
-                    auto cellSplatData = cell->splatMap.GetData<uint8_t>();
-
-                    // Now copy a tile of the original image
-                    // We make sure that every tile has the same size
-                    // We also increased resolution to make sure that
-                    // adjacent cells connect to each other
-                    for (int32_t y = 0; y <= tileResolution; y++) {
-                        for (int32_t x = 0; x <= tileResolution; x++) {
-                            int32_t cellOffset = y * (tileResolution + 1) + x;
-                            int32_t imageOffset = (j * tileResolution + y) * heightDataResolution +
-                                                  i * tileResolution + x;
-                            heightData[imageOffset] = (uint16_t)(cell->heightData[cellOffset] * 65535.0f);
-                            splatData[imageOffset] = cellSplatData[cellOffset];    
-                        }
-                    }
-                }
-            }
-
-            tileResolution += 1;
-
-            // Calculate the normals
-            auto normalData = std::vector<uint8_t>(heightData.size() * 3);
-
-            GenerateNormalData(heightData, normalData, heightDataResolution,
-                heightDataResolution, terrain->heightScale);
-
-            // Iterate through all the LoD level and resize images according to the tile size
-            std::vector<uint16_t> tileHeightData(tileResolution * tileResolution);
-            std::vector<uint8_t> tileSplatData(tileHeightData.size() * 4);
-
-            auto currentResolution = heightDataResolution;
-
-            for (int32_t k = 0; k < terrain->LoDCount; k++) {
-
-                int32_t Lod = terrain->LoDCount - k - 1;
-
-                int32_t downsample = (int32_t)powf(2.0f, (float)k);
-                int32_t tileSideCountLod = tileSideCount / downsample;
-
-                std::vector<uint16_t> resizedHeightData(currentResolution * currentResolution);                
-                std::vector<uint8_t> resizedSplatData(resizedHeightData.size() * 4);
-
-                auto resizedHeightDataResolution = (int32_t)sqrtf((float)resizedHeightData.size());
-
-                if (k == 0) {
-                    resizedHeightData = heightData;                    
-                    resizedSplatData = splatData;
-                }
-                else {
-                    // Downsample data (we need to do it manually here)
-
-                    for (int32_t y = 0; y < currentResolution; y++) {
-                        for (int32_t x = 0; x < currentResolution; x++) {
-                            auto offset0 = ivec2(x, y);
-                            auto offset1 = ivec2(x, y) * downsample;
-                            auto index0 = offset0.y * currentResolution + offset0.x;
-                            auto index1 = offset1.y * heightDataResolution + offset1.x;
-                            resizedHeightData[index0] = heightData[index1];
-                            resizedSplatData[index0] = splatData[index1];
-                        }
-                    }
-
-                }
-
-                //Common::Image8 img(resizedHeightDataResolution, resizedHeightDataResolution, 4);
-                //img.SetData(resizedSplatData);
-
-                //Loader::ImageLoader::SaveImage(img, "splat" + std::to_string(k) + ".png");
-
-                // We need to keep the normal maps at a higher resolution to make the terrain
-                // look realistic enough when having low triangle count in the distance
-                auto sizeFactor = glm::min(downsample, terrain->bakeResolution / (tileResolution - 1));
-                auto normalDataResolution = (tileResolution - 1) * sizeFactor + 3;
-
-                std::vector<uint8_t> tileNormalData(normalDataResolution * 
-                    normalDataResolution * 3);
-
-                auto resizedNormalDataResolution = 0;
-                Common::Image<uint8_t> resizedNormalMap;
-
-                downsample /= sizeFactor;
-
-                if (downsample == 1) {
-                    resizedNormalMap = Common::Image<uint8_t>(heightDataResolution,
-                        heightDataResolution, 3);
-                    resizedNormalMap.SetData(normalData);
-                    resizedNormalDataResolution = heightDataResolution;
-                }
-                else {
-                    resizedNormalDataResolution = tileSideCountLod * (normalDataResolution - 3) + 1;
-                    resizedNormalMap = Common::Image<uint8_t>(resizedNormalDataResolution,
-                        resizedNormalDataResolution, 3);
-                    for (int32_t y = 0; y < resizedNormalDataResolution; y++) {
-                        for (int32_t x = 0; x < resizedNormalDataResolution; x++) {
-                            auto offset1 = ivec2(x, y) * downsample;
-                            auto index1 = offset1.y * heightDataResolution + offset1.x;
-                            resizedNormalMap.SetData(x, y, 0, normalData[index1 * 3]);
-                            resizedNormalMap.SetData(x, y, 1, normalData[index1 * 3 + 1]);
-                            resizedNormalMap.SetData(x, y, 2, normalData[index1 * 3 + 2]);
-                        }
-                    }
-                }
-
-                // i is in x direction, j in y direction
-                for (int32_t i = 0; i < tileSideCountLod; i++) {
-                    for (int32_t j = 0; j < tileSideCountLod; j++) {
-                        auto cell = terrain->storage.GetCell(i, j, Lod);
-
-                        // Now copy a tile of the original image
-                        // We make sure that every tile has the same size
-                        // We also increased resolution to make sure that
-                        // adjacent cells connect to each other
-                        for (int32_t y = 0; y < tileResolution; y++) {
-                            for (int32_t x = 0; x < tileResolution; x++) {
-                                int32_t cellOffset = y * tileResolution + x;
-                                int32_t xImage = i * (tileResolution - 1) + x;
-                                int32_t yImage = j * (tileResolution - 1) + y;
-                                int32_t totalResolution = currentResolution;
-
-                                auto imageOffset = yImage * totalResolution + xImage;
-
-                                tileHeightData[cellOffset] = resizedHeightData[imageOffset];
-                                tileSplatData[cellOffset] = resizedSplatData[imageOffset];
-                            }
-                        }
-                        
-                        for (int32_t y = -1; y < normalDataResolution - 1; y++) {
-                            for (int32_t x = -1; x < normalDataResolution - 1; x++) {
-
-                                int32_t cellOffset = (y + 1) * normalDataResolution + x + 1;
-                                int32_t xImage = i * (normalDataResolution - 3) + x;
-                                int32_t yImage = j * (normalDataResolution - 3) + y;
-                                
-                                auto sample = resizedNormalMap.Sample(xImage, yImage);
-
-                                tileNormalData[cellOffset * 3] = (uint8_t)sample.r;
-                                tileNormalData[cellOffset * 3 + 1] = (uint8_t)sample.g;
-                                tileNormalData[cellOffset * 3 + 2] = (uint8_t)sample.b;
-                            }
-                        }
-
-                        /*
-                        if (!cell->heightField) {
-                            cell->heightField = new Texture::Texture2D(tileResolution,
-                                tileResolution, AE_R16UI, GL_CLAMP_TO_EDGE, GL_NEAREST, false, false);
-                        }
-                        if (!cell->normalMap) {
-                            cell->normalMap = new Texture::Texture2D(normalDataResolution,
-                                normalDataResolution, AE_RGB8, GL_CLAMP_TO_EDGE, GL_LINEAR, true, true);
-                        }
-                        if (!cell->splatMap) {
-                            cell->splatMap = new Texture::Texture2D(tileResolution,
-                                tileResolution, AE_R8UI, GL_CLAMP_TO_EDGE, GL_NEAREST, false, false);
-                        }
-
-                        if (cell->normalMap->width != normalDataResolution ||
-                            cell->normalMap->height != normalDataResolution) {
-                            delete cell->normalMap;
-                            cell->normalMap = new Texture::Texture2D(normalDataResolution,
-                                normalDataResolution, AE_RGB8, GL_CLAMP_TO_EDGE, GL_LINEAR, true, true);
-                        }
-                        */
-                        
-                        cell->normalMap.SetData(tileNormalData);
-                        cell->heightField.SetData(tileHeightData);
-                        cell->splatMap.SetData(tileSplatData);
-
-                    }
-                }
-
-                currentResolution = (currentResolution - 1) / 2 + 1;
-
+            int32_t LoD = terrain->LoDCount - 1;
+            int32_t cellCount = terrain->storage.GetCellCount(LoD);
+            int32_t cellSideCount = (int32_t)sqrtf((float)cellCount);
+
+            // The splat maps are only stored in the textures
+            std::vector<std::vector<uint8_t>> cellSplatData(cellCount);
+            std::vector<const uint8_t*> splatData(cellCount);
+            for (int32_t i = 0; i < cellCount; i++) {
+                auto cell = terrain->storage.GetCell(i / cellSideCount, i % cellSideCount, LoD);
+                if (cell->splatMap.IsValid())
+                    cellSplatData[i] = cell->splatMap.GetData<uint8_t>();
+                splatData[i] = cellSplatData[i].empty() ? nullptr : cellSplatData[i].data();
             }
 
+            BakeTerrain(terrain, splatData);
 
         }
 
@@ -464,6 +264,9 @@ namespace Atlas {
 
             filter->Get(&weights, &offsets);
 
+            // The region which was changed, in texels relative to the upper left cell
+            auto changedMin = ivec2(x, y), changedMax = ivec2(x, y);
+
             for (uint32_t i = 0; i < uint32_t(weights.size()); i++) {
                 for (uint32_t j = 0; j < uint32_t(weights.size()); j++) {
                     int32_t xTranslated = x + offsets[i][j].x;
@@ -471,15 +274,18 @@ namespace Atlas {
                     int32_t index = yTranslated * width * 3 + xTranslated;
                     float value = data[index] + scale * weights[i][j] / terrain->heightScale;
                     data[index] = glm::clamp(value, 0.0f, 1.0f);
+
+                    changedMin = glm::min(changedMin, ivec2(xTranslated, yTranslated));
+                    changedMax = glm::max(changedMax, ivec2(xTranslated, yTranslated));
                 }
             }
 
+            auto cellOrigin = ivec2(middleMiddle->x - 1, middleMiddle->y - 1) * ivec2(width, height);
+
             width += 1;
             height += 1;
 
-            std::vector<uint16_t> cellHeightData(width * height);
-
-            // Split the data up and update the height fields
+            // Split the data up and update the height data
             for (int32_t i = 0; i < 3; i++) {
                 for (int32_t j = 0; j < 3; j++) {
 
@@ -507,16 +313,14 @@ namespace Atlas {
                         }
                     }
 
-                    for (uint32_t k = 0; k < uint32_t(cellHeightData.size()); k++) {
-                        cellHeightData[k] = (uint16_t)(cell->heightData[k] * 65535.0f);
-                    }
-
-                    cell->heightField.SetData(cellHeightData);
+                    cell->UpdateHeightBounds();
 
                 }
 
             }
 
+            BakeTerrainRegion(terrain, cellOrigin + changedMin, cellOrigin + changedMax);
+
         }
 
         void TerrainTool::SmoothHeight(Terrain::Terrain *terrain, int32_t size, int32_t contributingRadius,
@@ -593,6 +397,10 @@ namespace Atlas {
 
             int32_t sizeRadius = (size - 1) / 2;
 
+            // The region which was changed, in texels relative to the upper left cell
+            auto changedMin = ivec2(x, y) - sizeRadius, changedMax = ivec2(x, y) + sizeRadius;
+            auto cellOrigin = ivec2(middleMiddle->x - 1, middleMiddle->y - 1) * ivec2(width, height);
+
             for (int32_t i = -sizeRadius; i <= sizeRadius; i++) {
                 for (int32_t j = -sizeRadius; j <= sizeRadius; j++) {
                     float sum = 0.0f;
@@ -626,9 +434,7 @@ namespace Atlas {
             width += 1;
             height += 1;
 
-            std::vector<uint16_t> cellHeightData(width * height);
-
-            // Split the data up and update the height fields
+            // Split the data up and update the height data
             for (int32_t i = 0; i < 3; i++) {
                 for (int32_t j = 0; j < 3; j++) {
 
@@ -656,15 +462,13 @@ namespace Atlas {
                         }
                     }
 
-                    for (uint32_t k = 0; k < uint32_t(cellHeightData.size()); k++) {
-                        cellHeightData[k] = (uint16_t)(cell->heightData[k] * 65535.0f);
-                    }
-
-                    cell->heightField.SetData(cellHeightData);
+                    cell->UpdateHeightBounds();
 
                 }
             }
 
+            BakeTerrainRegion(terrain, cellOrigin + changedMin, cellOrigin + changedMax);
+
         }
 
         void TerrainTool::BrushMaterial(Terrain::Terrain* terrain, vec2 position, float size, int32_t slot) {
@@ -901,41 +705,82 @@ namespace Atlas {
 
         }
 
-        void TerrainTool::GenerateNormalData(std::vector<uint16_t>& heightData, std::vector<uint8_t>& normalData, int32_t width, int32_t height, float scale) {
+        void TerrainTool::BakeTerrain(Terrain::Terrain* terrain, const std::vector<const uint8_t*>& splatData) {
 
-            int32_t dataWidth = (int32_t)sqrtf((float)heightData.size());
+            TerrainBaker baker(terrain->rootNodeSideCount, terrain->LoDCount, terrain->patchSizeFactor,
+                terrain->bakeResolution, terrain->heightScale);
+            if (!SetHeightData(terrain, baker))
+                return;
+
+            auto cells = terrain->storage.GetCell(0, 0, terrain->LoDCount - 1);
+            for (size_t i = 0; i < splatData.size(); i++)
+                baker.SetCell(cells[i].x, cells[i].y, cells[i].heightData.data(), splatData[i]);
+
+            auto tiles = baker.Bake();
+            UploadTiles(terrain, tiles);
+
+        }
 
-            for (int32_t x = 0; x < dataWidth; x++) {
-                for (int32_t y = 0; y < dataWidth; y++) {
+        void TerrainTool::BakeTerrainRegion(Terrain::Terrain* terrain, ivec2 min, ivec2 max) {
 
-                    float heightL = GetHeight(heightData, dataWidth, x - 1, y, width, height) * scale;
-                    float heightR = GetHeight(heightData, dataWidth, x + 1, y, width, height) * scale;
-                    float heightD = GetHeight(heightData, dataWidth, x, y - 1, width, height) * scale;
-                    float heightU = GetHeight(heightData, dataWidth, x, y + 1, width, height) * scale;
+            TerrainBaker baker(terrain->rootNodeSideCount, terrain->LoDCount, terrain->patchSizeFactor,
+                terrain->bakeResolution, terrain->heightScale);
+            if (!SetHeightData(terrain, baker))
+                return;
 
-                    auto normal = glm::normalize(glm::vec3(heightL - heightR, 1.0f, 
-                        heightD - heightU));
+            auto tiles = baker.Bake(min, max);
+            UploadTiles(terrain, tiles);
 
-                    normal = (0.5f * normal + 0.5f) * 255.0f;
+        }
 
-                    normalData[3 * y * dataWidth + 3 * x] = (uint8_t)normal.x;
-                    normalData[3 * y * dataWidth + 3 * x + 1] = (uint8_t)normal.y;
-                    normalData[3 * y * dataWidth + 3 * x + 2] = (uint8_t)normal.z;
+        bool TerrainTool::SetHeightData(Terrain::Terrain* terrain, TerrainBaker& baker) {
 
+            int32_t LoD = terrain->LoDCount - 1;
+            int32_t cellCount = terrain->storage.GetCellCount(LoD);
+            auto tileResolution = baker.GetTileResolution();
+
+            // Cells of the highest LoD are stored one after another
+            auto cells = terrain->storage.GetCell(0, 0, LoD);
+            for (int32_t i = 0; i < cellCount; i++) {
+                auto cell = &cells[i];
+                if (cell->heightData.size() != size_t(tileResolution * tileResolution)) {
+                    Log::Warning("Couldn't bake terrain, the height data of all cells of the highest LoD needs to be loaded");
+                    return false;
                 }
+                baker.SetCell(cell->x, cell->y, cell->heightData.data());
             }
 
+            return true;
+
         }
 
-        float TerrainTool::GetHeight(std::vector<uint16_t>& heightData, int32_t dataWidth,
-                                     int32_t x, int32_t y, int32_t width, int32_t height) {
+        void TerrainTool::UploadTiles(Terrain::Terrain* terrain, std::vector<TerrainBaker::Tile>& tiles) {
+
+            // Same formats as the loaded cells, see TerrainLoader
+            for (auto& tile : tiles) {
+                auto cell = terrain->storage.GetCell(tile.x, tile.y, tile.LoD);
+
+                if (!cell->heightField.IsValid() || cell->heightField.width != tile.resolution) {
+                    cell->heightField = Texture::Texture2D(tile.resolution, tile.resolution,
+                        VK_FORMAT_R16_UINT, Texture::Wrapping::ClampToEdge, Texture::Filtering::Nearest);
+                }
+                cell->heightField.SetData(tile.heightField);
+
+                if (!cell->normalMap.IsValid() || cell->normalMap.width != tile.normalResolution) {
+                    cell->normalMap = Texture::Texture2D(tile.normalResolution, tile.normalResolution,
+                        VK_FORMAT_R8G8B8A8_UNORM, Texture::Wrapping::ClampToEdge, Texture::Filtering::Anisotropic);
+                }
+                cell->normalMap.SetData(tile.normalMap);
 
-            x = x < 0 ? 0 : x;
-            x = x >= width ? width - 1 : x;
-            y = y < 0 ? 0 : y;
-            y = y >= height ? height - 1 : y;
+                if (tile.splatMap.empty())
+                    continue;
 
-            return (float)heightData[y * dataWidth + x] / 65535.0f;
+                if (!cell->splatMap.IsValid() || cell->splatMap.width != tile.resolution) {
+                    cell->splatMap = Texture::Texture2D(tile.resolution, tile.resolution,
+                        VK_FORMAT_R8_UINT, Texture::Wrapping::ClampToEdge, Texture::Filtering::Nearest);
+                }
+                cell->splatMap.SetData(tile.splatMap);
+            }
 
         }
 
@@ -4,6 +4,7 @@
 #include "../terrain/Terrain.h"
 #include "../common/Image.h"
 #include "../Filter.h"
+#include "TerrainBaker.h"
 
 namespace Atlas {
 
@@ -37,6 +38,7 @@ namespace Atlas {
              * @param terrain
              * @warning All storage cells of the terrain and their heightData member must be loaded.
              * It is assumed that all cells have textures of the same resolution.
+             * @note The tiles of all LoDs are baked in parallel on the job system.
              */
             static void BakeTerrain(Terrain::Terrain* terrain);
 
@@ -48,7 +50,8 @@ namespace Atlas {
              * @param position
              * @warning All max LoD storage cells of the terrain and their heightData member
              * must be loaded. It is assumed that all cells have textures of the same resolution.
-             * @note The kernel size needs to be smaller than 2 times the edge of a cell
+             * @note The kernel size needs to be smaller than 2 times the edge of a cell.
+             * Only the tiles of the cells and their lower LoDs which were touched are baked again.
              */
             static void BrushHeight(Terrain::Terrain* terrain, Filter* filter, float strength, vec2 position);
 
@@ -69,11 +72,13 @@ namespace Atlas {
             static Texture::Texture2D GenerateTerrainOceanMap(Terrain::Terrain* terrain, float oceanHeight, int32_t resolution);
 
         private:
-            static void GenerateNormalData(std::vector<uint16_t>& heightData, std::vector<uint8_t>& normalData,
-                                           int32_t width, int32_t height, float strength);
+            static void BakeTerrain(Terrain::Terrain* terrain, const std::vector<const uint8_t*>& splatData);
 
-            static float GetHeight(std::vector<uint16_t>& heightData, int32_t dataWidth,
-                    int32_t x, int32_t y, int32_t width, int32_t height);
+            static void BakeTerrainRegion(Terrain::Terrain* terrain, ivec2 min, ivec2 max);
+
+            static bool SetHeightData(Terrain::Terrain* terrain, TerrainBaker& baker);
+
+            static void UploadTiles(Terrain::Terrain* terrain, std::vector<TerrainBaker::Tile>& tiles);
 
         };
 
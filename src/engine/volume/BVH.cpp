@@ -2,6 +2,7 @@
 // https://www.nvidia.in/docs/IO/77714/sbvh.pdf
 #include <numeric>
 #include <future>
+#include <bit>
 
 #include "BVH.h"
 #include "Log.h"
@@ -11,7 +12,8 @@ namespace Atlas {
 
     namespace Volume {
 
-        BVH::BVH(const std::vector<AABB>& aabbs, const std::vector<BVHTriangle>& data, bool parallelBuild) {
+        BVH::BVH(const std::vector<AABB>& aabbs, const std::vector<BVHTriangle>& data, bool parallelBuild,
+            BVHBuildMode buildMode) {
 
             Tools::PerformanceCounter perfCounter;
 
@@ -24,22 +26,31 @@ namespace Atlas {
                 refs[i].aabb = aabbs[i];
             }
 
-            // Calculate initial aabb of root
-            AABB aabb(glm::vec3(std::numeric_limits<float>::max()),
-                glm::vec3(-std::numeric_limits<float>::max()));
-            for (auto& ref : refs)
-                aabb.Grow(aabbs[ref.idx]);
+            if (buildMode == BVHBuildMode::SAH) {
+                // Calculate initial aabb of root
+                AABB aabb(glm::vec3(std::numeric_limits<float>::max()),
+                    glm::vec3(-std::numeric_limits<float>::max()));
+                for (auto& ref : refs)
+                    aabb.Grow(aabbs[ref.idx]);
 
-            auto minOverlap = aabb.GetSurfaceArea() * 10e-6f;
-            auto builder = new BVHBuilder(aabb, 0, refs.size(), minOverlap, 256);
+                auto minOverlap = aabb.GetSurfaceArea() * 10e-6f;
+                auto builder = new BVHBuilder(aabb, 0, refs.size(), minOverlap, 256);
 
-            JobGroup group { JobPriority::Low };
-            builder->Build(refs, data, group, parallelBuild);
-            JobSystem::Wait(group);
+                JobGroup group { JobPriority::Low };
+                builder->Build(refs, data, group, parallelBuild);
+                JobSystem::Wait(group);
 
-            refs.reserve(data.size());
+                refs.reserve(data.size());
 
-            builder->Flatten(nodes, refs);
+                builder->Flatten(nodes, refs);
+
+                delete builder;
+            }
+            else {
+                // Linear builds don't split triangles, so leaves contain up to two triangles like the SAH build
+                LinearBVHBuilder builder(2, buildMode == BVHBuildMode::LinearOptimized, JobPriority::Low);
+                builder.Build(refs, nodes, parallelBuild);
+            }
 
             this->aabbs.resize(refs.size());
             this->data.resize(refs.size());
@@ -51,11 +62,9 @@ namespace Atlas {
                 this->data[i].endOfNode = ref.endOfNode;
             }
 
-            delete builder;
-
         }
 
-        BVH::BVH(const std::vector<AABB>& aabbs, bool parallelBuild) {
+        BVH::BVH(const std::vector<AABB>& aabbs, bool parallelBuild, BVHBuildMode buildMode) {
 
             refs.resize(aabbs.size());
             for (size_t i = 0; i < refs.size(); i++) {
@@ -63,31 +72,40 @@ namespace Atlas {
                 refs[i].aabb = aabbs[i];
             }
 
-            // Calculate initial aabb of root
-            AABB aabb(glm::vec3(std::numeric_limits<float>::max()),
-                glm::vec3(-std::numeric_limits<float>::max()));
-            for (auto& ref : refs)
-                aabb.Grow(aabbs[ref.idx]);
+            if (buildMode == BVHBuildMode::SAH) {
+                // Calculate initial aabb of root
+                AABB aabb(glm::vec3(std::numeric_limits<float>::max()),
+                    glm::vec3(-std::numeric_limits<float>::max()));
+                for (auto& ref : refs)
+                    aabb.Grow(aabbs[ref.idx]);
 
-            auto builder = new BVHBuilder(aabb, 0, refs.size(), 64);
+                auto builder = new BVHBuilder(aabb, 0, refs.size(), 64);
 
-            JobGroup group { JobPriority::Medium };
-            builder->Build(refs, group, parallelBuild);
-            JobSystem::Wait(group);
+                JobGroup group { JobPriority::Medium };
+                builder->Build(refs, group, parallelBuild);
+                JobSystem::Wait(group);
 
-            refs.reserve(data.size());
+                refs.reserve(data.size());
 
-            if (!nodes.size() && aabbs.size() == 1) {
-                BVHNode node;
-                node.leftPtr = ~0;
-                node.rightPtr = ~0;
-                node.leftAABB = aabb;
-                node.rightAABB = AABB(vec3(0.0f), vec3(0.0f));
+                if (!nodes.size() && aabbs.size() == 1) {
+                    BVHNode node;
+                    node.leftPtr = ~0;
+                    node.rightPtr = ~0;
+                    node.leftAABB = aabb;
+                    node.rightAABB = AABB(vec3(0.0f), vec3(0.0f));
 
-                nodes.push_back(node);
-            }
+                    nodes.push_back(node);
+                }
+
+                builder->Flatten(nodes, refs);
 
-            builder->Flatten(nodes, refs);
+                delete builder;
+            }
+            else {
+                // Only one reference per leaf is allowed here
+                LinearBVHBuilder builder(1, buildMode == BVHBuildMode::LinearOptimized, JobPriority::Medium);
+                builder.Build(refs, nodes, parallelBuild);
+            }
 
             this->aabbs.resize(refs.size());
 
@@ -96,8 +114,6 @@ namespace Atlas {
                 this->aabbs[i] = aabbs[ref.idx];
             }
 
-            delete builder;
-
         }
         
         bool BVH::GetIntersection(std::vector<std::pair<int32_t, float>>& stack, Ray ray, BVHTriangle& closest, glm::vec3& intersection) {
@@ -868,6 +884,503 @@ namespace Atlas {
 
         }
 
+        // Cost factors of the SAH used by the linear builder, relative to intersecting a single reference
+        static constexpr float linearNodeTraversalCost = 1.2f;
+        static constexpr float linearRefIntersectionCost = 1.0f;
+
+        // Spreads the lower 21 bits of the value such that there are two zero bits between each bit
+        static uint64_t ExpandBits(uint64_t value) {
+
+            value &= 0x1fffff;
+            value = (value | value << 32) & 0x1f00000000ffff;
+            value = (value | value << 16) & 0x1f0000ff0000ff;
+            value = (value | value << 8) & 0x100f00f00f00f00f;
+            value = (value | value << 4) & 0x10c30c30c30c30c3;
+            value = (value | value << 2) & 0x1249249249249249;
+            return value;
+
+        }
+
+        LinearBVHBuilder::LinearBVHBuilder(uint32_t maxLeafRefCount, bool optimizeTreelets, JobPriority priority) :
+            maxLeafRefCount(maxLeafRefCount), optimizeTreelets(optimizeTreelets), priority(priority) {}
+
+        void LinearBVHBuilder::Build(std::vector<BVHBuilder::Ref>& refs, std::vector<BVHNode>& nodes, bool parallelBuild) {
+
+            nodes.clear();
+
+            auto refCount = int32_t(refs.size());
+            if (refCount == 0)
+                return;
+
+            // A single reference is stored like the SAH build does it, with both children pointing to it
+            if (refCount == 1) {
+                BVHNode node;
+                node.leftPtr = ~0;
+                node.rightPtr = ~0;
+                node.leftAABB = refs.front().aabb;
+                node.rightAABB = AABB(vec3(0.0f), vec3(0.0f));
+
+                nodes.push_back(node);
+                refs.front().endOfNode = true;
+                return;
+            }
+
+            // Shorter codes need less sorting passes, but more references end up with the same code
+            auto bitCount = refCount > (1 << 18) ? 63u : 30u;
+
+            ComputeMortonCodes(refs, bitCount, parallelBuild);
+            SortMortonCodes(bitCount, parallelBuild);
+            EmitHierarchy(parallelBuild);
+            ComputeBounds(refs, optimizeTreelets, parallelBuild);
+
+            std::vector<BVHBuilder::Ref> orderedRefs;
+            Flatten(refs, orderedRefs, nodes);
+            refs = std::move(orderedRefs);
+
+            mortonCodes.clear();
+            refIndices.clear();
+            internalNodes.clear();
+            leafAABBs.clear();
+            leafParents.clear();
+            visitCounters.clear();
+
+        }
+
+        void LinearBVHBuilder::ComputeMortonCodes(const std::vector<BVHBuilder::Ref>& refs, uint32_t bitCount,
+            bool parallelBuild) {
+
+            auto count = int32_t(refs.size());
+
+            // The codes are relative to the bounds of all centroids
+            auto centroidMin = vec3(std::numeric_limits<float>::max());
+            auto centroidMax = vec3(-std::numeric_limits<float>::max());
+            for (const auto& ref : refs) {
+                auto centroid = 0.5f * (ref.aabb.min + ref.aabb.max);
+                centroidMin = glm::min(centroidMin, centroid);
+                centroidMax = glm::max(centroidMax, centroid);
+            }
+
+            auto cellCount = float((1u << (bitCount / 3)) - 1u);
+            auto extent = glm::max(centroidMax - centroidMin, vec3(1e-6f));
+            auto scale = cellCount / extent;
+
+            mortonCodes.resize(count);
+            refIndices.resize(count);
+
+            ParallelRange(count, 4096, parallelBuild, [&](int32_t begin, int32_t end) {
+                for (int32_t i = begin; i < end; i++) {
+                    const auto& ref = refs[i];
+                    auto centroid = 0.5f * (ref.aabb.min + ref.aabb.max);
+                    auto cell = glm::clamp((centroid - centroidMin) * scale, vec3(0.0f), vec3(cellCount));
+
+                    mortonCodes[i] = ExpandBits(uint64_t(cell.x)) << 2 |
+                        ExpandBits(uint64_t(cell.y)) << 1 | ExpandBits(uint64_t(cell.z));
+                    refIndices[i] = uint32_t(i);
+                }
+            });
+
+        }
+
+        void LinearBVHBuilder::SortMortonCodes(uint32_t bitCount, bool parallelBuild) {
+
+            // Least significant digit radix sort with 8 bit digits. Each chunk of keys is counted
+            // and scattered by a separate job, the offsets of the chunks are computed in between.
+            const int32_t radixSize = 256;
+
+            auto count = int32_t(mortonCodes.size());
+            auto chunkCount = parallelBuild ? std::clamp(count / 16384, 1,
+                4 * JobSystem::GetWorkerCount(priority)) : 1;
+            auto chunkSize = (count + chunkCount - 1) / chunkCount;
+
+            std::vector<uint64_t> sortedCodes(count);
+            std::vector<uint32_t> sortedIndices(count);
+            std::vector<uint32_t> offsets(chunkCount * radixSize);
+
+            for (uint32_t shift = 0; shift < bitCount; shift += 8) {
+                std::fill(offsets.begin(), offsets.end(), 0u);
+
+                ParallelRange(chunkCount, 1, parallelBuild, [&](int32_t begin, int32_t end) {
+                    for (int32_t chunk = begin; chunk < end; chunk++) {
+                        auto histogram = &offsets[chunk * radixSize];
+                        auto chunkEnd = std::min(count, (chunk + 1) * chunkSize);
+                        for (int32_t i = chunk * chunkSize; i < chunkEnd; i++)
+                            histogram[(mortonCodes[i] >> shift) & 0xff]++;
+                    }
+                });
+
+                // Digit major order over the chunks keeps the sort stable
+                uint32_t offset = 0;
+                bool sameDigit = false;
+                for (int32_t digit = 0; digit < radixSize; digit++) {
+                    auto digitOffset = offset;
+                    for (int32_t chunk = 0; chunk < chunkCount; chunk++) {
+                        auto digitCount = offsets[chunk * radixSize + digit];
+                        offsets[chunk * radixSize + digit] = offset;
+                        offset += digitCount;
+                    }
+                    sameDigit |= offset - digitOffset == uint32_t(count);
+                }
+
+                // Nothing would move in this pass
+                if (sameDigit)
+                    continue;
+
+                ParallelRange(chunkCount, 1, parallelBuild, [&](int32_t begin, int32_t end) {
+                    for (int32_t chunk = begin; chunk < end; chunk++) {
+                        auto chunkOffsets = &offsets[chunk * radixSize];
+                        auto chunkEnd = std::min(count, (chunk + 1) * chunkSize);
+                        for (int32_t i = chunk * chunkSize; i < chunkEnd; i++) {
+                            auto dst = chunkOffsets[(mortonCodes[i] >> shift) & 0xff]++;
+                            sortedCodes[dst] = mortonCodes[i];
+                            sortedIndices[dst] = refIndices[i];
+                        }
+                    }
+                });
+
+                std::swap(mortonCodes, sortedCodes);
+                std::swap(refIndices, sortedIndices);
+            }
+
+        }
+
+        void LinearBVHBuilder::EmitHierarchy(bool parallelBuild) {
+
+            auto count = int32_t(mortonCodes.size());
+
+            // There are count - 1 internal nodes, where node 0 is the root
+            internalNodes.assign(count - 1, Node());
+            leafParents.assign(count, -1);
+
+            ParallelRange(count - 1, 1024, parallelBuild, [&](int32_t begin, int32_t end) {
+                for (int32_t i = begin; i < end; i++) {
+                    // Each node covers a range of keys which starts or ends at its own index
+                    auto direction = Delta(i, i + 1) - Delta(i, i - 1) >= 0 ? 1 : -1;
+                    auto minDelta = Delta(i, i - direction);
+
+                    int32_t maxLength = 2;
+                    while (Delta(i, i + maxLength * direction) > minDelta)
+                        maxLength *= 2;
+
+                    int32_t length = 0;
+                    for (auto step = maxLength / 2; step >= 1; step /= 2) {
+                        if (Delta(i, i + (length + step) * direction) > minDelta)
+                            length += step;
+                    }
+
+                    auto j = i + length * direction;
+
+                    // The split is where the highest differing bit of the range changes
+                    auto nodeDelta = Delta(i, j);
+                    int32_t split = 0;
+                    for (int32_t divisor = 2; ; divisor *= 2) {
+                        auto step = (length + divisor - 1) / divisor;
+                        if (Delta(i, i + (split + step) * direction) > nodeDelta)
+                            split += step;
+                        if (step == 1)
+                            break;
+                    }
+
+                    auto splitIdx = i + split * direction + std::min(direction, 0);
+
+                    auto& node = internalNodes[i];
+                    node.leftPtr = std::min(i, j) == splitIdx ? ~splitIdx : splitIdx;
+                    node.rightPtr = std::max(i, j) == splitIdx + 1 ? ~(splitIdx + 1) : splitIdx + 1;
+
+                    SetParent(node.leftPtr, i);
+                    SetParent(node.rightPtr, i);
+                }
+            });
+
+        }
+
+        void LinearBVHBuilder::ComputeBounds(const std::vector<BVHBuilder::Ref>& refs, bool optimize, bool parallelBuild) {
+
+            auto count = int32_t(refIndices.size());
+
+            leafAABBs.resize(count);
+            visitCounters = std::vector<std::atomic_uint32_t>(count - 1);
+
+            // Walk up from each leaf, where only the second thread arriving at a node continues.
+            // At that point the whole subtree of the node is done and it can be restructured.
+            ParallelRange(count, 1024, parallelBuild, [&](int32_t begin, int32_t end) {
+                for (int32_t i = begin; i < end; i++) {
+                    leafAABBs[i] = refs[refIndices[i]].aabb;
+
+                    auto nodeIdx = leafParents[i];
+                    while (nodeIdx >= 0) {
+                        if (visitCounters[nodeIdx].fetch_add(1, std::memory_order_acq_rel) == 0)
+                            break;
+
+                        auto& node = internalNodes[nodeIdx];
+                        node.aabb = GetAABB(node.leftPtr);
+                        node.aabb.Grow(GetAABB(node.rightPtr));
+                        node.cost = linearNodeTraversalCost * node.aabb.GetSurfaceArea() +
+                            GetCost(node.leftPtr) + GetCost(node.rightPtr);
+                        node.refCount = GetRefCount(node.leftPtr) + GetRefCount(node.rightPtr);
+
+                        if (optimize && node.refCount >= 3)
+                            OptimizeTreelet(nodeIdx);
+
+                        nodeIdx = node.parentPtr;
+                    }
+                }
+            });
+
+        }
+
+        void LinearBVHBuilder::OptimizeTreelet(int32_t nodeIdx) {
+
+            constexpr int32_t maxTreeletSize = 8;
+            constexpr int32_t maxSubsetCount = 1 << maxTreeletSize;
+
+            auto size = std::clamp(int32_t(treeletSize), 3, maxTreeletSize);
+
+            int32_t leaves[maxTreeletSize];
+            int32_t internals[maxTreeletSize];
+            int32_t leafCount = 2, internalCount = 0;
+
+            leaves[0] = internalNodes[nodeIdx].leftPtr;
+            leaves[1] = internalNodes[nodeIdx].rightPtr;
+
+            // Grow the treelet by expanding the leaf with the largest surface area
+            while (leafCount < size) {
+                int32_t expandIdx = -1;
+                float maxArea = -1.0f;
+                for (int32_t i = 0; i < leafCount; i++) {
+                    if (leaves[i] < 0)
+                        continue;
+                    auto area = internalNodes[leaves[i]].aabb.GetSurfaceArea();
+                    if (area > maxArea) {
+                        maxArea = area;
+                        expandIdx = i;
+                    }
+                }
+
+                if (expandIdx < 0)
+                    break;
+
+                auto expandedNodeIdx = leaves[expandIdx];
+                internals[internalCount++] = expandedNodeIdx;
+                leaves[expandIdx] = internalNodes[expandedNodeIdx].leftPtr;
+                leaves[leafCount++] = internalNodes[expandedNodeIdx].rightPtr;
+            }
+
+            if (leafCount < 3)
+                return;
+
+            AABB subsetAABBs[maxSubsetCount];
+            float subsetCosts[maxSubsetCount];
+            uint32_t subsetRefCounts[maxSubsetCount];
+            uint32_t partitions[maxSubsetCount];
+
+            // Find the optimal topology for each subset of treelet leaves, smaller subsets first
+            auto subsetCount = uint32_t(1 << leafCount);
+            for (uint32_t subset = 1; subset < subsetCount; subset++) {
+                auto lowestBit = subset & (~subset + 1);
+                auto leafPtr = leaves[std::countr_zero(lowestBit)];
+
+                if (subset == lowestBit) {
+                    subsetAABBs[subset] = GetAABB(leafPtr);
+                    subsetCosts[subset] = GetCost(leafPtr);
+                    subsetRefCounts[subset] = GetRefCount(leafPtr);
+                    continue;
+                }
+
+                subsetAABBs[subset] = subsetAABBs[subset ^ lowestBit];
+                subsetAABBs[subset].Grow(GetAABB(leafPtr));
+                subsetRefCounts[subset] = subsetRefCounts[subset ^ lowestBit] + GetRefCount(leafPtr);
+
+                // Each partition only needs to be checked once, so the left side always contains the lowest bit
+                auto minCost = std::numeric_limits<float>::max();
+                for (auto partition = (subset - 1) & subset; partition > 0; partition = (partition - 1) & subset) {
+                    if (!(partition & lowestBit))
+                        continue;
+
+                    auto cost = subsetCosts[partition] + subsetCosts[subset ^ partition];
+                    if (cost < minCost) {
+                        minCost = cost;
+                        partitions[subset] = partition;
+                    }
+                }
+
+                subsetCosts[subset] = linearNodeTraversalCost * subsetAABBs[subset].GetSurfaceArea() + minCost;
+            }
+
+            auto fullSubset = subsetCount - 1;
+            if (subsetCosts[fullSubset] >= internalNodes[nodeIdx].cost)
+                return;
+
+            // Rebuild the treelet with the optimal topology, reusing its internal nodes
+            struct Entry {
+                int32_t nodeIdx;
+                uint32_t subset;
+            };
+
+            Entry stack[maxTreeletSize];
+            int32_t stackSize = 0, nextInternal = 0;
+            stack[stackSize++] = { nodeIdx, fullSubset };
+
+            while (stackSize > 0) {
+                auto entry = stack[--stackSize];
+
+                int32_t children[2];
+                uint32_t childSubsets[2] = { partitions[entry.subset], entry.subset ^ partitions[entry.subset] };
+                for (int32_t i = 0; i < 2; i++) {
+                    if (std::popcount(childSubsets[i]) == 1) {
+                        children[i] = leaves[std::countr_zero(childSubsets[i])];
+                    }
+                    else {
+                        children[i] = internals[nextInternal++];
+                        stack[stackSize++] = { children[i], childSubsets[i] };
+                    }
+                    SetParent(children[i], entry.nodeIdx);
+                }
+
+                auto& node = internalNodes[entry.nodeIdx];
+                node.leftPtr = children[0];
+                node.rightPtr = children[1];
+                node.aabb = subsetAABBs[entry.subset];
+                node.cost = subsetCosts[entry.subset];
+                node.refCount = subsetRefCounts[entry.subset];
+            }
+
+        }
+
+        void LinearBVHBuilder::Flatten(const std::vector<BVHBuilder::Ref>& refs, std::vector<BVHBuilder::Ref>& orderedRefs,
+            std::vector<BVHNode>& nodes) {
+
+            struct Entry {
+                int32_t ptr;
+                int32_t parentIdx;
+                bool left;
+            };
+
+            orderedRefs.reserve(refs.size());
+
+            std::vector<Entry> stack;
+            stack.push_back({ 0, -1, false });
+
+            // Depth first, such that the layout matches the one of the SAH build
+            while (!stack.empty()) {
+                auto entry = stack.back();
+                stack.pop_back();
+
+                auto isLeaf = entry.ptr < 0;
+                // Two leaves below a node are merged into one if that lowers the cost
+                if (!isLeaf && entry.parentIdx >= 0 && maxLeafRefCount > 1) {
+                    const auto& node = internalNodes[entry.ptr];
+                    if (node.leftPtr < 0 && node.rightPtr < 0) {
+                        auto leafCost = linearRefIntersectionCost * 2.0f * node.aabb.GetSurfaceArea();
+                        isLeaf = leafCost <= node.cost;
+                    }
+                }
+
+                int32_t flatPtr;
+                if (isLeaf) {
+                    flatPtr = ~int32_t(orderedRefs.size());
+
+                    auto addRef = [&](int32_t leafPtr) {
+                        auto ref = refs[refIndices[~leafPtr]];
+                        ref.nodeIdx = uint32_t(entry.parentIdx);
+                        ref.endOfNode = false;
+                        orderedRefs.push_back(ref);
+                    };
+
+                    if (entry.ptr < 0) {
+                        addRef(entry.ptr);
+                    }
+                    else {
+                        addRef(internalNodes[entry.ptr].leftPtr);
+                        addRef(internalNodes[entry.ptr].rightPtr);
+                    }
+
+                    orderedRefs.back().endOfNode = true;
+                }
+                else {
+                    flatPtr = int32_t(nodes.size());
+                    nodes.emplace_back();
+
+                    auto leftPtr = internalNodes[entry.ptr].leftPtr;
+                    auto rightPtr = internalNodes[entry.ptr].rightPtr;
+
+                    // Reorder such that shadow rays hit large surface are first
+                    if (GetAABB(leftPtr).GetSurfaceArea() < GetAABB(rightPtr).GetSurfaceArea())
+                        std::swap(leftPtr, rightPtr);
+
+                    nodes[flatPtr].leftAABB = GetAABB(leftPtr);
+                    nodes[flatPtr].rightAABB = GetAABB(rightPtr);
+
+                    stack.push_back({ rightPtr, flatPtr, false });
+                    stack.push_back({ leftPtr, flatPtr, true });
+                }
+
+                if (entry.parentIdx >= 0) {
+                    if (entry.left)
+                        nodes[entry.parentIdx].leftPtr = flatPtr;
+                    else
+                        nodes[entry.parentIdx].rightPtr = flatPtr;
+                }
+            }
+
+        }
+
+        int32_t LinearBVHBuilder::Delta(int32_t idx0, int32_t idx1) const {
+
+            if (idx1 < 0 || idx1 >= int32_t(mortonCodes.size()))
+                return -1;
+
+            auto code0 = mortonCodes[idx0];
+            auto code1 = mortonCodes[idx1];
+
+            // Duplicate codes are made unique by their index
+            if (code0 == code1)
+                return 64 + std::countl_zero(uint32_t(idx0 ^ idx1));
+
+            return std::countl_zero(code0 ^ code1);
+
+        }
+
+        const AABB& LinearBVHBuilder::GetAABB(int32_t ptr) const {
+
+            return ptr < 0 ? leafAABBs[~ptr] : internalNodes[ptr].aabb;
+
+        }
+
+        float LinearBVHBuilder::GetCost(int32_t ptr) const {
+
+            return ptr < 0 ? linearRefIntersectionCost * leafAABBs[~ptr].GetSurfaceArea() : internalNodes[ptr].cost;
+
+        }
+
+        uint32_t LinearBVHBuilder::GetRefCount(int32_t ptr) const {
+
+            return ptr < 0 ? 1 : internalNodes[ptr].refCount;
+
+        }
+
+        void LinearBVHBuilder::SetParent(int32_t ptr, int32_t parentIdx) {
+
+            if (ptr < 0)
+                leafParents[~ptr] = parentIdx;
+            else
+                internalNodes[ptr].parentPtr = parentIdx;
+
+        }
+
+        template<class F>
+        void LinearBVHBuilder::ParallelRange(int32_t count, int32_t grainSize, bool parallel, F&& func) {
+
+            if (!parallel || count <= grainSize) {
+                func(0, count);
+                return;
+            }
+
+            JobGroup group { priority };
+            JobSystem::ParallelFor(group, 0, count, grainSize, func);
+            JobSystem::Wait(group);
+
+        }
+
     }
 
-}
\ No newline at end of file
+}
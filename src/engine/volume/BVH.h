@@ -6,11 +6,21 @@
 
 #include <vector>
 #include <algorithm>
+#include <atomic>
 
 namespace Atlas {
 
     namespace Volume {
 
+        enum class BVHBuildMode {
+            // Binned SAH build, with spatial splits for triangles. Slowest build with the best quality.
+            SAH = 0,
+            // Linear BVH from Morton code sorted primitives. Fastest build with the lowest quality.
+            Linear,
+            // Linear BVH with an additional treelet reordering pass, which recovers most of the SAH quality.
+            LinearOptimized
+        };
+
         class BVHNode {
         public:
             BVHNode() {}
@@ -111,14 +121,96 @@ namespace Atlas {
         };
 
 
+        /**
+         * Builds a BVH by sorting the primitives along a Morton curve and emitting the whole hierarchy
+         * in a single parallel pass, see Maximizing Parallelism in the Construction of BVHs, Karras.
+         * Optionally the tree is improved afterwards by restructuring small treelets with a dynamic
+         * programming SAH optimization, see Fast Parallel Construction of High-Quality BVHs, Karras and Aila.
+         */
+        class LinearBVHBuilder {
+
+        public:
+            /**
+             * Constructs a LinearBVHBuilder object.
+             * @param maxLeafRefCount The maximum number of references per leaf, either 1 or 2
+             * @param optimizeTreelets Whether treelet reordering should be run after the initial build
+             * @param priority The priority of the build jobs
+             */
+            LinearBVHBuilder(uint32_t maxLeafRefCount, bool optimizeTreelets, JobPriority priority);
+
+            /**
+             * Builds the BVH.
+             * @param refs The references to build the BVH for. Afterwards they are ordered like the leaves.
+             * @param nodes The nodes of the BVH in the same format as the ones of a flattened BVHBuilder.
+             * @param parallelBuild Whether the build should be distributed on the job system
+             */
+            void Build(std::vector<BVHBuilder::Ref>& refs, std::vector<BVHNode>& nodes, bool parallelBuild);
+
+            uint32_t maxLeafRefCount;
+            bool optimizeTreelets;
+            JobPriority priority;
+
+            // Treelets with more leaves find better trees, but the cost grows exponentially
+            uint32_t treeletSize = 7;
+
+        private:
+            struct Node {
+                AABB aabb;
+                float cost = 0.0f;
+
+                int32_t leftPtr = 0;
+                int32_t rightPtr = 0;
+                int32_t parentPtr = -1;
+
+                uint32_t refCount = 0;
+            };
+
+            void ComputeMortonCodes(const std::vector<BVHBuilder::Ref>& refs, uint32_t bitCount, bool parallelBuild);
+
+            void SortMortonCodes(uint32_t bitCount, bool parallelBuild);
+
+            void EmitHierarchy(bool parallelBuild);
+
+            void ComputeBounds(const std::vector<BVHBuilder::Ref>& refs, bool optimize, bool parallelBuild);
+
+            void OptimizeTreelet(int32_t nodeIdx);
+
+            void Flatten(const std::vector<BVHBuilder::Ref>& refs, std::vector<BVHBuilder::Ref>& orderedRefs,
+                std::vector<BVHNode>& nodes);
+
+            int32_t Delta(int32_t idx0, int32_t idx1) const;
+
+            const AABB& GetAABB(int32_t ptr) const;
+
+            float GetCost(int32_t ptr) const;
+
+            uint32_t GetRefCount(int32_t ptr) const;
+
+            void SetParent(int32_t ptr, int32_t parentIdx);
+
+            template<class F>
+            void ParallelRange(int32_t count, int32_t grainSize, bool parallel, F&& func);
+
+            std::vector<uint64_t> mortonCodes;
+            std::vector<uint32_t> refIndices;
+
+            std::vector<Node> internalNodes;
+            std::vector<AABB> leafAABBs;
+            std::vector<int32_t> leafParents;
+
+            std::vector<std::atomic_uint32_t> visitCounters;
+
+        };
+
         class BVH {
 
         public:
             BVH() = default;
 
-            BVH(const std::vector<AABB>& aabbs, const std::vector<BVHTriangle>& data, bool parallelBuild = true);
+            BVH(const std::vector<AABB>& aabbs, const std::vector<BVHTriangle>& data, bool parallelBuild = true,
+                BVHBuildMode buildMode = BVHBuildMode::SAH);
 
-            BVH(const std::vector<AABB>& aabbs, bool parallelBuild = true);
+            BVH(const std::vector<AABB>& aabbs, bool parallelBuild = true, BVHBuildMode buildMode = BVHBuildMode::SAH);
 
             bool GetIntersection(std::vector<std::pair<int32_t, float>>& stack, Ray ray, BVHTriangle& closest,
                 glm::vec3& intersection);
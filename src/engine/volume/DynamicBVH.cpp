@@ -0,0 +1,408 @@
+// Insertion based on: Fast, Effective BVH Updates for Animated Scenes, Kopta et. al. and the
+// branch and bound sibling search of Box2D's dynamic tree
+#include "DynamicBVH.h"
+
+namespace Atlas {
+
+    namespace Volume {
+
+        int32_t DynamicBVH::Insert(const AABB& aabb) {
+
+            int32_t leafIdx;
+            if (!freeLeaves.empty()) {
+                leafIdx = freeLeaves.back();
+                freeLeaves.pop_back();
+            }
+            else {
+                leafIdx = int32_t(leafAABBs.size());
+                leafAABBs.emplace_back();
+                leafParents.push_back(-1);
+            }
+
+            leafAABBs[leafIdx] = aabb;
+            leafCount++;
+
+            // A single leaf is stored like the BVH does it, with both children pointing to the leaf
+            if (leafCount == 1) {
+                nodes.clear();
+                nodeParents.clear();
+                freeNodes.clear();
+
+                BVHNode root;
+                root.leftPtr = ~leafIdx;
+                root.rightPtr = ~leafIdx;
+                root.leftAABB = aabb;
+                root.rightAABB = AABB(vec3(0.0f), vec3(0.0f));
+
+                nodes.push_back(root);
+                nodeParents.push_back(-1);
+                leafParents[leafIdx] = 0;
+                surfaceAreaSum = aabb.GetSurfaceArea();
+                return leafIdx;
+            }
+
+            if (leafCount == 2) {
+                nodes[0].rightPtr = ~leafIdx;
+                nodes[0].rightAABB = aabb;
+                leafParents[leafIdx] = 0;
+                surfaceAreaSum += aabb.GetSurfaceArea();
+                return leafIdx;
+            }
+
+            // Descend the tree greedily towards the sibling which adds the least surface area
+            int32_t nodeIdx = 0, siblingPtr = 0;
+            while (true) {
+                const auto& node = nodes[nodeIdx];
+
+                auto nodeAABB = Combine(node.leftAABB, node.rightAABB);
+                auto area = nodeAABB.GetSurfaceArea();
+                auto combinedArea = Combine(nodeAABB, aabb).GetSurfaceArea();
+
+                // Cost of a new parent for this node and the leaf, all ancestors grow by the inherited cost
+                auto cost = 2.0f * combinedArea;
+                auto inheritanceCost = 2.0f * (combinedArea - area);
+
+                auto childCost = [&](int32_t childPtr, const AABB& childAABB) {
+                    auto childArea = Combine(childAABB, aabb).GetSurfaceArea();
+                    if (childPtr >= 0)
+                        childArea -= childAABB.GetSurfaceArea();
+                    return childArea + inheritanceCost;
+                };
+
+                auto leftCost = childCost(node.leftPtr, node.leftAABB);
+                auto rightCost = childCost(node.rightPtr, node.rightAABB);
+
+                if (cost < leftCost && cost < rightCost) {
+                    siblingPtr = nodeIdx;
+                    break;
+                }
+
+                auto childPtr = leftCost < rightCost ? node.leftPtr : node.rightPtr;
+                if (childPtr < 0) {
+                    siblingPtr = childPtr;
+                    break;
+                }
+
+                nodeIdx = childPtr;
+            }
+
+            // The root needs to stay at index 0, so move its content down into a new node
+            if (siblingPtr == 0) {
+                auto rootAABB = Combine(nodes[0].leftAABB, nodes[0].rightAABB);
+
+                auto movedIdx = AllocateNode();
+                nodes[movedIdx] = nodes[0];
+                nodeParents[movedIdx] = 0;
+                SetParent(nodes[movedIdx].leftPtr, movedIdx);
+                SetParent(nodes[movedIdx].rightPtr, movedIdx);
+
+                nodes[0].leftPtr = movedIdx;
+                nodes[0].leftAABB = rootAABB;
+                nodes[0].rightPtr = ~leafIdx;
+                nodes[0].rightAABB = aabb;
+                leafParents[leafIdx] = 0;
+
+                surfaceAreaSum += double(rootAABB.GetSurfaceArea()) + double(aabb.GetSurfaceArea());
+                return leafIdx;
+            }
+
+            auto parentIdx = siblingPtr < 0 ? leafParents[~siblingPtr] : nodeParents[siblingPtr];
+            const auto& parent = nodes[parentIdx];
+            auto siblingAABB = parent.leftPtr == siblingPtr ? parent.leftAABB : parent.rightAABB;
+
+            auto newIdx = AllocateNode();
+            nodes[newIdx].leftPtr = siblingPtr;
+            nodes[newIdx].leftAABB = siblingAABB;
+            nodes[newIdx].rightPtr = ~leafIdx;
+            nodes[newIdx].rightAABB = aabb;
+            nodeParents[newIdx] = parentIdx;
+            surfaceAreaSum += double(siblingAABB.GetSurfaceArea()) + double(aabb.GetSurfaceArea());
+
+            SetParent(siblingPtr, newIdx);
+            leafParents[leafIdx] = newIdx;
+
+            SetChild(parentIdx, siblingPtr, newIdx, Combine(siblingAABB, aabb));
+            Refit(parentIdx);
+
+            return leafIdx;
+
+        }
+
+        void DynamicBVH::Remove(int32_t leafIdx) {
+
+            AE_ASSERT(IsLeafValid(leafIdx) && "Leaf isn't part of the tree");
+
+            auto parentIdx = leafParents[leafIdx];
+            leafParents[leafIdx] = -1;
+            freeLeaves.push_back(leafIdx);
+            leafCount--;
+
+            if (leafCount == 0) {
+                nodes.clear();
+                nodeParents.clear();
+                freeNodes.clear();
+                surfaceAreaSum = 0.0;
+                return;
+            }
+
+            auto parent = nodes[parentIdx];
+            auto leftRemoved = parent.leftPtr == ~leafIdx;
+            auto siblingPtr = leftRemoved ? parent.rightPtr : parent.leftPtr;
+            auto siblingAABB = leftRemoved ? parent.rightAABB : parent.leftAABB;
+
+            surfaceAreaSum -= double(parent.leftAABB.GetSurfaceArea()) + double(parent.rightAABB.GetSurfaceArea());
+
+            // Go back to the single leaf representation
+            if (leafCount == 1) {
+                nodes[0].leftPtr = siblingPtr;
+                nodes[0].rightPtr = siblingPtr;
+                nodes[0].leftAABB = siblingAABB;
+                nodes[0].rightAABB = AABB(vec3(0.0f), vec3(0.0f));
+                surfaceAreaSum = siblingAABB.GetSurfaceArea();
+                return;
+            }
+
+            // With more than one leaf left the sibling of a leaf at the root has to be a node
+            if (parentIdx == 0) {
+                ReplaceRoot(siblingPtr);
+                return;
+            }
+
+            auto grandParentIdx = nodeParents[parentIdx];
+            nodeParents[parentIdx] = -1;
+            freeNodes.push_back(parentIdx);
+
+            // The sibling takes over the place of the parent
+            SetParent(siblingPtr, grandParentIdx);
+            SetChild(grandParentIdx, parentIdx, siblingPtr, siblingAABB);
+            Refit(grandParentIdx);
+
+        }
+
+        void DynamicBVH::Update(int32_t leafIdx, const AABB& aabb) {
+
+            AE_ASSERT(IsLeafValid(leafIdx) && "Leaf isn't part of the tree");
+
+            leafAABBs[leafIdx] = aabb;
+
+            if (leafCount == 1) {
+                nodes[0].leftAABB = aabb;
+                surfaceAreaSum = aabb.GetSurfaceArea();
+                return;
+            }
+
+            auto parentIdx = leafParents[leafIdx];
+            SetChildAABB(parentIdx, ~leafIdx, aabb);
+            Refit(parentIdx);
+
+        }
+
+        void DynamicBVH::Rebuild(bool parallelBuild, BVHBuildMode buildMode) {
+
+            if (leafCount == 0)
+                return;
+
+            std::vector<AABB> aabbs;
+            std::vector<int32_t> leafIndices;
+            aabbs.reserve(leafCount);
+            leafIndices.reserve(leafCount);
+
+            for (int32_t i = 0; i < int32_t(leafAABBs.size()); i++) {
+                if (!IsLeafValid(i))
+                    continue;
+                aabbs.push_back(leafAABBs[i]);
+                leafIndices.push_back(i);
+            }
+
+            if (leafCount == 1) {
+                rebuildCost = GetCost();
+                return;
+            }
+
+            auto bvh = BVH(aabbs, parallelBuild, buildMode);
+
+            nodes = std::move(bvh.nodes);
+            nodeParents.assign(nodes.size(), -1);
+            freeNodes.clear();
+            surfaceAreaSum = 0.0;
+
+            // The BVH points to its reordered references, remap them to the leaf indices
+            auto remap = [&](int32_t& ptr, int32_t nodeIdx) {
+                if (ptr < 0) {
+                    auto leafIdx = leafIndices[bvh.refs[~ptr].idx];
+                    ptr = ~leafIdx;
+                    leafParents[leafIdx] = nodeIdx;
+                }
+                else {
+                    nodeParents[ptr] = nodeIdx;
+                }
+            };
+
+            for (int32_t i = 0; i < int32_t(nodes.size()); i++) {
+                auto& node = nodes[i];
+                remap(node.leftPtr, i);
+                remap(node.rightPtr, i);
+
+                surfaceAreaSum += double(node.leftAABB.GetSurfaceArea()) + double(node.rightAABB.GetSurfaceArea());
+            }
+
+            rebuildCost = GetCost();
+
+        }
+
+        bool DynamicBVH::NeedsRebuild() const {
+
+            return leafCount > 1 && GetCost() > rebuildCost * rebuildThreshold;
+
+        }
+
+        float DynamicBVH::GetCost() const {
+
+            auto rootArea = GetRootSurfaceArea();
+            return rootArea > 0.0f ? float(surfaceAreaSum / double(rootArea)) : 0.0f;
+
+        }
+
+        const std::vector<BVHNode>& DynamicBVH::GetTree() const {
+
+            return nodes;
+
+        }
+
+        const AABB& DynamicBVH::GetLeafAABB(int32_t leafIdx) const {
+
+            return leafAABBs[leafIdx];
+
+        }
+
+        bool DynamicBVH::IsLeafValid(int32_t leafIdx) const {
+
+            return leafIdx >= 0 && leafIdx < int32_t(leafParents.size()) && leafParents[leafIdx] >= 0;
+
+        }
+
+        size_t DynamicBVH::GetLeafCapacity() const {
+
+            return leafAABBs.size();
+
+        }
+
+        size_t DynamicBVH::GetLeafCount() const {
+
+            return leafCount;
+
+        }
+
+        void DynamicBVH::Clear() {
+
+            nodes.clear();
+            nodeParents.clear();
+            freeNodes.clear();
+
+            leafAABBs.clear();
+            leafParents.clear();
+            freeLeaves.clear();
+
+            leafCount = 0;
+            surfaceAreaSum = 0.0;
+            rebuildCost = 0.0f;
+
+        }
+
+        void DynamicBVH::SetChild(int32_t nodeIdx, int32_t childPtr, int32_t newChildPtr, const AABB& aabb) {
+
+            auto& node = nodes[nodeIdx];
+            if (node.leftPtr == childPtr)
+                node.leftPtr = newChildPtr;
+            else
+                node.rightPtr = newChildPtr;
+
+            SetChildAABB(nodeIdx, newChildPtr, aabb);
+
+        }
+
+        void DynamicBVH::SetChildAABB(int32_t nodeIdx, int32_t childPtr, const AABB& aabb) {
+
+            auto& node = nodes[nodeIdx];
+            auto& childAABB = node.leftPtr == childPtr ? node.leftAABB : node.rightAABB;
+
+            surfaceAreaSum += double(aabb.GetSurfaceArea()) - double(childAABB.GetSurfaceArea());
+            childAABB = aabb;
+
+        }
+
+        void DynamicBVH::Refit(int32_t nodeIdx) {
+
+            // Walk up until the bounds of a node don't change anymore
+            while (nodeIdx > 0) {
+                auto parentIdx = nodeParents[nodeIdx];
+
+                const auto& node = nodes[nodeIdx];
+                auto aabb = Combine(node.leftAABB, node.rightAABB);
+
+                const auto& parent = nodes[parentIdx];
+                const auto& currentAABB = parent.leftPtr == nodeIdx ? parent.leftAABB : parent.rightAABB;
+                if (currentAABB.min == aabb.min && currentAABB.max == aabb.max)
+                    break;
+
+                SetChildAABB(parentIdx, nodeIdx, aabb);
+                nodeIdx = parentIdx;
+            }
+
+        }
+
+        void DynamicBVH::ReplaceRoot(int32_t nodeIdx) {
+
+            nodes[0] = nodes[nodeIdx];
+            SetParent(nodes[0].leftPtr, 0);
+            SetParent(nodes[0].rightPtr, 0);
+
+            nodeParents[nodeIdx] = -1;
+            freeNodes.push_back(nodeIdx);
+
+        }
+
+        void DynamicBVH::SetParent(int32_t childPtr, int32_t parentIdx) {
+
+            if (childPtr < 0)
+                leafParents[~childPtr] = parentIdx;
+            else
+                nodeParents[childPtr] = parentIdx;
+
+        }
+
+        int32_t DynamicBVH::AllocateNode() {
+
+            if (!freeNodes.empty()) {
+                auto nodeIdx = freeNodes.back();
+                freeNodes.pop_back();
+                return nodeIdx;
+            }
+
+            nodes.emplace_back();
+            nodeParents.push_back(-1);
+            return int32_t(nodes.size() - 1);
+
+        }
+
+        float DynamicBVH::GetRootSurfaceArea() const {
+
+            if (leafCount == 0)
+                return 0.0f;
+
+            if (leafCount == 1)
+                return nodes[0].leftAABB.GetSurfaceArea();
+
+            return Combine(nodes[0].leftAABB, nodes[0].rightAABB).GetSurfaceArea();
+
+        }
+
+        AABB DynamicBVH::Combine(const AABB& aabb0, const AABB& aabb1) {
+
+            return AABB(glm::min(aabb0.min, aabb1.min), glm::max(aabb0.max, aabb1.max));
+
+        }
+
+    }
+
+}
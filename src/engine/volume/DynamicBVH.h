@@ -0,0 +1,115 @@
+#pragma once
+
+#include "BVH.h"
+
+#include <vector>
+
+namespace Atlas {
+
+    namespace Volume {
+
+        /**
+         * A persistent bounding volume hierarchy with a single primitive per leaf, which supports
+         * inserting, removing and refitting leaves without rebuilding the whole tree.
+         * The nodes have the same layout as the ones of a BVH, where the root is always node 0 and
+         * a negative pointer ~idx references the leaf idx. Leaf indices are stable until the leaf is removed.
+         * Incremental changes degrade the tree quality, which is why the tree should be rebuilt when
+         * NeedsRebuild() returns true.
+         */
+        class DynamicBVH {
+
+        public:
+            DynamicBVH() = default;
+
+            /**
+             * Inserts a new leaf into the tree.
+             * @param aabb The bounding box of the leaf
+             * @return The index of the leaf
+             */
+            int32_t Insert(const AABB& aabb);
+
+            /**
+             * Removes a leaf from the tree. The index might be reused by following inserts.
+             * @param leafIdx The index of the leaf
+             */
+            void Remove(int32_t leafIdx);
+
+            /**
+             * Updates the bounding box of a leaf and refits all its ancestors in place.
+             * @param leafIdx The index of the leaf
+             * @param aabb The new bounding box of the leaf
+             */
+            void Update(int32_t leafIdx, const AABB& aabb);
+
+            /**
+             * Rebuilds the whole tree from scratch. Leaf indices are kept.
+             * @param parallelBuild Whether the build should be run in parallel on the job system
+             * @param buildMode The builder which is used, a linear build is faster but has a higher cost
+             */
+            void Rebuild(bool parallelBuild = true, BVHBuildMode buildMode = BVHBuildMode::SAH);
+
+            /**
+             * Checks whether the cost of the tree has grown too much compared to the cost after the last rebuild.
+             * @return True if the cost grew by more than the rebuild threshold, false otherwise.
+             */
+            bool NeedsRebuild() const;
+
+            /**
+             * Returns the SAH cost of the tree, which is the sum of the surface areas of all nodes
+             * and leaves relative to the surface area of the root.
+             */
+            float GetCost() const;
+
+            const std::vector<BVHNode>& GetTree() const;
+
+            const AABB& GetLeafAABB(int32_t leafIdx) const;
+
+            bool IsLeafValid(int32_t leafIdx) const;
+
+            /**
+             * Returns the number of leaf indices in use, including the ones of removed leaves
+             * which haven't been reused yet. All leaf indices are smaller than this number.
+             */
+            size_t GetLeafCapacity() const;
+
+            size_t GetLeafCount() const;
+
+            void Clear();
+
+            float rebuildThreshold = 1.5f;
+
+        private:
+            void SetChild(int32_t nodeIdx, int32_t childPtr, int32_t newChildPtr, const AABB& aabb);
+
+            void SetChildAABB(int32_t nodeIdx, int32_t childPtr, const AABB& aabb);
+
+            void Refit(int32_t nodeIdx);
+
+            void ReplaceRoot(int32_t nodeIdx);
+
+            void SetParent(int32_t childPtr, int32_t parentIdx);
+
+            int32_t AllocateNode();
+
+            float GetRootSurfaceArea() const;
+
+            static AABB Combine(const AABB& aabb0, const AABB& aabb1);
+
+            std::vector<BVHNode> nodes;
+            std::vector<int32_t> nodeParents;
+            std::vector<int32_t> freeNodes;
+
+            std::vector<AABB> leafAABBs;
+            std::vector<int32_t> leafParents;
+            std::vector<int32_t> freeLeaves;
+
+            size_t leafCount = 0;
+
+            double surfaceAreaSum = 0.0;
+            float rebuildCost = 0.0f;
+
+        };
+
+    }
+
+}
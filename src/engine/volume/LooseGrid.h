@@ -0,0 +1,460 @@
+#pragma once
+
+#include "../System.h"
+#include "AABB.h"
+#include "Frustum.h"
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+namespace Atlas {
+
+    namespace Volume {
+
+        /**
+         * A flat loose grid to cull large amounts of bounding boxes. Each element is assigned to a single
+         * cell by the center of its bounding box and the bounds of a cell grow to fit all of its elements,
+         * so elements never need to be split up or duplicated. Cells are grouped into blocks, which are
+         * culled first. The bounds of the elements of a cell are stored as separate arrays per component,
+         * which keeps the per element tests in tight loops.
+         * @tparam T The element type. Elements are identified by comparison.
+         */
+        template <class T> class LooseGrid {
+
+        public:
+            LooseGrid() = default;
+
+            /**
+             * Constructs a LooseGrid object.
+             * @param aabb The region covered by the grid. Elements outside are kept in the border cells.
+             * @param resolution The number of cells along each axis
+             * @param blockSize The number of cells along each axis of a block
+             * @note The grid keeps an index for each of the resolution^3 cells, even for empty ones.
+             */
+            LooseGrid(AABB aabb, int32_t resolution, int32_t blockSize = 4);
+
+            void Insert(T data, const AABB& aabb);
+
+            /**
+             * Removes an element.
+             * @param data The element to remove
+             * @param aabb The bounding box the element was inserted or last updated with
+             * @return True if the element was found, false otherwise
+             */
+            bool Remove(T data, const AABB& aabb);
+
+            /**
+             * Changes the bounding box of an element. Elements which stay in their cell are updated in place.
+             * @param data The element to update
+             * @param lastAABB The bounding box the element was inserted or last updated with
+             * @param aabb The new bounding box of the element
+             * @return True if the element was found, false otherwise. Elements which aren't found aren't inserted.
+             */
+            bool Update(T data, const AABB& lastAABB, const AABB& aabb);
+
+            /**
+             * Shrinks the bounds of all cells and blocks which changed since the last refit.
+             * @note Until then the bounds are just larger than needed, queries are still correct.
+             */
+            void Refit();
+
+            /**
+             * Queries all elements whose bounding box intersects the frustum.
+             * @param data The elements which intersect the frustum are appended here
+             * @param frustum The frustum to test against
+             * @note Queries don't change the grid and can run concurrently.
+             */
+            void QueryFrustum(std::vector<T>& data, const Frustum& frustum) const;
+
+            void GetData(std::vector<T>& data) const;
+
+            size_t GetCount() const;
+
+            void Clear();
+
+            AABB aabb;
+
+        private:
+            struct Cell {
+                AABB aabb;
+                int32_t blockIdx = 0;
+                bool dirty = false;
+
+                std::vector<T> data;
+                std::vector<float> minX, minY, minZ;
+                std::vector<float> maxX, maxY, maxZ;
+            };
+
+            struct Block {
+                AABB aabb;
+                size_t count = 0;
+                bool dirty = false;
+
+                // Only cells which had elements at some point are created
+                std::vector<int32_t> cells;
+            };
+
+            int32_t GetCellIdx(const AABB& aabb) const;
+
+            int32_t GetOrCreateCellIdx(const AABB& aabb);
+
+            int32_t FindElement(const Cell& cell, T data) const;
+
+            void RemoveElement(int32_t cellIdx, int32_t elementIdx);
+
+            void SetElementAABB(Cell& cell, int32_t elementIdx, const AABB& aabb);
+
+            void GrowCell(int32_t cellIdx, const AABB& aabb);
+
+            void MarkDirty(int32_t cellIdx);
+
+            void CullCell(const Cell& cell, const std::vector<vec4>& planes,
+                std::vector<T>& data, std::vector<uint8_t>& visible) const;
+
+            static AABB GetEmptyAABB();
+
+            std::vector<Cell> cells;
+            std::vector<Block> blocks;
+
+            // Dense index of all grid cells into the cells, -1 if the cell wasn't created yet
+            std::vector<int32_t> cellIndices;
+
+            std::vector<int32_t> dirtyCells;
+            std::vector<int32_t> dirtyBlocks;
+
+            int32_t resolution = 1;
+            int32_t blockSize = 1;
+            int32_t blockResolution = 1;
+
+            vec3 inverseCellSize = vec3(1.0f);
+
+            size_t count = 0;
+
+        };
+
+        template <class T>
+        LooseGrid<T>::LooseGrid(AABB aabb, int32_t resolution, int32_t blockSize) :
+            aabb(aabb), resolution(glm::max(resolution, 1)), blockSize(glm::max(blockSize, 1)) {
+
+            blockResolution = (this->resolution + this->blockSize - 1) / this->blockSize;
+            inverseCellSize = vec3(float(this->resolution)) / glm::max(aabb.max - aabb.min, vec3(1e-6f));
+
+            Clear();
+
+        }
+
+        template <class T>
+        void LooseGrid<T>::Insert(T data, const AABB& aabb) {
+
+            auto cellIdx = GetOrCreateCellIdx(aabb);
+            auto& cell = cells[cellIdx];
+
+            cell.data.push_back(data);
+            cell.minX.push_back(aabb.min.x);
+            cell.minY.push_back(aabb.min.y);
+            cell.minZ.push_back(aabb.min.z);
+            cell.maxX.push_back(aabb.max.x);
+            cell.maxY.push_back(aabb.max.y);
+            cell.maxZ.push_back(aabb.max.z);
+
+            blocks[cell.blockIdx].count++;
+            count++;
+
+            GrowCell(cellIdx, aabb);
+
+        }
+
+        template <class T>
+        bool LooseGrid<T>::Remove(T data, const AABB& aabb) {
+
+            auto cellIdx = GetCellIdx(aabb);
+            if (cellIdx < 0)
+                return false;
+
+            auto elementIdx = FindElement(cells[cellIdx], data);
+            if (elementIdx < 0)
+                return false;
+
+            RemoveElement(cellIdx, elementIdx);
+
+            return true;
+
+        }
+
+        template <class T>
+        bool LooseGrid<T>::Update(T data, const AABB& lastAABB, const AABB& aabb) {
+
+            auto cellIdx = GetCellIdx(lastAABB);
+            if (cellIdx < 0)
+                return false;
+
+            auto elementIdx = FindElement(cells[cellIdx], data);
+            if (elementIdx < 0)
+                return false;
+
+            if (GetCellIdx(aabb) == cellIdx) {
+                // The bounds might have shrunk, which is only handled by the next refit
+                SetElementAABB(cells[cellIdx], elementIdx, aabb);
+                GrowCell(cellIdx, aabb);
+                MarkDirty(cellIdx);
+                return true;
+            }
+
+            RemoveElement(cellIdx, elementIdx);
+            Insert(data, aabb);
+
+            return true;
+
+        }
+
+        template <class T>
+        void LooseGrid<T>::Refit() {
+
+            for (auto cellIdx : dirtyCells) {
+                auto& cell = cells[cellIdx];
+                cell.dirty = false;
+
+                cell.aabb = GetEmptyAABB();
+                for (size_t i = 0; i < cell.data.size(); i++) {
+                    cell.aabb.min = glm::min(cell.aabb.min, vec3(cell.minX[i], cell.minY[i], cell.minZ[i]));
+                    cell.aabb.max = glm::max(cell.aabb.max, vec3(cell.maxX[i], cell.maxY[i], cell.maxZ[i]));
+                }
+            }
+
+            for (auto blockIdx : dirtyBlocks) {
+                auto& block = blocks[blockIdx];
+                block.dirty = false;
+
+                block.aabb = GetEmptyAABB();
+                for (auto cellIdx : block.cells) {
+                    const auto& cell = cells[cellIdx];
+                    if (cell.data.empty())
+                        continue;
+
+                    block.aabb.min = glm::min(block.aabb.min, cell.aabb.min);
+                    block.aabb.max = glm::max(block.aabb.max, cell.aabb.max);
+                }
+            }
+
+            dirtyCells.clear();
+            dirtyBlocks.clear();
+
+        }
+
+        template <class T>
+        void LooseGrid<T>::QueryFrustum(std::vector<T>& data, const Frustum& frustum) const {
+
+            auto planes = frustum.GetPlanes();
+            std::vector<uint8_t> visible;
+
+            for (const auto& block : blocks) {
+                if (!block.count || !frustum.Intersects(block.aabb))
+                    continue;
+
+                // Everything in a block which is completely visible doesn't need to be tested
+                auto blockInside = frustum.IsInside(block.aabb);
+
+                for (auto cellIdx : block.cells) {
+                    const auto& cell = cells[cellIdx];
+                    if (cell.data.empty())
+                        continue;
+
+                    if (blockInside || frustum.IsInside(cell.aabb))
+                        data.insert(data.end(), cell.data.begin(), cell.data.end());
+                    else if (frustum.Intersects(cell.aabb))
+                        CullCell(cell, planes, data, visible);
+                }
+            }
+
+        }
+
+        template <class T>
+        void LooseGrid<T>::GetData(std::vector<T>& data) const {
+
+            for (const auto& cell : cells)
+                data.insert(data.end(), cell.data.begin(), cell.data.end());
+
+        }
+
+        template <class T>
+        size_t LooseGrid<T>::GetCount() const {
+
+            return count;
+
+        }
+
+        template <class T>
+        void LooseGrid<T>::Clear() {
+
+            cells.clear();
+            dirtyCells.clear();
+            dirtyBlocks.clear();
+
+            blocks.assign(size_t(blockResolution) * size_t(blockResolution) * size_t(blockResolution), Block());
+            for (auto& block : blocks)
+                block.aabb = GetEmptyAABB();
+
+            cellIndices.assign(size_t(resolution) * size_t(resolution) * size_t(resolution), -1);
+
+            count = 0;
+
+        }
+
+        template <class T>
+        int32_t LooseGrid<T>::GetCellIdx(const AABB& aabb) const {
+
+            auto center = 0.5f * (aabb.min + aabb.max);
+            auto coord = glm::clamp(ivec3(glm::floor((center - this->aabb.min) * inverseCellSize)),
+                ivec3(0), ivec3(resolution - 1));
+
+            return cellIndices[(size_t(coord.z) * size_t(resolution) + size_t(coord.y)) *
+                size_t(resolution) + size_t(coord.x)];
+
+        }
+
+        template <class T>
+        int32_t LooseGrid<T>::GetOrCreateCellIdx(const AABB& aabb) {
+
+            auto center = 0.5f * (aabb.min + aabb.max);
+            auto coord = glm::clamp(ivec3(glm::floor((center - this->aabb.min) * inverseCellSize)),
+                ivec3(0), ivec3(resolution - 1));
+
+            auto& cellIdx = cellIndices[(size_t(coord.z) * size_t(resolution) + size_t(coord.y)) *
+                size_t(resolution) + size_t(coord.x)];
+            if (cellIdx >= 0)
+                return cellIdx;
+
+            auto blockCoord = coord / blockSize;
+            auto blockIdx = (blockCoord.z * blockResolution + blockCoord.y) * blockResolution + blockCoord.x;
+
+            cellIdx = int32_t(cells.size());
+            blocks[blockIdx].cells.push_back(cellIdx);
+
+            Cell cell;
+            cell.aabb = GetEmptyAABB();
+            cell.blockIdx = blockIdx;
+            cells.push_back(std::move(cell));
+
+            return cellIdx;
+
+        }
+
+        template <class T>
+        int32_t LooseGrid<T>::FindElement(const Cell& cell, T data) const {
+
+            auto iter = std::find(cell.data.begin(), cell.data.end(), data);
+            if (iter == cell.data.end())
+                return -1;
+
+            return int32_t(iter - cell.data.begin());
+
+        }
+
+        template <class T>
+        void LooseGrid<T>::RemoveElement(int32_t cellIdx, int32_t elementIdx) {
+
+            auto& cell = cells[cellIdx];
+
+            // Swap with the last element, the order within a cell doesn't matter
+            auto lastIdx = int32_t(cell.data.size()) - 1;
+            if (elementIdx != lastIdx) {
+                cell.data[elementIdx] = cell.data[lastIdx];
+                cell.minX[elementIdx] = cell.minX[lastIdx];
+                cell.minY[elementIdx] = cell.minY[lastIdx];
+                cell.minZ[elementIdx] = cell.minZ[lastIdx];
+                cell.maxX[elementIdx] = cell.maxX[lastIdx];
+                cell.maxY[elementIdx] = cell.maxY[lastIdx];
+                cell.maxZ[elementIdx] = cell.maxZ[lastIdx];
+            }
+
+            cell.data.pop_back();
+            cell.minX.pop_back();
+            cell.minY.pop_back();
+            cell.minZ.pop_back();
+            cell.maxX.pop_back();
+            cell.maxY.pop_back();
+            cell.maxZ.pop_back();
+
+            blocks[cell.blockIdx].count--;
+            count--;
+
+            MarkDirty(cellIdx);
+
+        }
+
+        template <class T>
+        void LooseGrid<T>::SetElementAABB(Cell& cell, int32_t elementIdx, const AABB& aabb) {
+
+            cell.minX[elementIdx] = aabb.min.x;
+            cell.minY[elementIdx] = aabb.min.y;
+            cell.minZ[elementIdx] = aabb.min.z;
+            cell.maxX[elementIdx] = aabb.max.x;
+            cell.maxY[elementIdx] = aabb.max.y;
+            cell.maxZ[elementIdx] = aabb.max.z;
+
+        }
+
+        template <class T>
+        void LooseGrid<T>::GrowCell(int32_t cellIdx, const AABB& aabb) {
+
+            auto& cell = cells[cellIdx];
+            auto& block = blocks[cell.blockIdx];
+
+            cell.aabb.min = glm::min(cell.aabb.min, aabb.min);
+            cell.aabb.max = glm::max(cell.aabb.max, aabb.max);
+            block.aabb.min = glm::min(block.aabb.min, aabb.min);
+            block.aabb.max = glm::max(block.aabb.max, aabb.max);
+
+        }
+
+        template <class T>
+        void LooseGrid<T>::MarkDirty(int32_t cellIdx) {
+
+            auto& cell = cells[cellIdx];
+            if (!cell.dirty) {
+                cell.dirty = true;
+                dirtyCells.push_back(cellIdx);
+            }
+
+            auto& block = blocks[cell.blockIdx];
+            if (!block.dirty) {
+                block.dirty = true;
+                dirtyBlocks.push_back(cell.blockIdx);
+            }
+
+        }
+
+        template <class T>
+        void LooseGrid<T>::CullCell(const Cell& cell, const std::vector<vec4>& planes,
+            std::vector<T>& data, std::vector<uint8_t>& visible) const {
+
+            auto elementCount = cell.data.size();
+            visible.assign(elementCount, 1);
+
+            // Same test as Frustum::Intersects(), but one plane at a time for all elements
+            for (const auto& plane : planes) {
+                auto x = plane.x >= 0.0f ? cell.maxX.data() : cell.minX.data();
+                auto y = plane.y >= 0.0f ? cell.maxY.data() : cell.minY.data();
+                auto z = plane.z >= 0.0f ? cell.maxZ.data() : cell.minZ.data();
+
+                for (size_t i = 0; i < elementCount; i++)
+                    visible[i] &= uint8_t(plane.w + (plane.x * x[i] + plane.y * y[i] + plane.z * z[i]) >= 0.0f);
+            }
+
+            for (size_t i = 0; i < elementCount; i++)
+                if (visible[i])
+                    data.push_back(cell.data[i]);
+
+        }
+
+        template <class T>
+        AABB LooseGrid<T>::GetEmptyAABB() {
+
+            return AABB(vec3(std::numeric_limits<float>::max()), vec3(-std::numeric_limits<float>::max()));
+
+        }
+
+    }
+
+}
@@ -0,0 +1,491 @@
+#include "WideBVH.h"
+
+#include <cstring>
+#include <cmath>
+#include <bit>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AE_WIDE_BVH_SSE
+#include <emmintrin.h>
+#endif
+
+namespace Atlas {
+
+    namespace Volume {
+
+        // Enough for the deepest trees the binary builders generate, each level pushes at most width - 1 entries
+        static constexpr int32_t wideStackSize = 512;
+
+        // Slightly enlarges the slab intervals to make up for the rounding of the dequantization
+        static constexpr float robustFarFactor = 1.0f + 1e-5f;
+
+        WideBVH::WideBVH(const BVH& bvh) {
+
+            AE_ASSERT(bvh.data.size() == bvh.aabbs.size() && "The BVH needs to be built with triangle data");
+
+            if (bvh.nodes.empty() || bvh.data.empty())
+                return;
+
+            triangles.resize(bvh.data.size());
+            for (size_t i = 0; i < bvh.data.size(); i++) {
+                const auto& bvhTriangle = bvh.data[i];
+                auto& triangle = triangles[i];
+
+                triangle.v0 = bvhTriangle.v0;
+                triangle.e0 = bvhTriangle.v1 - bvhTriangle.v0;
+                triangle.e1 = bvhTriangle.v2 - bvhTriangle.v0;
+                triangle.idx = bvhTriangle.idx;
+                triangle.endOfNode = bvhTriangle.endOfNode;
+            }
+
+            // A binary node has at most two children, so at least half of the nodes are needed
+            nodes.reserve(bvh.nodes.size() / 2 + 1);
+            Collapse(bvh, 0, 1);
+
+            // Queries on a tree which is too deep would overflow the traversal stack
+            if ((width - 1) * maxDepth + 1 > wideStackSize) {
+                AE_ASSERT(false && "BVH is too deep for traversal");
+                Clear();
+            }
+
+        }
+
+        bool WideBVH::GetIntersection(const Ray& ray, RayResult<uint32_t>& result) const {
+
+            if (nodes.empty())
+                return false;
+
+            struct StackEntry {
+                int32_t ptr;
+                float distance;
+            };
+
+            StackEntry stack[wideStackSize];
+            int32_t stackPtr = 0;
+            stack[stackPtr++] = { 0, ray.tMin };
+
+            auto traversalRay = PrepareRay(ray);
+            auto closestDistance = ray.tMax;
+            int32_t closestIdx = -1;
+
+            while (stackPtr > 0) {
+                const auto [ptr, distance] = stack[--stackPtr];
+
+                if (distance > closestDistance)
+                    continue;
+
+                if (ptr < 0) {
+                    for (auto idx = ~ptr; ; idx++) {
+                        const auto& triangle = triangles[idx];
+                        if (IntersectTriangle(triangle, traversalRay, closestDistance))
+                            closestIdx = idx;
+                        if (triangle.endOfNode)
+                            break;
+                    }
+                    continue;
+                }
+
+                const auto& node = nodes[ptr];
+
+                float distances[width];
+                auto mask = IntersectChildren(node, traversalRay, closestDistance, distances);
+
+                // Push far children first, such that the nearest child is traversed next
+                int32_t hitCount = 0;
+                StackEntry hits[width];
+                for (int32_t i = 0; i < width; i++) {
+                    if (!(mask & (1 << i)))
+                        continue;
+
+                    auto j = hitCount++;
+                    for (; j > 0 && hits[j - 1].distance < distances[i]; j--)
+                        hits[j] = hits[j - 1];
+                    hits[j] = { node.children[i], distances[i] };
+                }
+
+                for (int32_t i = 0; i < hitCount; i++)
+                    stack[stackPtr++] = hits[i];
+            }
+
+            if (closestIdx < 0)
+                return false;
+
+            FillResult(triangles[closestIdx], closestDistance, result);
+            return true;
+
+        }
+
+        bool WideBVH::GetIntersectionAny(const Ray& ray) const {
+
+            if (nodes.empty())
+                return false;
+
+            int32_t stack[wideStackSize];
+            int32_t stackPtr = 0;
+            stack[stackPtr++] = 0;
+
+            auto traversalRay = PrepareRay(ray);
+            auto distance = ray.tMax;
+
+            while (stackPtr > 0) {
+                auto ptr = stack[--stackPtr];
+
+                if (ptr < 0) {
+                    for (auto idx = ~ptr; ; idx++) {
+                        const auto& triangle = triangles[idx];
+                        if (IntersectTriangle(triangle, traversalRay, distance))
+                            return true;
+                        if (triangle.endOfNode)
+                            break;
+                    }
+                    continue;
+                }
+
+                const auto& node = nodes[ptr];
+
+                float distances[width];
+                auto mask = IntersectChildren(node, traversalRay, distance, distances);
+                for (int32_t i = 0; i < width; i++) {
+                    if (mask & (1 << i))
+                        stack[stackPtr++] = node.children[i];
+                }
+            }
+
+            return false;
+
+        }
+
+        void WideBVH::GetIntersections(const Ray* rays, RayResult<uint32_t>* results, int32_t count) const {
+
+            AE_ASSERT(count <= maxPacketSize && "Too many rays in packet");
+
+            if (nodes.empty() || count <= 0)
+                return;
+
+            // Each entry keeps track of the rays which hit the node, only those are tested further down
+            struct StackEntry {
+                int32_t ptr;
+                float distance;
+                uint32_t rayMask;
+            };
+
+            StackEntry stack[wideStackSize];
+            int32_t stackPtr = 0;
+
+            TraversalRay traversalRays[maxPacketSize];
+            float closestDistances[maxPacketSize];
+            int32_t closestIndices[maxPacketSize];
+
+            float minTMin = std::numeric_limits<float>::max();
+            for (int32_t i = 0; i < count; i++) {
+                traversalRays[i] = PrepareRay(rays[i]);
+                closestDistances[i] = rays[i].tMax;
+                closestIndices[i] = -1;
+                minTMin = glm::min(minTMin, rays[i].tMin);
+            }
+
+            stack[stackPtr++] = { 0, minTMin, (1u << count) - 1u };
+
+            while (stackPtr > 0) {
+                const auto [ptr, distance, rayMask] = stack[--stackPtr];
+
+                // Skip the node if none of its rays found a closer hit in the meantime
+                auto maxDistance = -std::numeric_limits<float>::max();
+                for (auto mask = rayMask; mask; mask &= mask - 1)
+                    maxDistance = glm::max(maxDistance, closestDistances[std::countr_zero(mask)]);
+                if (distance > maxDistance)
+                    continue;
+
+                if (ptr < 0) {
+                    for (auto idx = ~ptr; ; idx++) {
+                        const auto& triangle = triangles[idx];
+                        for (auto mask = rayMask; mask; mask &= mask - 1) {
+                            auto rayIdx = std::countr_zero(mask);
+                            if (IntersectTriangle(triangle, traversalRays[rayIdx], closestDistances[rayIdx]))
+                                closestIndices[rayIdx] = idx;
+                        }
+                        if (triangle.endOfNode)
+                            break;
+                    }
+                    continue;
+                }
+
+                const auto& node = nodes[ptr];
+
+                uint32_t childRayMasks[width] = {};
+                float childDistances[width];
+                for (int32_t i = 0; i < width; i++)
+                    childDistances[i] = std::numeric_limits<float>::max();
+
+                for (auto mask = rayMask; mask; mask &= mask - 1) {
+                    auto rayIdx = std::countr_zero(mask);
+
+                    float distances[width];
+                    auto childMask = IntersectChildren(node, traversalRays[rayIdx], closestDistances[rayIdx], distances);
+                    for (int32_t i = 0; i < width; i++) {
+                        if (!(childMask & (1 << i)))
+                            continue;
+                        childRayMasks[i] |= 1u << rayIdx;
+                        childDistances[i] = glm::min(childDistances[i], distances[i]);
+                    }
+                }
+
+                int32_t hitCount = 0;
+                StackEntry hits[width];
+                for (int32_t i = 0; i < width; i++) {
+                    if (!childRayMasks[i])
+                        continue;
+
+                    auto j = hitCount++;
+                    for (; j > 0 && hits[j - 1].distance < childDistances[i]; j--)
+                        hits[j] = hits[j - 1];
+                    hits[j] = { node.children[i], childDistances[i], childRayMasks[i] };
+                }
+
+                for (int32_t i = 0; i < hitCount; i++)
+                    stack[stackPtr++] = hits[i];
+            }
+
+            for (int32_t i = 0; i < count; i++) {
+                results[i] = RayResult<uint32_t>();
+                if (closestIndices[i] >= 0)
+                    FillResult(triangles[closestIndices[i]], closestDistances[i], results[i]);
+            }
+
+        }
+
+        void WideBVH::Clear() {
+
+            nodes.clear();
+            nodes.shrink_to_fit();
+
+            triangles.clear();
+            triangles.shrink_to_fit();
+
+            maxDepth = 0;
+
+        }
+
+        int32_t WideBVH::Collapse(const BVH& bvh, int32_t binaryNodeIdx, int32_t depth) {
+
+            const auto& binaryNode = bvh.nodes[binaryNodeIdx];
+
+            int32_t childPtrs[width];
+            AABB childAABBs[width];
+            int32_t childCount = 0;
+
+            childPtrs[childCount] = binaryNode.leftPtr;
+            childAABBs[childCount++] = binaryNode.leftAABB;
+
+            // A single triangle is referenced by both children of the root
+            if (binaryNode.rightPtr != binaryNode.leftPtr) {
+                childPtrs[childCount] = binaryNode.rightPtr;
+                childAABBs[childCount++] = binaryNode.rightAABB;
+            }
+
+            // Pull up the children of the largest inner child until the node is full
+            while (childCount < width) {
+                int32_t expandIdx = -1;
+                float maxArea = -1.0f;
+                for (int32_t i = 0; i < childCount; i++) {
+                    if (childPtrs[i] < 0)
+                        continue;
+                    auto area = childAABBs[i].GetSurfaceArea();
+                    if (area > maxArea) {
+                        maxArea = area;
+                        expandIdx = i;
+                    }
+                }
+
+                if (expandIdx < 0)
+                    break;
+
+                const auto& expandedNode = bvh.nodes[childPtrs[expandIdx]];
+                childPtrs[expandIdx] = expandedNode.leftPtr;
+                childAABBs[expandIdx] = expandedNode.leftAABB;
+                childPtrs[childCount] = expandedNode.rightPtr;
+                childAABBs[childCount++] = expandedNode.rightAABB;
+            }
+
+            auto nodeIdx = int32_t(nodes.size());
+            nodes.emplace_back();
+            Quantize(nodes[nodeIdx], childAABBs, childCount);
+
+            maxDepth = glm::max(maxDepth, depth);
+
+            // Leaf pointers stay valid since the triangles are ordered like the ones of the binary BVH
+            for (int32_t i = 0; i < childCount; i++) {
+                auto childPtr = childPtrs[i] < 0 ? childPtrs[i] : Collapse(bvh, childPtrs[i], depth + 1);
+                nodes[nodeIdx].children[i] = childPtr;
+            }
+
+            return nodeIdx;
+
+        }
+
+        void WideBVH::Quantize(Node& node, const AABB* childAABBs, int32_t childCount) {
+
+            auto min = childAABBs[0].min;
+            auto max = childAABBs[0].max;
+            for (int32_t i = 1; i < childCount; i++) {
+                min = glm::min(min, childAABBs[i].min);
+                max = glm::max(max, childAABBs[i].max);
+            }
+
+            node.origin = min;
+
+            for (int32_t axis = 0; axis < 3; axis++) {
+                auto extent = max[axis] - min[axis];
+                auto scale = extent > 0.0f ? extent / 255.0f : 1.0f;
+                node.scale[axis] = scale;
+
+                auto dequantize = [&](int32_t value) { return min[axis] + scale * float(value); };
+
+                for (int32_t i = 0; i < width; i++) {
+                    // Unused children get inverted bounds, which are never hit
+                    if (i >= childCount) {
+                        node.min[axis][i] = 255;
+                        node.max[axis][i] = 0;
+                        node.children[i] = 0;
+                        continue;
+                    }
+
+                    // Round outwards, such that the quantized bounds always contain the original ones
+                    auto childMin = childAABBs[i].min[axis];
+                    auto childMax = childAABBs[i].max[axis];
+
+                    auto quantizedMin = glm::clamp(int32_t(std::floor((childMin - min[axis]) / scale)), 0, 255);
+                    while (quantizedMin > 0 && dequantize(quantizedMin) > childMin)
+                        quantizedMin--;
+
+                    auto quantizedMax = glm::clamp(int32_t(std::ceil((childMax - min[axis]) / scale)), 0, 255);
+                    while (quantizedMax < 255 && dequantize(quantizedMax) < childMax)
+                        quantizedMax++;
+
+                    node.min[axis][i] = uint8_t(quantizedMin);
+                    node.max[axis][i] = uint8_t(quantizedMax);
+                }
+            }
+
+        }
+
+        WideBVH::TraversalRay WideBVH::PrepareRay(const Ray& ray) {
+
+            TraversalRay traversalRay;
+
+            traversalRay.origin = ray.origin;
+            traversalRay.direction = ray.direction;
+            traversalRay.inverseDirection = 1.0f / ray.direction;
+            traversalRay.tMin = ray.tMin;
+            traversalRay.tMax = ray.tMax;
+
+            return traversalRay;
+
+        }
+
+        int32_t WideBVH::IntersectChildren(const Node& node, const TraversalRay& ray, float tMax, float* distances) {
+
+            // The slab distances are computed directly from the quantized values as
+            // (origin - rayOrigin + scale * q) * inverseDirection. Folding this into q * a + b
+            // doesn't work for direction components of zero, where inf - inf results in NaN.
+#ifdef AE_WIDE_BVH_SSE
+            auto loadQuantized = [](const uint8_t* values) {
+                int32_t packed;
+                std::memcpy(&packed, values, sizeof(int32_t));
+
+                auto zero = _mm_setzero_si128();
+                auto bytes = _mm_cvtsi32_si128(packed);
+                auto words = _mm_unpacklo_epi8(bytes, zero);
+                return _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero));
+            };
+
+            auto tNear = _mm_set1_ps(ray.tMin);
+            auto tFar = _mm_set1_ps(tMax);
+
+            for (int32_t axis = 0; axis < 3; axis++) {
+                auto inverseDirection = ray.inverseDirection[axis];
+                auto scale = _mm_set1_ps(node.scale[axis]);
+                auto offset = _mm_set1_ps(node.origin[axis] - ray.origin[axis]);
+                auto inverse = _mm_set1_ps(inverseDirection);
+
+                // The near plane is the max plane for negative directions
+                auto nearValues = inverseDirection >= 0.0f ? node.min[axis] : node.max[axis];
+                auto farValues = inverseDirection >= 0.0f ? node.max[axis] : node.min[axis];
+
+                auto nearDistances = _mm_mul_ps(_mm_add_ps(offset, _mm_mul_ps(loadQuantized(nearValues), scale)), inverse);
+                auto farDistances = _mm_mul_ps(_mm_add_ps(offset, _mm_mul_ps(loadQuantized(farValues), scale)), inverse);
+
+                // A plane which contains a parallel ray results in NaN (0 * inf). The min and max
+                // return their second operand in that case, so the plane is ignored.
+                tNear = _mm_max_ps(nearDistances, tNear);
+                tFar = _mm_min_ps(farDistances, tFar);
+            }
+
+            _mm_storeu_ps(distances, tNear);
+            return _mm_movemask_ps(_mm_cmple_ps(tNear, _mm_mul_ps(tFar, _mm_set1_ps(robustFarFactor))));
+#else
+            int32_t mask = 0;
+            for (int32_t i = 0; i < width; i++) {
+                auto tNear = ray.tMin;
+                auto tFar = tMax;
+
+                for (int32_t axis = 0; axis < 3; axis++) {
+                    auto inverseDirection = ray.inverseDirection[axis];
+                    auto offset = node.origin[axis] - ray.origin[axis];
+
+                    auto nearValue = inverseDirection >= 0.0f ? node.min[axis][i] : node.max[axis][i];
+                    auto farValue = inverseDirection >= 0.0f ? node.max[axis][i] : node.min[axis][i];
+
+                    auto nearDistance = (offset + float(nearValue) * node.scale[axis]) * inverseDirection;
+                    auto farDistance = (offset + float(farValue) * node.scale[axis]) * inverseDirection;
+
+                    // Comparisons with NaN are false, which ignores the plane like in the vectorized path
+                    tNear = nearDistance > tNear ? nearDistance : tNear;
+                    tFar = farDistance < tFar ? farDistance : tFar;
+                }
+
+                distances[i] = tNear;
+                mask |= tNear <= tFar * robustFarFactor ? 1 << i : 0;
+            }
+
+            return mask;
+#endif
+
+        }
+
+        bool WideBVH::IntersectTriangle(const Triangle& triangle, const TraversalRay& ray, float& distance) {
+
+            // Same formulation as Ray::Intersects, such that the results match
+            auto s = ray.origin - triangle.v0;
+
+            auto p = glm::cross(s, triangle.e0);
+            auto q = glm::cross(ray.direction, triangle.e1);
+
+            auto inverseDenominator = 1.0f / glm::dot(q, triangle.e0);
+
+            auto t = glm::dot(p, triangle.e1) * inverseDenominator;
+            if (!(t >= ray.tMin && t < distance))
+                return false;
+
+            auto u = glm::dot(q, s) * inverseDenominator;
+            auto v = glm::dot(p, ray.direction) * inverseDenominator;
+            if (u < 0.0f || v < 0.0f || u + v > 1.0f)
+                return false;
+
+            distance = t;
+            return true;
+
+        }
+
+        void WideBVH::FillResult(const Triangle& triangle, float distance, RayResult<uint32_t>& result) {
+
+            result.valid = true;
+            result.hitDistance = distance;
+            result.normal = glm::normalize(glm::cross(triangle.e0, triangle.e1));
+            result.data = triangle.idx;
+
+        }
+
+    }
+
+}
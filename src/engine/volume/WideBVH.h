@@ -0,0 +1,110 @@
+#pragma once
+
+#include "BVH.h"
+#include "Ray.h"
+
+#include <vector>
+
+namespace Atlas {
+
+    namespace Volume {
+
+        /**
+         * A four wide BVH for triangle ray queries on the CPU, which is collapsed from a binary BVH.
+         * The child bounds of a node are quantized to 8 bits relative to the bounds of the node and
+         * stored per axis, such that a whole node fits into a single cache line and all children are
+         * tested at once with SSE. Hit results reference the index of the triangle in the source data.
+         */
+        class WideBVH {
+
+        public:
+            static constexpr int32_t width = 4;
+            static constexpr int32_t maxPacketSize = 16;
+
+            struct alignas(64) Node {
+                // Child bounds are origin + scale * quantized bounds
+                vec3 origin = vec3(0.0f);
+                vec3 scale = vec3(1.0f);
+
+                uint8_t min[3][width];
+                uint8_t max[3][width];
+
+                // Negative pointers ~idx reference the first triangle of a leaf, unused children are 0
+                int32_t children[width];
+            };
+
+            struct Triangle {
+                vec3 v0;
+                vec3 e0;
+                vec3 e1;
+
+                uint32_t idx;
+                bool endOfNode;
+            };
+
+            WideBVH() = default;
+
+            /**
+             * Constructs a WideBVH object.
+             * @param bvh A binary BVH which was built with triangle data
+             */
+            explicit WideBVH(const BVH& bvh);
+
+            /**
+             * Finds the closest intersection of a ray with the triangles.
+             * @param ray The ray
+             * @param result The closest hit, where the data is the index of the triangle
+             * @return True if there was a hit, false otherwise
+             */
+            bool GetIntersection(const Ray& ray, RayResult<uint32_t>& result) const;
+
+            /**
+             * Checks whether a ray intersects any triangle, which is cheaper than finding the closest hit.
+             * @param ray The ray
+             * @return True if there was a hit, false otherwise
+             */
+            bool GetIntersectionAny(const Ray& ray) const;
+
+            /**
+             * Finds the closest intersections of a packet of rays. The rays share the node fetches, which
+             * is faster than single rays if the rays are coherent, e.g. for neighbouring pixels.
+             * @param rays The rays of the packet
+             * @param results The closest hit for each ray
+             * @param count The number of rays, at most maxPacketSize
+             */
+            void GetIntersections(const Ray* rays, RayResult<uint32_t>* results, int32_t count) const;
+
+            void Clear();
+
+            std::vector<Node> nodes;
+            std::vector<Triangle> triangles;
+
+        private:
+            struct TraversalRay {
+                vec3 origin;
+                vec3 direction;
+                vec3 inverseDirection;
+
+                float tMin;
+                float tMax;
+            };
+
+            int32_t Collapse(const BVH& bvh, int32_t binaryNodeIdx, int32_t depth);
+
+            static void Quantize(Node& node, const AABB* childAABBs, int32_t childCount);
+
+            static TraversalRay PrepareRay(const Ray& ray);
+
+            static int32_t IntersectChildren(const Node& node, const TraversalRay& ray, float tMax, float* distances);
+
+            static bool IntersectTriangle(const Triangle& triangle, const TraversalRay& ray, float& distance);
+
+            static void FillResult(const Triangle& triangle, float distance, RayResult<uint32_t>& result);
+
+            int32_t maxDepth = 0;
+
+        };
+
+    }
+
+}
@@ -0,0 +1,96 @@
+#include "Benchmark.h"
+#include "audio/AudioMixer.h"
+#include "Log.h"
+
+#include <random>
+#include <cmath>
+#include <vector>
+
+using namespace Atlas;
+
+class AudioBenchmark : public Benchmark {
+
+protected:
+    // Interleaved stereo sine wave with a slightly different tone on each channel
+    std::vector<int16_t> CreateClip(int32_t frameCount, float frequency, int32_t sampleRate) {
+        std::vector<int16_t> samples(size_t(frameCount) * 2);
+        for (int32_t i = 0; i < frameCount; i++) {
+            auto time = float(i) / float(sampleRate);
+            samples[i * 2] = int16_t(20000.0f * std::sin(6.2831853f * frequency * time));
+            samples[i * 2 + 1] = int16_t(20000.0f * std::sin(6.2831853f * frequency * 1.5f * time));
+        }
+        return samples;
+    }
+
+    std::mt19937 rng { 42 };
+
+};
+
+// Renders ten seconds of looping voices to memory, once with all voices mixed and once with a voice limit.
+TEST_P(AudioBenchmark, MixVoices) {
+
+    const int32_t sampleRate = 48000;
+    const int32_t channelCount = 2;
+    const int32_t blockSize = 128;
+    const int32_t frameCount = sampleRate * 10;
+
+    auto voiceCount = GetParam();
+
+    // A few distinct clips with odd lengths, such that the loops don't line up with the blocks
+    std::vector<std::vector<int16_t>> clips;
+    for (int32_t i = 0; i < 8; i++)
+        clips.push_back(CreateClip(sampleRate + i * 997, 110.0f * float(i + 1), sampleRate));
+
+    std::uniform_real_distribution<float> volumeDistribution(0.1f, 1.0f);
+    std::uniform_real_distribution<double> pitchDistribution(0.5, 2.0);
+
+    std::vector<int16_t> output(size_t(frameCount) * channelCount);
+
+    for (auto maxRealVoiceCount : { voiceCount, 64 }) {
+        Audio::AudioMixer mixer(sampleRate, channelCount, blockSize, voiceCount, maxRealVoiceCount);
+
+        std::vector<Scope<Audio::AudioStream>> streams;
+        for (int32_t i = 0; i < voiceCount; i++) {
+            auto stream = std::make_unique<Audio::AudioStream>();
+            stream->SetVolume(volumeDistribution(rng));
+            stream->SetPriority(volumeDistribution(rng));
+            // Half of the voices need to be resampled
+            stream->SetPitch(i % 2 ? pitchDistribution(rng) : 1.0);
+
+            const auto& clip = clips[i % clips.size()];
+            ASSERT_TRUE(mixer.AddStream(stream.get()));
+            ASSERT_TRUE(mixer.SetStreamData(stream.get(), clip.data(), int64_t(clip.size()) / channelCount));
+            ASSERT_TRUE(mixer.SetStreamLoop(stream.get(), true));
+
+            streams.push_back(std::move(stream));
+        }
+
+        auto time = Measure([&]() {
+            for (int32_t offset = 0; offset < frameCount; offset += blockSize)
+                mixer.Mix(output.data() + size_t(offset) * channelCount, blockSize);
+        });
+
+        Report("Mix ten seconds with " + std::to_string(maxRealVoiceCount) + " real voices", voiceCount, time);
+
+        EXPECT_EQ(mixer.GetProcessedCommandCount(), mixer.GetSubmittedCommandCount());
+        EXPECT_EQ(mixer.GetRealVoiceCount(), std::min(voiceCount, maxRealVoiceCount));
+        EXPECT_EQ(mixer.GetVirtualVoiceCount(), voiceCount - mixer.GetRealVoiceCount());
+
+        // The limiter needs to keep the sum of all voices below full scale
+        int32_t peak = 0;
+        for (auto sample : output)
+            peak = std::max(peak, std::abs(int32_t(sample)));
+
+        EXPECT_GT(peak, 0);
+        EXPECT_LT(peak, 32767);
+
+        for (auto& stream : streams)
+            ASSERT_TRUE(mixer.RemoveStream(stream.get()));
+
+        mixer.Mix(output.data(), blockSize);
+        EXPECT_EQ(mixer.GetRealVoiceCount(), 0);
+    }
+
+}
+
+INSTANTIATE_TEST_SUITE_P(AudioBenchmarkSuite, AudioBenchmark, testing::ValuesIn(BenchmarkSizes({100, 1000})));
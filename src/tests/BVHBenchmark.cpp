@@ -0,0 +1,551 @@
+#include "Benchmark.h"
+#include "jobsystem/JobSystem.h"
+#include "volume/BVH.h"
+#include "volume/DynamicBVH.h"
+#include "volume/WideBVH.h"
+#include "loader/BVHCacheLoader.h"
+#include "common/Hash.h"
+#include "Log.h"
+
+#include <random>
+#include <functional>
+#include <cmath>
+#include <filesystem>
+
+using namespace Atlas;
+
+class BVHBenchmark : public ParallelBenchmark {
+
+protected:
+    Volume::AABB RandomAABB() {
+        std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+        std::uniform_real_distribution<float> size(0.5f, 10.0f);
+        auto min = vec3(position(rng), position(rng), position(rng));
+        return Volume::AABB(min, min + vec3(size(rng), size(rng), size(rng)));
+    }
+
+    Volume::AABB Move(const Volume::AABB& aabb) {
+        std::uniform_real_distribution<float> offset(-5.0f, 5.0f);
+        auto translation = vec3(offset(rng), offset(rng), offset(rng));
+        return Volume::AABB(aabb.min + translation, aabb.max + translation);
+    }
+
+    // Checks that every child bound matches the union of its subtree and returns the number of reachable leaves
+    size_t Validate(const Volume::DynamicBVH& bvh) {
+        const auto& nodes = bvh.GetTree();
+        if (nodes.empty())
+            return 0;
+
+        // A single leaf is referenced by both children of the root
+        if (bvh.GetLeafCount() == 1) {
+            EXPECT_EQ(nodes[0].leftPtr, nodes[0].rightPtr);
+            return 1;
+        }
+
+        size_t leafCount = 0;
+        std::function<Volume::AABB(int32_t)> validateChild = [&](int32_t ptr) {
+            if (ptr < 0) {
+                leafCount++;
+                EXPECT_TRUE(bvh.IsLeafValid(~ptr));
+                return bvh.GetLeafAABB(~ptr);
+            }
+
+            const auto& node = nodes[ptr];
+            auto leftAABB = validateChild(node.leftPtr);
+            auto rightAABB = validateChild(node.rightPtr);
+
+            EXPECT_TRUE(leftAABB.min == node.leftAABB.min && leftAABB.max == node.leftAABB.max);
+            EXPECT_TRUE(rightAABB.min == node.rightAABB.min && rightAABB.max == node.rightAABB.max);
+
+            return Volume::AABB(glm::min(leftAABB.min, rightAABB.min), glm::max(leftAABB.max, rightAABB.max));
+        };
+
+        validateChild(0);
+        return leafCount;
+    }
+
+    // A displaced sphere, which has a mix of small and large triangles like a typical mesh
+    void CreateMesh(int32_t triangleCount, std::vector<Volume::AABB>& aabbs, std::vector<Volume::BVHTriangle>& triangles) {
+        auto segmentCount = std::max(2, int32_t(std::sqrt(float(triangleCount) / 2.0f)));
+        std::uniform_real_distribution<float> displacement(0.9f, 1.1f);
+
+        std::vector<vec3> vertices;
+        for (int32_t y = 0; y <= segmentCount; y++) {
+            for (int32_t x = 0; x <= segmentCount; x++) {
+                auto theta = 3.14159265f * float(y) / float(segmentCount);
+                auto phi = 2.0f * 3.14159265f * float(x) / float(segmentCount);
+                auto direction = vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+                vertices.push_back(100.0f * displacement(rng) * direction);
+            }
+        }
+
+        auto addTriangle = [&](int32_t idx0, int32_t idx1, int32_t idx2) {
+            Volume::BVHTriangle triangle;
+            triangle.v0 = vertices[idx0];
+            triangle.v1 = vertices[idx1];
+            triangle.v2 = vertices[idx2];
+            triangle.idx = uint32_t(triangles.size());
+            triangles.push_back(triangle);
+
+            auto min = glm::min(triangle.v0, glm::min(triangle.v1, triangle.v2));
+            auto max = glm::max(triangle.v0, glm::max(triangle.v1, triangle.v2));
+            aabbs.push_back(Volume::AABB(min, max));
+        };
+
+        for (int32_t y = 0; y < segmentCount; y++) {
+            for (int32_t x = 0; x < segmentCount; x++) {
+                auto idx = y * (segmentCount + 1) + x;
+                addTriangle(idx, idx + 1, idx + segmentCount + 1);
+                addTriangle(idx + 1, idx + segmentCount + 2, idx + segmentCount + 1);
+            }
+        }
+    }
+
+    // Expected cost of a ray traversal relative to the root, with the same cost factors as the linear builder
+    float ComputeCost(const Volume::BVH& bvh) {
+        const auto& nodes = bvh.nodes;
+        if (nodes.empty())
+            return 0.0f;
+
+        auto rootAABB = nodes[0].leftAABB;
+        rootAABB.Grow(nodes[0].rightAABB);
+
+        float cost = 0.0f;
+        auto addChild = [&](int32_t ptr, const Volume::AABB& aabb) {
+            if (ptr >= 0) {
+                cost += 1.2f * aabb.GetSurfaceArea();
+                return;
+            }
+
+            size_t refCount = 1;
+            if (!bvh.data.empty()) {
+                for (auto idx = size_t(~ptr); !bvh.data[idx].endOfNode; idx++)
+                    refCount++;
+            }
+            cost += float(refCount) * aabb.GetSurfaceArea();
+        };
+
+        for (const auto& node : nodes) {
+            addChild(node.leftPtr, node.leftAABB);
+            addChild(node.rightPtr, node.rightAABB);
+        }
+
+        return cost / rootAABB.GetSurfaceArea();
+    }
+
+    // Returns the number of references in the leaves, which fails for refs referenced more than once
+    size_t CountLeafRefs(const Volume::BVH& bvh) {
+        std::vector<bool> visited(bvh.aabbs.size(), false);
+        size_t refCount = 0;
+
+        for (const auto& node : bvh.nodes) {
+            for (auto ptr : { node.leftPtr, node.rightPtr }) {
+                if (ptr >= 0)
+                    continue;
+
+                for (auto idx = size_t(~ptr); idx < visited.size(); idx++) {
+                    EXPECT_FALSE(visited[idx] && bvh.nodes.size() > 1);
+                    refCount += visited[idx] ? 0 : 1;
+                    visited[idx] = true;
+                    if (bvh.data.empty() || bvh.data[idx].endOfNode)
+                        break;
+                }
+            }
+        }
+
+        return refCount;
+    }
+
+    std::mt19937 rng { 42 };
+
+    const int32_t frameCount = 16;
+
+};
+
+TEST_P(BVHBenchmark, TLASRefit) {
+
+    auto instanceCount = GetParam();
+
+    std::vector<Volume::AABB> aabbs(instanceCount);
+    for (auto& aabb : aabbs)
+        aabb = RandomAABB();
+
+    Volume::DynamicBVH dynamicBvh;
+    std::vector<int32_t> leafIndices(instanceCount);
+    auto initialTime = Measure([&]() {
+        for (int32_t i = 0; i < instanceCount; i++)
+            leafIndices[i] = dynamicBvh.Insert(aabbs[i]);
+        dynamicBvh.Rebuild();
+    });
+
+    ASSERT_EQ(Validate(dynamicBvh), size_t(instanceCount));
+    auto rebuildCost = dynamicBvh.GetCost();
+
+    // A few percent of the instances move each frame, similar to a mostly static scene
+    for (auto movingPercentage : { 1, 5, 25 }) {
+        auto movingStride = 100 / movingPercentage;
+
+        double fullBuildTime = 0.0, refitTime = 0.0;
+        int32_t rebuildCount = 0;
+
+        for (int32_t frame = 0; frame < frameCount; frame++) {
+            for (int32_t i = frame % movingStride; i < instanceCount; i += movingStride)
+                aabbs[i] = Move(aabbs[i]);
+
+            // This is what the ray tracing world did before: a full build and reordering every frame
+            fullBuildTime += Measure([&]() {
+                auto bvh = Volume::BVH(aabbs);
+                std::vector<Volume::AABB> orderedAABBs(bvh.refs.size());
+                for (size_t i = 0; i < bvh.refs.size(); i++)
+                    orderedAABBs[i] = aabbs[bvh.refs[i].idx];
+            });
+
+            refitTime += Measure([&]() {
+                for (int32_t i = frame % movingStride; i < instanceCount; i += movingStride)
+                    dynamicBvh.Update(leafIndices[i], aabbs[i]);
+
+                // Same rebuild as the ray tracing world
+                if (dynamicBvh.NeedsRebuild()) {
+                    dynamicBvh.Rebuild(true, Volume::BVHBuildMode::LinearOptimized);
+                    rebuildCount++;
+                }
+            });
+        }
+
+        ASSERT_EQ(Validate(dynamicBvh), size_t(instanceCount));
+
+        auto moving = " with " + std::to_string(movingPercentage) + "% moving";
+        Report("Full TLAS build" + moving, instanceCount, fullBuildTime / double(frameCount));
+        Report("TLAS refit" + moving, instanceCount, refitTime / double(frameCount));
+        Log::Message("TLAS rebuilds" + moving + ": " + std::to_string(rebuildCount) + ", cost " +
+            std::to_string(dynamicBvh.GetCost()) + " (after rebuild " + std::to_string(rebuildCost) + ")");
+    }
+
+    Report("Initial TLAS build", instanceCount, initialTime);
+
+}
+
+TEST_P(BVHBenchmark, TLASInsertRemove) {
+
+    auto instanceCount = GetParam();
+
+    Volume::DynamicBVH dynamicBvh;
+    std::vector<int32_t> leafIndices;
+    for (int32_t i = 0; i < instanceCount; i++)
+        leafIndices.push_back(dynamicBvh.Insert(RandomAABB()));
+    dynamicBvh.Rebuild();
+
+    // Instances are constantly spawned and despawned, leaf indices are reused in the process
+    auto churnCount = std::max(1, instanceCount / 20);
+    auto time = Measure([&]() {
+        for (int32_t frame = 0; frame < frameCount; frame++) {
+            std::shuffle(leafIndices.begin(), leafIndices.end(), rng);
+            for (int32_t i = 0; i < churnCount; i++) {
+                dynamicBvh.Remove(leafIndices.back());
+                leafIndices.pop_back();
+            }
+            for (int32_t i = 0; i < churnCount; i++)
+                leafIndices.push_back(dynamicBvh.Insert(RandomAABB()));
+
+            if (dynamicBvh.NeedsRebuild())
+                dynamicBvh.Rebuild(true, Volume::BVHBuildMode::LinearOptimized);
+        }
+    });
+
+    ASSERT_EQ(dynamicBvh.GetLeafCount(), size_t(instanceCount));
+    ASSERT_EQ(dynamicBvh.GetLeafCapacity(), size_t(instanceCount));
+    ASSERT_EQ(Validate(dynamicBvh), size_t(instanceCount));
+
+    // Remove everything down to a single leaf and start over
+    while (leafIndices.size() > 1) {
+        dynamicBvh.Remove(leafIndices.back());
+        leafIndices.pop_back();
+    }
+    ASSERT_EQ(Validate(dynamicBvh), size_t(1));
+    leafIndices.push_back(dynamicBvh.Insert(RandomAABB()));
+    ASSERT_EQ(Validate(dynamicBvh), size_t(2));
+
+    Report("TLAS insert and remove of 5% per frame", instanceCount, time / double(frameCount));
+
+}
+
+TEST_P(BVHBenchmark, MeshBuildModes) {
+
+    auto triangleCount = GetParam();
+
+    std::vector<Volume::AABB> aabbs;
+    std::vector<Volume::BVHTriangle> triangles;
+    CreateMesh(triangleCount, aabbs, triangles);
+
+    // Rays from a box around the mesh towards random points inside, most of them hit the mesh
+    std::uniform_real_distribution<float> position(-150.0f, 150.0f);
+    std::uniform_real_distribution<float> target(-50.0f, 50.0f);
+    std::vector<Volume::Ray> rays;
+    for (int32_t i = 0; i < 100000; i++) {
+        auto origin = vec3(position(rng), position(rng), 150.0f);
+        if (i % 2)
+            origin = vec3(150.0f, position(rng), position(rng));
+        auto direction = glm::normalize(vec3(target(rng), target(rng), target(rng)) - origin);
+        rays.push_back(Volume::Ray(origin, direction, 0.0f, 1000.0f));
+    }
+
+    std::vector<float> referenceDistances;
+
+    const std::pair<Volume::BVHBuildMode, std::string> buildModes[] = {
+        { Volume::BVHBuildMode::SAH, "SAH" },
+        { Volume::BVHBuildMode::Linear, "linear" },
+        { Volume::BVHBuildMode::LinearOptimized, "optimized linear" }
+    };
+
+    for (const auto& [buildMode, name] : buildModes) {
+        Volume::BVH bvh;
+        auto buildTime = Measure([&]() {
+            bvh = Volume::BVH(aabbs, triangles, true, buildMode);
+        });
+
+        // Only the linear builds keep each triangle in exactly one leaf
+        if (buildMode != Volume::BVHBuildMode::SAH)
+            ASSERT_EQ(CountLeafRefs(bvh), triangles.size());
+
+        // Linear trees are deeper than SAH trees
+        std::vector<std::pair<int32_t, float>> stack(256);
+        std::vector<float> distances(rays.size());
+        auto traceTime = Measure([&]() {
+            for (size_t i = 0; i < rays.size(); i++) {
+                Volume::BVHTriangle triangle;
+                vec3 intersection;
+                bvh.GetIntersection(stack, rays[i], triangle, intersection);
+                distances[i] = intersection.x;
+            }
+        });
+
+        if (referenceDistances.empty())
+            referenceDistances = distances;
+
+        size_t hitCount = 0;
+        for (size_t i = 0; i < distances.size(); i++) {
+            ASSERT_NEAR(distances[i], referenceDistances[i], 1e-3f);
+            hitCount += distances[i] < rays[i].tMax ? 1 : 0;
+        }
+
+        Report("Mesh BVH " + name + " build", triangleCount, buildTime);
+        Report("Mesh BVH " + name + " trace of " + std::to_string(rays.size()) +
+            " rays (" + std::to_string(hitCount) + " hits)", triangleCount, traceTime);
+        Log::Message("Mesh BVH " + name + " cost: " + std::to_string(ComputeCost(bvh)));
+    }
+
+}
+
+TEST_P(BVHBenchmark, AABBBuildModes) {
+
+    auto instanceCount = GetParam();
+
+    std::vector<Volume::AABB> aabbs(instanceCount);
+    for (auto& aabb : aabbs)
+        aabb = RandomAABB();
+
+    const std::pair<Volume::BVHBuildMode, std::string> buildModes[] = {
+        { Volume::BVHBuildMode::SAH, "SAH" },
+        { Volume::BVHBuildMode::Linear, "linear" },
+        { Volume::BVHBuildMode::LinearOptimized, "optimized linear" }
+    };
+
+    for (const auto& [buildMode, name] : buildModes) {
+        Volume::BVH bvh;
+        auto buildTime = Measure([&]() {
+            bvh = Volume::BVH(aabbs, true, buildMode);
+        });
+
+        ASSERT_EQ(bvh.refs.size(), aabbs.size());
+        ASSERT_EQ(CountLeafRefs(bvh), aabbs.size());
+
+        // Sequential and parallel builds need to result in the same tree
+        if (buildMode != Volume::BVHBuildMode::SAH) {
+            auto sequentialBvh = Volume::BVH(aabbs, false, buildMode);
+            ASSERT_EQ(sequentialBvh.nodes.size(), bvh.nodes.size());
+            for (size_t i = 0; i < bvh.refs.size(); i++)
+                ASSERT_EQ(sequentialBvh.refs[i].idx, bvh.refs[i].idx);
+        }
+
+        Report("AABB BVH " + name + " build", instanceCount, buildTime);
+        Log::Message("AABB BVH " + name + " cost: " + std::to_string(ComputeCost(bvh)));
+    }
+
+    // Single instances are stored the same way as with the SAH build
+    auto singleBvh = Volume::BVH({ aabbs.front() }, true, Volume::BVHBuildMode::LinearOptimized);
+    ASSERT_EQ(singleBvh.nodes.size(), size_t(1));
+    ASSERT_EQ(singleBvh.nodes[0].leftPtr, ~0);
+    ASSERT_EQ(singleBvh.nodes[0].rightPtr, ~0);
+
+}
+
+TEST_P(BVHBenchmark, CPURayTracing) {
+
+    auto triangleCount = GetParam();
+
+    std::vector<Volume::AABB> aabbs;
+    std::vector<Volume::BVHTriangle> triangles;
+    CreateMesh(triangleCount, aabbs, triangles);
+
+    // Same build as the one of MeshData::BuildBVH
+    auto bvh = Volume::BVH(aabbs, triangles);
+
+    Volume::WideBVH wideBvh;
+    auto collapseTime = Measure([&]() {
+        wideBvh = Volume::WideBVH(bvh);
+    });
+
+    // Primary rays of a pinhole camera are coherent, they are ordered in tiles which form the packets
+    const int32_t resolution = 512;
+    const int32_t tileSize = 4;
+    std::vector<Volume::Ray> coherentRays;
+    for (int32_t tileY = 0; tileY < resolution; tileY += tileSize) {
+        for (int32_t tileX = 0; tileX < resolution; tileX += tileSize) {
+            for (int32_t y = tileY; y < tileY + tileSize; y++) {
+                for (int32_t x = tileX; x < tileX + tileSize; x++) {
+                    auto uv = 2.0f * (vec2(float(x), float(y)) + 0.5f) / float(resolution) - 1.0f;
+                    auto direction = glm::normalize(vec3(0.5f * uv.x, 0.5f * uv.y, -1.0f));
+                    coherentRays.push_back(Volume::Ray(vec3(0.0f, 0.0f, 300.0f), direction, 0.0f, 1000.0f));
+                }
+            }
+        }
+    }
+
+    std::uniform_real_distribution<float> position(-150.0f, 150.0f);
+    std::vector<Volume::Ray> incoherentRays;
+    for (size_t i = 0; i < coherentRays.size(); i++) {
+        auto origin = vec3(position(rng), position(rng), position(rng));
+        auto direction = glm::normalize(vec3(position(rng), position(rng), position(rng)) - origin);
+        incoherentRays.push_back(Volume::Ray(origin, direction, 0.0f, 1000.0f));
+    }
+
+    // Picking and gameplay queries often have direction components of exactly zero, e.g. straight down
+    std::vector<Volume::Ray> axisAlignedRays;
+    const vec3 axisDirections[] = { vec3(0.0f, -1.0f, 0.0f), vec3(1.0f, 0.0f, 0.0f), vec3(0.0f, 0.0f, -1.0f),
+        glm::normalize(vec3(1.0f, 0.0f, -1.0f)) };
+    for (size_t i = 0; axisAlignedRays.size() < coherentRays.size(); i++) {
+        auto direction = axisDirections[i % 4];
+        auto origin = vec3(position(rng), position(rng), position(rng)) - 200.0f * direction;
+        // Some origins lie exactly in a plane of the root bounds
+        if (i % 16 == 0)
+            origin.y = 0.0f;
+        axisAlignedRays.push_back(Volume::Ray(origin, direction, 0.0f, 1000.0f));
+    }
+
+    const std::pair<std::vector<Volume::Ray>*, std::string> rayTypes[] = {
+        { &coherentRays, "coherent" },
+        { &incoherentRays, "incoherent" },
+        { &axisAlignedRays, "axis aligned" }
+    };
+
+    for (const auto& [rays, name] : rayTypes) {
+        auto rayCount = rays->size();
+
+        std::vector<float> binaryDistances(rayCount);
+        std::vector<std::pair<int32_t, float>> stack(256);
+        auto binaryTime = Measure([&]() {
+            for (size_t i = 0; i < rayCount; i++) {
+                Volume::BVHTriangle triangle;
+                vec3 intersection;
+                bvh.GetIntersection(stack, (*rays)[i], triangle, intersection);
+                binaryDistances[i] = intersection.x;
+            }
+        });
+
+        std::vector<Volume::RayResult<uint32_t>> wideResults(rayCount);
+        auto wideTime = Measure([&]() {
+            for (size_t i = 0; i < rayCount; i++)
+                wideBvh.GetIntersection((*rays)[i], wideResults[i]);
+        });
+
+        std::vector<Volume::RayResult<uint32_t>> packetResults(rayCount);
+        auto packetTime = Measure([&]() {
+            for (size_t i = 0; i < rayCount; i += tileSize * tileSize) {
+                auto count = int32_t(std::min(rayCount - i, size_t(tileSize * tileSize)));
+                wideBvh.GetIntersections(&(*rays)[i], &packetResults[i], count);
+            }
+        });
+
+        size_t anyHitCount = 0;
+        auto anyTime = Measure([&]() {
+            for (size_t i = 0; i < rayCount; i++)
+                anyHitCount += wideBvh.GetIntersectionAny((*rays)[i]) ? 1 : 0;
+        });
+
+        size_t hitCount = 0;
+        for (size_t i = 0; i < rayCount; i++) {
+            auto hit = binaryDistances[i] < (*rays)[i].tMax;
+            ASSERT_EQ(wideResults[i].valid, hit);
+            ASSERT_EQ(packetResults[i].valid, hit);
+            if (hit) {
+                ASSERT_NEAR(wideResults[i].hitDistance, binaryDistances[i], 1e-3f);
+                ASSERT_NEAR(packetResults[i].hitDistance, binaryDistances[i], 1e-3f);
+            }
+            hitCount += hit ? 1 : 0;
+        }
+        ASSERT_EQ(anyHitCount, hitCount);
+        ASSERT_GT(hitCount, 0u);
+
+        auto suffix = " of " + std::to_string(rayCount) + " " + name + " rays (" + std::to_string(hitCount) + " hits)";
+        Report("Binary BVH trace" + suffix, triangleCount, binaryTime);
+        Report("Wide BVH trace" + suffix, triangleCount, wideTime);
+        Report("Wide BVH packet trace" + suffix, triangleCount, packetTime);
+        Report("Wide BVH any hit trace" + suffix, triangleCount, anyTime);
+    }
+
+    Report("Wide BVH collapse", triangleCount, collapseTime);
+    Log::Message("BVH node memory: binary " + std::to_string(bvh.nodes.size() * sizeof(Volume::BVHNode)) +
+        " bytes, wide " + std::to_string(wideBvh.nodes.size() * sizeof(Volume::WideBVH::Node)) + " bytes");
+
+}
+
+TEST_P(BVHBenchmark, MeshBVHCache) {
+
+    auto triangleCount = GetParam();
+
+    std::vector<Volume::AABB> aabbs;
+    std::vector<Volume::BVHTriangle> triangles;
+    CreateMesh(triangleCount, aabbs, triangles);
+
+    auto hash = HashBytes(triangles.data(), triangles.size() * sizeof(Volume::BVHTriangle));
+    auto filename = (std::filesystem::temp_directory_path() / ("bvh_cache_" + std::to_string(hash))).string();
+
+    Volume::BVH bvh;
+    auto buildTime = Measure([&]() {
+        bvh = Volume::BVH(aabbs, triangles);
+    });
+
+    auto saveTime = Measure([&]() {
+        Loader::BVHCacheLoader::SaveBVH(filename, hash, bvh);
+    });
+
+    Volume::BVH cachedBvh;
+    bool loaded = false;
+    auto loadTime = Measure([&]() {
+        loaded = Loader::BVHCacheLoader::LoadBVH(filename, hash, triangles, cachedBvh);
+    });
+
+    ASSERT_TRUE(loaded);
+    ASSERT_EQ(cachedBvh.nodes.size(), bvh.nodes.size());
+    ASSERT_EQ(cachedBvh.data.size(), bvh.data.size());
+    ASSERT_EQ(std::memcmp(cachedBvh.nodes.data(), bvh.nodes.data(), bvh.nodes.size() * sizeof(Volume::BVHNode)), 0);
+    for (size_t i = 0; i < bvh.data.size(); i++) {
+        ASSERT_EQ(cachedBvh.data[i].idx, bvh.data[i].idx);
+        ASSERT_EQ(cachedBvh.data[i].endOfNode, bvh.data[i].endOfNode);
+    }
+
+    // Changed data invalidates the cache
+    Volume::BVH invalidBvh;
+    ASSERT_FALSE(Loader::BVHCacheLoader::LoadBVH(filename, hash + 1, triangles, invalidBvh));
+    ASSERT_TRUE(invalidBvh.nodes.empty());
+
+    std::filesystem::remove(filename);
+    ASSERT_FALSE(Loader::BVHCacheLoader::LoadBVH(filename, hash, triangles, invalidBvh));
+
+    Report("Mesh BVH build", triangleCount, buildTime);
+    Report("Mesh BVH cache save", triangleCount, saveTime);
+    Report("Mesh BVH cache load", triangleCount, loadTime);
+
+}
+
+INSTANTIATE_TEST_SUITE_P(BVHBenchmarkSuite, BVHBenchmark, testing::ValuesIn(BenchmarkSizes({1000, 100000})));
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include "jobsystem/JobSystem.h"
+#include "Log.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <initializer_list>
+
+// Workloads above this size are only run if the tests are configured with ATLAS_LARGE_BENCHMARKS
+constexpr int32_t maxDefaultBenchmarkSize = 100000;
+
+/**
+ * Filters the workload sizes of a benchmark, such that a regular test run stays short.
+ * @param sizes All sizes the benchmark is meant to run with
+ * @return The sizes to instantiate the benchmark with, e.g. with testing::ValuesIn()
+ */
+inline std::vector<int32_t> BenchmarkSizes(std::initializer_list<int32_t> sizes) {
+
+    std::vector<int32_t> filteredSizes;
+    for (auto size : sizes) {
+#ifndef AE_LARGE_BENCHMARKS
+        if (size > maxDefaultBenchmarkSize)
+            continue;
+#endif
+        filteredSizes.push_back(size);
+    }
+
+    return filteredSizes;
+
+}
+
+/**
+ * Base fixture of all benchmarks, the parameter is the size of the workload.
+ */
+class Benchmark : public testing::TestWithParam<int32_t> {
+
+protected:
+    // Returns the average time of all iterations in milliseconds
+    template<class F>
+    double Measure(F&& func, int32_t iterationCount = 1) {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int32_t i = 0; i < iterationCount; i++)
+            func();
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::milli>(end - start).count() / double(iterationCount);
+    }
+
+    void Report(const std::string& name, int32_t count, double milliseconds) {
+        Atlas::Log::Message(name + " [" + std::to_string(count) + "]: " + std::to_string(milliseconds) + "ms");
+    }
+
+};
+
+/**
+ * Base fixture of benchmarks which run jobs. The job system is shared by all tests of a suite.
+ */
+class ParallelBenchmark : public Benchmark {
+
+public:
+    static void SetUpTestSuite() {
+        Atlas::JobSystem::Init(Atlas::JobSystemConfig());
+    }
+
+    static void TearDownTestSuite() {
+        Atlas::JobSystem::Shutdown();
+    }
+
+};
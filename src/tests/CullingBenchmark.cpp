@@ -0,0 +1,156 @@
+#include "Benchmark.h"
+#include "jobsystem/JobSystem.h"
+#include "volume/LooseGrid.h"
+#include "Log.h"
+
+#include <random>
+#include <algorithm>
+
+using namespace Atlas;
+
+class CullingBenchmark : public ParallelBenchmark {
+
+protected:
+    // Same distribution as the meshes in the scene benchmark
+    Volume::AABB RandomAABB() {
+        std::uniform_real_distribution<float> position(-1500.0f, 1500.0f);
+        std::uniform_real_distribution<float> size(0.5f, 10.0f);
+        auto min = vec3(position(rng), position(rng), position(rng));
+        return Volume::AABB(min, min + vec3(size(rng), size(rng), size(rng)));
+    }
+
+    // Cameras on a circle around the center looking outwards, like a player turning around
+    std::vector<Volume::Frustum> GetFrustums() {
+        std::vector<Volume::Frustum> frustums;
+        // Same projection as a camera component
+        const mat4 clip = mat4(1.0f, 0.0f, 0.0f, 0.0f,
+            0.0f, -1.0f, 0.0f, 0.0f,
+            0.0f, 0.0f, 0.5f, 0.0f,
+            0.0f, 0.0f, 0.5f, 1.0f);
+        auto projection = clip * glm::perspective(glm::radians(47.0f), 2.0f, 1.0f, 1000.0f);
+        for (int32_t i = 0; i < frustumCount; i++) {
+            auto angle = float(i) / float(frustumCount) * 2.0f * 3.14159265f;
+            auto direction = vec3(std::cos(angle), 0.0f, std::sin(angle));
+            auto location = 200.0f * direction;
+            auto view = glm::lookAt(location, location + direction, vec3(0.0f, 1.0f, 0.0f));
+            frustums.emplace_back(projection * view);
+        }
+        return frustums;
+    }
+
+    // This is what Scene::GetRenderList() did before: test every bounding box
+    void ReferenceQuery(std::vector<uint32_t>& data, const Volume::Frustum& frustum) {
+        for (size_t i = 0; i < aabbs.size(); i++)
+            if (frustum.Intersects(aabbs[i]))
+                data.push_back(uint32_t(i));
+    }
+
+    void Query(std::vector<uint32_t>& data, const Volume::Frustum& frustum) {
+        staticGrid.QueryFrustum(data, frustum);
+        movableGrid.QueryFrustum(data, frustum);
+    }
+
+    void ExpectEqual(std::vector<uint32_t> data0, std::vector<uint32_t> data1) {
+        std::sort(data0.begin(), data0.end());
+        std::sort(data1.begin(), data1.end());
+        ASSERT_TRUE(data0 == data1);
+    }
+
+    std::vector<Volume::AABB> aabbs;
+
+    // Same setup as the space partitioning of a default scene
+    Volume::LooseGrid<uint32_t> staticGrid { Volume::AABB(vec3(-2048.0f), vec3(2048.0f)), 32 };
+    Volume::LooseGrid<uint32_t> movableGrid { Volume::AABB(vec3(-2048.0f), vec3(2048.0f)), 32 };
+
+    std::mt19937 rng { 42 };
+
+    const int32_t frustumCount = 8;
+
+};
+
+TEST_P(CullingBenchmark, FrustumQueries) {
+
+    auto count = GetParam();
+
+    // A mostly static world, where one percent of the elements can move
+    aabbs.resize(count);
+    for (auto& aabb : aabbs)
+        aabb = RandomAABB();
+
+    auto insertTime = Measure([&]() {
+        for (int32_t i = 0; i < count; i++) {
+            if (i % 100 == 0)
+                movableGrid.Insert(uint32_t(i), aabbs[i]);
+            else
+                staticGrid.Insert(uint32_t(i), aabbs[i]);
+        }
+    });
+
+    ASSERT_EQ(staticGrid.GetCount() + movableGrid.GetCount(), size_t(count));
+
+    auto frustums = GetFrustums();
+
+    std::vector<std::vector<uint32_t>> referenceData(frustumCount);
+    auto referenceTime = Measure([&]() {
+        for (int32_t i = 0; i < frustumCount; i++)
+            ReferenceQuery(referenceData[i], frustums[i]);
+    });
+
+    std::vector<std::vector<uint32_t>> data(frustumCount);
+    auto gridTime = Measure([&]() {
+        for (int32_t i = 0; i < frustumCount; i++)
+            Query(data[i], frustums[i]);
+    });
+
+    size_t visibleCount = 0;
+    for (int32_t i = 0; i < frustumCount; i++) {
+        ExpectEqual(data[i], referenceData[i]);
+        visibleCount += data[i].size();
+    }
+
+    // Move the movable elements, most of them stay in their cell
+    std::uniform_real_distribution<float> offset(-5.0f, 5.0f);
+    std::vector<Volume::AABB> movedAABBs(aabbs);
+    for (int32_t i = 0; i < count; i += 100) {
+        auto translation = vec3(offset(rng), offset(rng), offset(rng));
+        movedAABBs[i] = Volume::AABB(aabbs[i].min + translation, aabbs[i].max + translation);
+    }
+
+    auto updateTime = Measure([&]() {
+        for (int32_t i = 0; i < count; i += 100)
+            movableGrid.Update(uint32_t(i), aabbs[i], movedAABBs[i]);
+        movableGrid.Refit();
+    });
+
+    aabbs = movedAABBs;
+
+    for (int32_t i = 0; i < frustumCount; i++) {
+        std::vector<uint32_t> movedData, movedReferenceData;
+        Query(movedData, frustums[i]);
+        ReferenceQuery(movedReferenceData, frustums[i]);
+        ExpectEqual(movedData, movedReferenceData);
+    }
+
+    // Removed elements are gone from all following queries
+    for (int32_t i = 0; i < count; i += 2) {
+        auto& grid = i % 100 == 0 ? movableGrid : staticGrid;
+        ASSERT_TRUE(grid.Remove(uint32_t(i), aabbs[i]));
+        ASSERT_FALSE(grid.Remove(uint32_t(i), aabbs[i]));
+    }
+    staticGrid.Refit();
+    movableGrid.Refit();
+
+    std::vector<uint32_t> remainingData;
+    Query(remainingData, frustums[0]);
+    for (auto idx : remainingData)
+        ASSERT_EQ(idx % 2, 1u);
+
+    auto suffix = " (" + std::to_string(frustumCount) + " frustums, " + std::to_string(visibleCount) + " visible)";
+    Report("Culling insert into loose grids", count, insertTime);
+    Report("Culling with linear scan" + suffix, count, referenceTime);
+    Report("Culling with loose grids" + suffix, count, gridTime);
+    Report("Culling update of one percent moved elements", count, updateTime);
+
+}
+
+INSTANTIATE_TEST_SUITE_P(CullingBenchmarkSuite, CullingBenchmark, testing::ValuesIn(BenchmarkSizes({10000, 100000, 1000000})));
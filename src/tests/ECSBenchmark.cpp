@@ -0,0 +1,163 @@
+#include "Benchmark.h"
+#include "ecs/EntityManager.h"
+#include "Log.h"
+
+#include <random>
+
+using namespace Atlas;
+
+struct PositionComponent {
+    vec3 position = vec3(0.0f);
+};
+
+struct VelocityComponent {
+    vec3 velocity = vec3(1.0f);
+};
+
+struct MassComponent {
+    float mass = 2.0f;
+};
+
+// Compares iterating subsets, which look up all other pools for each candidate, with owning groups
+class ECSBenchmark : public Benchmark {
+
+protected:
+    // Every entity has a position, but only every other one a velocity or mass
+    void Populate(ECS::EntityManager& entityManager, int32_t entityCount) {
+        std::mt19937 rng { 42 };
+        std::bernoulli_distribution distribution(0.5);
+
+        for (int32_t i = 0; i < entityCount; i++) {
+            auto entity = entityManager.Create();
+            entityManager.Emplace<PositionComponent>(entity);
+            if (distribution(rng))
+                entityManager.Emplace<VelocityComponent>(entity);
+            if (distribution(rng))
+                entityManager.Emplace<MassComponent>(entity);
+        }
+    }
+
+    const int32_t iterationCount = 10;
+    const float deltaTime = 1.0f / 60.0f;
+
+};
+
+TEST_P(ECSBenchmark, TwoComponents) {
+
+    auto entityCount = GetParam();
+
+    ECS::EntityManager subsetEntityManager, groupEntityManager;
+    Populate(subsetEntityManager, entityCount);
+    Populate(groupEntityManager, entityCount);
+
+    size_t subsetCount = 0;
+    auto subsetTime = Measure([&]() {
+        subsetCount = 0;
+        auto subset = subsetEntityManager.GetSubset<PositionComponent, VelocityComponent>();
+        for (auto entity : subset) {
+            const auto& [positionComponent, velocityComponent] = subset.Get(entity);
+            positionComponent.position = positionComponent.position + deltaTime * velocityComponent.velocity;
+            subsetCount++;
+        }
+    }, iterationCount);
+
+    // Creating the group sorts the existing components once, which isn't part of the measurement
+    groupEntityManager.GetGroup<PositionComponent, VelocityComponent>();
+
+    size_t groupCount = 0;
+    auto groupTime = Measure([&]() {
+        groupCount = 0;
+        auto group = groupEntityManager.GetGroup<PositionComponent, VelocityComponent>();
+        group.Each([&](ECS::Entity entity, PositionComponent& positionComponent, VelocityComponent& velocityComponent) {
+            positionComponent.position = positionComponent.position + deltaTime * velocityComponent.velocity;
+            groupCount++;
+        });
+    }, iterationCount);
+
+    ASSERT_EQ(subsetCount, groupCount);
+
+    Report("Subset with two components", entityCount, subsetTime);
+    Report("Group with two components", entityCount, groupTime);
+
+}
+
+TEST_P(ECSBenchmark, ThreeComponents) {
+
+    auto entityCount = GetParam();
+
+    ECS::EntityManager subsetEntityManager, groupEntityManager;
+    Populate(subsetEntityManager, entityCount);
+    Populate(groupEntityManager, entityCount);
+
+    size_t subsetCount = 0;
+    auto subsetTime = Measure([&]() {
+        subsetCount = 0;
+        auto subset = subsetEntityManager.GetSubset<PositionComponent, VelocityComponent, MassComponent>();
+        for (auto entity : subset) {
+            const auto& [positionComponent, velocityComponent, massComponent] = subset.Get(entity);
+            positionComponent.position = positionComponent.position +
+                (deltaTime / massComponent.mass) * velocityComponent.velocity;
+            subsetCount++;
+        }
+    }, iterationCount);
+
+    groupEntityManager.GetGroup<PositionComponent, VelocityComponent, MassComponent>();
+
+    size_t groupCount = 0;
+    auto groupTime = Measure([&]() {
+        groupCount = 0;
+        auto group = groupEntityManager.GetGroup<PositionComponent, VelocityComponent, MassComponent>();
+        group.Each([&](ECS::Entity entity, PositionComponent& positionComponent,
+            VelocityComponent& velocityComponent, MassComponent& massComponent) {
+            positionComponent.position = positionComponent.position +
+                (deltaTime / massComponent.mass) * velocityComponent.velocity;
+            groupCount++;
+        });
+    }, iterationCount);
+
+    ASSERT_EQ(subsetCount, groupCount);
+
+    Report("Subset with three components", entityCount, subsetTime);
+    Report("Group with three components", entityCount, groupTime);
+
+}
+
+TEST_P(ECSBenchmark, GroupConsistency) {
+
+    auto entityCount = GetParam();
+
+    ECS::EntityManager entityManager;
+    Populate(entityManager, entityCount);
+
+    auto group = entityManager.GetGroup<PositionComponent, VelocityComponent>();
+
+    // Removing and adding components while the group exists needs to keep it packed
+    std::vector<ECS::Entity> entities;
+    for (auto entity : entityManager)
+        entities.push_back(entity);
+
+    for (size_t i = 0; i < entities.size(); i += 3) {
+        if (entityManager.Contains<VelocityComponent>(entities[i]))
+            entityManager.Erase<VelocityComponent>(entities[i]);
+        else
+            entityManager.Emplace<VelocityComponent>(entities[i]);
+    }
+    for (size_t i = 0; i < entities.size(); i += 7)
+        entityManager.Destroy(entities[i]);
+
+    auto subset = entityManager.GetSubset<PositionComponent, VelocityComponent>();
+    size_t subsetCount = 0;
+    for (auto entity : subset)
+        subsetCount++;
+
+    ASSERT_EQ(group.Size(), subsetCount);
+    for (size_t i = 0; i < group.Size(); i++) {
+        auto entity = *(group.begin() + i);
+        ASSERT_TRUE((entityManager.Contains<PositionComponent, VelocityComponent>(entity)));
+        ASSERT_EQ(&entityManager.Get<PositionComponent>(entity), &group.GetByIndex<PositionComponent>(i));
+        ASSERT_EQ(&entityManager.Get<VelocityComponent>(entity), &group.GetByIndex<VelocityComponent>(i));
+    }
+
+}
+
+INSTANTIATE_TEST_SUITE_P(ECSBenchmarkSuite, ECSBenchmark, testing::ValuesIn(BenchmarkSizes({100000, 1000000})));
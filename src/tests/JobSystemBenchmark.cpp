@@ -0,0 +1,375 @@
+#include "Benchmark.h"
+#include "jobsystem/JobSystem.h"
+#include "jobsystem/TaskGraph.h"
+#include "Log.h"
+
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace Atlas;
+
+class JobSystemBenchmark : public ParallelBenchmark {
+
+protected:
+    int32_t threadCount = std::max(2, int32_t(std::thread::hardware_concurrency()));
+
+};
+
+// The queue of the job system before the work stealing deques: jobs are copied in and out
+// of a mutex guarded std::deque, including the function of every single job
+class BaselineJobQueue {
+
+public:
+    struct Job {
+        int32_t idx = 0;
+        JobPriority priority = JobPriority::Low;
+
+        std::atomic_int32_t* counter = nullptr;
+        std::function<void(JobData&)> function;
+
+        void* userData = nullptr;
+    };
+
+    void Push(const Job& job) {
+        std::scoped_lock lock(mutex);
+        jobs.push_back(job);
+    }
+
+    std::optional<Job> Pop() {
+        std::scoped_lock lock(mutex);
+        if (jobs.empty())
+            return std::nullopt;
+
+        auto job = jobs.front();
+        jobs.pop_front();
+        return job;
+    }
+
+private:
+    std::mutex mutex;
+    std::deque<Job> jobs;
+
+};
+
+// Compares the original mutex guarded queue against the lock-free deque on tiny jobs.
+// The producer pushes everything to a single queue and all threads consume from it.
+TEST_P(JobSystemBenchmark, QueueComparison) {
+
+    auto jobCount = GetParam();
+
+    std::atomic_int32_t counter = 0;
+    std::atomic_int32_t executed = 0;
+
+    auto runJob = [&]() {
+        executed++;
+        counter--;
+    };
+
+    auto lockedTime = Measure([&]() {
+        BaselineJobQueue queue;
+        counter = jobCount;
+
+        auto runBaselineJob = [](BaselineJobQueue::Job& job) {
+            JobData data = { .idx = job.idx, .userData = job.userData };
+            job.function(data);
+        };
+
+        std::vector<std::thread> threads;
+        for (int32_t i = 1; i < threadCount; i++) {
+            threads.emplace_back([&]() {
+                while (counter.load() > 0) {
+                    if (auto job = queue.Pop())
+                        runBaselineJob(job.value());
+                }
+            });
+        }
+
+        for (int32_t i = 0; i < jobCount; i++)
+            queue.Push({ .idx = i, .function = [&](JobData&) { runJob(); } });
+
+        while (auto job = queue.Pop())
+            runBaselineJob(job.value());
+
+        for (auto& thread : threads)
+            thread.join();
+    });
+
+    ASSERT_EQ(executed.load(), jobCount);
+    executed = 0;
+
+    std::vector<Job> jobs(jobCount);
+
+    auto lockFreeTime = Measure([&]() {
+        WorkStealingDeque<Job*> deque;
+        counter = jobCount;
+
+        std::vector<std::thread> threads;
+        for (int32_t i = 1; i < threadCount; i++) {
+            threads.emplace_back([&]() {
+                while (counter.load() > 0) {
+                    if (deque.Steal())
+                        runJob();
+                }
+            });
+        }
+
+        for (int32_t i = 0; i < jobCount; i++)
+            deque.Push(&jobs[i]);
+
+        while (deque.Pop())
+            runJob();
+
+        for (auto& thread : threads)
+            thread.join();
+    });
+
+    ASSERT_EQ(executed.load(), jobCount);
+
+    Report("Mutex job queue", jobCount, lockedTime);
+    Report("Work stealing deque", jobCount, lockFreeTime);
+
+}
+
+TEST_P(JobSystemBenchmark, ExecuteMultiple) {
+
+    auto jobCount = GetParam();
+
+    std::atomic_int32_t executed = 0;
+    auto time = Measure([&]() {
+        JobGroup group { JobPriority::High };
+        JobSystem::ExecuteMultiple(group, jobCount, [&executed](JobData&) { executed++; });
+        JobSystem::Wait(group);
+    });
+
+    ASSERT_EQ(executed.load(), jobCount);
+    Report("JobSystem::ExecuteMultiple", jobCount, time);
+
+}
+
+TEST_P(JobSystemBenchmark, WaitAll) {
+
+    auto jobCount = GetParam();
+
+    // Groups of all priorities are only synchronized with a single WaitAll
+    std::atomic_int32_t executed = 0;
+    auto time = Measure([&]() {
+        JobGroup highGroup { JobPriority::High };
+        JobGroup mediumGroup { JobPriority::Medium };
+        JobGroup lowGroup { JobPriority::Low };
+        JobSystem::ExecuteMultiple(highGroup, jobCount, [&executed](JobData&) { executed++; });
+        JobSystem::ExecuteMultiple(mediumGroup, jobCount, [&executed](JobData&) { executed++; });
+        JobSystem::ExecuteAfter({ &highGroup }, lowGroup, [&](JobData&) {
+            JobSystem::ExecuteMultiple(lowGroup, jobCount, [&executed](JobData&) { executed++; });
+        });
+        JobSystem::WaitAll();
+
+        ASSERT_TRUE(highGroup.HasFinished() && mediumGroup.HasFinished() && lowGroup.HasFinished());
+    });
+
+    ASSERT_EQ(executed.load(), 3 * jobCount);
+    Report("JobSystem::WaitAll", jobCount, time);
+
+}
+
+TEST_P(JobSystemBenchmark, ShutdownWithQueuedJobs) {
+
+    auto jobCount = GetParam();
+
+    // Jobs which are still queued and their continuations run during the shutdown
+    std::atomic_int32_t executed = 0;
+    JobGroup group { JobPriority::Low };
+    JobGroup continuationGroup { JobPriority::High };
+    auto time = Measure([&]() {
+        JobSystem::ExecuteMultiple(group, jobCount, [&executed](JobData&) { executed++; });
+        JobSystem::ExecuteAfter({ &group }, continuationGroup, [&executed](JobData&) { executed++; });
+        JobSystem::Shutdown();
+    });
+
+    ASSERT_TRUE(group.HasFinished() && continuationGroup.HasFinished());
+    ASSERT_EQ(executed.load(), jobCount + 1);
+
+    // Without workers, jobs run on the submitting thread and waits return right away
+    JobSystem::Execute(group, [&executed](JobData&) { executed++; });
+    JobSystem::Wait(group);
+    JobSystem::WaitAll();
+    ASSERT_EQ(executed.load(), jobCount + 2);
+
+    JobSystem::Init(JobSystemConfig());
+
+    Report("JobSystem::Shutdown with queued jobs", jobCount, time);
+
+}
+
+TEST_P(JobSystemBenchmark, NestedExecute) {
+
+    auto jobCount = GetParam();
+
+    // Jobs spawned from within workers end up in their local deque and need to be stolen
+    std::atomic_int32_t executed = 0;
+    auto time = Measure([&]() {
+        JobGroup group { JobPriority::High };
+        JobSystem::Execute(group, [&](JobData&) {
+            JobGroup nestedGroup { JobPriority::High };
+            for (int32_t i = 0; i < jobCount; i++)
+                JobSystem::Execute(nestedGroup, [&executed](JobData&) { executed++; });
+            JobSystem::Wait(nestedGroup);
+        });
+        JobSystem::Wait(group);
+    });
+
+    ASSERT_EQ(executed.load(), jobCount);
+    Report("Nested JobSystem::Execute", jobCount, time);
+
+}
+
+TEST_P(JobSystemBenchmark, ParallelFor) {
+
+    auto elementCount = GetParam();
+
+    std::vector<float> data(elementCount, 1.0f);
+    auto work = [&data](int32_t idx) {
+        auto value = data[idx];
+        for (int32_t i = 0; i < 64; i++)
+            value = value * 0.999f + 0.001f;
+        data[idx] = value;
+    };
+
+    // Scale the worker count of the pool from 1 to the number of available cores
+    for (int32_t workerCount = 1; workerCount <= threadCount; workerCount *= 2) {
+        JobSystem::Shutdown();
+        JobSystem::Init(JobSystemConfig {
+            .highPriorityThreadCount = workerCount,
+            .mediumPriorityThreadCount = 1,
+            .lowPriorityThreadCount = 1
+        });
+
+        auto perIndexTime = Measure([&]() {
+            JobGroup group { JobPriority::High };
+            JobSystem::ExecuteMultiple(group, elementCount, [&work](JobData& jobData) { work(jobData.idx); });
+            JobSystem::Wait(group);
+        });
+
+        std::atomic_int32_t processed = 0;
+        auto parallelForTime = Measure([&]() {
+            JobGroup group { JobPriority::High };
+            JobSystem::ParallelFor(group, 0, elementCount, 0, [&](int32_t begin, int32_t end) {
+                for (int32_t i = begin; i < end; i++)
+                    work(i);
+                processed += end - begin;
+            });
+            JobSystem::Wait(group);
+        });
+
+        ASSERT_EQ(processed.load(), elementCount);
+
+        auto workers = " with " + std::to_string(workerCount) + " workers";
+        Report("Per index ExecuteMultiple" + workers, elementCount, perIndexTime);
+        Report("ParallelFor" + workers, elementCount, parallelForTime);
+    }
+
+    JobSystem::Shutdown();
+    JobSystem::Init(JobSystemConfig());
+
+}
+
+TEST_P(JobSystemBenchmark, TaskGraph) {
+
+    auto elementCount = GetParam();
+
+    std::vector<float> transforms(elementCount, 1.0f);
+    std::vector<float> physics(elementCount, 0.0f);
+    std::vector<float> bounds(elementCount, 0.0f);
+    std::atomic_int32_t renderListCount = 0;
+
+    auto transformPass = [&](int32_t begin, int32_t end) {
+        for (int32_t i = begin; i < end; i++) transforms[i] = transforms[i] * 0.5f + 1.0f;
+    };
+    auto physicsPass = [&](int32_t begin, int32_t end) {
+        for (int32_t i = begin; i < end; i++) physics[i] = transforms[i] - 1.0f;
+    };
+    auto boundsPass = [&](int32_t begin, int32_t end) {
+        for (int32_t i = begin; i < end; i++) bounds[i] = transforms[i] + 1.0f;
+    };
+    auto renderListPass = [&](int32_t begin, int32_t end) {
+        int32_t count = 0;
+        for (int32_t i = begin; i < end; i++) count += physics[i] < bounds[i] ? 1 : 0;
+        renderListCount += count;
+    };
+
+    // Every system is synchronized with a blocking wait
+    auto waitTime = Measure([&]() {
+        renderListCount = 0;
+        JobGroup group { JobPriority::High };
+        for (auto pass : { std::function(transformPass), std::function(physicsPass),
+            std::function(boundsPass), std::function(renderListPass) }) {
+            JobSystem::ParallelFor(group, 0, elementCount, 0, pass);
+            JobSystem::Wait(group);
+        }
+    });
+
+    ASSERT_EQ(renderListCount.load(), elementCount);
+
+    // Physics and bounds only depend on the transforms and can run side by side
+    TaskGraph graph;
+    auto transformTask = graph.AddTask("Transforms", [&](JobGroup& group) {
+        JobSystem::ParallelFor(group, 0, elementCount, 0, transformPass); });
+    auto physicsTask = graph.AddTask("Physics", [&](JobGroup& group) {
+        JobSystem::ParallelFor(group, 0, elementCount, 0, physicsPass); }, { transformTask });
+    auto boundsTask = graph.AddTask("Bounds", [&](JobGroup& group) {
+        JobSystem::ParallelFor(group, 0, elementCount, 0, boundsPass); }, { transformTask });
+    graph.AddTask("RenderList", [&](JobGroup& group) {
+        JobSystem::ParallelFor(group, 0, elementCount, 0, renderListPass); }, { physicsTask, boundsTask });
+
+    auto graphTime = Measure([&]() {
+        renderListCount = 0;
+        graph.Execute();
+        graph.Wait();
+    });
+
+    ASSERT_EQ(renderListCount.load(), elementCount);
+
+    Report("Passes with blocking waits", elementCount, waitTime);
+    Report("Passes as task graph", elementCount, graphTime);
+
+}
+
+#ifdef AE_JOBSYSTEM_PROFILING
+TEST_P(JobSystemBenchmark, ProfilerExport) {
+
+    auto jobCount = GetParam();
+
+    JobProfiler::BeginFrame();
+    auto firstFrame = JobProfiler::GetFrameIndex();
+
+    std::atomic_int32_t executed = 0;
+    auto time = Measure([&]() {
+        JobGroup group { JobPriority::Medium };
+        JobSystem::ExecuteMultiple(group, jobCount, [&executed](JobData&) { executed++; });
+        JobSystem::Wait(group);
+    });
+
+    JobProfiler::BeginFrame();
+
+    ASSERT_EQ(executed.load(), jobCount);
+    ASSERT_EQ(JobProfiler::GetPoolStats(JobPriority::Medium).executedJobCount, jobCount);
+
+    auto filename = testing::TempDir() + "jobsystem_trace.json";
+    ASSERT_TRUE(JobProfiler::ExportChromeTrace(filename, firstFrame, firstFrame));
+
+    // Jobs are categorized by the priority of their pool
+    std::stringstream trace;
+    trace << std::ifstream(filename).rdbuf();
+    ASSERT_NE(trace.str().find("\"name\":\"Job\",\"cat\":\"Medium\""), std::string::npos);
+
+    Report("Profiled JobSystem::ExecuteMultiple", jobCount, time);
+
+}
+#endif
+
+INSTANTIATE_TEST_SUITE_P(JobSystemBenchmarkSuite, JobSystemBenchmark, testing::ValuesIn(BenchmarkSizes({1000, 100000})));
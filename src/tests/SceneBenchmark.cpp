@@ -0,0 +1,294 @@
+#include "Benchmark.h"
+#include "jobsystem/JobSystem.h"
+#include "scene/Scene.h"
+#include "resource/ResourceManager.h"
+#include "Log.h"
+
+#include <chrono>
+#include <random>
+
+using namespace Atlas;
+
+// Each scenario changes the scene such that a single pass of Scene::Timestep dominates its time
+class SceneBenchmark : public ParallelBenchmark {
+
+public:
+    static void SetUpTestSuite() {
+        ParallelBenchmark::SetUpTestSuite();
+
+        auto mesh = CreateRef<Mesh::Mesh>();
+        mesh->data.aabb = Volume::AABB(vec3(-1.0f), vec3(1.0f));
+        meshHandle = ResourceManager<Mesh::Mesh>::AddResource("SceneBenchmarkMesh", mesh);
+    }
+
+    static void TearDownTestSuite() {
+        meshHandle = ResourceHandle<Mesh::Mesh>();
+        ParallelBenchmark::TearDownTestSuite();
+    }
+
+protected:
+    void SetUp() override {
+        scene = CreateRef<Scene::Scene>("SceneBenchmark");
+    }
+
+    void TearDown() override {
+        scene = nullptr;
+    }
+
+    // Returns the average time of a timestep in milliseconds, after changing the scene with modify()
+    template<class F>
+    double MeasureTimestep(F&& modify) {
+        // The first timestep does all the initial work, e.g. inserting into the space partitioning
+        scene->Timestep(1.0f / 60.0f);
+
+        double time = 0.0;
+        for (int32_t i = 0; i < frameCount; i++) {
+            modify(i);
+
+            auto start = std::chrono::high_resolution_clock::now();
+            scene->Timestep(1.0f / 60.0f);
+            auto end = std::chrono::high_resolution_clock::now();
+            time += std::chrono::duration<double, std::milli>(end - start).count();
+        }
+
+        return time / double(frameCount);
+    }
+
+    mat4 RandomMatrix() {
+        std::uniform_real_distribution<float> distribution(-1500.0f, 1500.0f);
+        return glm::translate(vec3(distribution(rng), distribution(rng), distribution(rng)));
+    }
+
+    static inline ResourceHandle<Mesh::Mesh> meshHandle;
+
+    Ref<Scene::Scene> scene;
+    std::mt19937 rng { 42 };
+
+    const int32_t frameCount = 4;
+
+};
+
+TEST_P(SceneBenchmark, TransformPass) {
+
+    auto entityCount = GetParam();
+
+    std::vector<Scene::Entity> entities;
+    for (int32_t i = 0; i < entityCount; i++) {
+        auto entity = scene->CreateEntity();
+        entity.AddComponent<TransformComponent>(RandomMatrix(), false);
+        entities.push_back(entity);
+    }
+
+    auto time = MeasureTimestep([&](int32_t frame) {
+        for (auto& entity : entities)
+            entity.GetComponent<TransformComponent>().Translate(vec3(0.0f, 1.0f, 0.0f));
+    });
+
+    Report("Transform pass", entityCount, time);
+
+}
+
+TEST_P(SceneBenchmark, HierarchyPass) {
+
+    auto entityCount = GetParam();
+
+    // A wide and deep tree, where each node has up to 8 children. Moving the root updates all levels.
+    auto root = scene->CreateEntity();
+    root.AddComponent<TransformComponent>(mat4(1.0f), false);
+    root.AddComponent<HierarchyComponent>().root = true;
+
+    std::vector<Scene::Entity> parents = { root };
+    int32_t createdCount = 1, parentIdx = 0;
+    while (createdCount < entityCount) {
+        auto parent = parents[parentIdx];
+
+        for (int32_t i = 0; i < 8 && createdCount < entityCount; i++, createdCount++) {
+            auto entity = scene->CreateEntity();
+            entity.AddComponent<TransformComponent>(glm::translate(vec3(1.0f, 0.0f, 0.0f)), false);
+            entity.AddComponent<HierarchyComponent>();
+            // Adding a component can grow the pool, so the parent component can't be kept across it
+            parent.GetComponent<HierarchyComponent>().AddChild(entity);
+            parents.push_back(entity);
+        }
+
+        parentIdx++;
+    }
+
+    auto time = MeasureTimestep([&](int32_t frame) {
+        root.GetComponent<TransformComponent>().Translate(vec3(0.0f, 1.0f, 0.0f));
+    });
+
+    Report("Hierarchy pass", entityCount, time);
+
+}
+
+TEST_P(SceneBenchmark, MeshPass) {
+
+    auto entityCount = GetParam();
+
+    std::vector<Scene::Entity> entities;
+    for (int32_t i = 0; i < entityCount; i++) {
+        auto entity = scene->CreateEntity();
+        entity.AddComponent<TransformComponent>(RandomMatrix(), false);
+        entity.AddComponent<MeshComponent>(meshHandle);
+        entities.push_back(entity);
+    }
+
+    // All entities move, which means they need to be updated in the space partitioning
+    auto time = MeasureTimestep([&](int32_t frame) {
+        auto offset = frame % 2 ? -50.0f : 50.0f;
+        for (auto& entity : entities)
+            entity.GetComponent<TransformComponent>().Translate(vec3(offset, 0.0f, 0.0f));
+    });
+
+    Report("Mesh pass", entityCount, time);
+
+}
+
+TEST_P(SceneBenchmark, SparseChanges) {
+
+    auto entityCount = GetParam();
+
+    std::vector<Scene::Entity> entities;
+    for (int32_t i = 0; i < entityCount; i++) {
+        auto entity = scene->CreateEntity();
+        entity.AddComponent<TransformComponent>(RandomMatrix(), false);
+        entity.AddComponent<MeshComponent>(meshHandle);
+        entities.push_back(entity);
+    }
+
+    // A mostly static world, where only one percent of the entities move each frame
+    auto time = MeasureTimestep([&](int32_t frame) {
+        for (size_t i = frame; i < entities.size(); i += 100)
+            entities[i].GetComponent<TransformComponent>().Translate(vec3(0.0f, 1.0f, 0.0f));
+    });
+
+    Report("Timestep with one percent changes", entityCount, time);
+
+}
+
+TEST_P(SceneBenchmark, RenderList) {
+
+    auto entityCount = GetParam();
+
+    auto camera = scene->CreateEntity();
+    auto& cameraComponent = camera.AddComponent<CameraComponent>(47.0f, 2.0f, 1.0f, 1000.0f);
+
+    // A mostly static world, where one percent of the entities are movable
+    for (int32_t i = 0; i < entityCount; i++) {
+        auto entity = scene->CreateEntity();
+        entity.AddComponent<TransformComponent>(RandomMatrix(), i % 100 != 0);
+        entity.AddComponent<MeshComponent>(meshHandle);
+    }
+
+    scene->Timestep(1.0f / 60.0f);
+    scene->Update();
+
+    auto pass = CreateRef<RenderList::Pass>();
+    pass->type = RenderList::RenderPassType::Main;
+
+    double referenceTime = 0.0, time = 0.0;
+    size_t referenceCount = 0, count = 0;
+    for (int32_t i = 0; i < frameCount; i++) {
+        cameraComponent.rotation = vec2(float(i) * 1.5f, 0.0f);
+        scene->Update();
+
+        const auto& frustum = cameraComponent.frustum;
+        auto cameraLocation = cameraComponent.GetLocation();
+
+        // This is what Scene::GetRenderList() did before: test every mesh of the scene
+        auto start = std::chrono::high_resolution_clock::now();
+        auto subset = scene->GetSubset<MeshComponent, TransformComponent>();
+        for (auto entity : subset) {
+            auto& comp = subset.Get<MeshComponent>(entity);
+            if (!comp.mesh.IsLoaded())
+                continue;
+
+            auto diff = comp.aabb.GetCenter() - cameraLocation;
+            auto cullingDist = comp.mesh->distanceCulling;
+            if (comp.dontCull || comp.visible && glm::dot(diff, diff) < cullingDist * cullingDist &&
+                frustum.Intersects(comp.aabb))
+                referenceCount++;
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        referenceTime += std::chrono::duration<double, std::milli>(end - start).count();
+
+        pass->meshToEntityMap.clear();
+
+        start = std::chrono::high_resolution_clock::now();
+        scene->GetRenderList(frustum, pass);
+        end = std::chrono::high_resolution_clock::now();
+        time += std::chrono::duration<double, std::milli>(end - start).count();
+
+        for (const auto& [meshId, batch] : pass->meshToEntityMap)
+            count += batch.count;
+    }
+
+    EXPECT_EQ(count, referenceCount);
+
+    Report("Render list with linear scan", entityCount, referenceTime / double(frameCount));
+    Report("Render list with loose grids", entityCount, time / double(frameCount));
+
+}
+
+TEST_P(SceneBenchmark, LightPass) {
+
+    auto entityCount = GetParam();
+
+    for (int32_t i = 0; i < entityCount; i++) {
+        auto entity = scene->CreateEntity();
+        entity.AddComponent<TransformComponent>(RandomMatrix(), true);
+        entity.AddComponent<LightComponent>(LightType::PointLight);
+    }
+
+    auto time = MeasureTimestep([&](int32_t frame) {});
+
+    Report("Light pass", entityCount, time);
+
+}
+
+TEST_P(SceneBenchmark, AudioPass) {
+
+    auto entityCount = GetParam();
+
+    // Every emitter owns a stream, which makes the largest scene too heavy for this scenario
+    if (entityCount > 100000)
+        GTEST_SKIP();
+
+    auto camera = scene->CreateEntity();
+    auto& cameraComponent = camera.AddComponent<CameraComponent>(47.0f, 2.0f, 1.0f, 400.0f);
+
+    // A few percent of the emitters are within their audible range, which is still more than the voice limit
+    std::uniform_real_distribution<float> distribution(-200.0f, 200.0f);
+    for (int32_t i = 0; i < entityCount; i++) {
+        auto entity = scene->CreateEntity();
+        auto location = vec3(distribution(rng), distribution(rng), distribution(rng));
+        entity.AddComponent<TransformComponent>(glm::translate(location), false);
+
+        auto& audioComponent = entity.AddComponent<AudioComponent>();
+        audioComponent.stream = CreateRef<Audio::AudioStream>();
+        audioComponent.falloffFactor = 5.0f;
+    }
+
+    scene->Timestep(1.0f / 60.0f);
+
+    double time = 0.0;
+    for (int32_t i = 0; i < frameCount; i++) {
+        cameraComponent.location = vec3(float(i) * 10.0f, 0.0f, 0.0f);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        scene->Update();
+        auto end = std::chrono::high_resolution_clock::now();
+        time += std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    Report("Audio pass", entityCount, time / double(frameCount));
+
+    const auto& spatialAudio = scene->spatialAudio;
+    EXPECT_EQ(spatialAudio.GetEmitterCount(), entityCount);
+    EXPECT_GT(spatialAudio.GetAudibleCount(), spatialAudio.maxRealVoiceCount);
+    EXPECT_EQ(spatialAudio.GetRealCount(), spatialAudio.maxRealVoiceCount);
+
+}
+
+INSTANTIATE_TEST_SUITE_P(SceneBenchmarkSuite, SceneBenchmark, testing::ValuesIn(BenchmarkSizes({10000, 100000, 1000000})));
@@ -0,0 +1,244 @@
+#include "Benchmark.h"
+#include "jobsystem/JobSystem.h"
+#include "tools/TerrainBaker.h"
+#include "Log.h"
+
+#include <cmath>
+
+using namespace Atlas;
+
+class TerrainBakeBenchmark : public ParallelBenchmark {
+
+protected:
+    void SetUp() override {
+        // The parameter is the root node side count, the rest is a typical terrain layout
+        rootNodeSideCount = GetParam();
+        tileSideCount = rootNodeSideCount << (LoDCount - 1);
+        tileResolution = 8 * patchSizeFactor + 1;
+
+        heightData.resize(tileSideCount * tileSideCount);
+        splatData.resize(heightData.size());
+        for (int32_t x = 0; x < tileSideCount; x++) {
+            for (int32_t y = 0; y < tileSideCount; y++) {
+                auto& cellHeightData = heightData[x * tileSideCount + y];
+                auto& cellSplatData = splatData[x * tileSideCount + y];
+                cellHeightData.resize(tileResolution * tileResolution);
+                cellSplatData.resize(cellHeightData.size());
+                for (int32_t j = 0; j < tileResolution; j++) {
+                    for (int32_t i = 0; i < tileResolution; i++) {
+                        // Adjacent cells share their edges
+                        auto position = vec2(float(x * (tileResolution - 1) + i), float(y * (tileResolution - 1) + j));
+                        auto height = Noise(position);
+                        cellHeightData[i + j * tileResolution] = height;
+                        cellSplatData[i + j * tileResolution] = uint8_t(height * 4.0f);
+                    }
+                }
+            }
+        }
+    }
+
+    float Noise(vec2 position) {
+        auto hills = std::sin(position.x * 0.013f) * std::cos(position.y * 0.011f);
+        auto detail = std::sin(position.x * 0.21f + position.y * 0.17f) * std::sin(position.y * 0.23f);
+        return 0.5f + 0.4f * hills + 0.09f * detail;
+    }
+
+    Tools::TerrainBaker CreateBaker() {
+        Tools::TerrainBaker baker(rootNodeSideCount, LoDCount, patchSizeFactor, bakeResolution, heightScale);
+        for (int32_t x = 0; x < tileSideCount; x++)
+            for (int32_t y = 0; y < tileSideCount; y++)
+                baker.SetCell(x, y, heightData[x * tileSideCount + y].data(), splatData[x * tileSideCount + y].data());
+        return baker;
+    }
+
+    // This is what TerrainTool::BakeTerrain() did before: assemble the whole terrain, calculate the normals
+    // of the whole terrain and then downsample everything for each LoD on a single thread
+    std::vector<Tools::TerrainBaker::Tile> ReferenceBake() {
+        auto quadCount = tileResolution - 1;
+        auto resolution = tileSideCount * quadCount + 1;
+
+        std::vector<uint16_t> heights(resolution * resolution);
+        std::vector<uint8_t> splats(heights.size());
+        for (int32_t i = 0; i < tileSideCount; i++) {
+            for (int32_t j = 0; j < tileSideCount; j++) {
+                for (int32_t y = 0; y < tileResolution; y++) {
+                    for (int32_t x = 0; x < tileResolution; x++) {
+                        auto cellOffset = y * tileResolution + x;
+                        auto imageOffset = (j * quadCount + y) * resolution + i * quadCount + x;
+                        heights[imageOffset] = (uint16_t)(heightData[i * tileSideCount + j][cellOffset] * 65535.0f);
+                        splats[imageOffset] = splatData[i * tileSideCount + j][cellOffset];
+                    }
+                }
+            }
+        }
+
+        auto getHeight = [&](int32_t x, int32_t y) {
+            x = glm::clamp(x, 0, resolution - 1);
+            y = glm::clamp(y, 0, resolution - 1);
+            return (float)heights[y * resolution + x] / 65535.0f * heightScale;
+        };
+
+        std::vector<uint8_t> normals(heights.size() * 3);
+        for (int32_t y = 0; y < resolution; y++) {
+            for (int32_t x = 0; x < resolution; x++) {
+                auto normal = glm::normalize(vec3(getHeight(x - 1, y) - getHeight(x + 1, y), 1.0f,
+                    getHeight(x, y - 1) - getHeight(x, y + 1)));
+                normal = (0.5f * normal + 0.5f) * 255.0f;
+                normals[3 * (y * resolution + x)] = (uint8_t)normal.x;
+                normals[3 * (y * resolution + x) + 1] = (uint8_t)normal.y;
+                normals[3 * (y * resolution + x) + 2] = (uint8_t)normal.z;
+            }
+        }
+
+        std::vector<Tools::TerrainBaker::Tile> tiles;
+        for (int32_t LoD = 0; LoD < LoDCount; LoD++) {
+            auto downsample = 1 << (LoDCount - 1 - LoD);
+            auto sideCount = tileSideCount / downsample;
+
+            auto sizeFactor = glm::min(downsample, bakeResolution / quadCount);
+            auto normalResolution = quadCount * sizeFactor + 3;
+            auto normalDownsample = downsample / sizeFactor;
+
+            auto resizedResolution = normalDownsample == 1 ? resolution : sideCount * (normalResolution - 3) + 1;
+            std::vector<uint8_t> resizedNormals(resizedResolution * resizedResolution * 3);
+            for (int32_t y = 0; y < resizedResolution; y++) {
+                for (int32_t x = 0; x < resizedResolution; x++) {
+                    auto index = (y * normalDownsample) * resolution + x * normalDownsample;
+                    for (int32_t k = 0; k < 3; k++)
+                        resizedNormals[(y * resizedResolution + x) * 3 + k] = normals[index * 3 + k];
+                }
+            }
+
+            for (int32_t i = 0; i < sideCount; i++) {
+                for (int32_t j = 0; j < sideCount; j++) {
+                    Tools::TerrainBaker::Tile tile;
+                    tile.x = i;
+                    tile.y = j;
+                    tile.LoD = LoD;
+                    tile.resolution = tileResolution;
+                    tile.normalResolution = normalResolution;
+
+                    for (int32_t y = 0; y < tileResolution; y++) {
+                        for (int32_t x = 0; x < tileResolution; x++) {
+                            auto index = ((j * quadCount + y) * downsample) * resolution + (i * quadCount + x) * downsample;
+                            tile.heightField.push_back(heights[index]);
+                            tile.splatMap.push_back(splats[index]);
+                        }
+                    }
+
+                    for (int32_t y = -1; y < normalResolution - 1; y++) {
+                        for (int32_t x = -1; x < normalResolution - 1; x++) {
+                            auto xImage = glm::clamp(i * (normalResolution - 3) + x, 0, resizedResolution - 1);
+                            auto yImage = glm::clamp(j * (normalResolution - 3) + y, 0, resizedResolution - 1);
+                            auto index = (yImage * resizedResolution + xImage) * 3;
+                            for (int32_t k = 0; k < 3; k++)
+                                tile.normalMap.push_back(resizedNormals[index + k]);
+                            tile.normalMap.push_back(255);
+                        }
+                    }
+
+                    tiles.push_back(std::move(tile));
+                }
+            }
+        }
+
+        return tiles;
+    }
+
+    void ExpectEqual(const Tools::TerrainBaker::Tile& tile0, const Tools::TerrainBaker::Tile& tile1) {
+        ASSERT_EQ(tile0.x, tile1.x);
+        ASSERT_EQ(tile0.y, tile1.y);
+        ASSERT_EQ(tile0.LoD, tile1.LoD);
+        ASSERT_EQ(tile0.normalResolution, tile1.normalResolution);
+        ASSERT_TRUE(tile0.heightField == tile1.heightField);
+        ASSERT_TRUE(tile0.splatMap == tile1.splatMap);
+
+        // Vectorized normals may differ in rounding
+        ASSERT_EQ(tile0.normalMap.size(), tile1.normalMap.size());
+        for (size_t i = 0; i < tile0.normalMap.size(); i++)
+            ASSERT_NEAR(int32_t(tile0.normalMap[i]), int32_t(tile1.normalMap[i]), 1);
+    }
+
+    std::vector<std::vector<float>> heightData;
+    std::vector<std::vector<uint8_t>> splatData;
+
+    int32_t rootNodeSideCount = 0;
+    int32_t tileSideCount = 0;
+    int32_t tileResolution = 0;
+
+    const int32_t LoDCount = 5;
+    const int32_t patchSizeFactor = 8;
+    const int32_t bakeResolution = 512;
+    const float heightScale = 200.0f;
+
+};
+
+TEST_P(TerrainBakeBenchmark, Bake) {
+
+    auto baker = CreateBaker();
+    auto resolution = baker.GetResolution();
+
+    std::vector<Tools::TerrainBaker::Tile> referenceTiles;
+    auto referenceTime = Measure([&]() {
+        referenceTiles = ReferenceBake();
+    });
+
+    std::vector<Tools::TerrainBaker::Tile> tiles;
+    auto bakeTime = Measure([&]() {
+        tiles = baker.Bake();
+    });
+
+    ASSERT_EQ(tiles.size(), referenceTiles.size());
+    for (size_t i = 0; i < tiles.size(); i++)
+        ExpectEqual(tiles[i], referenceTiles[i]);
+
+    // A brush stroke in the middle of the terrain, like TerrainTool::BrushHeight() does it
+    auto brushCenter = ivec2(resolution / 2 + 7);
+    auto brushRadius = 12;
+    for (int32_t x = brushCenter.x - brushRadius; x <= brushCenter.x + brushRadius; x++) {
+        for (int32_t y = brushCenter.y - brushRadius; y <= brushCenter.y + brushRadius; y++) {
+            auto quadCount = tileResolution - 1;
+            // Shared edges are stored in both cells
+            for (int32_t cellX = (x - 1) / quadCount; cellX <= x / quadCount; cellX++) {
+                for (int32_t cellY = (y - 1) / quadCount; cellY <= y / quadCount; cellY++) {
+                    auto localX = x - cellX * quadCount, localY = y - cellY * quadCount;
+                    if (localX > quadCount || localY > quadCount)
+                        continue;
+                    auto& height = heightData[cellX * tileSideCount + cellY][localX + localY * tileResolution];
+                    height = glm::clamp(height + 0.05f, 0.0f, 1.0f);
+                }
+            }
+        }
+    }
+
+    std::vector<Tools::TerrainBaker::Tile> regionTiles;
+    auto regionTime = Measure([&]() {
+        regionTiles = baker.Bake(brushCenter - brushRadius, brushCenter + brushRadius);
+    });
+
+    // Every tile which changed needs to be baked again, the others need to stay the same
+    auto changedTiles = baker.Bake();
+    size_t regionIdx = 0, changedCount = 0;
+    for (size_t i = 0; i < changedTiles.size(); i++) {
+        const auto& tile = changedTiles[i];
+        auto changed = tile.heightField != tiles[i].heightField || tile.normalMap != tiles[i].normalMap;
+        changedCount += changed ? 1 : 0;
+
+        if (regionIdx < regionTiles.size() && regionTiles[regionIdx].LoD == tile.LoD &&
+            regionTiles[regionIdx].x == tile.x && regionTiles[regionIdx].y == tile.y) {
+            ExpectEqual(regionTiles[regionIdx++], tile);
+            continue;
+        }
+
+        ASSERT_FALSE(changed);
+    }
+    ASSERT_EQ(regionIdx, regionTiles.size());
+
+    Report("Terrain bake, single threaded", resolution, referenceTime);
+    Report("Terrain bake, tile jobs", resolution, bakeTime);
+    Report("Terrain bake of a brush stroke (" + std::to_string(regionTiles.size()) + " of " +
+        std::to_string(tiles.size()) + " tiles, " + std::to_string(changedCount) + " changed)", resolution, regionTime);
+
+}
+
+INSTANTIATE_TEST_SUITE_P(TerrainBakeBenchmarkSuite, TerrainBakeBenchmark, testing::Values(2, 4));
@@ -0,0 +1,249 @@
+#include "Benchmark.h"
+#include "terrain/TerrainHeightQuery.h"
+#include "Log.h"
+
+#include <random>
+#include <cmath>
+
+using namespace Atlas;
+
+class TerrainBenchmark : public Benchmark {
+
+protected:
+    void SetUp() override {
+        // Same layout as the highest LoD of a terrain with 2x2 root nodes, 5 LoDs and a patch size factor of 8
+        cells.assign(cellSideCount * cellSideCount, Terrain::TerrainStorageCell(nullptr));
+        for (int32_t x = 0; x < cellSideCount; x++) {
+            for (int32_t z = 0; z < cellSideCount; z++) {
+                auto& cell = cells[x * cellSideCount + z];
+                cell.heightData.resize(tileResolution * tileResolution);
+                for (int32_t j = 0; j < tileResolution; j++) {
+                    for (int32_t i = 0; i < tileResolution; i++) {
+                        // Adjacent cells share their edges
+                        auto position = vec2(float(x * (tileResolution - 1) + i), float(z * (tileResolution - 1) + j));
+                        cell.heightData[i + j * tileResolution] = Noise(position);
+                    }
+                }
+                cell.UpdateHeightBounds();
+            }
+        }
+    }
+
+    // Rolling hills with some high frequency detail, normalized like the height data of the storage cells
+    float Noise(vec2 position) {
+        auto hills = std::sin(position.x * 0.013f) * std::cos(position.y * 0.011f);
+        auto detail = std::sin(position.x * 0.21f + position.y * 0.17f) * std::sin(position.y * 0.23f);
+        return 0.5f + 0.4f * hills + 0.09f * detail;
+    }
+
+    Terrain::TerrainHeightQuery GetQuery() {
+        return Terrain::TerrainHeightQuery(cells.data(), cellSideCount, cellSideLength, tileResolution, heightScale);
+    }
+
+    // This is what Terrain::GetHeight() does for each point
+    float ReferenceHeight(vec2 position, vec3& normal) {
+        auto x = position.x / cellSideLength, z = position.y / cellSideLength;
+        auto cellX = std::min(int32_t(std::floor(x)), cellSideCount - 1);
+        auto cellZ = std::min(int32_t(std::floor(z)), cellSideCount - 1);
+        const auto& heightData = cells[cellX * cellSideCount + cellZ].heightData;
+
+        x = (x - float(cellX)) * float(tileResolution - 1);
+        z = (z - float(cellZ)) * float(tileResolution - 1);
+        auto xIndex = std::min(int32_t(std::floor(x)), tileResolution - 2);
+        auto zIndex = std::min(int32_t(std::floor(z)), tileResolution - 2);
+        auto u = x - float(xIndex), v = z - float(zIndex);
+
+        auto bottomLeft = vec3(0.0f, heightData[xIndex + zIndex * tileResolution] * heightScale, 0.0f);
+        auto topLeft = vec3(1.0f, heightData[xIndex + 1 + zIndex * tileResolution] * heightScale, 0.0f);
+        auto bottomRight = vec3(0.0f, heightData[xIndex + (zIndex + 1) * tileResolution] * heightScale, 1.0f);
+        auto topRight = vec3(1.0f, heightData[xIndex + 1 + (zIndex + 1) * tileResolution] * heightScale, 1.0f);
+
+        auto p1 = bottomLeft, p2 = u > v ? topLeft : topRight, p3 = u > v ? topRight : bottomRight;
+        auto det = (p2.z - p3.z) * (p1.x - p3.x) + (p3.x - p2.x) * (p1.z - p3.z);
+        auto l1 = ((p2.z - p3.z) * (u - p3.x) + (p3.x - p2.x) * (v - p3.z)) / det;
+        auto l2 = ((p3.z - p1.z) * (u - p3.x) + (p1.x - p3.x) * (v - p3.z)) / det;
+        auto l3 = 1.0f - l1 - l2;
+
+        vec3 forward, right;
+        if (u > v) {
+            forward = -glm::normalize(bottomLeft - topLeft);
+            right = glm::normalize(topRight - topLeft);
+        }
+        else {
+            forward = glm::normalize(topRight - bottomRight);
+            right = -glm::normalize(bottomLeft - bottomRight);
+        }
+        normal = -glm::normalize(glm::cross(forward, right));
+
+        return l1 * p1.y + l2 * p2.y + l3 * p3.y;
+    }
+
+    // This is what the mouse picking did before: a linear march with a binary search on the first crossing
+    bool ReferenceIntersect(const Volume::Ray& ray, float& distance) {
+        auto isUnderground = [&](float t) {
+            auto position = ray.Get(t);
+            auto terrainSideLength = cellSideLength * float(cellSideCount);
+            if (position.x < 0.0f || position.z < 0.0f || position.x > terrainSideLength ||
+                position.z > terrainSideLength)
+                return false;
+            vec3 normal;
+            return ReferenceHeight(vec2(position.x, position.z), normal) > position.y;
+        };
+
+        const float linearStepLength = 1.0f;
+        for (auto t = ray.tMin + linearStepLength; t < ray.tMax; t += linearStepLength) {
+            if (isUnderground(t - linearStepLength) || !isUnderground(t))
+                continue;
+
+            auto start = t - linearStepLength, finish = t;
+            for (int32_t i = 0; i < 10; i++) {
+                auto half = 0.5f * (start + finish);
+                if (isUnderground(half))
+                    finish = half;
+                else
+                    start = half;
+            }
+
+            distance = 0.5f * (start + finish);
+            return true;
+        }
+
+        return false;
+    }
+
+    std::vector<Terrain::TerrainStorageCell> cells;
+
+    const int32_t cellSideCount = 2 * 16;
+    const int32_t tileResolution = 8 * 8 + 1;
+    const float cellSideLength = 8.0f * 8.0f * 0.5f;
+    const float heightScale = 200.0f;
+
+    std::mt19937 rng { 42 };
+
+};
+
+TEST_P(TerrainBenchmark, HeightQueries) {
+
+    auto pointCount = GetParam();
+    auto terrainSideLength = cellSideLength * float(cellSideCount);
+
+    // Units spread over a part of the terrain, like an army moving across a map
+    std::uniform_real_distribution<float> position(0.25f * terrainSideLength, 0.5f * terrainSideLength);
+    std::vector<vec2> positions(pointCount);
+    for (auto& point : positions)
+        point = vec2(position(rng), position(rng));
+
+    std::vector<float> referenceHeights(pointCount);
+    std::vector<vec3> referenceNormals(pointCount);
+    auto referenceTime = Measure([&]() {
+        for (int32_t i = 0; i < pointCount; i++)
+            referenceHeights[i] = ReferenceHeight(positions[i], referenceNormals[i]);
+    });
+
+    auto query = GetQuery();
+
+    std::vector<float> heights;
+    std::vector<vec3> normals;
+    auto batchTime = Measure([&]() {
+        query.GetHeights(positions, heights, &normals);
+    });
+
+    // The second query doesn't need to allocate anymore
+    auto heightOnlyTime = Measure([&]() {
+        query.GetHeights(positions, heights);
+    });
+
+    ASSERT_EQ(heights.size(), positions.size());
+    ASSERT_EQ(normals.size(), positions.size());
+    for (int32_t i = 0; i < pointCount; i++) {
+        ASSERT_NEAR(heights[i], referenceHeights[i], 1e-3f);
+        ASSERT_NEAR(glm::dot(normals[i], referenceNormals[i]), 1.0f, 1e-4f);
+    }
+
+    // Points outside the terrain don't fail the query
+    std::vector<vec2> outsidePositions = { vec2(-1.0f), vec2(terrainSideLength + 1.0f), vec2(terrainSideLength) };
+    query.GetHeights(outsidePositions, heights, &normals);
+    ASSERT_EQ(heights[0], 0.0f);
+    ASSERT_EQ(heights[1], 0.0f);
+    ASSERT_TRUE(normals[0] == vec3(0.0f, 1.0f, 0.0f));
+
+    Report("Terrain height queries, per point", pointCount, referenceTime);
+    Report("Terrain height queries, batched with normals", pointCount, batchTime);
+    Report("Terrain height queries, batched", pointCount, heightOnlyTime);
+
+}
+
+TEST_P(TerrainBenchmark, RayCasts) {
+
+    auto rayCount = GetParam() / 10;
+    auto terrainSideLength = cellSideLength * float(cellSideCount);
+
+    // Mouse picks from cameras above the terrain at a shallow angle, which is the hard case for the pyramid
+    std::uniform_real_distribution<float> position(0.1f * terrainSideLength, 0.9f * terrainSideLength);
+    std::uniform_real_distribution<float> height(1.1f * heightScale, 1.5f * heightScale);
+    std::uniform_real_distribution<float> angle(0.0f, 2.0f * 3.14159265f);
+    std::uniform_real_distribution<float> slope(-0.6f, -0.1f);
+
+    std::vector<Volume::Ray> rays(rayCount);
+    for (auto& ray : rays) {
+        auto direction = angle(rng);
+        auto origin = vec3(position(rng), height(rng), position(rng));
+        ray = Volume::Ray(origin, glm::normalize(vec3(std::cos(direction), slope(rng), std::sin(direction))),
+            0.0f, 2048.0f);
+    }
+
+    std::vector<float> referenceDistances(rayCount);
+    std::vector<bool> referenceHits(rayCount);
+    auto referenceTime = Measure([&]() {
+        for (int32_t i = 0; i < rayCount; i++)
+            referenceHits[i] = ReferenceIntersect(rays[i], referenceDistances[i]);
+    });
+
+    auto query = GetQuery();
+
+    std::vector<Volume::RayResult<Terrain::TerrainStorageCell*>> results(rayCount);
+    auto pyramidTime = Measure([&]() {
+        for (int32_t i = 0; i < rayCount; i++)
+            results[i] = query.Intersect(rays[i]);
+    });
+
+    // Without the pyramid every quad along the ray is tested
+    for (auto& cell : cells)
+        cell.heightBounds.clear();
+
+    std::vector<Volume::RayResult<Terrain::TerrainStorageCell*>> quadResults(rayCount);
+    auto quadTime = Measure([&]() {
+        for (int32_t i = 0; i < rayCount; i++)
+            quadResults[i] = query.Intersect(rays[i]);
+    });
+
+    int32_t hitCount = 0;
+    for (int32_t i = 0; i < rayCount; i++) {
+        const auto& result = results[i];
+        ASSERT_EQ(result.valid, quadResults[i].valid);
+
+        // The march can step over thin features, but never finds a hit in front of the exact one
+        if (referenceHits[i])
+            ASSERT_TRUE(result.valid);
+        if (!result.valid)
+            continue;
+
+        ASSERT_NEAR(result.hitDistance, quadResults[i].hitDistance, 1e-3f);
+        if (referenceHits[i])
+            ASSERT_LE(result.hitDistance, referenceDistances[i] + 0.01f);
+
+        auto hit = rays[i].Get(result.hitDistance);
+        vec3 normal;
+        ASSERT_NEAR(hit.y, ReferenceHeight(vec2(hit.x, hit.z), normal), 0.05f);
+        ASSERT_NE(result.data, nullptr);
+        hitCount++;
+    }
+
+    auto suffix = " of " + std::to_string(rayCount) + " rays (" + std::to_string(hitCount) + " hits)";
+    Report("Terrain ray march with binary search" + suffix, rayCount, referenceTime);
+    Report("Terrain ray cast with min/max pyramid" + suffix, rayCount, pyramidTime);
+    Report("Terrain ray cast without min/max pyramid" + suffix, rayCount, quadTime);
+
+}
+
+INSTANTIATE_TEST_SUITE_P(TerrainBenchmarkSuite, TerrainBenchmark, testing::ValuesIn(BenchmarkSizes({10000, 100000})));
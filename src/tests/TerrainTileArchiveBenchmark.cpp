@@ -0,0 +1,211 @@
+#include "Benchmark.h"
+#include "terrain/TerrainTileArchive.h"
+#include "Log.h"
+
+#include <random>
+#include <vector>
+#include <cstring>
+#include <cmath>
+#include <fstream>
+#include <filesystem>
+
+using namespace Atlas;
+
+class TerrainTileArchiveBenchmark : public Benchmark {
+
+protected:
+    struct TileData {
+        std::vector<uint16_t> heightField;
+        std::vector<uint8_t> normalMap;
+        std::vector<uint8_t> splatMap;
+    };
+
+    void TearDown() override {
+        std::filesystem::remove(filename);
+        std::filesystem::remove(filename + ".tmp");
+    }
+
+    // Every other tile is flat with a single material, the others are noise which doesn't compress
+    void GenerateTile(int32_t x, int32_t y, int32_t LoD, TileData& data) {
+        // Higher LoDs have smaller normal maps, like the ones of a baked terrain
+        auto normalResolution = (tileResolution - 1) * (1 << (LoDCount - LoD - 1)) + 3;
+        auto texelCount = size_t(tileResolution * tileResolution);
+        auto normalTexelCount = size_t(normalResolution * normalResolution);
+
+        data.heightField.resize(texelCount);
+        data.normalMap.resize(normalTexelCount * 4);
+        data.splatMap.resize(texelCount);
+
+        if ((x + y + LoD) % 2 == 0) {
+            std::fill(data.heightField.begin(), data.heightField.end(), uint16_t(x * 31 + y * 17 + LoD));
+            std::fill(data.normalMap.begin(), data.normalMap.end(), uint8_t(127));
+            std::fill(data.splatMap.begin(), data.splatMap.end(), uint8_t(LoD));
+        }
+        else {
+            std::mt19937 rng(uint32_t(x * 7919 + y * 104729 + LoD));
+            for (auto& height : data.heightField)
+                height = uint16_t(rng());
+            for (auto& normal : data.normalMap)
+                normal = uint8_t(rng());
+            for (auto& splat : data.splatMap)
+                splat = uint8_t(rng());
+        }
+    }
+
+    bool Write(bool compress, int32_t missingTileIdx = -1) {
+        TileData data;
+        int32_t tileIdx = 0;
+        return Terrain::TerrainTileArchive::Write(filename, rootNodeSideCount, LoDCount, tileResolution,
+            [&](int32_t x, int32_t y, int32_t LoD, Terrain::TerrainTileArchive::Tile& tile) {
+                if (tileIdx++ == missingTileIdx)
+                    return false;
+
+                GenerateTile(x, y, LoD, data);
+                tile.resolution = tileResolution;
+                tile.normalResolution = int32_t(std::sqrt(data.normalMap.size() / 4));
+                tile.heightField = reinterpret_cast<const uint8_t*>(data.heightField.data());
+                tile.normalMap = data.normalMap.data();
+                tile.splatMap = data.splatMap.data();
+                return true;
+            }, compress);
+    }
+
+    void ExpectTile(const Terrain::TerrainTileArchive& archive, int32_t x, int32_t y, int32_t LoD) {
+        TileData data;
+        GenerateTile(x, y, LoD, data);
+
+        Terrain::TerrainTileArchive::Tile tile;
+        ASSERT_TRUE(archive.GetTile(x, y, LoD, tile));
+        ASSERT_EQ(tile.resolution, tileResolution);
+        ASSERT_EQ(size_t(tile.normalResolution * tile.normalResolution * 4), data.normalMap.size());
+        ASSERT_EQ(std::memcmp(tile.heightField, data.heightField.data(), data.heightField.size() * 2), 0);
+        ASSERT_EQ(std::memcmp(tile.normalMap, data.normalMap.data(), data.normalMap.size()), 0);
+        ASSERT_EQ(std::memcmp(tile.splatMap, data.splatMap.data(), data.splatMap.size()), 0);
+    }
+
+    std::vector<char> ReadFile() {
+        std::ifstream stream(filename, std::ios::in | std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    }
+
+    void WriteFile(const std::vector<char>& content) {
+        std::ofstream stream(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+        stream.write(content.data(), std::streamsize(content.size()));
+    }
+
+    std::string filename = testing::TempDir() + "terrain_tile_archive.aetiles";
+
+    int32_t LoDCount = GetParam();
+
+    // Same layout as a terrain with 2x2 root nodes and a patch size factor of 4
+    const int32_t rootNodeSideCount = 2;
+    const int32_t tileResolution = 33;
+
+    // The header is followed by the table, the first entry starts with the offset of the first tile
+    const size_t headerSize = 32;
+    // Within an entry the normal resolution follows the offset, size and compression
+    const size_t normalResolutionOffset = 16;
+
+};
+
+TEST_P(TerrainTileArchiveBenchmark, RoundTrip) {
+
+    size_t fileSizes[2];
+    for (auto compress : { false, true }) {
+        double writeTime = 0.0, readTime = 0.0;
+        int32_t tileCount = 0;
+        {
+            writeTime = Measure([&]() { ASSERT_TRUE(Write(compress)); });
+            ASSERT_FALSE(std::filesystem::exists(filename + ".tmp"));
+
+            Terrain::TerrainTileArchive archive(filename);
+            ASSERT_TRUE(archive.IsValid());
+            ASSERT_TRUE(archive.IsCompatible(rootNodeSideCount, LoDCount, tileResolution));
+            ASSERT_FALSE(archive.IsCompatible(rootNodeSideCount, LoDCount + 1, tileResolution));
+
+            readTime = Measure([&]() {
+                for (int32_t LoD = 0; LoD < LoDCount; LoD++) {
+                    auto sideCount = rootNodeSideCount << LoD;
+                    for (int32_t x = 0; x < sideCount; x++) {
+                        for (int32_t y = 0; y < sideCount; y++, tileCount++)
+                            ExpectTile(archive, x, y, LoD);
+                    }
+                }
+            });
+
+            // The last tile of the highest LoD is the last entry of the table
+            auto sideCount = rootNodeSideCount << (LoDCount - 1);
+            ExpectTile(archive, sideCount - 1, sideCount - 1, LoDCount - 1);
+
+            Terrain::TerrainTileArchive::Tile tile;
+            ASSERT_FALSE(archive.GetTile(sideCount, 0, LoDCount - 1, tile));
+            ASSERT_FALSE(archive.GetTile(0, 0, LoDCount, tile));
+            ASSERT_FALSE(archive.GetTile(-1, 0, 0, tile));
+        }
+
+        fileSizes[compress ? 1 : 0] = std::filesystem::file_size(filename);
+
+        auto suffix = compress ? " (compressed)" : " (uncompressed)";
+        Report("Tile archive write" + std::string(suffix), tileCount, writeTime);
+        Report("Tile archive read" + std::string(suffix), tileCount, readTime);
+    }
+
+    // Half of the tiles are flat
+    ASSERT_LT(fileSizes[1], fileSizes[0] * 3 / 4);
+
+}
+
+TEST_P(TerrainTileArchiveBenchmark, RejectsDamagedArchives) {
+
+    ASSERT_TRUE(Write(true));
+    auto content = ReadFile();
+
+    // Cut off within the table
+    auto truncated = content;
+    truncated.resize(headerSize + 10);
+    WriteFile(truncated);
+    ASSERT_FALSE(Terrain::TerrainTileArchive(filename).IsValid());
+
+    // Cut off within the last tile
+    truncated = content;
+    truncated.resize(content.size() - 1);
+    WriteFile(truncated);
+    ASSERT_FALSE(Terrain::TerrainTileArchive(filename).IsValid());
+
+    // A tile offset behind the end of the file
+    auto corrupted = content;
+    std::memset(corrupted.data() + headerSize, 0xFF, sizeof(uint64_t));
+    WriteFile(corrupted);
+    ASSERT_FALSE(Terrain::TerrainTileArchive(filename).IsValid());
+
+    // A compressed tile with a normal map larger than any terrain could bake
+    corrupted = content;
+    auto normalResolution = INT32_MAX;
+    std::memcpy(corrupted.data() + headerSize + normalResolutionOffset, &normalResolution, sizeof(int32_t));
+    WriteFile(corrupted);
+    ASSERT_FALSE(Terrain::TerrainTileArchive(filename).IsValid());
+
+    // A damaged header
+    corrupted = content;
+    corrupted[0] = 0;
+    WriteFile(corrupted);
+    ASSERT_FALSE(Terrain::TerrainTileArchive(filename).IsValid());
+
+    WriteFile(content);
+    ASSERT_TRUE(Terrain::TerrainTileArchive(filename).IsValid());
+
+}
+
+TEST_P(TerrainTileArchiveBenchmark, KeepsArchiveOnFailedWrite) {
+
+    ASSERT_TRUE(Write(false));
+    auto content = ReadFile();
+
+    // A missing tile aborts the write, which neither touches the archive nor leaves a temporary file
+    ASSERT_FALSE(Write(true, 5));
+    ASSERT_FALSE(std::filesystem::exists(filename + ".tmp"));
+    ASSERT_TRUE(ReadFile() == content);
+
+}
+
+INSTANTIATE_TEST_SUITE_P(TerrainTileArchiveBenchmarkSuite, TerrainTileArchiveBenchmark, testing::Values(3, 5));
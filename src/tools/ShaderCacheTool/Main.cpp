@@ -0,0 +1,32 @@
+#include "graphics/ShaderCompiler.h"
+#include "loader/AssetLoader.h"
+#include "loader/ShaderLoader.h"
+#include "jobsystem/JobSystem.h"
+#include "Log.h"
+
+#include <string>
+
+// Compiles all shader variants which were recorded by previous runs of the engine into the
+// shader cache archive. Doesn't need a graphics device, so it can run on build machines.
+int main(int argc, char* argv[]) {
+
+    if (argc < 3) {
+        Atlas::Log::Error("Usage: AtlasShaderCacheTool <asset directory> <shader directory>");
+        return 1;
+    }
+
+    Atlas::Loader::AssetLoader::SetAssetDirectory(argv[1]);
+    Atlas::Loader::ShaderLoader::SetSourceDirectory(argv[2]);
+
+    Atlas::JobSystem::Init(Atlas::JobSystemConfig());
+    Atlas::Graphics::ShaderCompiler::Init();
+
+    Atlas::Graphics::ShaderCompiler::WarmUpCache();
+
+    // Writes the archive with the new binaries
+    Atlas::Graphics::ShaderCompiler::Shutdown();
+    Atlas::JobSystem::Shutdown();
+
+    return 0;
+
+}
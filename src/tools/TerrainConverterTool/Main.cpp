@@ -0,0 +1,35 @@
+#include "loader/TerrainLoader.h"
+#include "loader/AssetLoader.h"
+#include "Log.h"
+
+#include <string>
+
+// Converts terrain files which store their cells after the header into tile archives.
+// Doesn't need a graphics device, so it can run on build machines.
+int main(int argc, char* argv[]) {
+
+    if (argc < 3) {
+        Atlas::Log::Error("Usage: AtlasTerrainConverterTool <asset directory> <terrain file>... [--no-compression]");
+        return 1;
+    }
+
+    Atlas::Loader::AssetLoader::SetAssetDirectory(argv[1]);
+
+    auto compress = true;
+    for (int32_t i = 2; i < argc; i++) {
+        if (std::string(argv[i]) == "--no-compression")
+            compress = false;
+    }
+
+    auto success = true;
+    for (int32_t i = 2; i < argc; i++) {
+        std::string filename = argv[i];
+        if (filename == "--no-compression")
+            continue;
+
+        success &= Atlas::Loader::TerrainLoader::ConvertTerrain(filename, compress);
+    }
+
+    return success ? 0 : 1;
+
+}